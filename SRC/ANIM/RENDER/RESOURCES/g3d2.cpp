@@ -0,0 +1,695 @@
+/***************************************************************
+ * Copyright (C) 2020
+ *    Computer Graphics Support Group of 30 Phys-Math Gymnasium
+ ***************************************************************/
+
+/* FILE NAME   : g3d2.cpp
+ * PURPOSE     : G3D2 binary mesh format function file.
+ * PROGRAMMER  : Dmitriy Vlasov.
+ * LAST UPDATE : 19.10.2020
+ * NOTE        : Namespace 'digl'.
+ *
+ * No part of this file may be changed without agreement of
+ * Computer Graphics Support Group of 30 Phys-Math Gymnasium.
+ */
+
+#include "g3d2.h"
+#include "obj.h"
+
+#include <cstdio>
+#include <cstring>
+
+using namespace digl;
+
+/* Align offset up to sections alignment function.
+ * ARGUMENTS:
+ *   - offset:
+ *       size_t Offset;
+ * RETURNS:
+ *   (size_t) aligned offset.
+ */
+static size_t AlignUp( size_t Offset )
+{
+  return (Offset + g3d2::Align - 1) & ~(size_t)(g3d2::Align - 1);
+} /* End of 'AlignUp' function */
+
+/* Get directory part of file name function.
+ * ARGUMENTS:
+ *   - file name:
+ *       const std::string &FileName;
+ * RETURNS:
+ *   (std::string) directory with trailing separator (or empty string).
+ */
+static std::string DirOf( const std::string &FileName )
+{
+  size_t pos = FileName.find_last_of("\\/");
+
+  return pos == std::string::npos ? std::string() : FileName.substr(0, pos + 1);
+} /* End of 'DirOf' function */
+
+/* Check if path is absolute function.
+ * ARGUMENTS:
+ *   - path:
+ *       const std::string &Path;
+ * RETURNS:
+ *   (BOOL) TRUE if path starts from root or drive, FALSE otherwise.
+ */
+static BOOL IsAbsolutePath( const std::string &Path )
+{
+  return !Path.empty() && (Path[0] == '\\' || Path[0] == '/' || Path.find(':') != std::string::npos);
+} /* End of 'IsAbsolutePath' function */
+
+/* Rebase relative path to other directory function.
+ * ARGUMENTS:
+ *   - path relative to source directory:
+ *       const std::string &Path;
+ *   - source and destination directories (with trailing separator or empty):
+ *       const std::string &FromDir, &ToDir;
+ * RETURNS:
+ *   (std::string) same file path relative to destination directory.
+ */
+static std::string RebasePath( const std::string &Path, const std::string &FromDir, const std::string &ToDir )
+{
+  if (IsAbsolutePath(Path) || FromDir == ToDir)
+    return Path;
+
+  /* Split to directory names (separators are unified) */
+  auto Split = []( const std::string &S ) -> std::vector<std::string>
+  {
+    std::vector<std::string> Res;
+    size_t start = 0;
+
+    for (size_t i = 0; i <= S.size(); i++)
+      if (i == S.size() || S[i] == '\\' || S[i] == '/')
+      {
+        std::string Name = S.substr(start, i - start);
+
+        if (Name == ".." && !Res.empty() && Res.back() != "..")
+          Res.pop_back();
+        else if (!Name.empty() && Name != ".")
+          Res.push_back(Name);
+        start = i + 1;
+      }
+    return Res;
+  };
+  std::vector<std::string>
+    File = Split(FromDir + Path),
+    To = Split(ToDir);
+  size_t common = 0;
+
+  if (IsAbsolutePath(FromDir) != IsAbsolutePath(ToDir))
+    return FromDir + Path;
+  while (common < To.size() && common + 1 < File.size() && _stricmp(To[common].c_str(), File[common].c_str()) == 0)
+    common++;
+
+  std::string Res;
+  for (size_t i = common; i < To.size(); i++)
+    Res += "../";
+  for (size_t i = common; i < File.size(); i++)
+    Res += File[i] + (i + 1 < File.size() ? "/" : "");
+  return Res;
+} /* End of 'RebasePath' function */
+
+/* Read whole file to memory function.
+ * ARGUMENTS:
+ *   - file name:
+ *       const std::string &FileName;
+ *   - memory to fill:
+ *       std::vector<BYTE> &Mem;
+ * RETURNS:
+ *   (BOOL) TRUE if success, FALSE otherwise.
+ */
+static BOOL LoadFileMem( const std::string &FileName, std::vector<BYTE> &Mem )
+{
+  FILE *F;
+  LONG flen;
+
+  if ((F = fopen(FileName.c_str(), "rb")) == nullptr)
+    return FALSE;
+  fseek(F, 0, SEEK_END);
+  flen = ftell(F);
+  rewind(F);
+  if (flen <= 0)
+  {
+    fclose(F);
+    return FALSE;
+  }
+  Mem.resize(flen);
+  BOOL IsOk = fread(Mem.data(), 1, flen, F) == (size_t)flen;
+  fclose(F);
+  return IsOk;
+} /* End of 'LoadFileMem' function */
+
+/* Load G3D2 file to model in upload format function.
+ * ARGUMENTS:
+ *   - file name:
+ *       const std::string &FileName;
+ *   - model to fill:
+ *       packed_model &Mdl;
+ *   - transformation applied to vertices while decoding:
+ *       const matr &LoadTransform;
+ * RETURNS:
+ *   (BOOL) TRUE if success, FALSE otherwise.
+ */
+BOOL digl::g3d2::Load( const std::string &FileName, packed_model &Mdl, const matr &LoadTransform )
+{
+  std::vector<BYTE> Mem;
+
+  if (!LoadFileMem(FileName, Mem) || Mem.size() < sizeof(header))
+    return FALSE;
+
+  const BYTE *Base = Mem.data();
+  const header *Hdr = (const header *)Base;
+
+  if (Hdr->Sign != Tag("G3D2") || Hdr->Version != Version ||
+      sizeof(header) + (size_t)Hdr->NumOfChunks * sizeof(chunk) > Mem.size())
+    return FALSE;
+
+  /* Find chunks in table of contents */
+  const chunk *Toc = (const chunk *)(Base + sizeof(header)),
+    *Prm = nullptr, *Vrt = nullptr, *Idx = nullptr, *Mtl = nullptr, *Tex = nullptr, *Str = nullptr, *Lod = nullptr;
+  for (DWORD c = 0; c < Hdr->NumOfChunks; c++)
+  {
+    const chunk &Ch = Toc[c];
+
+    if (Ch.Offset % Align != 0 || (size_t)Ch.Offset + Ch.Size > Mem.size())
+      return FALSE;
+    if (Ch.Tag == Tag("PRIM"))
+      Prm = &Ch;
+    else if (Ch.Tag == Tag("VERT"))
+      Vrt = &Ch;
+    else if (Ch.Tag == Tag("INDX"))
+      Idx = &Ch;
+    else if (Ch.Tag == Tag("MTRL"))
+      Mtl = &Ch;
+    else if (Ch.Tag == Tag("TEXR"))
+      Tex = &Ch;
+    else if (Ch.Tag == Tag("STRS"))
+      Str = &Ch;
+    else if (Ch.Tag == Tag("LODS"))
+      Lod = &Ch;
+  }
+  if (Prm == nullptr || Vrt == nullptr || Idx == nullptr ||
+      (size_t)Prm->Count * sizeof(prim) > Prm->Size ||
+      (Mtl != nullptr && (size_t)Mtl->Count * sizeof(material) > Mtl->Size) ||
+      (Tex != nullptr && (size_t)Tex->Count * sizeof(texture) > Tex->Size) ||
+      (Lod != nullptr && (size_t)Lod->Count * sizeof(lod) > Lod->Size))
+    return FALSE;
+
+  /* Level of detail errors are scaled as longest transformed axis */
+  FLT ErrorScale = mth::Max(mth::Max(!LoadTransform.TransformVector(vec3(1, 0, 0)),
+                                     !LoadTransform.TransformVector(vec3(0, 1, 0))),
+                            !LoadTransform.TransformVector(vec3(0, 0, 1)));
+
+  /* String table access */
+  auto GetStr = [&]( DWORD Offset ) -> std::string
+  {
+    if (Str == nullptr || Offset >= Str->Size)
+      return std::string();
+
+    const CHAR *S = (const CHAR *)(Base + Str->Offset + Offset);
+    return std::string(S, strnlen(S, Str->Size - Offset));
+  };
+
+  /* Decode prims */
+  const prim *Prims = (const prim *)(Base + Prm->Offset);
+  Mdl.Prims.resize(Prm->Count);
+  for (DWORD p = 0; p < Prm->Count; p++)
+  {
+    const prim &P = Prims[p];
+    packed_model::prim &Out = Mdl.Prims[p];
+
+    if ((P.IndexSize != 2 && P.IndexSize != 4) || P.IOffset % P.IndexSize != 0 ||
+        (size_t)P.VOffset + (size_t)P.NumOfV * sizeof(vertex) > Vrt->Size ||
+        (size_t)P.IOffset + (size_t)P.NumOfI * P.IndexSize > Idx->Size ||
+        (P.NumOfLods != 0 && (Lod == nullptr || (size_t)P.FirstLod + P.NumOfLods > Lod->Count)))
+      return FALSE;
+
+    Out.MtlNo = P.MtlNo;
+    Out.IndexSize = P.IndexSize;
+
+    /* Indices keep file width (restart index is largest value), file with index out of prim vertices is rejected */
+    stock<digl::vertex::packed> &Vertex = P.IndexSize == 2 ? Out.Topo16.Vertex : Out.Topo32.Vertex;
+    stock<topology::lod> &Lods = P.IndexSize == 2 ? Out.Topo16.Lods : Out.Topo32.Lods;
+    prim_type Type = P.PrimType == (DWORD)prim_type::STRIP ? prim_type::STRIP : prim_type::TRIMESH;
+
+    if (P.IndexSize == 2)
+    {
+      const WORD *I = (const WORD *)(Base + Idx->Offset + P.IOffset);
+
+      for (DWORD i = 0; i < P.NumOfI; i++)
+        if (I[i] != 0xFFFF && I[i] >= P.NumOfV)
+          return FALSE;
+      Out.Topo16.PrimType = Type;
+      Out.Topo16.Index.assign(I, I + P.NumOfI);
+    }
+    else
+    {
+      const UINT *I = (const UINT *)(Base + Idx->Offset + P.IOffset);
+
+      for (DWORD i = 0; i < P.NumOfI; i++)
+        if (I[i] != 0xFFFFFFFF && I[i] >= P.NumOfV)
+          return FALSE;
+      Out.Topo32.PrimType = Type;
+      Out.Topo32.Index.assign(I, I + P.NumOfI);
+    }
+
+    /* Dequantize and transform vertices straight to upload format, dequantization is folded into transformation */
+    const vertex *V = (const vertex *)(Base + Vrt->Offset + P.VOffset);
+    matr M =
+      matr::Scale(vec3((P.Max[0] - P.Min[0]) / 65535.0f, (P.Max[1] - P.Min[1]) / 65535.0f, (P.Max[2] - P.Min[2]) / 65535.0f)) *
+      matr::Translate(vec3(P.Min[0], P.Min[1], P.Min[2])) * LoadTransform;
+
+    Vertex.resize(P.NumOfV);
+    for (DWORD i = 0; i < P.NumOfV; i++)
+    {
+      digl::vertex::packed &D = Vertex[i];
+
+      D.P = M.TransformPoint(vec3(V[i].P[0], V[i].P[1], V[i].P[2]));
+      D.T[0] = V[i].T[0];
+      D.T[1] = V[i].T[1];
+      D.N = mth::PackSnorm1010102(LoadTransform.TransformVector(mth::OctDecode(V[i].N)));
+    }
+
+    /* Levels of detail */
+    Lods.clear();
+    for (DWORD l = 0; l < P.NumOfLods; l++)
+    {
+      const lod &L = ((const lod *)(Base + Lod->Offset))[P.FirstLod + l];
+
+      if (L.Start > P.NumOfI || L.Count > P.NumOfI - L.Start)
+        return FALSE;
+      Lods << topology::lod {(INT)L.Start, (INT)L.Count, L.Error * ErrorScale};
+    }
+  }
+
+  /* Materials */
+  Mdl.Materials.clear();
+  if (Mtl != nullptr)
+  {
+    const material *M = (const material *)(Base + Mtl->Offset);
+
+    Mdl.Materials.resize(Mtl->Count);
+    for (DWORD m = 0; m < Mtl->Count; m++)
+    {
+      model::material &Out = Mdl.Materials[m];
+
+      Out.Name = GetStr(M[m].Name);
+      Out.Ka = vec3(M[m].Ka[0], M[m].Ka[1], M[m].Ka[2]);
+      Out.Kd = vec3(M[m].Kd[0], M[m].Kd[1], M[m].Kd[2]);
+      Out.Ks = vec3(M[m].Ks[0], M[m].Ks[1], M[m].Ks[2]);
+      Out.Ph = M[m].Ph;
+      Out.Trans = M[m].Trans;
+      for (INT k = 0; k < 8; k++)
+        Out.Tex[k] = M[m].Tex[k] < 0 || Tex == nullptr || (DWORD)M[m].Tex[k] >= Tex->Count ? -1 : M[m].Tex[k];
+    }
+  }
+
+  /* External texture references (paths are relative to model file) */
+  Mdl.Textures.clear();
+  if (Tex != nullptr)
+  {
+    const texture *T = (const texture *)(Base + Tex->Offset);
+    std::string Dir = DirOf(FileName);
+
+    Mdl.Textures.resize(Tex->Count);
+    for (DWORD t = 0; t < Tex->Count; t++)
+    {
+      std::string Path = GetStr(T[t].Path);
+
+      Mdl.Textures[t].Name = GetStr(T[t].Name);
+      Mdl.Textures[t].Path = IsAbsolutePath(Path) ? Path : Dir + Path;
+      Mdl.Textures[t].W = T[t].W;
+      Mdl.Textures[t].H = T[t].H;
+    }
+  }
+  return TRUE;
+} /* End of 'digl::g3d2::Load' function */
+
+/* Save model to G3D2 file function.
+ * ARGUMENTS:
+ *   - file name:
+ *       const std::string &FileName;
+ *   - model to save:
+ *       const model &Mdl;
+ * RETURNS:
+ *   (BOOL) TRUE if success, FALSE otherwise.
+ */
+BOOL digl::g3d2::Save( const std::string &FileName, const model &Mdl )
+{
+  std::vector<prim> Prims(Mdl.Prims.size());
+  std::vector<vertex> Verts;
+  std::vector<BYTE> Inds, Strs;
+  std::vector<material> Mtls(Mdl.Materials.size());
+  std::vector<texture> Texs(Mdl.Textures.size());
+  std::vector<lod> Lods;
+
+  /* Add string to table */
+  auto AddStr = [&]( const std::string &S ) -> DWORD
+  {
+    DWORD Offset = (DWORD)Strs.size();
+
+    Strs.insert(Strs.end(), S.begin(), S.end());
+    Strs.push_back(0);
+    return Offset;
+  };
+
+  /* Encode prims */
+  for (size_t p = 0; p < Mdl.Prims.size(); p++)
+  {
+    const model::prim &Pr = Mdl.Prims[p];
+    prim &P = Prims[p];
+    vec3 Min(0), Max(0);
+
+    memset(&P, 0, sizeof(P));
+    P.NumOfV = (DWORD)Pr.Topo.Vertex.size();
+    P.NumOfI = (DWORD)Pr.Topo.Index.size();
+    P.MtlNo = Pr.MtlNo;
+    P.PrimType = (DWORD)Pr.Topo.PrimType;
+    /* 0xFFFF is reserved for primitive restart */
+    P.IndexSize = P.NumOfV < 0xFFFF ? 2 : 4;
+
+    /* Bound box */
+    if (P.NumOfV > 0)
+    {
+      Min = Max = Pr.Topo.Vertex[0].P;
+      for (auto &V : Pr.Topo.Vertex)
+        Min = vec3::Min(Min, V.P), Max = vec3::Max(Max, V.P);
+    }
+    for (INT k = 0; k < 3; k++)
+      P.Min[k] = Min[k], P.Max[k] = Max[k];
+
+    /* Levels of detail */
+    P.FirstLod = (DWORD)Lods.size();
+    P.NumOfLods = (DWORD)Pr.Topo.Lods.size();
+    for (auto &L : Pr.Topo.Lods)
+      Lods.push_back({(DWORD)L.Start, (DWORD)L.Count, L.Error, 0});
+
+    /* Vertices */
+    P.VOffset = (DWORD)(Verts.size() * sizeof(vertex));
+    Verts.reserve(Verts.size() + P.NumOfV);
+    for (auto &V : Pr.Topo.Vertex)
+    {
+      vertex Q;
+
+      for (INT k = 0; k < 3; k++)
+        Q.P[k] = mth::QuantizeUnorm16(V.P[k], Min[k], Max[k]);
+      Q.P[3] = 0;
+      mth::OctEncode(vec3(V.N).Normalizing(), Q.N);
+      Q.T[0] = mth::FloatToHalf(V.T[0]);
+      Q.T[1] = mth::FloatToHalf(V.T[1]);
+      Verts.push_back(Q);
+    }
+
+    /* Indices */
+    Inds.resize((Inds.size() + 3) & ~(size_t)3);
+    P.IOffset = (DWORD)Inds.size();
+    Inds.resize(Inds.size() + (size_t)P.NumOfI * P.IndexSize);
+    for (DWORD i = 0; i < P.NumOfI; i++)
+    {
+      INT I = Pr.Topo.Index[i];
+
+      if (P.IndexSize == 2)
+      {
+        WORD W = I < 0 ? 0xFFFF : (WORD)I;
+        memcpy(&Inds[P.IOffset + i * 2], &W, 2);
+      }
+      else
+        memcpy(&Inds[P.IOffset + i * 4], &I, 4);
+    }
+  }
+
+  /* Materials */
+  for (size_t m = 0; m < Mdl.Materials.size(); m++)
+  {
+    const model::material &M = Mdl.Materials[m];
+
+    Mtls[m].Name = AddStr(M.Name);
+    for (INT k = 0; k < 3; k++)
+      Mtls[m].Ka[k] = M.Ka[k], Mtls[m].Kd[k] = M.Kd[k], Mtls[m].Ks[k] = M.Ks[k];
+    Mtls[m].Ph = M.Ph;
+    Mtls[m].Trans = M.Trans;
+    for (INT k = 0; k < 8; k++)
+      Mtls[m].Tex[k] = M.Tex[k];
+  }
+
+  /* Textures */
+  for (size_t t = 0; t < Mdl.Textures.size(); t++)
+  {
+    Texs[t].Name = AddStr(Mdl.Textures[t].Name);
+    Texs[t].Path = AddStr(Mdl.Textures[t].Path);
+    Texs[t].W = Mdl.Textures[t].W;
+    Texs[t].H = Mdl.Textures[t].H;
+  }
+
+  /* Build table of contents */
+  struct
+  {
+    const CHAR *Tag;
+    const VOID *Data;
+    size_t Count, Size;
+  } Sections[] =
+  {
+    {"PRIM", Prims.data(), Prims.size(), Prims.size() * sizeof(prim)},
+    {"VERT", Verts.data(), Verts.size(), Verts.size() * sizeof(vertex)},
+    {"INDX", Inds.data(), Inds.size(), Inds.size()},
+    {"MTRL", Mtls.data(), Mtls.size(), Mtls.size() * sizeof(material)},
+    {"TEXR", Texs.data(), Texs.size(), Texs.size() * sizeof(texture)},
+    {"STRS", Strs.data(), Strs.size(), Strs.size()},
+    {"LODS", Lods.data(), Lods.size(), Lods.size() * sizeof(lod)},
+  };
+  const DWORD NumOfChunks = sizeof(Sections) / sizeof(Sections[0]);
+  std::vector<BYTE> Out;
+  header Hdr = {Tag("G3D2"), Version, NumOfChunks, 0};
+  chunk Toc[NumOfChunks];
+  size_t Offset = AlignUp(sizeof(header) + sizeof(Toc));
+
+  for (DWORD c = 0; c < NumOfChunks; c++)
+  {
+    Toc[c].Tag = Tag(Sections[c].Tag);
+    Toc[c].Count = (DWORD)Sections[c].Count;
+    Toc[c].Offset = (DWORD)Offset;
+    Toc[c].Size = (DWORD)Sections[c].Size;
+    Offset = AlignUp(Offset + Sections[c].Size);
+  }
+  if (Offset > 0xFFFFFFFF)
+    return FALSE;
+
+  /* Assemble file image */
+  Out.resize(Offset, 0);
+  memcpy(Out.data(), &Hdr, sizeof(Hdr));
+  memcpy(Out.data() + sizeof(Hdr), Toc, sizeof(Toc));
+  for (DWORD c = 0; c < NumOfChunks; c++)
+    if (Sections[c].Size != 0)
+      memcpy(Out.data() + Toc[c].Offset, Sections[c].Data, Sections[c].Size);
+
+  FILE *F;
+  if ((F = fopen(FileName.c_str(), "wb")) == nullptr)
+    return FALSE;
+  BOOL IsOk = fwrite(Out.data(), 1, Out.size(), F) == Out.size();
+  fclose(F);
+  return IsOk;
+} /* End of 'digl::g3d2::Save' function */
+
+/* Read G3DM file to model function.
+ * ARGUMENTS:
+ *   - file name:
+ *       const std::string &FileName;
+ *   - model to fill:
+ *       model &Mdl;
+ * RETURNS:
+ *   (BOOL) TRUE if success, FALSE otherwise.
+ */
+BOOL digl::g3d2::ReadG3DM( const std::string &FileName, model &Mdl )
+{
+  std::vector<BYTE> Mem;
+
+  if (!LoadFileMem(FileName, Mem) || Mem.size() < 16 || *(DWORD *)Mem.data() != Tag("G3DM"))
+    return FALSE;
+
+  const BYTE *ptr = Mem.data() + 4, *end = Mem.data() + Mem.size();
+  INT NoofP = ((INT *)ptr)[0], NoofM = ((INT *)ptr)[1], NoofT = ((INT *)ptr)[2];
+  ptr += 12;
+
+  if (NoofP < 0 || NoofM < 0 || NoofT < 0)
+    return FALSE;
+
+  /* Prims */
+  Mdl.Prims.resize(NoofP);
+  for (INT p = 0; p < NoofP; p++)
+  {
+    if (end - ptr < 12)
+      return FALSE;
+
+    INT NoofV = ((INT *)ptr)[0], NoofI = ((INT *)ptr)[1];
+    model::prim &Pr = Mdl.Prims[p];
+
+    Pr.MtlNo = ((INT *)ptr)[2];
+    ptr += 12;
+    if (NoofV < 0 || NoofI < 0 ||
+        (size_t)(end - ptr) < sizeof(digl::vertex::std) * NoofV + sizeof(INT) * NoofI)
+      return FALSE;
+    Pr.Topo.PrimType = prim_type::TRIMESH;
+    Pr.Topo.Vertex.resize(NoofV);
+    memcpy(Pr.Topo.Vertex.data(), ptr, sizeof(digl::vertex::std) * NoofV);
+    ptr += sizeof(digl::vertex::std) * NoofV;
+    Pr.Topo.Index.resize(NoofI);
+    memcpy(Pr.Topo.Index.data(), ptr, sizeof(INT) * NoofI);
+    ptr += sizeof(INT) * NoofI;
+  }
+
+  /* Materials */
+  if ((size_t)(end - ptr) < sizeof(MaterialG3DM) * NoofM)
+    return FALSE;
+  Mdl.Materials.resize(NoofM);
+  for (INT m = 0; m < NoofM; m++, ptr += sizeof(MaterialG3DM))
+  {
+    const MaterialG3DM *Mtl = (const MaterialG3DM *)ptr;
+    model::material &M = Mdl.Materials[m];
+
+    M.Name = std::string(Mtl->Name, strnlen(Mtl->Name, sizeof(Mtl->Name)));
+    M.Ka = Mtl->Ka;
+    M.Kd = Mtl->Kd;
+    M.Ks = Mtl->Ks;
+    M.Ph = Mtl->Ph;
+    M.Trans = Mtl->Trans;
+    for (INT k = 0; k < 8; k++)
+      M.Tex[k] = Mtl->Tex[k] < 0 || Mtl->Tex[k] >= NoofT ? -1 : Mtl->Tex[k];
+  }
+
+  /* Textures with inline pixels */
+  Mdl.Textures.resize(NoofT);
+  for (INT t = 0; t < NoofT; t++)
+  {
+    if ((size_t)(end - ptr) < sizeof(TextureG3DM))
+      return FALSE;
+
+    const TextureG3DM *Tex = (const TextureG3DM *)ptr;
+    model::texture &T = Mdl.Textures[t];
+
+    ptr += sizeof(TextureG3DM);
+    if (Tex->W < 0 || Tex->H < 0 || (size_t)(end - ptr) < 4 * (size_t)Tex->W * Tex->H)
+      return FALSE;
+    T.Name = std::string(Tex->Name, strnlen(Tex->Name, sizeof(Tex->Name)));
+    T.W = Tex->W;
+    T.H = Tex->H;
+    T.Pixels.resize((size_t)T.W * T.H);
+    memcpy(T.Pixels.data(), ptr, 4 * T.Pixels.size());
+    ptr += 4 * T.Pixels.size();
+  }
+  return TRUE;
+} /* End of 'digl::g3d2::ReadG3DM' function */
+
+/* Convert G3DM or OBJ file to G3D2 file function.
+ * Meshes are optimized and get levels of detail here, so loading does not do it.
+ * ARGUMENTS:
+ *   - source (*.g3dm or *.obj) and destination file names:
+ *       const std::string &InFileName, &OutFileName;
+ *   - level of detail generation settings:
+ *       const meshopt::lod_settings &LodSettings;
+ * RETURNS:
+ *   (BOOL) TRUE if success, FALSE otherwise.
+ */
+BOOL digl::g3d2::Convert( const std::string &InFileName, const std::string &OutFileName,
+                          const meshopt::lod_settings &LodSettings )
+{
+  model Mdl;
+  std::string Ext = InFileName.size() > 4 ? InFileName.substr(InFileName.size() - 4) : "";
+
+  for (auto &c : Ext)
+    c = tolower(c);
+  if (Ext == ".obj")
+  {
+    obj::model Obj;
+
+    if (!obj::Load(InFileName, Obj))
+      return FALSE;
+
+    /* Materials with diffuse textures as external references (paths are rebased from source to output directory) */
+    std::string
+      InDir = DirOf(InFileName),
+      OutDir = DirOf(OutFileName);
+
+    for (auto &M : Obj.Materials)
+    {
+      model::material Mtl;
+
+      Mtl.Name = M.Name;
+      Mtl.Ka = M.Ka;
+      Mtl.Kd = M.Kd;
+      Mtl.Ks = M.Ks;
+      Mtl.Ph = M.Ph;
+      Mtl.Trans = M.Trans;
+      for (INT k = 0; k < 8; k++)
+        Mtl.Tex[k] = -1;
+      if (!M.TexFile.empty())
+      {
+        Mtl.Tex[0] = (INT)Mdl.Textures.size();
+        Mdl.Textures.push_back({M.TexFile, RebasePath(M.TexFile, InDir, OutDir), 0, 0, {}});
+      }
+      Mdl.Materials.push_back(Mtl);
+    }
+
+    /* One prim per material group */
+    for (auto &G : Obj.Groups)
+    {
+      model::prim Pr;
+
+      Pr.MtlNo = -1;
+      for (size_t m = 0; m < Obj.Materials.size(); m++)
+        if (Obj.Materials[m].Name == G.Material)
+          Pr.MtlNo = (INT)m;
+
+      /* Keep only vertices used by group */
+      std::vector<INT> Remap(Obj.Positions.size(), -1);
+      for (auto I : G.Index)
+      {
+        if (Remap[I] == -1)
+        {
+          Remap[I] = (INT)Pr.Topo.Vertex.size();
+          Pr.Topo.Vertex << digl::vertex::std(Obj.Positions[I], Obj.TexCoords[I], Obj.Normals[I]);
+        }
+        Pr.Topo.Index << Remap[I];
+      }
+      Mdl.Prims.push_back(Pr);
+    }
+  }
+  else if (!ReadG3DM(InFileName, Mdl))
+    return FALSE;
+
+  /* Vertex cache, overdraw and vertex fetch optimization (OBJ import already did it), then levels of detail */
+  for (size_t p = 0; p < Mdl.Prims.size(); p++)
+  {
+    if (Ext != ".obj")
+      meshopt::Optimize(Mdl.Prims[p].Topo, InFileName + ":" + std::to_string(p));
+    meshopt::BuildLods(Mdl.Prims[p].Topo, LodSettings, InFileName + ":" + std::to_string(p));
+  }
+
+  /* Move inline texels to external G32 files next to output file */
+  std::string
+    Dir = DirOf(OutFileName),
+    Base = OutFileName.substr(Dir.size());
+  Base = Base.substr(0, Base.find_last_of('.'));
+  for (size_t t = 0; t < Mdl.Textures.size(); t++)
+  {
+    model::texture &T = Mdl.Textures[t];
+
+    if (T.Pixels.empty())
+      continue;
+    if (T.W > 0xFFFF || T.H > 0xFFFF)
+      return FALSE;
+
+    FILE *F;
+    WORD Size[2] = {(WORD)T.W, (WORD)T.H};
+
+    T.Path = Base + "_" + std::to_string(t) + ".g32";
+    if ((F = fopen((Dir + T.Path).c_str(), "wb")) == nullptr)
+      return FALSE;
+    fwrite(Size, 2, 2, F);
+    fwrite(T.Pixels.data(), 4, T.Pixels.size(), F);
+    fclose(F);
+  }
+  return Save(OutFileName, Mdl);
+} /* End of 'digl::g3d2::Convert' function */
+
+/* END OF 'g3d2.cpp' FILE */
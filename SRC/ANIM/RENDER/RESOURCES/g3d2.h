@@ -0,0 +1,257 @@
+/***************************************************************
+ * Copyright (C) 2020
+ *    Computer Graphics Support Group of 30 Phys-Math Gymnasium
+ ***************************************************************/
+
+/* FILE NAME   : g3d2.h
+ * PURPOSE     : G3D2 binary mesh format header file.
+ * PROGRAMMER  : Dmitriy Vlasov.
+ * LAST UPDATE : 19.10.2020
+ * NOTE        : Namespace 'digl'.
+ *
+ *   File layout (every section starts at 16-byte aligned offset):
+ *     header            - signature 'G3D2', version, number of chunks;
+ *     chunk[NumOfChunks] - table of contents (tag, offset, size);
+ *     'PRIM' chunk      - prim descriptions (AABB, counts, offsets);
+ *     'VERT' chunk      - quantized vertices (16 bytes each);
+ *     'INDX' chunk      - 16-bit or 32-bit indices;
+ *     'MTRL' chunk      - materials;
+ *     'TEXR' chunk      - external texture references;
+ *     'STRS' chunk      - zero-terminated strings for names and paths;
+ *     'LODS' chunk      - levels of detail (index ranges, built at conversion).
+ *
+ *   Files without 'LODS' chunk (or prims with no levels) are still valid.
+ *
+ * No part of this file may be changed without agreement of
+ * Computer Graphics Support Group of 30 Phys-Math Gymnasium.
+ */
+
+#ifndef __G3D2_H_
+#define __G3D2_H_
+
+#include "../../../def.h"
+#include "meshopt.h"
+#include "topology.h"
+
+#include <string>
+#include <vector>
+
+/* Animation project namespace */
+namespace digl
+{
+  /* Old G3DM format material record */
+  struct MaterialG3DM
+  {
+    CHAR Name[300];
+    vec3 Ka, Kd, Ks;
+    FLT Ph, Trans;
+    INT Tex[8];
+    CHAR ShaderStr[300];
+    INT ShdNo;
+  }; /* End of 'MaterialG3DM' struct */
+
+  /* Old G3DM format texture record */
+  struct TextureG3DM
+  {
+    CHAR Name[300];
+    INT W, H;
+    UINT TexId;
+  }; /* End of 'TextureG3DM' struct */
+
+  /* G3D2 format namespace */
+  namespace g3d2
+  {
+    /* Format version */
+    const DWORD Version = 1;
+
+    /* Sections alignment in bytes */
+    const DWORD Align = 16;
+
+    /* Make chunk tag function.
+     * ARGUMENTS:
+     *   - tag text (4 characters):
+     *       const CHAR *Tag;
+     * RETURNS:
+     *   (DWORD) tag value.
+     */
+    inline DWORD Tag( const CHAR *Tag )
+    {
+      return (DWORD)(BYTE)Tag[0] | ((DWORD)(BYTE)Tag[1] << 8) |
+        ((DWORD)(BYTE)Tag[2] << 16) | ((DWORD)(BYTE)Tag[3] << 24);
+    } /* End of 'Tag' function */
+
+    /* File header */
+    struct header
+    {
+      DWORD Sign;        // 'G3D2'
+      DWORD Version;     // Format version
+      DWORD NumOfChunks; // Number of table of contents entries
+      DWORD Reserved;
+    }; /* End of 'header' struct */
+
+    /* Table of contents entry */
+    struct chunk
+    {
+      DWORD Tag;    // Chunk tag
+      DWORD Count;  // Number of records in chunk
+      DWORD Offset; // Offset from file start (aligned)
+      DWORD Size;   // Size in bytes
+    }; /* End of 'chunk' struct */
+
+    /* Prim description */
+    struct prim
+    {
+      DWORD NumOfV;     // Number of vertices
+      DWORD NumOfI;     // Number of indices
+      INT MtlNo;        // Material number (-1 if none)
+      DWORD IndexSize;  // Index size in bytes (2 or 4)
+      DWORD VOffset;    // First vertex byte offset in 'VERT' chunk
+      DWORD IOffset;    // First index byte offset in 'INDX' chunk
+      DWORD PrimType;   // Primitive topology (see 'prim_type')
+      DWORD Reserved;
+      FLT Min[3];       // Bound box (also position quantization range)
+      FLT Max[3];
+      DWORD FirstLod;   // First level of detail in 'LODS' chunk
+      DWORD NumOfLods;  // Number of levels of detail (0 if none)
+    }; /* End of 'prim' struct */
+
+    /* Level of detail */
+    struct lod
+    {
+      DWORD Start;      // First index in prim indices
+      DWORD Count;      // Number of indices
+      FLT Error;        // Geometric error in file space units
+      DWORD Reserved;
+    }; /* End of 'lod' struct */
+
+    /* Quantized vertex */
+    struct vertex
+    {
+      WORD P[4]; // Position (unsigned normalized inside prim bound box, 4th is unused)
+      SHORT N[2]; // Normal (octahedral, signed normalized)
+      WORD T[2];  // Texture coordinates (half float)
+    }; /* End of 'vertex' struct */
+
+    /* Material */
+    struct material
+    {
+      DWORD Name;       // Name offset in 'STRS' chunk
+      FLT Ka[3], Kd[3], Ks[3];
+      FLT Ph, Trans;
+      INT Tex[8];       // Texture reference numbers (-1 if none)
+    }; /* End of 'material' struct */
+
+    /* External texture reference */
+    struct texture
+    {
+      DWORD Name;       // Name offset in 'STRS' chunk
+      DWORD Path;       // File path (relative to model file) offset in 'STRS' chunk
+      INT W, H;
+    }; /* End of 'texture' struct */
+
+    /* Decoded model representation type */
+    class model
+    {
+    public:
+      /* Model prim */
+      struct prim
+      {
+        topology::base<digl::vertex::std> Topo; // Decoded topology
+        vec3 Min, Max;                          // Bound box
+        INT MtlNo;                              // Material number
+      }; /* End of 'prim' struct */
+
+      /* Model material */
+      struct material
+      {
+        std::string Name;
+        vec3 Ka, Kd, Ks;
+        FLT Ph, Trans;
+        INT Tex[8];
+      }; /* End of 'material' struct */
+
+      /* Model texture reference */
+      struct texture
+      {
+        std::string Name, Path;
+        INT W, H;
+        std::vector<DWORD> Pixels; // Inline pixels for conversion (may be empty)
+      }; /* End of 'texture' struct */
+
+      std::vector<prim> Prims;
+      std::vector<material> Materials;
+      std::vector<texture> Textures;
+    }; /* End of 'model' class */
+
+    /* Loaded model representation type (vertices in upload format, indices in file width) */
+    class packed_model
+    {
+    public:
+      /* Model prim (only topology of file index width is filled) */
+      struct prim
+      {
+        topology::base<digl::vertex::packed, WORD> Topo16; // Topology with 16-bit indices (0xFFFF is restart)
+        topology::base<digl::vertex::packed, UINT> Topo32; // Topology with 32-bit indices (0xFFFFFFFF is restart)
+        INT IndexSize;                                     // Used topology index size in bytes (2 or 4)
+        INT MtlNo;                                         // Material number
+      }; /* End of 'prim' struct */
+
+      std::vector<prim> Prims;
+      std::vector<model::material> Materials;
+      std::vector<model::texture> Textures;
+    }; /* End of 'packed_model' class */
+
+    /* Load G3D2 file to model in upload format function.
+     * Vertices are dequantized straight to packed ones, indices keep file width.
+     * ARGUMENTS:
+     *   - file name:
+     *       const std::string &FileName;
+     *   - model to fill:
+     *       packed_model &Mdl;
+     *   - transformation applied to vertices while decoding:
+     *       const matr &LoadTransform;
+     * RETURNS:
+     *   (BOOL) TRUE if success, FALSE otherwise.
+     */
+    BOOL Load( const std::string &FileName, packed_model &Mdl, const matr &LoadTransform = matr::Identity() );
+
+    /* Save model to G3D2 file function.
+     * ARGUMENTS:
+     *   - file name:
+     *       const std::string &FileName;
+     *   - model to save:
+     *       const model &Mdl;
+     * RETURNS:
+     *   (BOOL) TRUE if success, FALSE otherwise.
+     */
+    BOOL Save( const std::string &FileName, const model &Mdl );
+
+    /* Read G3DM file to model function.
+     * ARGUMENTS:
+     *   - file name:
+     *       const std::string &FileName;
+     *   - model to fill:
+     *       model &Mdl;
+     * RETURNS:
+     *   (BOOL) TRUE if success, FALSE otherwise.
+     */
+    BOOL ReadG3DM( const std::string &FileName, model &Mdl );
+
+    /* Convert G3DM or OBJ file to G3D2 file function.
+     * Meshes are optimized and get levels of detail here, so loading does not do it.
+     * ARGUMENTS:
+     *   - source (*.g3dm or *.obj) and destination file names:
+     *       const std::string &InFileName, &OutFileName;
+     *   - level of detail generation settings:
+     *       const meshopt::lod_settings &LodSettings;
+     * RETURNS:
+     *   (BOOL) TRUE if success, FALSE otherwise.
+     */
+    BOOL Convert( const std::string &InFileName, const std::string &OutFileName,
+                  const meshopt::lod_settings &LodSettings = meshopt::lod_settings() );
+  } /* end of 'g3d2' namespace */
+} /* end of 'digl' namespace */
+
+#endif /* __G3D2_H_ */
+
+/* END OF 'g3d2.h' FILE */
@@ -83,12 +83,13 @@ digl::image::image( const std::string &FileName ) :
             Pixels[p++] = 255;
           }
       }
-      else if (flen == 4 + fw * fh * 3)
+      else if (flen == 4 + fw * fh * 4)
       {
         // G32
         fseek(F, 4, SEEK_SET);
         Pixels.resize(fw * fh * 4);
         Width = fw;
+        Height = fh;
         fread(&Pixels[0], 4, fw * fh, F);
       }
       fclose(F);
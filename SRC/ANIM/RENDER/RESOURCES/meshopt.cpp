@@ -0,0 +1,739 @@
+/***************************************************************
+ * Copyright (C) 2020
+ *    Computer Graphics Support Group of 30 Phys-Math Gymnasium
+ ***************************************************************/
+
+/* FILE NAME   : meshopt.cpp
+ * PURPOSE     : Mesh optimization function file.
+ * PROGRAMMER  : Dmitriy Vlasov.
+ * LAST UPDATE : 19.10.2020
+ * NOTE        : Namespace 'digl'.
+ *
+ * No part of this file may be changed without agreement of
+ * Computer Graphics Support Group of 30 Phys-Math Gymnasium.
+ */
+
+#include "meshopt.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <unordered_map>
+
+using namespace digl;
+
+/* Mesh optimization namespace */
+namespace digl
+{
+  namespace meshopt
+  {
+    /* Forsyth algorithm parameters */
+    const INT CacheSize = 32;
+    const FLT CacheDecayPower = 1.5f;
+    const FLT LastTriScore = 0.75f;
+    const FLT ValenceBoostScale = 2.0f;
+    const FLT ValenceBoostPower = 0.5f;
+
+    /* Evaluate Forsyth vertex score function.
+     * ARGUMENTS:
+     *   - vertex position in cache (-1 if not in cache):
+     *       INT CachePos;
+     *   - number of not emitted triangles using vertex:
+     *       INT Remaining;
+     * RETURNS:
+     *   (FLT) vertex score.
+     */
+    static FLT VertexScore( INT CachePos, INT Remaining )
+    {
+      if (Remaining == 0)
+        return -1;
+
+      FLT Score = 0;
+
+      if (CachePos >= 0)
+        if (CachePos < 3)
+          Score = LastTriScore;
+        else
+          Score = powf(1 - (FLT)(CachePos - 3) / (CacheSize - 3), CacheDecayPower);
+      return Score + ValenceBoostScale * powf((FLT)Remaining, -ValenceBoostPower);
+    } /* End of 'VertexScore' function */
+
+    /* Evaluate vertex cache statistics function.
+     * ARGUMENTS:
+     *   - triangle list indices:
+     *       const INT *Index;
+     *       size_t NumOfI;
+     *   - number of vertices:
+     *       size_t NumOfV;
+     * RETURNS:
+     *   (stats) statistics.
+     */
+    stats Analyze( const INT *Index, size_t NumOfI, size_t NumOfV )
+    {
+      std::vector<UINT64> Stamp(NumOfV, 0);
+      std::vector<BYTE> Used(NumOfV, 0);
+      UINT64 Time = StatsCacheSize + 1;
+      size_t Misses = 0, NumOfUsed = 0;
+
+      // FIFO cache: vertex is in cache while less than 'StatsCacheSize' misses happened after its load
+      for (size_t i = 0; i < NumOfI; i++)
+      {
+        INT v = Index[i];
+
+        if (v < 0 || (size_t)v >= NumOfV)
+          continue;
+        if (!Used[v])
+          Used[v] = 1, NumOfUsed++;
+        if (Time - Stamp[v] > StatsCacheSize)
+          Stamp[v] = Time++, Misses++;
+      }
+      stats St;
+
+      St.ACMR = NumOfI < 3 ? 0 : (FLT)Misses / (NumOfI / 3);
+      St.ATVR = NumOfUsed == 0 ? 0 : (FLT)Misses / NumOfUsed;
+      return St;
+    } /* End of 'Analyze' function */
+
+    /* Remove degenerate triangles function.
+     * ARGUMENTS:
+     *   - triangle list indices:
+     *       INT *Index;
+     *       size_t NumOfI;
+     * RETURNS:
+     *   (size_t) new number of indices.
+     */
+    size_t RemoveDegenerate( INT *Index, size_t NumOfI )
+    {
+      size_t n = 0;
+
+      for (size_t i = 0; i + 2 < NumOfI; i += 3)
+      {
+        INT a = Index[i], b = Index[i + 1], c = Index[i + 2];
+
+        if (a == b || b == c || c == a || a < 0 || b < 0 || c < 0)
+          continue;
+        Index[n++] = a;
+        Index[n++] = b;
+        Index[n++] = c;
+      }
+      return n;
+    } /* End of 'RemoveDegenerate' function */
+
+    /* Reorder triangles for vertex cache function.
+     * ARGUMENTS:
+     *   - triangle list indices:
+     *       INT *Index;
+     *       size_t NumOfI;
+     *   - number of vertices:
+     *       size_t NumOfV;
+     * RETURNS: None.
+     */
+    VOID OptimizeVertexCache( INT *Index, size_t NumOfI, size_t NumOfV )
+    {
+      size_t NumOfT = NumOfI / 3;
+
+      if (NumOfT < 2)
+        return;
+
+      // Vertex -> triangles adjacency (not emitted triangles are kept at list start)
+      std::vector<INT> Remaining(NumOfV, 0), Offset(NumOfV + 1, 0), Adj(NumOfT * 3);
+
+      for (size_t i = 0; i < NumOfT * 3; i++)
+        Remaining[Index[i]]++;
+      for (size_t v = 0; v < NumOfV; v++)
+        Offset[v + 1] = Offset[v] + Remaining[v];
+      std::vector<INT> Fill(Offset.begin(), Offset.end() - 1);
+
+      for (size_t i = 0; i < NumOfT * 3; i++)
+        Adj[Fill[Index[i]]++] = (INT)(i / 3);
+
+      std::vector<INT> CachePos(NumOfV, -1);
+      std::vector<FLT> Score(NumOfV), TriScore(NumOfT);
+      std::vector<BYTE> Emitted(NumOfT, 0);
+      std::vector<INT> Res;
+
+      for (size_t v = 0; v < NumOfV; v++)
+        Score[v] = VertexScore(-1, Remaining[v]);
+      for (size_t t = 0; t < NumOfT; t++)
+        TriScore[t] = Score[Index[t * 3]] + Score[Index[t * 3 + 1]] + Score[Index[t * 3 + 2]];
+
+      INT Cache[CacheSize + 3], NewCache[CacheSize + 3], CacheLen = 0;
+      INT Best = (INT)(std::max_element(TriScore.begin(), TriScore.end()) - TriScore.begin());
+      size_t Cursor = 0;
+
+      Res.reserve(NumOfT * 3);
+      for (size_t k = 0; k < NumOfT; k++)
+      {
+        if (Best < 0)
+        {
+          // Cache is exhausted - take next not emitted triangle in input order
+          while (Emitted[Cursor])
+            Cursor++;
+          Best = (INT)Cursor;
+        }
+
+        const INT *Tri = &Index[Best * 3];
+        INT NewLen = 0;
+
+        Emitted[Best] = 1;
+        for (INT j = 0; j < 3; j++)
+        {
+          INT v = Tri[j];
+          INT *List = &Adj[Offset[v]];
+
+          Res.push_back(v);
+          for (INT a = 0; a < Remaining[v]; a++)
+            if (List[a] == Best)
+            {
+              std::swap(List[a], List[Remaining[v] - 1]);
+              break;
+            }
+          Remaining[v]--;
+          NewCache[NewLen++] = v;
+        }
+        for (INT c = 0; c < CacheLen; c++)
+        {
+          INT v = Cache[c];
+
+          if (v != Tri[0] && v != Tri[1] && v != Tri[2])
+            NewCache[NewLen++] = v;
+        }
+        // Vertices pushed out of cache lose their cache score
+        for (INT c = CacheSize; c < NewLen; c++)
+        {
+          CachePos[NewCache[c]] = -1;
+          Score[NewCache[c]] = VertexScore(-1, Remaining[NewCache[c]]);
+        }
+        CacheLen = NewLen < CacheSize ? NewLen : CacheSize;
+        for (INT c = 0; c < CacheLen; c++)
+        {
+          INT v = NewCache[c];
+
+          Cache[c] = v;
+          CachePos[v] = c;
+          Score[v] = VertexScore(c, Remaining[v]);
+        }
+
+        // Update scores of triangles touching cache and choose best one
+        FLT BestScore = -1;
+
+        Best = -1;
+        for (INT c = 0; c < CacheLen; c++)
+        {
+          INT v = Cache[c];
+
+          for (INT a = 0; a < Remaining[v]; a++)
+          {
+            INT t = Adj[Offset[v] + a];
+            FLT S = Score[Index[t * 3]] + Score[Index[t * 3 + 1]] + Score[Index[t * 3 + 2]];
+
+            TriScore[t] = S;
+            if (S > BestScore)
+              BestScore = S, Best = t;
+          }
+        }
+      }
+      std::copy(Res.begin(), Res.end(), Index);
+    } /* End of 'OptimizeVertexCache' function */
+
+    /* Reorder vertex cache clusters to reduce overdraw function.
+     * ARGUMENTS:
+     *   - triangle list indices (ordered for vertex cache):
+     *       INT *Index;
+     *       size_t NumOfI;
+     *   - vertex positions (vec3 at start of every vertex):
+     *       const BYTE *Pos;
+     *       size_t Stride;
+     *   - number of vertices:
+     *       size_t NumOfV;
+     *   - allowed ACMR growth:
+     *       FLT Threshold;
+     * RETURNS: None.
+     */
+    VOID OptimizeOverdraw( INT *Index, size_t NumOfI, const BYTE *Pos, size_t Stride, size_t NumOfV,
+                           FLT Threshold )
+    {
+      size_t NumOfT = NumOfI / 3;
+
+      if (NumOfT < 2)
+        return;
+
+      auto P = [&]( INT v ) -> const vec3 &
+      {
+        return *(const vec3 *)(Pos + Stride * v);
+      };
+
+      // Split to clusters at hard boundaries: triangles with all vertices missed in cache
+      std::vector<size_t> Start;
+      std::vector<UINT64> Stamp(NumOfV, 0);
+      UINT64 Time = StatsCacheSize + 1;
+
+      for (size_t t = 0; t < NumOfT; t++)
+      {
+        INT Misses = 0;
+
+        for (INT j = 0; j < 3; j++)
+        {
+          INT v = Index[t * 3 + j];
+
+          if (Time - Stamp[v] > StatsCacheSize)
+            Stamp[v] = Time++, Misses++;
+        }
+        if (Misses == 3)
+          Start.push_back(t);
+      }
+      if (Start.empty() || Start[0] != 0)
+        Start.insert(Start.begin(), 0);
+      Start.push_back(NumOfT);
+      if (Start.size() < 3)
+        return;
+
+      // Cluster sort key: how cluster faces outwards from mesh center
+      vec3 Center(0);
+      FLT Area = 0;
+      std::vector<vec3> CC(Start.size() - 1), CN(Start.size() - 1);
+      std::vector<FLT> CA(Start.size() - 1, 0);
+
+      for (size_t c = 0; c + 1 < Start.size(); c++)
+      {
+        CC[c] = vec3(0);
+        CN[c] = vec3(0);
+        for (size_t t = Start[c]; t < Start[c + 1]; t++)
+        {
+          const vec3
+            &p0 = P(Index[t * 3]),
+            &p1 = P(Index[t * 3 + 1]),
+            &p2 = P(Index[t * 3 + 2]);
+          vec3 N = (p1 - p0) % (p2 - p0);
+          FLT A = !N;
+
+          CC[c] += (p0 + p1 + p2) * (A / 3);
+          CN[c] += N;
+          CA[c] += A;
+        }
+        Center += CC[c];
+        Area += CA[c];
+      }
+      if (Area == 0)
+        return;
+      Center /= Area;
+
+      std::vector<FLT> Key(Start.size() - 1);
+      std::vector<INT> Order(Start.size() - 1);
+
+      for (size_t c = 0; c < Key.size(); c++)
+      {
+        vec3 C = CA[c] == 0 ? CC[c] : CC[c] / CA[c];
+        FLT L = !CN[c];
+
+        Key[c] = L == 0 ? 0 : ((C - Center) & CN[c]) / L;
+        Order[c] = (INT)c;
+      }
+      std::stable_sort(Order.begin(), Order.end(),
+        [&]( INT A, INT B )
+        {
+          return Key[A] > Key[B];
+        });
+
+      std::vector<INT> Res;
+
+      Res.reserve(NumOfT * 3);
+      for (INT c : Order)
+        Res.insert(Res.end(), Index + Start[c] * 3, Index + Start[c + 1] * 3);
+
+      // Keep new order only if vertex cache efficiency is not lost
+      if (Analyze(Res.data(), Res.size(), NumOfV).ACMR <= Analyze(Index, NumOfT * 3, NumOfV).ACMR * Threshold)
+        std::copy(Res.begin(), Res.end(), Index);
+    } /* End of 'OptimizeOverdraw' function */
+
+    /* Build vertex fetch order remap table function.
+     * ARGUMENTS:
+     *   - remap table to fill (new vertex number or -1 for unused vertex):
+     *       std::vector<INT> &Remap;
+     *   - triangle list indices (remapped in place):
+     *       INT *Index;
+     *       size_t NumOfI;
+     *   - number of vertices:
+     *       size_t NumOfV;
+     * RETURNS:
+     *   (size_t) new number of vertices.
+     */
+    size_t OptimizeVertexFetch( std::vector<INT> &Remap, INT *Index, size_t NumOfI, size_t NumOfV )
+    {
+      INT n = 0;
+
+      Remap.assign(NumOfV, -1);
+      for (size_t i = 0; i < NumOfI; i++)
+      {
+        INT v = Index[i];
+
+        if (v < 0 || (size_t)v >= NumOfV)
+          continue;
+        if (Remap[v] < 0)
+          Remap[v] = n++;
+        Index[i] = Remap[v];
+      }
+      return n;
+    } /* End of 'OptimizeVertexFetch' function */
+
+    /* Quadric error representation type (symmetric 4x4 matrix) */
+    struct quadric
+    {
+      DBL A00, A11, A22, A01, A02, A12, B0, B1, B2, C, W; // Matrix, vector, constant and weight
+
+      /* Quadric of plane function.
+       * ARGUMENTS:
+       *   - plane 'N * P + D = 0' (unit normal):
+       *       const vec3 &N;
+       *       DBL D;
+       *   - weight:
+       *       DBL Weight;
+       * RETURNS:
+       *   (quadric) quadric.
+       */
+      static quadric Plane( const vec3 &N, DBL D, DBL Weight )
+      {
+        DBL x = N[0], y = N[1], z = N[2];
+
+        return {Weight * x * x, Weight * y * y, Weight * z * z,
+                Weight * x * y, Weight * x * z, Weight * y * z,
+                Weight * D * x, Weight * D * y, Weight * D * z, Weight * D * D, Weight};
+      } /* End of 'Plane' function */
+
+      /* Add quadric function.
+       * ARGUMENTS:
+       *   - quadric to add:
+       *       const quadric &Q;
+       * RETURNS:
+       *   (quadric &) this quadric.
+       */
+      quadric & operator+=( const quadric &Q )
+      {
+        A00 += Q.A00, A11 += Q.A11, A22 += Q.A22;
+        A01 += Q.A01, A02 += Q.A02, A12 += Q.A12;
+        B0 += Q.B0, B1 += Q.B1, B2 += Q.B2;
+        C += Q.C, W += Q.W;
+        return *this;
+      } /* End of 'operator+=' function */
+
+      /* Evaluate error at point function.
+       * ARGUMENTS:
+       *   - point:
+       *       const vec3 &P;
+       * RETURNS:
+       *   (DBL) weighted squared distance sum.
+       */
+      DBL Eval( const vec3 &P ) const
+      {
+        DBL x = P[0], y = P[1], z = P[2];
+
+        return A00 * x * x + A11 * y * y + A22 * z * z +
+          2 * (A01 * x * y + A02 * x * z + A12 * y * z + B0 * x + B1 * y + B2 * z) + C;
+      } /* End of 'Eval' function */
+    }; /* End of 'quadric' struct */
+
+    /* Simplification vertex kinds */
+    enum vertex_kind : BYTE
+    {
+      KIND_MANIFOLD, // Interior vertex, can collapse to any neighbour
+      KIND_BORDER,   // Vertex on open border, can collapse only along border
+      KIND_LOCKED    // Border corner or non-manifold vertex, never collapses
+    }; /* End of 'vertex_kind' enum */
+
+    /* Border quadric weight (keeps open borders in place) */
+    const DBL BorderWeight = 10;
+
+    /* Simplify triangle list by quadric error edge collapses function.
+     * ARGUMENTS:
+     *   - triangle list indices:
+     *       const INT *Index;
+     *       size_t NumOfI;
+     *   - vertex positions (vec3 at start of every vertex):
+     *       const BYTE *Pos;
+     *       size_t Stride;
+     *   - number of vertices:
+     *       size_t NumOfV;
+     *   - wanted number of indices:
+     *       size_t TargetNumOfI;
+     *   - maximal allowed error (distance in model space):
+     *       FLT MaxError;
+     *   - achieved error (may be nullptr):
+     *       FLT *ResultError;
+     * RETURNS:
+     *   (std::vector<INT>) simplified triangle list.
+     */
+    std::vector<INT> Simplify( const INT *Index, size_t NumOfI, const BYTE *Pos, size_t Stride, size_t NumOfV,
+                               size_t TargetNumOfI, FLT MaxError, FLT *ResultError )
+    {
+      std::vector<INT> I(Index, Index + NumOfI / 3 * 3);
+      DBL MaxCost = (DBL)MaxError * MaxError, Error = 0;
+
+      if (ResultError != nullptr)
+        *ResultError = 0;
+      if (MaxError <= 0 || I.size() <= TargetNumOfI)
+        return I;
+
+      auto P = [&]( INT v ) -> const vec3 &
+      {
+        return *(const vec3 *)(Pos + Stride * v);
+      };
+      auto Key = []( INT A, INT B ) -> UINT64
+      {
+        return ((UINT64)(UINT)A << 32) | (UINT)B;
+      };
+
+      /* Vertices with same position form group (list by 'Next' from canonical one) */
+      std::unordered_multimap<UINT64, INT> First;
+      std::vector<INT> Canon(NumOfV), Next(NumOfV, -1);
+
+      First.reserve(NumOfV);
+      for (size_t v = 0; v < NumOfV; v++)
+      {
+        UINT64 H = hash()(&P((INT)v), sizeof(vec3));
+        auto Range = First.equal_range(H);
+
+        Canon[v] = (INT)v;
+        for (auto el = Range.first; el != Range.second; el++)
+          if (P(el->second) == P((INT)v))
+          {
+            INT c = el->second;
+
+            Canon[v] = c;
+            Next[v] = Next[c];
+            Next[c] = (INT)v;
+            break;
+          }
+        if (Canon[v] == (INT)v)
+          First.insert({H, (INT)v});
+      }
+
+      /* Face and border plane quadrics of canonical vertices */
+      std::vector<quadric> Q(NumOfV, quadric {});
+      std::unordered_map<UINT64, INT> Edges;
+
+      for (size_t k = 0; k < I.size(); k += 3)
+        for (INT j = 0; j < 3; j++)
+          Edges[Key(Canon[I[k + j]], Canon[I[k + (j + 1) % 3]])]++;
+      for (size_t k = 0; k < I.size(); k += 3)
+      {
+        INT c[3] = {Canon[I[k]], Canon[I[k + 1]], Canon[I[k + 2]]};
+        vec3 N = (P(c[1]) - P(c[0])) % (P(c[2]) - P(c[0]));
+        FLT Area2 = !N;
+
+        if (Area2 == 0)
+          continue;
+        N /= Area2;
+        for (INT j = 0; j < 3; j++)
+        {
+          INT a = c[j], b = c[(j + 1) % 3];
+
+          Q[a] += quadric::Plane(N, -(N & P(a)), Area2 / 2);
+          if (Edges.find(Key(b, a)) == Edges.end())
+          {
+            vec3 E = P(b) - P(a), BN = E % N;
+            FLT L = !BN;
+
+            if (L > 0)
+            {
+              quadric BQ = quadric::Plane(BN / L, -((BN / L) & P(a)), (E & E) * BorderWeight);
+
+              Q[a] += BQ;
+              Q[b] += BQ;
+            }
+          }
+        }
+      }
+
+      std::vector<BYTE> Kind(NumOfV), Touched(NumOfV);
+      std::vector<INT> Map(NumOfV), BorderCnt(NumOfV), Offset(NumOfV + 1), Adj;
+      struct collapse
+      {
+        DBL Cost;
+        INT U, V;
+      };
+      std::vector<collapse> Cands;
+
+      while (I.size() > TargetNumOfI)
+      {
+        size_t NumOfT = I.size() / 3;
+
+        /* Vertex kinds for current topology */
+        Edges.clear();
+        for (size_t k = 0; k < I.size(); k += 3)
+          for (INT j = 0; j < 3; j++)
+            Edges[Key(Canon[I[k + j]], Canon[I[k + (j + 1) % 3]])]++;
+        std::fill(Kind.begin(), Kind.end(), (BYTE)KIND_MANIFOLD);
+        std::fill(BorderCnt.begin(), BorderCnt.end(), 0);
+        for (auto &E : Edges)
+        {
+          INT a = (INT)(E.first >> 32), b = (INT)(E.first & 0xFFFFFFFF);
+
+          if (E.second > 1)
+            Kind[a] = Kind[b] = KIND_LOCKED;
+          else if (Edges.find(Key(b, a)) == Edges.end())
+            BorderCnt[a]++, BorderCnt[b]++;
+        }
+        for (size_t v = 0; v < NumOfV; v++)
+          if (Kind[v] != KIND_LOCKED && BorderCnt[v] != 0)
+            Kind[v] = BorderCnt[v] == 2 ? KIND_BORDER : KIND_LOCKED;
+
+        /* Canonical vertex -> triangles adjacency */
+        std::fill(Offset.begin(), Offset.end(), 0);
+        for (size_t k = 0; k < I.size(); k++)
+          Offset[Canon[I[k]] + 1]++;
+        for (size_t v = 0; v < NumOfV; v++)
+          Offset[v + 1] += Offset[v];
+        Adj.resize(I.size());
+        {
+          std::vector<INT> Fill(Offset.begin(), Offset.end() - 1);
+
+          for (size_t k = 0; k < I.size(); k++)
+            Adj[Fill[Canon[I[k]]]++] = (INT)(k / 3);
+        }
+
+        /* Collapse candidates sorted by cost */
+        auto IsBorderEdge = [&]( INT A, INT B )
+        {
+          return (Edges.find(Key(A, B)) != Edges.end()) != (Edges.find(Key(B, A)) != Edges.end());
+        };
+        auto TryCollapse = [&]( INT U, INT V )
+        {
+          if (Kind[U] == KIND_LOCKED ||
+              (Kind[U] == KIND_BORDER && (Kind[V] == KIND_MANIFOLD || !IsBorderEdge(U, V))))
+            return;
+
+          quadric S = Q[U];
+
+          S += Q[V];
+          Cands.push_back({S.W > 0 ? S.Eval(P(V)) / S.W : 0, U, V});
+        };
+
+        Cands.clear();
+        for (size_t k = 0; k < I.size(); k += 3)
+          for (INT j = 0; j < 3; j++)
+          {
+            INT a = Canon[I[k + j]], b = Canon[I[k + (j + 1) % 3]];
+
+            if (a < b || Edges.find(Key(b, a)) == Edges.end())
+            {
+              TryCollapse(a, b);
+              TryCollapse(b, a);
+            }
+          }
+        std::sort(Cands.begin(), Cands.end(),
+          []( const collapse &A, const collapse &B )
+          {
+            return A.Cost < B.Cost;
+          });
+
+        /* Apply cheapest independent collapses */
+        size_t ToRemove = (I.size() - TargetNumOfI) / 3, Removed = 0;
+        INT Collapsed = 0;
+
+        for (size_t v = 0; v < NumOfV; v++)
+          Map[v] = (INT)v;
+        std::fill(Touched.begin(), Touched.end(), 0);
+        for (auto &Cd : Cands)
+        {
+          if (Cd.Cost > MaxCost || Removed >= ToRemove)
+            break;
+          INT U = Cd.U, V = Cd.V;
+
+          if (Touched[U] || Touched[V])
+            continue;
+
+          /* Reject triangle flips */
+          BOOL IsFlip = FALSE;
+
+          for (INT a = Offset[U]; a < Offset[U + 1] && !IsFlip; a++)
+          {
+            const INT *T = &I[Adj[a] * 3];
+            INT c[3] = {Canon[T[0]], Canon[T[1]], Canon[T[2]]};
+
+            if (c[0] == V || c[1] == V || c[2] == V)
+              continue;
+
+            vec3 p[3] = {P(c[0]), P(c[1]), P(c[2])}, N0 = (p[1] - p[0]) % (p[2] - p[0]);
+
+            for (INT j = 0; j < 3; j++)
+              if (c[j] == U)
+                p[j] = P(V);
+
+            vec3 N1 = (p[1] - p[0]) % (p[2] - p[0]);
+
+            IsFlip = (N0 & N1) <= 0.01f * !N0 * !N1;
+          }
+          if (IsFlip)
+            continue;
+
+          /* Group vertices follow seams: move to vertex of shared triangle */
+          INT Rep = V;
+
+          for (INT a = Offset[U]; a < Offset[U + 1]; a++)
+          {
+            const INT *T = &I[Adj[a] * 3];
+            INT x = -1, y = -1;
+
+            for (INT j = 0; j < 3; j++)
+            {
+              if (Canon[T[j]] == U)
+                x = T[j];
+              else if (Canon[T[j]] == V)
+                y = T[j];
+              Touched[Canon[T[j]]] = 1;
+            }
+            if (x != -1 && y != -1)
+              Map[x] = Rep = y;
+          }
+          for (INT x = U; x != -1; x = Next[x])
+            if (Map[x] == x)
+              Map[x] = Rep;
+          Q[V] += Q[U];
+          Touched[U] = Touched[V] = 1;
+          Error = Cd.Cost > Error ? Cd.Cost : Error;
+          Removed += Kind[U] == KIND_MANIFOLD ? 2 : 1;
+          Collapsed++;
+        }
+        if (Collapsed == 0)
+          break;
+
+        /* Rebuild triangle list without collapsed triangles */
+        size_t n = 0;
+
+        for (size_t k = 0; k < NumOfT * 3; k += 3)
+        {
+          INT a = Map[I[k]], b = Map[I[k + 1]], c = Map[I[k + 2]];
+
+          if (Canon[a] == Canon[b] || Canon[b] == Canon[c] || Canon[c] == Canon[a])
+            continue;
+          I[n++] = a;
+          I[n++] = b;
+          I[n++] = c;
+        }
+        I.resize(n);
+      }
+      if (ResultError != nullptr)
+        *ResultError = (FLT)sqrt(Error);
+      return I;
+    } /* End of 'Simplify' function */
+
+    /* Report statistics function.
+     * ARGUMENTS:
+     *   - mesh name:
+     *       const std::string &Name;
+     *   - statistics before and after optimization:
+     *       const stats &Before, &After;
+     * RETURNS: None.
+     */
+    VOID Report( const std::string &Name, const stats &Before, const stats &After )
+    {
+      CHAR Buf[512];
+
+      sprintf(Buf, "%.300s: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n",
+        Name.c_str(), Before.ACMR, After.ACMR, Before.ATVR, After.ATVR);
+      OutputDebugString(Buf);
+    } /* End of 'Report' function */
+  } /* end of 'meshopt' namespace */
+} /* end of 'digl' namespace */
+
+/* END OF 'meshopt.cpp' FILE */
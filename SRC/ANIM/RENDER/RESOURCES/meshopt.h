@@ -0,0 +1,307 @@
+/***************************************************************
+ * Copyright (C) 2020
+ *    Computer Graphics Support Group of 30 Phys-Math Gymnasium
+ ***************************************************************/
+
+/* FILE NAME   : meshopt.h
+ * PURPOSE     : Mesh optimization header file.
+ * PROGRAMMER  : Dmitriy Vlasov.
+ * LAST UPDATE : 19.10.2020
+ * NOTE        : Namespace 'digl'.
+ *
+ *   Optimization stages (for triangle lists):
+ *     - duplicate vertices merging and degenerate triangles removal;
+ *     - vertex cache order (Forsyth linear-speed algorithm);
+ *     - overdraw order of vertex cache clusters (outward facing first);
+ *     - vertex fetch order (vertices sorted by first use);
+ *     - level of detail chain by quadric error edge collapses (LOD index
+ *       lists reference same vertices and are appended to index array).
+ *   Result quality is measured as ACMR (cache misses per triangle) and
+ *   ATVR (cache misses per vertex) for FIFO cache.
+ *
+ * No part of this file may be changed without agreement of
+ * Computer Graphics Support Group of 30 Phys-Math Gymnasium.
+ */
+
+#ifndef __MESHOPT_H_
+#define __MESHOPT_H_
+
+#include "../../../def.h"
+#include "../../../UTILS/hash.h"
+#include "topology.h"
+
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/* Animation project namespace */
+namespace digl
+{
+  /* Mesh optimization namespace */
+  namespace meshopt
+  {
+    /* Vertex cache statistics */
+    struct stats
+    {
+      FLT ACMR; // Average cache miss ratio (misses per triangle)
+      FLT ATVR; // Average transformed vertex ratio (misses per used vertex)
+    }; /* End of 'stats' struct */
+
+    /* Simulated FIFO cache size */
+    const INT StatsCacheSize = 16;
+
+    /* Level of detail generation and selection settings */
+    struct lod_settings
+    {
+      INT MaxLevels = 4;        // Maximal number of levels (including full mesh)
+      FLT Ratio = 0.5f;         // Index count ratio of neighbour levels
+      FLT MaxError = 0.02f;     // Maximal error relative to mesh bounding box diagonal
+      size_t MinNumOfI = 300;   // Meshes with fewer indices have no levels
+      FLT PixelError = 1.0f;    // Allowed projected error in pixels
+      FLT Hysteresis = 0.25f;   // Relative band of pixel error without level switching
+    }; /* End of 'lod_settings' struct */
+
+    /* Evaluate vertex cache statistics function.
+     * ARGUMENTS:
+     *   - triangle list indices:
+     *       const INT *Index;
+     *       size_t NumOfI;
+     *   - number of vertices:
+     *       size_t NumOfV;
+     * RETURNS:
+     *   (stats) statistics.
+     */
+    stats Analyze( const INT *Index, size_t NumOfI, size_t NumOfV );
+
+    /* Remove degenerate triangles function.
+     * ARGUMENTS:
+     *   - triangle list indices:
+     *       INT *Index;
+     *       size_t NumOfI;
+     * RETURNS:
+     *   (size_t) new number of indices.
+     */
+    size_t RemoveDegenerate( INT *Index, size_t NumOfI );
+
+    /* Reorder triangles for vertex cache function.
+     * ARGUMENTS:
+     *   - triangle list indices:
+     *       INT *Index;
+     *       size_t NumOfI;
+     *   - number of vertices:
+     *       size_t NumOfV;
+     * RETURNS: None.
+     */
+    VOID OptimizeVertexCache( INT *Index, size_t NumOfI, size_t NumOfV );
+
+    /* Reorder vertex cache clusters to reduce overdraw function.
+     * ARGUMENTS:
+     *   - triangle list indices (ordered for vertex cache):
+     *       INT *Index;
+     *       size_t NumOfI;
+     *   - vertex positions (vec3 at start of every vertex):
+     *       const BYTE *Pos;
+     *       size_t Stride;
+     *   - number of vertices:
+     *       size_t NumOfV;
+     *   - allowed ACMR growth:
+     *       FLT Threshold;
+     * RETURNS: None.
+     */
+    VOID OptimizeOverdraw( INT *Index, size_t NumOfI, const BYTE *Pos, size_t Stride, size_t NumOfV,
+                           FLT Threshold = 1.05f );
+
+    /* Build vertex fetch order remap table function.
+     * ARGUMENTS:
+     *   - remap table to fill (new vertex number or -1 for unused vertex):
+     *       std::vector<INT> &Remap;
+     *   - triangle list indices (remapped in place):
+     *       INT *Index;
+     *       size_t NumOfI;
+     *   - number of vertices:
+     *       size_t NumOfV;
+     * RETURNS:
+     *   (size_t) new number of vertices.
+     */
+    size_t OptimizeVertexFetch( std::vector<INT> &Remap, INT *Index, size_t NumOfI, size_t NumOfV );
+
+    /* Simplify triangle list by quadric error edge collapses function.
+     * Only vertices of existing ones are used (no new vertices), vertices
+     * with same position are collapsed together following attribute seams.
+     * ARGUMENTS:
+     *   - triangle list indices:
+     *       const INT *Index;
+     *       size_t NumOfI;
+     *   - vertex positions (vec3 at start of every vertex):
+     *       const BYTE *Pos;
+     *       size_t Stride;
+     *   - number of vertices:
+     *       size_t NumOfV;
+     *   - wanted number of indices:
+     *       size_t TargetNumOfI;
+     *   - maximal allowed error (distance in model space):
+     *       FLT MaxError;
+     *   - achieved error (may be nullptr):
+     *       FLT *ResultError;
+     * RETURNS:
+     *   (std::vector<INT>) simplified triangle list.
+     */
+    std::vector<INT> Simplify( const INT *Index, size_t NumOfI, const BYTE *Pos, size_t Stride, size_t NumOfV,
+                               size_t TargetNumOfI, FLT MaxError, FLT *ResultError );
+
+    /* Report statistics function.
+     * ARGUMENTS:
+     *   - mesh name:
+     *       const std::string &Name;
+     *   - statistics before and after optimization:
+     *       const stats &Before, &After;
+     * RETURNS: None.
+     */
+    VOID Report( const std::string &Name, const stats &Before, const stats &After );
+
+    /* Apply vertex remap table function.
+     * ARGUMENTS:
+     *   - vertices:
+     *       std::vector<Type> &V;
+     *   - remap table (new vertex number or -1):
+     *       const std::vector<INT> &Remap;
+     *   - new number of vertices:
+     *       size_t NewNumOfV;
+     * RETURNS: None.
+     */
+    template<class Type>
+      VOID ApplyRemap( std::vector<Type> &V, const std::vector<INT> &Remap, size_t NewNumOfV )
+      {
+        std::vector<Type> Res(NewNumOfV);
+
+        for (size_t i = 0; i < Remap.size() && i < V.size(); i++)
+          if (Remap[i] >= 0)
+            Res[Remap[i]] = V[i];
+        V.swap(Res);
+      } /* End of 'ApplyRemap' function */
+
+    /* Merge binary equal vertices function.
+     * ARGUMENTS:
+     *   - vertices:
+     *       const std::vector<Type> &V;
+     *   - triangle list indices (remapped in place):
+     *       INT *Index;
+     *       size_t NumOfI;
+     * RETURNS:
+     *   (size_t) number of merged vertices.
+     */
+    template<class Type>
+      size_t MergeDuplicates( const std::vector<Type> &V, INT *Index, size_t NumOfI )
+      {
+        std::unordered_multimap<UINT64, INT> First;
+        std::vector<INT> Remap(V.size());
+        size_t Merged = 0;
+
+        First.reserve(V.size());
+        for (size_t i = 0; i < V.size(); i++)
+        {
+          UINT64 H = hash()(&V[i], sizeof(Type));
+          auto Range = First.equal_range(H);
+
+          Remap[i] = (INT)i;
+          for (auto el = Range.first; el != Range.second; el++)
+            if (memcmp(&V[el->second], &V[i], sizeof(Type)) == 0)
+            {
+              Remap[i] = el->second;
+              Merged++;
+              break;
+            }
+          if (Remap[i] == (INT)i)
+            First.insert({H, (INT)i});
+        }
+        for (size_t i = 0; i < NumOfI; i++)
+          if (Index[i] >= 0 && (size_t)Index[i] < V.size())
+            Index[i] = Remap[Index[i]];
+        return Merged;
+      } /* End of 'MergeDuplicates' function */
+
+    /* Optimize triangle mesh topology function.
+     * ARGUMENTS:
+     *   - topology (only triangle lists are changed):
+     *       topology::base<VertexType> &Topo;
+     *   - mesh name for statistics report:
+     *       const std::string &Name;
+     * RETURNS: None.
+     */
+    template<class VertexType>
+      VOID Optimize( topology::base<VertexType> &Topo, const std::string &Name )
+      {
+        if (Topo.PrimType != prim_type::TRIMESH || Topo.Index.size() < 3 || !Topo.Lods.empty())
+          return;
+
+        stats Before = Analyze(Topo.Index.data(), Topo.Index.size(), Topo.Vertex.size());
+        std::vector<INT> Remap;
+
+        MergeDuplicates(Topo.Vertex, Topo.Index.data(), Topo.Index.size());
+        Topo.Index.resize(RemoveDegenerate(Topo.Index.data(), Topo.Index.size()));
+        OptimizeVertexCache(Topo.Index.data(), Topo.Index.size(), Topo.Vertex.size());
+        OptimizeOverdraw(Topo.Index.data(), Topo.Index.size(), (const BYTE *)&Topo.Vertex[0].P,
+                         sizeof(VertexType), Topo.Vertex.size());
+        ApplyRemap(Topo.Vertex, Remap,
+                   OptimizeVertexFetch(Remap, Topo.Index.data(), Topo.Index.size(), Topo.Vertex.size()));
+        Report(Name, Before, Analyze(Topo.Index.data(), Topo.Index.size(), Topo.Vertex.size()));
+      } /* End of 'Optimize' function */
+
+    /* Build level of detail chain function.
+     * ARGUMENTS:
+     *   - topology (only triangle lists get levels):
+     *       topology::base<VertexType> &Topo;
+     *   - settings:
+     *       const lod_settings &Settings;
+     *   - mesh name for report:
+     *       const std::string &Name;
+     * RETURNS: None.
+     */
+    template<class VertexType>
+      VOID BuildLods( topology::base<VertexType> &Topo, const lod_settings &Settings, const std::string &Name )
+      {
+        if (Topo.PrimType != prim_type::TRIMESH || Topo.Index.size() < Settings.MinNumOfI ||
+            Settings.MaxLevels < 2 || !Topo.Lods.empty())
+          return;
+
+        vec3 Min = Topo.Vertex[0].P, Max = Min;
+
+        for (auto &V : Topo.Vertex)
+          Min = vec3::Min(Min, V.P), Max = vec3::Max(Max, V.P);
+
+        FLT Size = !(Max - Min), Error = 0;
+        std::vector<INT> Cur(Topo.Index.begin(), Topo.Index.end());
+        std::string Levels;
+
+        Topo.Lods << topology::lod {0, (INT)Cur.size(), 0};
+        for (INT l = 1; l < Settings.MaxLevels; l++)
+        {
+          FLT LevelError = 0;
+          std::vector<INT> Res =
+            Simplify(Cur.data(), Cur.size(), (const BYTE *)&Topo.Vertex[0].P, sizeof(VertexType), Topo.Vertex.size(),
+                     (size_t)(Cur.size() * Settings.Ratio) / 3 * 3, Settings.MaxError * Size - Error, &LevelError);
+
+          /* Stop when error bound does not allow noticeable reduction */
+          if (Res.size() < 3 || Res.size() > Cur.size() * 0.9)
+            break;
+          OptimizeVertexCache(Res.data(), Res.size(), Topo.Vertex.size());
+          Error += LevelError;
+          Topo.Lods << topology::lod {(INT)Topo.Index.size(), (INT)Res.size(), Error};
+          Topo.Index.insert(Topo.Index.end(), Res.begin(), Res.end());
+          Levels += " " + std::to_string(Res.size() / 3);
+          Cur.swap(Res);
+        }
+        if (Topo.Lods.size() == 1)
+        {
+          Topo.Lods.clear();
+          return;
+        }
+        OutputDebugString((Name + ": LOD triangles " + std::to_string(Topo.Lods[0].Count / 3) + Levels + "\n").c_str());
+      } /* End of 'BuildLods' function */
+  } /* end of 'meshopt' namespace */
+} /* end of 'digl' namespace */
+
+#endif /* __MESHOPT_H_ */
+
+/* END OF 'meshopt.h' FILE */
@@ -0,0 +1,875 @@
+/***************************************************************
+ * Copyright (C) 2020
+ *    Computer Graphics Support Group of 30 Phys-Math Gymnasium
+ ***************************************************************/
+
+/* FILE NAME   : obj.cpp
+ * PURPOSE     : Wavefront OBJ/MTL importer function file.
+ * PROGRAMMER  : Dmitriy Vlasov.
+ * LAST UPDATE : 19.10.2020
+ * NOTE        : Namespace 'digl'.
+ *
+ * No part of this file may be changed without agreement of
+ * Computer Graphics Support Group of 30 Phys-Math Gymnasium.
+ */
+
+#include "obj.h"
+#include "meshopt.h"
+#include "../../../UTILS/hash.h"
+#include "../../../UTILS/parallel.h"
+
+#include <algorithm>
+#include <charconv>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <unordered_map>
+
+using namespace digl;
+
+/* Wavefront OBJ format namespace */
+namespace digl
+{
+  namespace obj
+  {
+    /* Read only memory mapped file representation type */
+    class mapped_file
+    {
+      HANDLE hFile, hMap; // File and mapping handles
+
+    public:
+      const CHAR *Data;   // File data (nullptr if not mapped)
+      size_t Size;        // File size in bytes
+
+      /* Mapped file constructor.
+       * ARGUMENTS:
+       *   - file name:
+       *       const std::string &FileName;
+       */
+      mapped_file( const std::string &FileName ) :
+        hFile(INVALID_HANDLE_VALUE), hMap(nullptr), Data(nullptr), Size(0)
+      {
+        LARGE_INTEGER Len;
+
+        if ((hFile = CreateFile(FileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr)) == INVALID_HANDLE_VALUE ||
+            !GetFileSizeEx(hFile, &Len) || Len.QuadPart == 0 ||
+            (hMap = CreateFileMapping(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr)) == nullptr)
+          return;
+        if ((Data = (const CHAR *)MapViewOfFile(hMap, FILE_MAP_READ, 0, 0, 0)) != nullptr)
+          Size = (size_t)Len.QuadPart;
+      } /* End of 'mapped_file' function */
+
+      /* Mapped file destructor */
+      ~mapped_file( VOID )
+      {
+        if (Data != nullptr)
+          UnmapViewOfFile(Data);
+        if (hMap != nullptr)
+          CloseHandle(hMap);
+        if (hFile != INVALID_HANDLE_VALUE)
+          CloseHandle(hFile);
+      } /* End of '~mapped_file' function */
+    }; /* End of 'mapped_file' class */
+
+    /* Absent index value */
+    const INT NoIndex = INT_MAX;
+
+    /* Relative (negative) index bias: relative index is stored as
+     * 'block local index - RelBias' and resolved after blocks merge */
+    const INT RelBias = 1 << 30;
+
+    /* Polygon corner (position, texture, normal indices) */
+    struct corner
+    {
+      INT V, T, N;
+
+      /* Compare corners function */
+      BOOL operator==( const corner &C ) const
+      {
+        return V == C.V && T == C.T && N == C.N;
+      } /* End of 'operator==' function */
+    }; /* End of 'corner' struct */
+
+    /* Corner hash functor */
+    struct corner_hash
+    {
+      size_t operator()( const corner &C ) const
+      {
+        return (size_t)(UINT64)(hash() << C);
+      } /* End of 'operator()' function */
+    }; /* End of 'corner_hash' struct */
+
+    /* Parsed file block */
+    struct block
+    {
+      std::vector<vec3> P, N;
+      std::vector<vec2> T;
+      std::vector<corner> Corners;                           // 3 corners per triangle
+      std::vector<std::pair<size_t, std::string>> Switches;  // ('usemtl' triangle number, material)
+      std::vector<std::string> Libs;                         // 'mtllib' names
+      size_t NumOfBadIndices = 0;                            // Zero or out of range position indices
+    }; /* End of 'block' struct */
+
+    /* Skip spaces function.
+     * ARGUMENTS:
+     *   - text range:
+     *       const CHAR *ptr, *end;
+     * RETURNS:
+     *   (const CHAR *) first non space character.
+     */
+    static const CHAR * SkipSpaces( const CHAR *ptr, const CHAR *end )
+    {
+      while (ptr < end && (*ptr == ' ' || *ptr == '\t' || *ptr == '\r'))
+        ptr++;
+      return ptr;
+    } /* End of 'SkipSpaces' function */
+
+    /* Read float number function.
+     * ARGUMENTS:
+     *   - text range:
+     *       const CHAR *ptr, *end;
+     *   - number to fill (unchanged if there is no number):
+     *       FLT &F;
+     * RETURNS:
+     *   (const CHAR *) pointer after number.
+     */
+    static const CHAR * ReadFloat( const CHAR *ptr, const CHAR *end, FLT &F )
+    {
+      ptr = SkipSpaces(ptr, end);
+      if (ptr < end && *ptr == '+')
+        ptr++;
+      return std::from_chars(ptr, end, F).ptr;
+    } /* End of 'ReadFloat' function */
+
+    /* Read index function.
+     * ARGUMENTS:
+     *   - text range:
+     *       const CHAR *ptr, *end;
+     *   - number of elements read before in block:
+     *       size_t Count;
+     *   - index to fill (NoIndex if there is no number):
+     *       INT &I;
+     * RETURNS:
+     *   (const CHAR *) pointer after index.
+     */
+    static const CHAR * ReadIndex( const CHAR *ptr, const CHAR *end, size_t Count, INT &I )
+    {
+      INT X = 0;
+      auto Res = std::from_chars(ptr, end, X);
+
+      if (Res.ec != std::errc() || X == 0)
+        I = NoIndex;
+      else if (X > 0)
+        I = X - 1;
+      else
+        I = (INT)Count + X - RelBias;
+      return Res.ptr;
+    } /* End of 'ReadIndex' function */
+
+    /* Read rest of line as name function.
+     * ARGUMENTS:
+     *   - text range:
+     *       const CHAR *ptr, *end;
+     * RETURNS:
+     *   (std::string) name without surrounding spaces.
+     */
+    static std::string ReadName( const CHAR *ptr, const CHAR *end )
+    {
+      ptr = SkipSpaces(ptr, end);
+      while (end > ptr && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r'))
+        end--;
+      return std::string(ptr, end);
+    } /* End of 'ReadName' function */
+
+    /* Check keyword at line start function.
+     * ARGUMENTS:
+     *   - text range:
+     *       const CHAR *ptr, *end;
+     *   - keyword:
+     *       const CHAR *Word;
+     * RETURNS:
+     *   (const CHAR *) pointer after keyword or nullptr if there is no keyword.
+     */
+    static const CHAR * Keyword( const CHAR *ptr, const CHAR *end, const CHAR *Word )
+    {
+      size_t len = strlen(Word);
+
+      if ((size_t)(end - ptr) < len || strncmp(ptr, Word, len) != 0 ||
+          ((size_t)(end - ptr) > len && ptr[len] != ' ' && ptr[len] != '\t'))
+        return nullptr;
+      return ptr + len;
+    } /* End of 'Keyword' function */
+
+    /* Parse block of OBJ file function.
+     * ARGUMENTS:
+     *   - text range (starts and ends at line boundaries):
+     *       const CHAR *ptr, *end;
+     *   - block to fill:
+     *       block &B;
+     * RETURNS: None.
+     */
+    static VOID ParseBlock( const CHAR *ptr, const CHAR *end, block &B )
+    {
+      std::vector<corner> Poly;
+
+      B.P.reserve((end - ptr) / 64);
+      B.Corners.reserve((end - ptr) / 16);
+      while (ptr < end)
+      {
+        const CHAR
+          *eol = (const CHAR *)memchr(ptr, '\n', end - ptr),
+          *s;
+
+        if (eol == nullptr)
+          eol = end;
+        ptr = SkipSpaces(ptr, eol);
+
+        if ((s = Keyword(ptr, eol, "v")) != nullptr)
+        {
+          vec3 V(0);
+
+          s = ReadFloat(s, eol, V[0]);
+          s = ReadFloat(s, eol, V[1]);
+          ReadFloat(s, eol, V[2]);
+          B.P.push_back(V);
+        }
+        else if ((s = Keyword(ptr, eol, "vt")) != nullptr)
+        {
+          vec2 V(0);
+
+          s = ReadFloat(s, eol, V[0]);
+          ReadFloat(s, eol, V[1]);
+          B.T.push_back(V);
+        }
+        else if ((s = Keyword(ptr, eol, "vn")) != nullptr)
+        {
+          vec3 V(0);
+
+          s = ReadFloat(s, eol, V[0]);
+          s = ReadFloat(s, eol, V[1]);
+          ReadFloat(s, eol, V[2]);
+          B.N.push_back(V);
+        }
+        else if ((s = Keyword(ptr, eol, "f")) != nullptr)
+        {
+          /* Polygon corners: 'v', 'v/t', 'v//n', 'v/t/n' */
+          Poly.clear();
+          while ((s = SkipSpaces(s, eol)) < eol)
+          {
+            corner C;
+            const CHAR *start = s;
+
+            s = ReadIndex(s, eol, B.P.size(), C.V);
+            if (C.V == NoIndex)
+            {
+              /* Number which is not an index ('0') is an error, anything else ends polygon */
+              if (s != start)
+                B.NumOfBadIndices++;
+              break;
+            }
+            C.T = C.N = NoIndex;
+            if (s < eol && *s == '/')
+            {
+              if (++s < eol && *s != '/')
+                s = ReadIndex(s, eol, B.T.size(), C.T);
+              if (s < eol && *s == '/')
+                s = ReadIndex(s + 1, eol, B.N.size(), C.N);
+            }
+            Poly.push_back(C);
+            while (s < eol && *s != ' ' && *s != '\t')
+              s++;
+          }
+
+          /* Fan triangulation */
+          for (size_t k = 1; k + 1 < Poly.size(); k++)
+          {
+            B.Corners.push_back(Poly[0]);
+            B.Corners.push_back(Poly[k]);
+            B.Corners.push_back(Poly[k + 1]);
+          }
+        }
+        else if ((s = Keyword(ptr, eol, "usemtl")) != nullptr)
+          B.Switches.push_back({B.Corners.size() / 3, ReadName(s, eol)});
+        else if ((s = Keyword(ptr, eol, "mtllib")) != nullptr)
+          B.Libs.push_back(ReadName(s, eol));
+        ptr = eol + 1;
+      }
+    } /* End of 'ParseBlock' function */
+
+    /* Get directory part of file name function.
+     * ARGUMENTS:
+     *   - file name:
+     *       const std::string &FileName;
+     * RETURNS:
+     *   (std::string) directory with trailing separator (or empty string).
+     */
+    static std::string DirOf( const std::string &FileName )
+    {
+      size_t pos = FileName.find_last_of("\\/");
+
+      return pos == std::string::npos ? std::string() : FileName.substr(0, pos + 1);
+    } /* End of 'DirOf' function */
+
+    /* Load MTL library function.
+     * ARGUMENTS:
+     *   - file name:
+     *       const std::string &FileName;
+     *   - model to add materials to:
+     *       model &Mdl;
+     * RETURNS: None.
+     */
+    static VOID LoadMtl( const std::string &FileName, model &Mdl )
+    {
+      mapped_file F(FileName);
+      const CHAR *ptr = F.Data, *end = F.Data + F.Size;
+      model::material *Mtl = nullptr;
+
+      while (ptr < end)
+      {
+        const CHAR
+          *eol = (const CHAR *)memchr(ptr, '\n', end - ptr),
+          *s;
+
+        if (eol == nullptr)
+          eol = end;
+        ptr = SkipSpaces(ptr, eol);
+
+        if ((s = Keyword(ptr, eol, "newmtl")) != nullptr)
+        {
+          Mdl.Materials.push_back({ReadName(s, eol), vec3(0.1), vec3(0.9), vec3(0), 30, 1, ""});
+          Mtl = &Mdl.Materials.back();
+        }
+        else if (Mtl != nullptr)
+        {
+          vec3 *K = nullptr;
+
+          if ((s = Keyword(ptr, eol, "Ka")) != nullptr)
+            K = &Mtl->Ka;
+          else if ((s = Keyword(ptr, eol, "Kd")) != nullptr)
+            K = &Mtl->Kd;
+          else if ((s = Keyword(ptr, eol, "Ks")) != nullptr)
+            K = &Mtl->Ks;
+          if (K != nullptr)
+          {
+            s = ReadFloat(s, eol, (*K)[0]);
+            s = ReadFloat(s, eol, (*K)[1]);
+            ReadFloat(s, eol, (*K)[2]);
+          }
+          else if ((s = Keyword(ptr, eol, "Ns")) != nullptr)
+            ReadFloat(s, eol, Mtl->Ph);
+          else if ((s = Keyword(ptr, eol, "d")) != nullptr)
+            ReadFloat(s, eol, Mtl->Trans);
+          else if ((s = Keyword(ptr, eol, "Tr")) != nullptr)
+          {
+            FLT Tr = 0;
+
+            ReadFloat(s, eol, Tr);
+            Mtl->Trans = 1 - Tr;
+          }
+          else if ((s = Keyword(ptr, eol, "map_Kd")) != nullptr)
+            Mtl->TexFile = ReadName(s, eol);
+        }
+        ptr = eol + 1;
+      }
+    } /* End of 'LoadMtl' function */
+
+    /* Cache file header */
+    struct cache_header
+    {
+      DWORD Sign;         // 'OBJC'
+      DWORD Version;      // Cache version
+      UINT64 SrcSize;     // Source file size
+      UINT64 SrcTime;     // Source file last write time
+      DWORD NumOfV;       // Number of vertices
+      DWORD NumOfGroups;  // Number of groups
+      DWORD NumOfMtls;    // Number of materials
+      DWORD NumOfLibs;    // Number of material libraries (each is stored with its size and time)
+    }; /* End of 'cache_header' struct */
+
+    /* Get source file stamp function.
+     * ARGUMENTS:
+     *   - file name:
+     *       const std::string &FileName;
+     *   - size and last write time to fill:
+     *       UINT64 &Size, &Time;
+     * RETURNS:
+     *   (BOOL) TRUE if success, FALSE otherwise (stamp is zero).
+     */
+    static BOOL GetStamp( const std::string &FileName, UINT64 &Size, UINT64 &Time )
+    {
+      WIN32_FILE_ATTRIBUTE_DATA Attr;
+
+      Size = Time = 0;
+      if (!GetFileAttributesEx(FileName.c_str(), GetFileExInfoStandard, &Attr))
+        return FALSE;
+      Size = ((UINT64)Attr.nFileSizeHigh << 32) | Attr.nFileSizeLow;
+      Time = ((UINT64)Attr.ftLastWriteTime.dwHighDateTime << 32) | Attr.ftLastWriteTime.dwLowDateTime;
+      return TRUE;
+    } /* End of 'GetStamp' function */
+  } /* end of 'obj' namespace */
+} /* end of 'digl' namespace */
+
+/* Parse OBJ file without cache function.
+ * ARGUMENTS:
+ *   - file name:
+ *       const std::string &FileName;
+ *   - model to fill:
+ *       model &Mdl;
+ * RETURNS:
+ *   (BOOL) TRUE if success, FALSE otherwise.
+ */
+BOOL digl::obj::Parse( const std::string &FileName, model &Mdl )
+{
+  mapped_file F(FileName);
+
+  if (F.Data == nullptr)
+    return FALSE;
+
+  /* Split file at line boundaries and parse blocks in parallel */
+  const size_t MinBlock = 1 << 20;
+  INT NumOfBlocks = parallel::NumOfBlocks(F.Size, MinBlock);
+  std::vector<block> Blocks(NumOfBlocks);
+  std::vector<const CHAR *> Bounds(NumOfBlocks + 1);
+
+  Bounds[0] = F.Data;
+  Bounds[NumOfBlocks] = F.Data + F.Size;
+  for (INT b = 1; b < NumOfBlocks; b++)
+  {
+    const CHAR *ptr = F.Data + F.Size * b / NumOfBlocks;
+
+    if (ptr < Bounds[b - 1])
+      ptr = Bounds[b - 1];
+    while (ptr < Bounds[NumOfBlocks] && ptr[-1] != '\n')
+      ptr++;
+    Bounds[b] = ptr;
+  }
+  parallel::For(NumOfBlocks, [&]( size_t Begin, size_t End, INT )
+    {
+      for (size_t b = Begin; b < End; b++)
+        ParseBlock(Bounds[b], Bounds[b + 1], Blocks[b]);
+    });
+
+  /* Blocks prefix sums */
+  std::vector<size_t> PStart(NumOfBlocks + 1, 0), TStart(NumOfBlocks + 1, 0),
+    NStart(NumOfBlocks + 1, 0), CStart(NumOfBlocks + 1, 0);
+  for (INT b = 0; b < NumOfBlocks; b++)
+  {
+    PStart[b + 1] = PStart[b] + Blocks[b].P.size();
+    TStart[b + 1] = TStart[b] + Blocks[b].T.size();
+    NStart[b + 1] = NStart[b] + Blocks[b].N.size();
+    CStart[b + 1] = CStart[b] + Blocks[b].Corners.size();
+  }
+  if (PStart[NumOfBlocks] == 0 || CStart[NumOfBlocks] == 0)
+    return FALSE;
+
+  /* Merge blocks resolving relative and invalid indices */
+  std::vector<vec3> P(PStart[NumOfBlocks]), N(NStart[NumOfBlocks]);
+  std::vector<vec2> T(TStart[NumOfBlocks]);
+  std::vector<corner> Corners(CStart[NumOfBlocks]);
+  std::vector<BYTE> IsNormalMissed(NumOfBlocks, FALSE);
+
+  parallel::For(NumOfBlocks, [&]( size_t Begin, size_t End, INT )
+    {
+      for (size_t b = Begin; b < End; b++)
+      {
+        block &B = Blocks[b];
+
+        std::copy(B.P.begin(), B.P.end(), P.begin() + PStart[b]);
+        std::copy(B.T.begin(), B.T.end(), T.begin() + TStart[b]);
+        std::copy(B.N.begin(), B.N.end(), N.begin() + NStart[b]);
+
+        /* Resolve index */
+        auto Resolve = []( INT I, size_t Start, size_t Count ) -> INT
+        {
+          if (I == NoIndex)
+            return NoIndex;
+          if (I < 0)
+            I = (INT)Start + I + RelBias;
+          return I >= 0 && (size_t)I < Count ? I : NoIndex;
+        };
+        for (size_t i = 0; i < B.Corners.size(); i++)
+        {
+          corner &C = Corners[CStart[b] + i];
+
+          C.V = Resolve(B.Corners[i].V, PStart[b], P.size());
+          C.T = Resolve(B.Corners[i].T, TStart[b], T.size());
+          C.N = Resolve(B.Corners[i].N, NStart[b], N.size());
+          if (C.V == NoIndex)
+            B.NumOfBadIndices++;
+          if (C.N == NoIndex)
+            IsNormalMissed[b] = TRUE;
+        }
+        std::vector<corner>().swap(B.Corners);
+      }
+    });
+
+  /* Triangles referring to absent positions make file invalid */
+  size_t NumOfBadIndices = 0;
+  for (auto &B : Blocks)
+    NumOfBadIndices += B.NumOfBadIndices;
+  if (NumOfBadIndices != 0)
+  {
+    CHAR Buf[500];
+
+    sprintf(Buf, "%.300s: %zu invalid position indices in faces\n", FileName.c_str(), NumOfBadIndices);
+    OutputDebugString(Buf);
+    return FALSE;
+  }
+
+  /* Weld corners: hash high bits select shard, then each shard numbers its unique corners */
+  const INT NumOfShards = 64;
+  std::vector<BYTE> Shard(Corners.size());
+  std::vector<INT> LocalId(Corners.size());
+  std::vector<size_t> ShardStart(NumOfShards + 1, 0);
+  std::vector<size_t> Order(Corners.size());
+  std::vector<std::vector<corner>> Unique(NumOfShards);
+
+  parallel::For(Corners.size(), [&]( size_t Begin, size_t End, INT )
+    {
+      for (size_t i = Begin; i < End; i++)
+        Shard[i] = (BYTE)((UINT64)corner_hash()(Corners[i]) >> 58);
+    }, 1 << 16);
+  for (size_t i = 0; i < Corners.size(); i++)
+    ShardStart[Shard[i] + 1]++;
+  for (INT s = 0; s < NumOfShards; s++)
+    ShardStart[s + 1] += ShardStart[s];
+  {
+    std::vector<size_t> Pos(ShardStart.begin(), ShardStart.end() - 1);
+
+    for (size_t i = 0; i < Corners.size(); i++)
+      Order[Pos[Shard[i]]++] = i;
+  }
+  parallel::For(NumOfShards, [&]( size_t Begin, size_t End, INT )
+    {
+      for (size_t s = Begin; s < End; s++)
+      {
+        std::unordered_map<corner, INT, corner_hash> Ids;
+
+        Ids.reserve(ShardStart[s + 1] - ShardStart[s]);
+        for (size_t k = ShardStart[s]; k < ShardStart[s + 1]; k++)
+        {
+          size_t i = Order[k];
+          auto Res = Ids.insert({Corners[i], (INT)Unique[s].size()});
+
+          if (Res.second)
+            Unique[s].push_back(Corners[i]);
+          LocalId[i] = Res.first->second;
+        }
+      }
+    });
+
+  /* Fill welded vertices */
+  std::vector<size_t> VStart(NumOfShards + 1, 0);
+  for (INT s = 0; s < NumOfShards; s++)
+    VStart[s + 1] = VStart[s] + Unique[s].size();
+  Mdl.Positions.resize(VStart[NumOfShards]);
+  Mdl.TexCoords.resize(VStart[NumOfShards]);
+  Mdl.Normals.resize(VStart[NumOfShards]);
+  parallel::For(NumOfShards, [&]( size_t Begin, size_t End, INT )
+    {
+      for (size_t s = Begin; s < End; s++)
+        for (size_t j = 0; j < Unique[s].size(); j++)
+        {
+          const corner &C = Unique[s][j];
+
+          Mdl.Positions[VStart[s] + j] = P[C.V];
+          Mdl.TexCoords[VStart[s] + j] = C.T != NoIndex ? T[C.T] : vec2(0);
+          Mdl.Normals[VStart[s] + j] = C.N != NoIndex ? N[C.N] : vec3(0);
+        }
+    });
+  std::vector<INT> Index(Corners.size());
+  parallel::For(Corners.size(), [&]( size_t Begin, size_t End, INT )
+    {
+      for (size_t i = Begin; i < End; i++)
+        Index[i] = (INT)VStart[Shard[i]] + LocalId[i];
+    }, 1 << 16);
+
+  /* Smooth normals for corners without normal */
+  if (std::find(IsNormalMissed.begin(), IsNormalMissed.end(), TRUE) != IsNormalMissed.end())
+  {
+    std::vector<BYTE> IsMissed(Mdl.Normals.size(), 0);
+
+    for (size_t s = 0; s < Unique.size(); s++)
+      for (size_t j = 0; j < Unique[s].size(); j++)
+        IsMissed[VStart[s] + j] = Unique[s][j].N == NoIndex;
+    for (size_t i = 0; i < Index.size(); i += 3)
+    {
+      vec3
+        &P0 = Mdl.Positions[Index[i]],
+        &P1 = Mdl.Positions[Index[i + 1]],
+        &P2 = Mdl.Positions[Index[i + 2]],
+        FN = (P1 - P0) % (P2 - P0);
+
+      for (INT k = 0; k < 3; k++)
+        if (IsMissed[Index[i + k]])
+          Mdl.Normals[Index[i + k]] += FN;
+    }
+    for (size_t v = 0; v < Mdl.Normals.size(); v++)
+      if (IsMissed[v])
+        Mdl.Normals[v] = Mdl.Normals[v].Normalizing();
+  }
+
+  /* Split triangles to material groups */
+  std::map<std::string, INT> GroupNo;
+  std::vector<std::pair<size_t, INT>> Switches; // (first triangle, group)
+
+  Mdl.Groups.clear();
+  Mdl.Groups.push_back({"", {}});
+  GroupNo[""] = 0;
+  Switches.push_back({0, 0});
+  for (INT b = 0; b < NumOfBlocks; b++)
+    for (auto &Sw : Blocks[b].Switches)
+    {
+      auto Res = GroupNo.insert({Sw.second, (INT)Mdl.Groups.size()});
+
+      if (Res.second)
+        Mdl.Groups.push_back({Sw.second, {}});
+      Switches.push_back({CStart[b] / 3 + Sw.first, Res.first->second});
+    }
+  Switches.push_back({Index.size() / 3, 0});
+  for (size_t k = 0; k + 1 < Switches.size(); k++)
+  {
+    std::vector<INT> &GI = Mdl.Groups[Switches[k].second].Index;
+
+    GI.insert(GI.end(), Index.begin() + Switches[k].first * 3, Index.begin() + Switches[k + 1].first * 3);
+  }
+
+  /* Optimize groups for vertex cache and overdraw, reorder vertices for fetch */
+  meshopt::stats Before = meshopt::Analyze(Index.data(), Index.size(), Mdl.Positions.size());
+  std::vector<INT> Remap(Mdl.Positions.size(), -1);
+  INT NumOfV = 0;
+
+  Index.clear();
+  for (auto &G : Mdl.Groups)
+  {
+    G.Index.resize(meshopt::RemoveDegenerate(G.Index.data(), G.Index.size()));
+    meshopt::OptimizeVertexCache(G.Index.data(), G.Index.size(), Mdl.Positions.size());
+    meshopt::OptimizeOverdraw(G.Index.data(), G.Index.size(), (const BYTE *)Mdl.Positions.data(),
+                              sizeof(vec3), Mdl.Positions.size());
+    for (INT &I : G.Index)
+    {
+      if (Remap[I] < 0)
+        Remap[I] = NumOfV++;
+      I = Remap[I];
+    }
+    Index.insert(Index.end(), G.Index.begin(), G.Index.end());
+  }
+  meshopt::ApplyRemap(Mdl.Positions, Remap, NumOfV);
+  meshopt::ApplyRemap(Mdl.TexCoords, Remap, NumOfV);
+  meshopt::ApplyRemap(Mdl.Normals, Remap, NumOfV);
+  meshopt::Report(FileName, Before, meshopt::Analyze(Index.data(), Index.size(), NumOfV));
+
+  for (size_t g = 0; g < Mdl.Groups.size(); )
+    if (Mdl.Groups[g].Index.empty())
+      Mdl.Groups.erase(Mdl.Groups.begin() + g);
+    else
+      g++;
+
+  /* Material libraries */
+  std::string Dir = DirOf(FileName);
+  std::vector<std::string> Libs;
+
+  Mdl.Materials.clear();
+  for (auto &B : Blocks)
+    for (auto &Lib : B.Libs)
+      if (std::find(Libs.begin(), Libs.end(), Lib) == Libs.end())
+      {
+        Libs.push_back(Lib);
+        LoadMtl(Dir + Lib, Mdl);
+      }
+  Mdl.MtlLibs = Libs;
+  return TRUE;
+} /* End of 'digl::obj::Parse' function */
+
+/* Load OBJ file (using binary cache if it is actual) function.
+ * ARGUMENTS:
+ *   - file name:
+ *       const std::string &FileName;
+ *   - model to fill:
+ *       model &Mdl;
+ * RETURNS:
+ *   (BOOL) TRUE if success, FALSE otherwise.
+ */
+BOOL digl::obj::Load( const std::string &FileName, model &Mdl )
+{
+  cache_header Hdr = {*(DWORD *)"OBJC", 3};
+  std::string
+    CacheName = FileName + ".bin",
+    Dir = DirOf(FileName);
+
+  if (!GetStamp(FileName, Hdr.SrcSize, Hdr.SrcTime))
+    return FALSE;
+
+  /* Try cache (counts are checked against file size before allocation, any invalid data makes source be parsed) */
+  {
+    mapped_file F(CacheName);
+    const BYTE *ptr = (const BYTE *)F.Data, *end = ptr + F.Size;
+    const cache_header *CHdr = (const cache_header *)ptr;
+
+    /* Read bytes with bounds check */
+    auto Get = [&]( VOID *Data, size_t Size ) -> BOOL
+    {
+      if ((size_t)(end - ptr) < Size)
+        return FALSE;
+      memcpy(Data, ptr, Size);
+      ptr += Size;
+      return TRUE;
+    };
+    /* Read string with bounds check */
+    auto GetStr = [&]( std::string &S ) -> BOOL
+    {
+      DWORD Len;
+
+      if (!Get(&Len, 4) || (size_t)(end - ptr) < Len)
+        return FALSE;
+      S.assign((const CHAR *)ptr, Len);
+      ptr += Len;
+      return TRUE;
+    };
+
+    if (F.Size >= sizeof(cache_header) && CHdr->Sign == Hdr.Sign && CHdr->Version == Hdr.Version &&
+        CHdr->SrcSize == Hdr.SrcSize && CHdr->SrcTime == Hdr.SrcTime)
+    {
+      /* Smallest stored sizes: vertex, group (empty name and indices), material (empty strings), library */
+      const UINT64
+        VSize = sizeof(vec3) * 2 + sizeof(vec2),
+        GSize = 4 + 4,
+        MSize = 4 + sizeof(vec3) * 3 + sizeof(FLT) * 2 + 4,
+        LSize = 4 + 8 + 8;
+      BOOL IsOk =
+        (UINT64)CHdr->NumOfV * VSize + (UINT64)CHdr->NumOfGroups * GSize +
+        (UINT64)CHdr->NumOfMtls * MSize + (UINT64)CHdr->NumOfLibs * LSize <= F.Size - sizeof(cache_header);
+
+      if (IsOk)
+      {
+        DWORD NumOfV = CHdr->NumOfV;
+
+        ptr += sizeof(cache_header);
+        Mdl.Positions.resize(NumOfV);
+        Mdl.TexCoords.resize(NumOfV);
+        Mdl.Normals.resize(NumOfV);
+        Mdl.Groups.resize(CHdr->NumOfGroups);
+        Mdl.Materials.resize(CHdr->NumOfMtls);
+        Mdl.MtlLibs.resize(CHdr->NumOfLibs);
+        IsOk = Get(Mdl.Positions.data(), sizeof(vec3) * NumOfV) &&
+               Get(Mdl.TexCoords.data(), sizeof(vec2) * NumOfV) &&
+               Get(Mdl.Normals.data(), sizeof(vec3) * NumOfV);
+        for (auto &G : Mdl.Groups)
+        {
+          DWORD NumOfI = 0;
+
+          if (!IsOk || !GetStr(G.Material) || !Get(&NumOfI, 4) || (size_t)(end - ptr) < sizeof(INT) * NumOfI)
+          {
+            IsOk = FALSE;
+            break;
+          }
+          G.Index.resize(NumOfI);
+          Get(G.Index.data(), sizeof(INT) * NumOfI);
+          for (auto I : G.Index)
+            if ((DWORD)I >= NumOfV)
+            {
+              IsOk = FALSE;
+              break;
+            }
+        }
+        for (auto &M : Mdl.Materials)
+          if (!IsOk || !GetStr(M.Name) || !Get(&M.Ka, sizeof(vec3)) || !Get(&M.Kd, sizeof(vec3)) ||
+              !Get(&M.Ks, sizeof(vec3)) || !Get(&M.Ph, sizeof(FLT)) || !Get(&M.Trans, sizeof(FLT)) ||
+              !GetStr(M.TexFile))
+          {
+            IsOk = FALSE;
+            break;
+          }
+
+        /* Material libraries must be unchanged too */
+        for (auto &Lib : Mdl.MtlLibs)
+        {
+          UINT64 Size, Time, LibSize, LibTime;
+
+          if (!IsOk || !GetStr(Lib) || !Get(&Size, 8) || !Get(&Time, 8))
+          {
+            IsOk = FALSE;
+            break;
+          }
+          GetStamp(Dir + Lib, LibSize, LibTime);
+          if (Size != LibSize || Time != LibTime)
+          {
+            IsOk = FALSE;
+            break;
+          }
+        }
+      }
+      if (IsOk)
+        return TRUE;
+      Mdl = model();
+    }
+  }
+
+  /* Parse source and write cache */
+  if (!Parse(FileName, Mdl))
+    return FALSE;
+
+  std::vector<BYTE> Out;
+
+  /* Write bytes */
+  auto Put = [&]( const VOID *Data, size_t Size )
+  {
+    Out.insert(Out.end(), (const BYTE *)Data, (const BYTE *)Data + Size);
+  };
+  /* Write string */
+  auto PutStr = [&]( const std::string &S )
+  {
+    DWORD Len = (DWORD)S.size();
+
+    Put(&Len, 4);
+    Put(S.data(), Len);
+  };
+
+  Hdr.NumOfV = (DWORD)Mdl.Positions.size();
+  Hdr.NumOfGroups = (DWORD)Mdl.Groups.size();
+  Hdr.NumOfMtls = (DWORD)Mdl.Materials.size();
+  Hdr.NumOfLibs = (DWORD)Mdl.MtlLibs.size();
+  Put(&Hdr, sizeof(Hdr));
+  Put(Mdl.Positions.data(), sizeof(vec3) * Hdr.NumOfV);
+  Put(Mdl.TexCoords.data(), sizeof(vec2) * Hdr.NumOfV);
+  Put(Mdl.Normals.data(), sizeof(vec3) * Hdr.NumOfV);
+  for (auto &G : Mdl.Groups)
+  {
+    DWORD NumOfI = (DWORD)G.Index.size();
+
+    PutStr(G.Material);
+    Put(&NumOfI, 4);
+    Put(G.Index.data(), sizeof(INT) * NumOfI);
+  }
+  for (auto &M : Mdl.Materials)
+  {
+    PutStr(M.Name);
+    Put(&M.Ka, sizeof(vec3));
+    Put(&M.Kd, sizeof(vec3));
+    Put(&M.Ks, sizeof(vec3));
+    Put(&M.Ph, sizeof(FLT));
+    Put(&M.Trans, sizeof(FLT));
+    PutStr(M.TexFile);
+  }
+  for (auto &Lib : Mdl.MtlLibs)
+  {
+    UINT64 Size, Time;
+
+    GetStamp(Dir + Lib, Size, Time);
+    PutStr(Lib);
+    Put(&Size, 8);
+    Put(&Time, 8);
+  }
+
+  FILE *F;
+  if ((F = fopen(CacheName.c_str(), "wb")) != nullptr)
+  {
+    fwrite(Out.data(), 1, Out.size(), F);
+    fclose(F);
+  }
+  return TRUE;
+} /* End of 'digl::obj::Load' function */
+
+/* END OF 'obj.cpp' FILE */
@@ -0,0 +1,90 @@
+/***************************************************************
+ * Copyright (C) 2020
+ *    Computer Graphics Support Group of 30 Phys-Math Gymnasium
+ ***************************************************************/
+
+/* FILE NAME   : obj.h
+ * PURPOSE     : Wavefront OBJ/MTL importer header file.
+ * PROGRAMMER  : Dmitriy Vlasov.
+ * LAST UPDATE : 19.10.2020
+ * NOTE        : Namespace 'digl'.
+ *
+ *   File is memory mapped and parsed in parallel by blocks split at line
+ *   boundaries, polygons are triangulated as fans, vertices with same
+ *   position/texture/normal indices are welded. Result is cached in
+ *   '<file>.bin' binary file which is used while source is unchanged.
+ *
+ * No part of this file may be changed without agreement of
+ * Computer Graphics Support Group of 30 Phys-Math Gymnasium.
+ */
+
+#ifndef __OBJ_H_
+#define __OBJ_H_
+
+#include "../../../def.h"
+
+#include <string>
+#include <vector>
+
+/* Animation project namespace */
+namespace digl
+{
+  /* Wavefront OBJ format namespace */
+  namespace obj
+  {
+    /* Imported model representation type */
+    class model
+    {
+    public:
+      /* Triangles group with same material */
+      struct group
+      {
+        std::string Material; // Material name ('usemtl')
+        std::vector<INT> Index; // Triangle list indices
+      }; /* End of 'group' struct */
+
+      /* Material from MTL library */
+      struct material
+      {
+        std::string Name;
+        vec3 Ka, Kd, Ks;
+        FLT Ph, Trans;
+        std::string TexFile; // Diffuse texture ('map_Kd') path relative to model file
+      }; /* End of 'material' struct */
+
+      /* Welded vertices */
+      std::vector<vec3> Positions, Normals;
+      std::vector<vec2> TexCoords;
+
+      std::vector<group> Groups;
+      std::vector<material> Materials;
+      std::vector<std::string> MtlLibs; // Material library file names ('mtllib', relative to model file)
+    }; /* End of 'model' class */
+
+    /* Load OBJ file (using binary cache if it is actual) function.
+     * ARGUMENTS:
+     *   - file name:
+     *       const std::string &FileName;
+     *   - model to fill:
+     *       model &Mdl;
+     * RETURNS:
+     *   (BOOL) TRUE if success, FALSE otherwise.
+     */
+    BOOL Load( const std::string &FileName, model &Mdl );
+
+    /* Parse OBJ file without cache function.
+     * ARGUMENTS:
+     *   - file name:
+     *       const std::string &FileName;
+     *   - model to fill:
+     *       model &Mdl;
+     * RETURNS:
+     *   (BOOL) TRUE if success, FALSE otherwise.
+     */
+    BOOL Parse( const std::string &FileName, model &Mdl );
+  } /* end of 'obj' namespace */
+} /* end of 'digl' namespace */
+
+#endif /* __OBJ_H_ */
+
+/* END OF 'obj.h' FILE */
@@ -64,10 +64,20 @@ namespace  digl
      *   - 
      * RETURNS: None.
      */
-    texture( const std::string &InName, const std::string &FileName ) : W(0), H(0), TexId(-1), Name(InName)
+    texture( const std::string &InName, const std::string &FileName ) : texture(InName, image(FileName))
     {
-      image Img(FileName);
+    } /* End of 'texture' function */
 
+    /* Texture constructor.
+     * ARGUMENTS:
+     *   - name:
+     *       const std::string &InName;
+     *   - loaded image:
+     *       const image &Img;
+     * RETURNS: None.
+     */
+    texture( const std::string &InName, const image &Img ) : W(0), H(0), TexId(-1), Name(InName)
+    {
       W = Img.W;
       H = Img.H;
 
@@ -1,20 +0,0 @@
-/***************************************************************
- * Copyright (C) 2020
- *    Computer Graphics Support Group of 30 Phys-Math Gymnasium
- ***************************************************************/
-
-/* FILE NAME   : render.h
- * PURPOSE     : render header file.
- * PROGRAMMER  : Dmitriy Vlasov.
- * LAST UPDATE : 25.07.2020
- *
- * No part of this file may be changed without agreement of
- * Computer Graphics Support Group of 30 Phys-Math Gymnasium.
- */
-
-#include "topology.h"
-
-/* Topology descriptor */
-const CHAR *digl::vertex::std::Descr = "f3f2f3f4";  // f i 1 2 3 4
-
-/* END OF 'topology.cpp' FILE */
@@ -18,6 +18,9 @@
 
 #include "../../../def.h"
 #include "../../../stock.h"
+#include "obj.h"
+
+#include <cstddef>
 
 /* Animation project namespace */
 namespace digl
@@ -34,6 +37,105 @@ namespace digl
   /* Vertex namespace */
   namespace vertex
   {
+    /* Number of attribute locations used by shaders */
+    const INT NumOfLocations = 4;
+
+    /* Vertex attribute descriptor */
+    struct attribute
+    {
+      INT Location;        // Shader attribute location
+      INT NumOfComponents; // Number of components (1..4)
+      UINT Type;           // Component type ('GL_FLOAT', 'GL_HALF_FLOAT', ...)
+      BOOL IsNormalized;   // Integer components are mapped to [0; 1] or [-1; 1]
+      size_t Offset;       // Offset in vertex structure
+
+      /* Component size in bytes function.
+       * ARGUMENTS: None.
+       * RETURNS:
+       *   (size_t) attribute size in bytes.
+       */
+      constexpr size_t Size( VOID ) const
+      {
+        return
+          Type == GL_INT_2_10_10_10_REV ? 4 :
+          Type == GL_FLOAT ? 4 * NumOfComponents :
+          Type == GL_HALF_FLOAT || Type == GL_SHORT || Type == GL_UNSIGNED_SHORT ? 2 * NumOfComponents :
+          NumOfComponents;
+      } /* End of 'Size' function */
+
+      /* Float attribute function.
+       * ARGUMENTS:
+       *   - location, number of components and offset:
+       *       INT Loc, N;
+       *       size_t Offset;
+       * RETURNS:
+       *   (attribute) descriptor.
+       */
+      static constexpr attribute Float( INT Loc, INT N, size_t Offset )
+      {
+        return {Loc, N, GL_FLOAT, FALSE, Offset};
+      } /* End of 'Float' function */
+
+      /* Half float attribute function.
+       * ARGUMENTS:
+       *   - location, number of components and offset:
+       *       INT Loc, N;
+       *       size_t Offset;
+       * RETURNS:
+       *   (attribute) descriptor.
+       */
+      static constexpr attribute Half( INT Loc, INT N, size_t Offset )
+      {
+        return {Loc, N, GL_HALF_FLOAT, FALSE, Offset};
+      } /* End of 'Half' function */
+
+      /* Unsigned normalized 8-bit attribute function.
+       * ARGUMENTS:
+       *   - location, number of components and offset:
+       *       INT Loc, N;
+       *       size_t Offset;
+       * RETURNS:
+       *   (attribute) descriptor.
+       */
+      static constexpr attribute Unorm8( INT Loc, INT N, size_t Offset )
+      {
+        return {Loc, N, GL_UNSIGNED_BYTE, TRUE, Offset};
+      } /* End of 'Unorm8' function */
+
+      /* Signed normalized 10-10-10-2 attribute function.
+       * ARGUMENTS:
+       *   - location and offset:
+       *       INT Loc;
+       *       size_t Offset;
+       * RETURNS:
+       *   (attribute) descriptor.
+       */
+      static constexpr attribute Snorm1010102( INT Loc, size_t Offset )
+      {
+        return {Loc, 4, GL_INT_2_10_10_10_REV, TRUE, Offset};
+      } /* End of 'Snorm1010102' function */
+    }; /* End of 'attribute' struct */
+
+    /* Vertex layout (specialized for every vertex type with 'Attributes' table) */
+    template<class VertexType>
+      struct layout;
+
+    /* Check vertex layout at compile time function.
+     * ARGUMENTS: None.
+     * RETURNS:
+     *   (BOOL) TRUE if all attributes fit in vertex and have valid locations.
+     */
+    template<class VertexType>
+      constexpr BOOL IsLayoutValid( VOID )
+      {
+        for (const attribute &A : layout<VertexType>::Attributes)
+          if (A.Location < 0 || A.Location >= NumOfLocations ||
+              A.NumOfComponents < 1 || A.NumOfComponents > 4 ||
+              A.Offset + A.Size() > sizeof(VertexType))
+            return FALSE;
+        return TRUE;
+      } /* End of 'IsLayoutValid' function */
+
     /* Standard class */ 
     class std
     {
@@ -42,7 +144,6 @@ namespace digl
       vec2 T;
       vec3 N;
       vec4 C;
-      static const char *Descr;
 
       /* Vertex constructor.
        * ARGUMENTS: None.
@@ -53,20 +154,138 @@ namespace digl
       {
       } /* End of 'std' function */
     }; /* End of 'std' class */
+
+    /* Standard vertex layout */
+    template<>
+      struct layout<std>
+      {
+        static constexpr attribute Attributes[] =
+        {
+          attribute::Float(0, 3, offsetof(std, P)),
+          attribute::Float(1, 2, offsetof(std, T)),
+          attribute::Float(2, 3, offsetof(std, N)),
+          attribute::Float(3, 4, offsetof(std, C)),
+        };
+      }; /* End of 'layout' struct */
+
+    /* Packed vertex class (20 bytes, color is taken as white) */
+    class packed
+    {
+    public:
+      vec3 P;    // Position
+      WORD T[2]; // Texture coordinates (half float)
+      DWORD N;   // Normal (signed normalized 10-10-10-2)
+
+      /* Vertex constructor.
+       * ARGUMENTS:
+       *   - position, texture coordinates and normal:
+       *       const vec3 &P;
+       *       const vec2 &T;
+       *       const vec3 &N;
+       * RETURNS: None.
+       */
+      packed( const vec3 &P = vec3(0), const vec2 &T = vec2(0), const vec3 &N = vec3(0) ) :
+        P(P), T{mth::FloatToHalf(T[0]), mth::FloatToHalf(T[1])}, N(mth::PackSnorm1010102(N))
+      {
+      } /* End of 'packed' function */
+
+      /* Vertex from standard vertex constructor.
+       * ARGUMENTS:
+       *   - standard vertex:
+       *       const std &V;
+       * RETURNS: None.
+       */
+      explicit packed( const std &V ) : packed(V.P, V.T, V.N)
+      {
+      } /* End of 'packed' function */
+
+      /* Convert to standard vertex function.
+       * ARGUMENTS: None.
+       * RETURNS:
+       *   (std) unpacked vertex.
+       */
+      explicit operator std( VOID ) const
+      {
+        return std(P, vec2(mth::HalfToFloat(T[0]), mth::HalfToFloat(T[1])), mth::UnpackSnorm1010102(N));
+      } /* End of 'operator std' function */
+    }; /* End of 'packed' class */
+
+    /* Packed vertex layout */
+    template<>
+      struct layout<packed>
+      {
+        static constexpr attribute Attributes[] =
+        {
+          attribute::Float(0, 3, offsetof(packed, P)),
+          attribute::Half(1, 2, offsetof(packed, T)),
+          attribute::Snorm1010102(2, offsetof(packed, N)),
+        };
+      }; /* End of 'layout' struct */
+
+    /* Packed vertex with color class (24 bytes, for meshes with vertex colors) */
+    class packed_color
+    {
+    public:
+      vec3 P;    // Position
+      WORD T[2]; // Texture coordinates (half float)
+      DWORD N;   // Normal (signed normalized 10-10-10-2)
+      DWORD C;   // Color (unsigned normalized 8-bit components, clamped to [0; 1])
+
+      /* Vertex from standard vertex constructor.
+       * ARGUMENTS:
+       *   - standard vertex:
+       *       const std &V;
+       * RETURNS: None.
+       */
+      explicit packed_color( const std &V = std() ) :
+        P(V.P), T{mth::FloatToHalf(V.T[0]), mth::FloatToHalf(V.T[1])},
+        N(mth::PackSnorm1010102(V.N)), C(mth::PackUnorm8x4(V.C))
+      {
+      } /* End of 'packed_color' function */
+    }; /* End of 'packed_color' class */
+
+    /* Packed vertex with color layout */
+    template<>
+      struct layout<packed_color>
+      {
+        static constexpr attribute Attributes[] =
+        {
+          attribute::Float(0, 3, offsetof(packed_color, P)),
+          attribute::Half(1, 2, offsetof(packed_color, T)),
+          attribute::Snorm1010102(2, offsetof(packed_color, N)),
+          attribute::Unorm8(3, 4, offsetof(packed_color, C)),
+        };
+      }; /* End of 'layout' struct */
+
+    static_assert(sizeof(packed) == 20, "Packed vertex must be 20 bytes");
+    static_assert(sizeof(packed_color) == 24, "Packed vertex with color must be 24 bytes");
+    static_assert(IsLayoutValid<std>() && IsLayoutValid<packed>() && IsLayoutValid<packed_color>(), "Invalid vertex layout");
   } /* end of 'vertex' namespace */
 
 
   /* Topology namespace */
   namespace topology
   {
-    /* Base topology class */
-    template<class VertexType>
+    /* Level of detail (range of index array) */
+    struct lod
+    {
+      INT Start, Count; // First index and number of indices
+      FLT Error;        // Geometric error in model space units
+    }; /* End of 'lod' struct */
+
+    /* Base topology class.
+     * Indices are 'INT' (-1 is primitive restart, narrowed on upload) or
+     * already narrowed 'WORD'/'UINT' ones (largest value is restart) which
+     * are uploaded as is.
+     */
+    template<class VertexType, class IndexType = INT>
       class base
       {
       public:
         prim_type PrimType = prim_type::TRIMESH;
         stock<VertexType> Vertex;
-        stock<INT> Index;
+        stock<IndexType> Index;
+        stock<lod> Lods; // Levels of detail as ranges of 'Index' (empty if there is only full mesh)
 
         /* Topology constructor.
          * ARGUMENTS: None.
@@ -80,7 +299,7 @@ namespace digl
          * ARGUMENTS: /////////////////////////////None.
          * RETURNS: None.
          */
-        base( prim_type NewPrimType, const stock<VertexType> &V = {}, const stock<INT> &I = {} ) :
+        base( prim_type NewPrimType, const stock<VertexType> &V = {}, const stock<IndexType> &I = {} ) :
           PrimType(NewPrimType), Vertex(V), Index(I)
         {
         } /* End of 'base' constructor */
@@ -221,47 +440,26 @@ namespace digl
         {
         } /* End of 'trimesh' function */
 
-        /* Load topo from file function .
+        /* Load topo from OBJ file function.
          * ARGUMENTS:
          *   - file name:
-         *       const CHAR *FileName;
-         * RETUNRNS: None.
+         *       const std::string FileName;
+         * RETUNRNS:
+         *   (BOOL) TRUE if success, FALSE otherwise.
          */
         BOOL LoadFile( const std::string FileName )
         {
-          FILE *F;
-          CHAR Buf[1000];
+          obj::model Mdl;
 
-          if ((F = fopen(FileName.c_str(), "r")) == NULL )
+          if (!obj::Load(FileName, Mdl))
             return FALSE;
 
-          while (fgets(Buf, sizeof(Buf), F) != NULL)
-            if (Buf[0] == 'v' && Buf[1] == ' ')
-            {
-              DBL x, y, z;
-
-              sscanf(Buf + 2, "%lf%lf%lf", &x, &y, &z);
-              this->Vertex << vertex::std(vec3(x, y, z));
-            }
-            else if (Buf[0] == 'f' && Buf[1] == ' ')
-            {
-              INT n1, n2, n3;
-
-              const CHAR *f1 = "%d %d %d",
-                         *f2 = "%d/%*d %d/%*d %d/%*d",
-                         *f3 = "%d//%*d %d//%*d %d//%*d",
-                         *f4 = "%d/%*d/%*d%d/%*d/%*d%d/%*d/%*d";
-
-              sscanf(Buf + 2, f4, &n1, &n2, &n3) == 3 ||
-                sscanf(Buf + 2, f3, &n1, &n2, &n3) == 3 ||
-                sscanf(Buf + 2, f2, &n1, &n2, &n3) == 3 ||
-                sscanf(Buf + 2, f1, &n1, &n2, &n3) == 3;
-
-              this->Index << n1 - 1;
-              this->Index << n2 - 1;
-              this->Index << n3 - 1;
-            }
-          fclose(F);
+          this->Vertex.resize(Mdl.Positions.size());
+          for (size_t i = 0; i < Mdl.Positions.size(); i++)
+            this->Vertex[i] = VertexType(Mdl.Positions[i], Mdl.TexCoords[i], Mdl.Normals[i]);
+          this->Index.clear();
+          for (auto &G : Mdl.Groups)
+            this->Index.insert(this->Index.end(), G.Index.begin(), G.Index.end());
           return TRUE;
         } /* End of 'LoadFile' function */
 
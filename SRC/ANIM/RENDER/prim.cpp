@@ -13,26 +13,26 @@
  */
 
 #include "prim.h"
+#include "resources/g3d2.h"
 #include "../anim.h"
 
 using namespace digl;
 
-struct MaterialG3DM
-{
-  CHAR Name[300];
-  vec3 Ka, Kd, Ks;
-  FLT Ph, Trans;
-  INT Tex[8];
-  CHAR ShaderStr[300];
-  INT ShdNo;
-};
-
-struct TextureG3DM
+/* Get file last write time function.
+ * ARGUMENTS:
+ *   - file name:
+ *       const std::string &FileName;
+ * RETURNS:
+ *   (UINT64) last write time (0 if there is no file).
+ */
+static UINT64 GetWriteTime( const std::string &FileName )
 {
-  CHAR Name[300];
-  INT W, H;
-  UINT TexId;
-};
+  WIN32_FILE_ATTRIBUTE_DATA Attr;
+
+  if (!GetFileAttributesEx(FileName.c_str(), GetFileExInfoStandard, &Attr))
+    return 0;
+  return ((UINT64)Attr.ftLastWriteTime.dwHighDateTime << 32) | Attr.ftLastWriteTime.dwLowDateTime;
+} /* End of 'GetWriteTime' function */
 
 /* Load topo from file function.
  * ARGUMENTS:
@@ -104,14 +104,15 @@ primitives::primitives * primitives::primitives::LoadG3DM( const CHAR *FileName,
     INT *I = (INT *)ptr;
     ptr += sizeof(INT) * NoofI;
 
-    topology::base<vertex::std> Topo;
+    /* Transform verticies, they are uploaded in packed format with colors */
+    topology::base<vertex::packed_color> Topo;
 
-    /* Transform verticies */
+    Topo.Vertex.reserve(NoofV);
     for (i = 0; i < NoofV; i++)
     {
       V[i].P = LoadTransfrom.TransformPoint(V[i].P);
       V[i].N = LoadTransfrom.TransformVector(V[i].N);
-      Topo.Vertex << V[i];
+      Topo.Vertex << vertex::packed_color(V[i]);
     }
     for (i = 0; i < NoofI; i++)
     {
@@ -119,49 +120,166 @@ primitives::primitives * primitives::primitives::LoadG3DM( const CHAR *FileName,
     }
 
     /* Add a new primitive */
-    prim *Pr = AC->PrimCreate(Topo);;
+    prim *Pr = AC->PrimCreate(Topo);
     Prims << Pr;
     MtlNoTable[Pr] = MtlNo;
   }
 
-  /* Textures id table */
-  std::map<material *, std::vector<INT>> TexIdTable;
-
-  /* Read materials */
-  for (m = 0; m < NoofM; m++)
-  {
-    MaterialG3DM *Mtl = (MaterialG3DM *)ptr;
-
-    for (auto el : MtlNoTable)
-      if (el.second == m)
-      {
-        el.first->Material = AC->MaterialCreate(Shd, Mtl->Ka, Mtl->Kd, Mtl->Ks, Mtl->Ph, Mtl->Trans);
+  /* Materials are created after textures they refer to */
+  MaterialG3DM *Mtls = (MaterialG3DM *)ptr;
+  ptr += sizeof(MaterialG3DM) * NoofM;
 
-        for (int k = 0; k < 8; k++)
-          if (k < 0 || Mtl->Tex[k] != -1)
-            TexIdTable[el.first->Material].push_back(Mtl->Tex[k]);
-      }
-
-    ptr += sizeof(MaterialG3DM);
-  }
-
-  /* Read textures */
+  /* Read textures (each texture is created once) */
+  std::vector<texture *> Texs(NoofT);
   for (t = 0; t < NoofT; t++)
   {
     TextureG3DM *Tex = (TextureG3DM *)ptr;
     ptr += sizeof(TextureG3DM);
-    for (auto el : TexIdTable)
-      for (int k = 0; k < el.second.size(); k++)
-        if (el.second[k] == t)
-          el.first->Textures.push_back(AC->TextureCreate( Tex->Name, Tex->W, Tex->H, (DWORD *)ptr ));
-
+    Texs[t] = AC->TextureCreate(Tex->Name, Tex->W, Tex->H, (DWORD *)ptr);
     ptr += 4 * Tex->W * Tex->H;
   }
 
-  fclose(F);
+  /* Create used materials */
+  std::vector<material *> MtlTable(NoofM);
+  for (auto el : MtlNoTable)
+  {
+    if (el.second < 0 || el.second >= NoofM)
+      continue;
+    m = el.second;
+    if (MtlTable[m] == nullptr)
+    {
+      MaterialG3DM *Mtl = &Mtls[m];
+      std::vector<texture *> MtlTexs;
+
+      for (INT k = 0; k < 8; k++)
+        if (Mtl->Tex[k] >= 0 && Mtl->Tex[k] < NoofT)
+          MtlTexs.push_back(Texs[Mtl->Tex[k]]);
+      MtlTable[m] = AC->MaterialCreate(Shd, Mtl->Ka, Mtl->Kd, Mtl->Ks, Mtl->Ph, Mtl->Trans, MtlTexs);
+    }
+    el.first->Material = MtlTable[m];
+  }
+
   delete[] mem;
   return this;
 }
 
+/* Load topo from G3D2 file function.
+ * ARGUMENTS:
+ *   - file name:
+ *       const CHAR *FileName;
+ *   - shader for materials:
+ *       shader *Shd;
+ *   - transformation applied to vertices:
+ *       const matr &LoadTransfrom;
+ * RETUNRNS:
+ *   (primitives *) this primitives or nullptr if failed.
+ */
+primitives::primitives * primitives::primitives::LoadG3D2( const CHAR *FileName, shader *Shd, const matr &LoadTransfrom )
+{
+  anim *AC = anim::GetPtr();
+  g3d2::packed_model Mdl;
+
+  if (!g3d2::Load(FileName, Mdl, LoadTransfrom))
+    return nullptr;
+
+  /* Textures are referenced by path and created once */
+  std::vector<texture *> Texs(Mdl.Textures.size());
+  for (size_t t = 0; t < Mdl.Textures.size(); t++)
+    Texs[t] = AC->TextureCreate(Mdl.Textures[t].Name, Mdl.Textures[t].Path);
+
+  /* One material per material record (identical ones are shared) */
+  std::vector<material *> Mtls(Mdl.Materials.size());
+  for (size_t m = 0; m < Mdl.Materials.size(); m++)
+  {
+    const g3d2::model::material &M = Mdl.Materials[m];
+    std::vector<texture *> MtlTexs;
+
+    for (INT k = 0; k < 8; k++)
+      if (M.Tex[k] >= 0 && M.Tex[k] < (INT)Texs.size())
+        MtlTexs.push_back(Texs[M.Tex[k]]);
+    Mtls[m] = AC->MaterialCreate(Shd, M.Ka, M.Kd, M.Ks, M.Ph, M.Trans, MtlTexs);
+  }
+
+  Prims.reserve(Prims.size() + Mdl.Prims.size());
+  for (auto &P : Mdl.Prims)
+  {
+    /* Decoded vertices and file width indices are uploaded as is */
+    prim *Pr = P.IndexSize == 2 ? AC->PrimCreate(P.Topo16) : AC->PrimCreate(P.Topo32);
+
+    if (P.MtlNo >= 0 && P.MtlNo < (INT)Mtls.size())
+      Pr->Material = Mtls[P.MtlNo];
+    if (Prims.empty())
+      Min = Pr->Min, Max = Pr->Max;
+    else
+      Min = vec3::Min(Min, Pr->Min), Max = vec3::Max(Max, Pr->Max);
+    Prims << Pr;
+  }
+  return this;
+} /* End of 'LoadG3D2' function */
+
+/* Load topo from G3DM or G3D2 file function.
+ * ARGUMENTS:
+ *   - file name (if '*.g3d2' file with same name exists it is used instead of '*.g3dm'):
+ *       const CHAR *FileName;
+ *   - shader for materials:
+ *       shader *Shd;
+ *   - transformation applied to vertices:
+ *       const matr &LoadTransfrom;
+ * RETUNRNS:
+ *   (primitives *) this primitives or nullptr if failed.
+ */
+primitives::primitives * primitives::primitives::Load( const CHAR *FileName, shader *Shd, const matr &LoadTransfrom )
+{
+  anim *AC = anim::GetPtr();
+  std::string Name = FileName;
+  primitives *Res = nullptr;
+  FILE *F;
+  DWORD Sign = 0;
+  UINT64
+    TexBytes = AC->TextureDedupBytes,
+    PrimBytes = AC->PrimDedupBytes,
+    MtlCount = AC->MaterialDedupCount;
+  LARGE_INTEGER t0, t1, Freq;
+
+  QueryPerformanceFrequency(&Freq);
+  QueryPerformanceCounter(&t0);
+
+  /* Prefer converted file, G3DM file is imported (optimized with levels of detail) when it is newer */
+  if (Name.size() > 5 && _stricmp(Name.c_str() + Name.size() - 5, ".g3dm") == 0)
+  {
+    std::string Name2 = Name.substr(0, Name.size() - 5) + ".g3d2";
+    UINT64 Time = GetWriteTime(Name), Time2 = GetWriteTime(Name2);
+
+    if (Time2 != 0 && Time2 >= Time)
+      Res = LoadG3D2(Name2.c_str(), Shd, LoadTransfrom);
+    if (Res == nullptr && g3d2::Convert(Name, Name2, AC->LodSettings))
+      Res = LoadG3D2(Name2.c_str(), Shd, LoadTransfrom);
+  }
+
+  /* Dispatch by signature */
+  if (Res == nullptr && (F = fopen(FileName, "rb")) != nullptr)
+  {
+    fread(&Sign, 4, 1, F);
+    fclose(F);
+    if (Sign == g3d2::Tag("G3D2"))
+      Res = LoadG3D2(FileName, Shd, LoadTransfrom);
+    else
+      Res = LoadG3DM(FileName, Shd, LoadTransfrom);
+  }
+
+  /* Load statistics */
+  QueryPerformanceCounter(&t1);
+  if (Res != nullptr)
+  {
+    CHAR Buf[500];
+
+    sprintf(Buf, "%s: %d prims in %.1f ms, deduplicated %llu texture bytes, %llu geometry bytes, %llu materials\n",
+      FileName, (INT)Prims.size(), (DBL)(t1.QuadPart - t0.QuadPart) * 1000 / Freq.QuadPart, AC->TextureDedupBytes - TexBytes,
+      AC->PrimDedupBytes - PrimBytes, AC->MaterialDedupCount - MtlCount);
+    OutputDebugString(Buf);
+  }
+  return Res;
+} /* End of 'Load' function */
+
 
 /* END OF 'prim.cpp' FILE */
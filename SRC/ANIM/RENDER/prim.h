@@ -19,6 +19,7 @@
 #include "resources/topology.h"
 #include "resources/material.h" 
 #include "resources/texture.h"
+#include "../../UTILS/bvh.h"
 #include <map>
 #include <vector>
 
@@ -31,6 +32,17 @@ namespace digl
   /* Primitives namespace */
   namespace primitives
   {
+    /* Per instance data of instanced rendering (attribute locations
+     * 'InstanceLocation' .. 'InstanceLocation + 3' keep 'World' rows as
+     * shader 'mat4', next location keeps 'Params') */
+    struct instance
+    {
+      matr World;  // Instance world transformation
+      vec4 Params; // Shader specific parameters
+    }; /* End of 'instance' struct */
+
+    /* First vertex attribute location of per instance data */
+    const INT InstanceLocation = vertex::NumOfLocations;
 
     /* Primitive class */
     class prim
@@ -38,35 +50,77 @@ namespace digl
     public:
       prim_type Type;
       UINT VA, VBuf, IBuf, NumOfElements;
+      UINT IndexType; // Index buffer type ('GL_UNSIGNED_BYTE/SHORT/INT', 0 if there are no indices)
+      std::vector<topology::lod> Lods; // Levels of detail (first is full mesh)
       matr Transform;
       vec3 Min, Max;
       material *Material;
+      const prim *Source; // Primitive owning shared GPU buffers (nullptr if buffers are own)
+      mutable mesh_bvh Bvh;                  // Triangles tree of full mesh (empty for shared one)
+      mutable std::vector<vec3> BvhPoints;   // Full mesh points until tree is built on first 'GetBvh' call
+      mutable std::vector<INT> BvhIndex;     // Full mesh triangle indices (empty for triangle list)
 
       /* Primitive constructor.
        * ARGUMENTS: None.
        * RETUNRS: None.
        */
       prim( VOID ): Transform(matr::Identity()), Type(prim_type::TRIMESH),
-        VA(0), VBuf(0), IBuf(0), NumOfElements(0), Min(0), Max(0), Material()
+        VA(0), VBuf(0), IBuf(0), NumOfElements(0), IndexType(0), Min(0), Max(0), Material(), Source()
+      {
+      } /* End of 'prim' function */
+
+      /* Primitive constructor sharing GPU buffers of other primitive.
+       * ARGUMENTS:
+       *   - primitive with same geometry:
+       *       const prim *Src;
+       * RETUNRS: None.
+       */
+      explicit prim( const prim *Src ): Transform(matr::Identity()), Type(Src->Type),
+        VA(Src->VA), VBuf(Src->VBuf), IBuf(Src->IBuf), NumOfElements(Src->NumOfElements),
+        IndexType(Src->IndexType), Lods(Src->Lods),
+        Min(Src->Min), Max(Src->Max), Material(), Source(Src->Source != nullptr ? Src->Source : Src)
       {
       } /* End of 'prim' function */
 
       /* Primitive constructor.
        * ARGUMENTS:
        *   - topology:
-       *       const topology::base<vertex_type> &Topo;
+       *       const topology::base<vertex_type, index_type> &Topo;
        *   - name:
                const std::string &Name;
        * RETUNRS: None.
        */
-    template<class vertex_type>
-      prim ( const topology::base<vertex_type> &Topo = topology::base<vertex_type>() ) :
+    template<class vertex_type, class index_type = INT>
+      prim ( const topology::base<vertex_type, index_type> &Topo = topology::base<vertex_type, index_type>() ) :
         Transform(matr::Identity()), Type(prim_type::TRIMESH),
-        VA(0), VBuf(0), IBuf(0), NumOfElements(0), Min(0), Max(0), Material()
+        VA(0), VBuf(0), IBuf(0), NumOfElements(0), IndexType(0), Min(0), Max(0), Material(), Source()
       {
         (*this)(Topo);
       } /* End of 'prim' function */
 
+      /* Get triangles tree function.
+       * Tree is built on first call (from main thread only), so
+       * primitives never used by spatial queries do not pay for it.
+       * ARGUMENTS: None.
+       * RETURNS:
+       *   (const mesh_bvh *) tree (shared primitive uses tree of source one).
+       */
+      const mesh_bvh * GetBvh( VOID ) const
+      {
+        if (Source != nullptr)
+          return Source->GetBvh();
+        if (!BvhPoints.empty())
+        {
+          if (BvhIndex.empty())
+            Bvh.Build(BvhPoints.data(), nullptr, BvhPoints.size() / 3);
+          else
+            Bvh.Build(BvhPoints.data(), BvhIndex.data(), BvhIndex.size() / 3);
+          std::vector<vec3>().swap(BvhPoints);
+          std::vector<INT>().swap(BvhIndex);
+        }
+        return &Bvh;
+      } /* End of 'GetBvh' function */
+
       /* Set material function.
        * ARGUMENTS:
        *   - material:
@@ -93,14 +147,79 @@ namespace digl
       /* Primitive constructor.
        * ARGUMENTS:
        *   - topology:
-       *       const topology::base<vertex_type> &Topo;
+       *       const topology::base<vertex_type, index_type> &Topo;
        * RETUNRS: None.
        */
-    template<class vertex_type>
-      VOID operator()( const topology::base<vertex_type> &Topo )
+    template<class vertex_type, class index_type>
+      VOID operator()( const topology::base<vertex_type, index_type> &Topo )
       {
-        NumOfElements = Topo.Vertex.size() > Topo.Index.size() ? Topo.Vertex.size() : Topo.Index.size();
+        NumOfElements = Topo.Index.empty() ? Topo.Vertex.size() : Topo.Index.size();
+        IndexType = Topo.Index.empty() ? 0 : IndexTypeFor(Topo.Index, Topo.Vertex.size());
         Type = Topo.PrimType;
+        Lods = Topo.Lods;
+        if (Lods.empty())
+          Lods.push_back({0, (INT)NumOfElements, 0});
+        NumOfElements = Lods[0].Count;
+
+        if (!Topo.Vertex.empty())
+        {
+          Min = Max = Topo.Vertex[0].P;
+          for (auto &V : Topo.Vertex)
+            Min = vec3::Min(Min, V.P), Max = vec3::Max(Max, V.P);
+        }
+
+        /* Full mesh for spatial queries tree (built by first 'GetBvh' call) */
+        Bvh = mesh_bvh();
+        BvhPoints.clear();
+        BvhIndex.clear();
+        if (Type == prim_type::TRIMESH && !Topo.Vertex.empty())
+        {
+          INT Start = Lods[0].Start, Count = Lods[0].Count / 3 * 3;
+
+          if (Topo.Index.empty())
+          {
+            BvhPoints.resize(Count);
+            for (INT i = 0; i < Count; i++)
+              BvhPoints[i] = Topo.Vertex[Start + i].P;
+          }
+          else if (Count > 0)
+          {
+            BvhPoints.resize(Topo.Vertex.size());
+            for (size_t i = 0; i < BvhPoints.size(); i++)
+              BvhPoints[i] = Topo.Vertex[i].P;
+            BvhIndex.resize(Count);
+            for (INT i = 0; i < Count; i++)
+              BvhIndex[i] = IndexAt(Topo.Index, Start + i);
+          }
+        }
+        else if (Type == prim_type::STRIP && !Topo.Vertex.empty())
+        {
+          /* Strips (split by -1 restart index) to triangle list, degenerate triangles are skipped */
+          INT Start = Lods[0].Start, Count = Lods[0].Count, a = -1, b = -1;
+
+          BvhPoints.resize(Topo.Vertex.size());
+          for (size_t i = 0; i < BvhPoints.size(); i++)
+            BvhPoints[i] = Topo.Vertex[i].P;
+          for (INT i = Start; i < Start + Count; i++)
+          {
+            INT c = Topo.Index.empty() ? i : IndexAt(Topo.Index, i);
+
+            if (c < 0)
+            {
+              a = b = -1;
+              continue;
+            }
+            if (a >= 0 && a != b && b != c && a != c)
+            {
+              BvhIndex.push_back(a);
+              BvhIndex.push_back(b);
+              BvhIndex.push_back(c);
+            }
+            a = b, b = c;
+          }
+          if (BvhIndex.empty())
+            BvhPoints.clear();
+        }
 
         glGenBuffers(1, &VBuf);
         glGenVertexArrays(1, &VA);
@@ -108,46 +227,146 @@ namespace digl
         glBindBuffer(GL_ARRAY_BUFFER, VBuf);
         glBufferData(GL_ARRAY_BUFFER, sizeof(vertex_type) * Topo.Vertex.size(), &Topo.Vertex[0], GL_STATIC_DRAW);
 
-        /* Descriptor parser */
-        CHAR *ptr = (CHAR *)vertex_type::Descr;
-        INT NumComp,
-            i = 0,
-            Shift = 0;
-        while (*ptr != 0)
+        /* Attributes from compile time layout, absent ones read white generic value */
+        static_assert(vertex::IsLayoutValid<vertex_type>(), "Invalid vertex layout");
+        BOOL IsUsed[vertex::NumOfLocations] = {};
+
+        for (const vertex::attribute &A : vertex::layout<vertex_type>::Attributes)
         {
-          if (*ptr++ == 'f')
-          {
-            NumComp = *ptr++ - '0';
-            glVertexAttribPointer(i, NumComp, GL_FLOAT, FALSE, sizeof(vertex_type), (VOID *)Shift);
-            glEnableVertexAttribArray(i);
-            Shift += sizeof(FLT) * NumComp;
-          }
-          else if (*ptr++ == 'i')
-          {
-            NumComp = *ptr++ - '0';
-            glVertexAttribPointer(i, NumComp, GL_FLOAT, FALSE, sizeof(vertex_type), (VOID *)Shift);
-            glEnableVertexAttribArray(i);
-            Shift += sizeof(INT) * NumComp;
-          }
-          else
-            return;
-          i++;
+          glVertexAttribPointer(A.Location, A.NumOfComponents, A.Type, A.IsNormalized, sizeof(vertex_type), (VOID *)A.Offset);
+          glEnableVertexAttribArray(A.Location);
+          IsUsed[A.Location] = TRUE;
         }
+        for (INT i = 0; i < vertex::NumOfLocations; i++)
+          if (!IsUsed[i])
+            glVertexAttrib4f(i, 1, 1, 1, 1);
 
+        if (IndexType == 0)
+          return;
         glGenBuffers(1, &IBuf);
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBuf);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(INT) * Topo.Index.size(), &Topo.Index[0], GL_STATIC_DRAW);
+        UploadIndices(Topo.Index, IndexType);
       } /* End of 'prim' function */
 
+      /* Choose index type for number of vertices function.
+       * Largest value of type is reserved for primitive restart
+       * ('GL_PRIMITIVE_RESTART_FIXED_INDEX'), so -1 index becomes restart.
+       * ARGUMENTS:
+       *   - number of vertices:
+       *       size_t NumOfV;
+       * RETURNS:
+       *   (UINT) 'GL_UNSIGNED_BYTE', 'GL_UNSIGNED_SHORT' or 'GL_UNSIGNED_INT'.
+       */
+      static UINT IndexTypeFor( size_t NumOfV )
+      {
+        return
+          NumOfV < 0xFF ? GL_UNSIGNED_BYTE :
+          NumOfV < 0xFFFF ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+      } /* End of 'IndexTypeFor' function */
+
+      /* Choose index type for indices function.
+       * ARGUMENTS:
+       *   - indices ('INT' ones are narrowed by number of vertices, others are kept):
+       *       const stock<index_type> &Index;
+       *   - number of vertices:
+       *       size_t NumOfV;
+       * RETURNS:
+       *   (UINT) 'GL_UNSIGNED_BYTE', 'GL_UNSIGNED_SHORT' or 'GL_UNSIGNED_INT'.
+       */
+      static UINT IndexTypeFor( const stock<INT> &Index, size_t NumOfV )
+      {
+        return IndexTypeFor(NumOfV);
+      } /* End of 'IndexTypeFor' function */
+      static UINT IndexTypeFor( const stock<WORD> &Index, size_t NumOfV )
+      {
+        return GL_UNSIGNED_SHORT;
+      } /* End of 'IndexTypeFor' function */
+      static UINT IndexTypeFor( const stock<UINT> &Index, size_t NumOfV )
+      {
+        return GL_UNSIGNED_INT;
+      } /* End of 'IndexTypeFor' function */
+
+      /* Get index as signed value function.
+       * ARGUMENTS:
+       *   - indices and index number:
+       *       const stock<index_type> &Index;
+       *       size_t i;
+       * RETURNS:
+       *   (INT) index (-1 for primitive restart).
+       */
+      template<class index_type>
+        static INT IndexAt( const stock<index_type> &Index, size_t i )
+        {
+          return Index[i] == (index_type)-1 ? -1 : (INT)Index[i];
+        } /* End of 'IndexAt' function */
+
+      /* Get index size in bytes function.
+       * ARGUMENTS:
+       *   - index type:
+       *       UINT Format;
+       * RETURNS:
+       *   (size_t) index size in bytes.
+       */
+      static size_t IndexSize( UINT Format )
+      {
+        return Format == GL_UNSIGNED_BYTE ? 1 : Format == GL_UNSIGNED_SHORT ? 2 : 4;
+      } /* End of 'IndexSize' function */
+
+    private:
+      /* Upload indices to bound element buffer function.
+       * ARGUMENTS:
+       *   - indices (-1 is primitive restart):
+       *       const stock<INT> &Index;
+       * RETURNS: None.
+       */
+      template<class ElementType>
+        static VOID UploadIndices( const stock<INT> &Index )
+        {
+          std::vector<ElementType> Res(Index.size());
+
+          for (size_t i = 0; i < Index.size(); i++)
+            Res[i] = (ElementType)Index[i];
+          glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(ElementType) * Res.size(), Res.data(), GL_STATIC_DRAW);
+        } /* End of 'UploadIndices' function */
+
+      /* Upload indices to bound element buffer function.
+       * ARGUMENTS:
+       *   - indices ('INT' ones are narrowed to index type, others are uploaded as is):
+       *       const stock<index_type> &Index;
+       *   - index type:
+       *       UINT Format;
+       * RETURNS: None.
+       */
+      static VOID UploadIndices( const stock<INT> &Index, UINT Format )
+      {
+        if (Format == GL_UNSIGNED_BYTE)
+          UploadIndices<BYTE>(Index);
+        else if (Format == GL_UNSIGNED_SHORT)
+          UploadIndices<WORD>(Index);
+        else
+          UploadIndices<UINT>(Index);
+      } /* End of 'UploadIndices' function */
+      template<class index_type>
+        static VOID UploadIndices( const stock<index_type> &Index, UINT Format )
+        {
+          glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(index_type) * Index.size(), Index.data(), GL_STATIC_DRAW);
+        } /* End of 'UploadIndices' function */
+
+    public:
+
       /* Destructor */
       ~prim()
       {
+        /* Shared buffers are deleted by owner */
+        if (Source != nullptr)
+          return;
         glBindVertexArray(VA);
         glBindBuffer(GL_ARRAY_BUFFER, 0);
         glDeleteBuffers(1, &VBuf);
         glBindVertexArray(0);
         glDeleteVertexArrays(1, &VA);
-        glDeleteBuffers(1, &IBuf);
+        if (IBuf != 0)
+          glDeleteBuffers(1, &IBuf);
       } /* End of '~prim' function */
 
     }; /* End of 'prim' class */
@@ -159,12 +378,13 @@ namespace digl
       stock<prim *> Prims;
       matr Transform;
       vec3 Min, Max;
+      mutable INT Lod; // Selected level of detail (kept between frames for hysteresis)
 
       /* Primitives constructor function.
        * ARGUMENTS: None.
        * RETURNS: None.
        */
-      primitives ( VOID ) : Transform(matr::Identity()), Min(), Max()
+      primitives ( VOID ) : Transform(matr::Identity()), Min(), Max(), Lod(0)
       {
       } /* End of 'primitives' function */
 
@@ -181,9 +401,9 @@ namespace digl
        * RETURNS: None.
        */
       primitives ( const CHAR *FileName, shader *Shd, const matr &LoadTransfrom = matr::Identity() ) :
-        Transform(matr::Identity())
+        Transform(matr::Identity()), Min(0), Max(0), Lod(0)
       {
-        LoadG3DM(FileName, Shd, LoadTransfrom);
+        Load(FileName, Shd, LoadTransfrom);
       } /* End of 'primitives' function */
 
       /* Add prim in primitives function.
@@ -206,6 +426,32 @@ namespace digl
        * RETUNRNS: None.
        */
       primitives * LoadG3DM( const CHAR *FileName, shader *Shd, const matr &LoadTransfrom );
+
+      /* Load topo from G3D2 file function.
+       * ARGUMENTS:
+       *   - file name:
+       *       const CHAR *FileName;
+       *   - shader for materials:
+       *       shader *Shd;
+       *   - transformation applied to vertices:
+       *       const matr &LoadTransfrom;
+       * RETUNRNS:
+       *   (primitives *) this primitives or nullptr if failed.
+       */
+      primitives * LoadG3D2( const CHAR *FileName, shader *Shd, const matr &LoadTransfrom );
+
+      /* Load topo from G3DM or G3D2 file function.
+       * ARGUMENTS:
+       *   - file name (if '*.g3d2' file with same name exists it is used instead of '*.g3dm'):
+       *       const CHAR *FileName;
+       *   - shader for materials:
+       *       shader *Shd;
+       *   - transformation applied to vertices:
+       *       const matr &LoadTransfrom;
+       * RETUNRNS:
+       *   (primitives *) this primitives or nullptr if failed.
+       */
+      primitives * Load( const CHAR *FileName, shader *Shd, const matr &LoadTransfrom );
    }; /* End of 'primitives' class */
   } /* end of 'primitives' namespace */
 } /* end of 'digl' namespace */
@@ -233,8 +233,7 @@ digl::render::render( HWND &hWnd, INT &W, INT &H ) :
 
   glEnable(GL_BLEND);
   glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-  glEnable(GL_PRIMITIVE_RESTART);
-  glPrimitiveRestartIndex(-1);
+  glEnable(GL_PRIMITIVE_RESTART_FIXED_INDEX);
 
   PFNWGLSWAPINTERVALEXTPROC wglSwapInterval = (PFNWGLSWAPINTERVALEXTPROC)wglGetProcAddress("wglSwapIntervalEXT");
   wglSwapInterval(0);
@@ -249,6 +248,8 @@ digl::render::render( HWND &hWnd, INT &W, INT &H ) :
 /* Render destructor function */
 digl::render::~render( VOID )
 {
+  if (InstanceBuf != 0)
+    glDeleteBuffers(1, &InstanceBuf);
 } /* End of 'render::~render' function */
 
 /* Resize render function.
@@ -361,71 +362,310 @@ VOID digl::render::PopFill( VOID )
  * ARGUMENTS:
  *   - primitive to draw:
  *       const prim Pr;
+ *   - selected level of detail storage (nullptr to use 'Prs.Lod'):
+ *       INT *LodState;
  * RETURNS: None.
  */
-VOID digl::render::DrawPrims( const primitives::primitives &Prs, const matr &World )
+VOID digl::render::DrawPrims( const primitives::primitives &Prs, const matr &World, INT *LodState )
 {
+  INT &Lod = LodState != nullptr ? *LodState : Prs.Lod;
+
+  Lod = SelectLod(Prs, World, Lod);
   for (auto Pr : Prs.Prims)
     if (1 || Pr->Material->Trans >= 1)
-      Draw(*Pr, Pr->Transform * World);
+      Draw(*Pr, Pr->Transform * World, Lod);
 
   glEnable(GL_CULL_FACE);
   glCullFace(GL_FRONT);
   for (auto Pr : Prs.Prims)
     if (Pr->Material->Trans >= 1)
-      Draw(*Pr, Pr->Transform * World);
+      Draw(*Pr, Pr->Transform * World, Lod);
 
   glCullFace(GL_BACK);
   for (auto Pr : Prs.Prims)
     if (Pr->Material->Trans >= 1)
-      Draw(*Pr, Pr->Transform * World);
+      Draw(*Pr, Pr->Transform * World, Lod);
 
   glDisable(GL_CULL_FACE);
 } /* End of 'digl::render::DrawPrims' function */
 
-/* Draw primitive function.
+/* Select level of detail by projected error function.
+ * Level error (model space) is projected with camera pixel size at
+ * nearest point of bounding sphere. Coarser level is taken when it fits
+ * in tighter bound, finer one when current exceeds looser bound, so
+ * level does not flicker near threshold.
  * ARGUMENTS:
- *   - primitive to draw:
- *       const prim Pr;
+ *   - primitives and their world transformation:
+ *       const primitives::primitives &Prs;
+ *       const matr &World;
+ *   - currently selected level:
+ *       INT Current;
+ * RETURNS:
+ *   (INT) new level of detail.
+ */
+INT digl::render::SelectLod( const primitives::primitives &Prs, const matr &World, INT Current ) const
+{
+  INT NumOfLods = 1;
+  vec3 Min(0), Max(0);
+
+  for (size_t p = 0; p < Prs.Prims.size(); p++)
+  {
+    const primitives::prim *Pr = Prs.Prims[p];
+
+    NumOfLods = (INT)Pr->Lods.size() > NumOfLods ? (INT)Pr->Lods.size() : NumOfLods;
+    if (p == 0)
+      Min = Pr->Min, Max = Pr->Max;
+    else
+      Min = vec3::Min(Min, Pr->Min), Max = vec3::Max(Max, Pr->Max);
+  }
+
+  FLT Size = !(Max - Min);
+
+  if (NumOfLods == 1 || Size == 0)
+    return 0;
+
+  vec3
+    WMin = World.TransformPoint(Min),
+    WMax = World.TransformPoint(Max);
+  FLT
+    Scale = !(WMax - WMin) / Size,
+    Dist = !((WMin + WMax) / 2 - Cam.Loc) - Size * Scale / 2;
+
+  if (Dist <= Cam.Near)
+    return 0;
+
+  /* Pixels per model space unit */
+  FLT PixelSize = (FrameW < FrameH ? FrameW : FrameH) * Cam.Near / (Cam.ProjSize * Dist) * Scale;
+
+  auto Select = [&]( FLT MaxPixels )
+  {
+    INT Res = 0;
+
+    for (INT l = 1; l < NumOfLods; l++)
+    {
+      FLT Error = 0;
+
+      for (auto Pr : Prs.Prims)
+        if (!Pr->Lods.empty())
+        {
+          FLT E = Pr->Lods[l < (INT)Pr->Lods.size() ? l : Pr->Lods.size() - 1].Error;
+
+          Error = E > Error ? E : Error;
+        }
+      if (Error * PixelSize > MaxPixels)
+        break;
+      Res = l;
+    }
+    return Res;
+  };
+  INT
+    Coarse = Select(LodSettings.PixelError * (1 - LodSettings.Hysteresis)),
+    Fine = Select(LodSettings.PixelError * (1 + LodSettings.Hysteresis));
+
+  return Current < Coarse ? Coarse : Current > Fine ? Fine : Current;
+} /* End of 'digl::render::SelectLod' function */
+
+/* Apply primitive material and transformation uniforms function.
+ * ARGUMENTS:
+ *   - primitive:
+ *       const primitives::prim &Pr;
+ *   - world transformation (primitive own one for instanced drawing):
+ *       const matr &World;
+ *   - instanced drawing flag:
+ *       BOOL IsInstanced;
+ * RETURNS:
+ *   (INT) shader program id.
+ */
+INT digl::render::Apply( const primitives::prim &Pr, const matr &World, BOOL IsInstanced )
+{
+  matr WVP = World * Cam.VP;
+
+  glLoadMatrixf(WVP);
+
+  INT ProgId = Pr.ApplyMaterial();
+
+  INT loc;
+  if ((loc = glGetUniformLocation(ProgId, "MatrWVP")) != -1)
+    glUniformMatrix4fv(loc, 1, FALSE, WVP);
+  if ((loc = glGetUniformLocation(ProgId, "MatrW")) != -1)
+    glUniformMatrix4fv(loc, 1, FALSE, (matr)World);
+  if ((loc = glGetUniformLocation(ProgId, "MatrVP")) != -1)
+    glUniformMatrix4fv(loc, 1, FALSE, Cam.VP);
+  if ((loc = glGetUniformLocation(ProgId, "IsInstanced")) != -1)
+    glUniform1i(loc, IsInstanced);
+
+  if ((loc = glGetUniformLocation(ProgId, "Time")) != -1)
+    glUniform1f(loc, anim::Get().Time);
+  /*
+  if ((loc = glGetUniformLocation(ProgId, "GlobalTime")) != -1)
+    glUniform1f(loc, anim::Get());*/
+  if ((loc = glGetUniformLocation(ProgId, "CamLoc")) != -1)
+    glUniform3fv(loc, 1, Cam.Loc);
+  if ((loc = glGetUniformLocation(ProgId, "CamDir")) != -1)
+    glUniform3fv(loc, 1, Cam.Dir);
+  return ProgId;
+} /* End of 'digl::render::Apply' function */
+
+/* Issue primitive draw call function.
+ * ARGUMENTS:
+ *   - primitive:
+ *       const primitives::prim &Pr;
+ *   - level of detail (clamped to primitive levels):
+ *       INT Lod;
+ *   - range of 'InstanceBuf' instances (count 0 for not instanced drawing):
+ *       size_t FirstInstance, NumOfInstances;
  * RETURNS: None.
  */
-VOID digl::render::Draw( const primitives::prim &Pr, const matr &World )
+VOID digl::render::Submit( const primitives::prim &Pr, INT Lod, size_t FirstInstance, size_t NumOfInstances )
+{
+  INT Type =
+    (Pr.Type == prim_type::TRIMESH) ? GL_TRIANGLES :
+    (Pr.Type == prim_type::STRIP) ? GL_TRIANGLE_STRIP : GL_POINTS;
+
+  glBindVertexArray(Pr.VA);
+  if (NumOfInstances > 0)
   {
-    INT Type =
-      (Pr.Type == prim_type::TRIMESH) ? GL_TRIANGLES :
-      (Pr.Type == prim_type::STRIP) ? GL_TRIANGLE_STRIP : GL_POINTS;
-
-    matr WVP = World * Cam.VP;
-
-    glLoadMatrixf(WVP);
-
-    INT ProgId = Pr.ApplyMaterial();
-
-    INT loc;
-    if ((loc = glGetUniformLocation(ProgId, "MatrWVP")) != -1)
-      glUniformMatrix4fv(loc, 1, FALSE, WVP);
-    if ((loc = glGetUniformLocation(ProgId, "MatrW")) != -1)
-      glUniformMatrix4fv(loc, 1, FALSE, (matr)World);
-
-    if ((loc = glGetUniformLocation(ProgId, "Time")) != -1)
-      glUniform1f(loc, anim::Get().Time);
-    /*
-    if ((loc = glGetUniformLocation(ProgId, "GlobalTime")) != -1)
-      glUniform1f(loc, anim::Get());*/
-    if ((loc = glGetUniformLocation(ProgId, "CamLoc")) != -1)
-      glUniform3fv(loc, 1, Cam.Loc);
-    if ((loc = glGetUniformLocation(ProgId, "CamDir")) != -1)
-      glUniform3fv(loc, 1, Cam.Dir);
-
-    glBindVertexArray(Pr.VA);
-    if (Pr.NumOfElements != 0)
+    /* World rows and parameters: 5 'vec4' attributes advancing per instance */
+    glBindBuffer(GL_ARRAY_BUFFER, InstanceBuf);
+    for (INT k = 0; k < 5; k++)
     {
-      glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, Pr.IBuf);
-      glDrawElements(Type, Pr.NumOfElements, GL_UNSIGNED_INT, NULL);
-      glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+      glEnableVertexAttribArray(primitives::InstanceLocation + k);
+      glVertexAttribPointer(primitives::InstanceLocation + k, 4, GL_FLOAT, FALSE, sizeof(primitives::instance),
+                            (VOID *)(FirstInstance * sizeof(primitives::instance) + k * 4 * sizeof(FLT)));
+      glVertexAttribDivisor(primitives::InstanceLocation + k, 1);
     }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+  }
+  if (Pr.IndexType != 0)
+  {
+    INT Start = 0, Count = Pr.NumOfElements;
+
+    if (!Pr.Lods.empty())
+    {
+      const topology::lod &L = Pr.Lods[Lod < 0 ? 0 : Lod < (INT)Pr.Lods.size() ? Lod : Pr.Lods.size() - 1];
+
+      Start = L.Start;
+      Count = L.Count;
+    }
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, Pr.IBuf);
+    if (NumOfInstances > 0)
+      glDrawElementsInstanced(Type, Count, Pr.IndexType, (VOID *)(Start * primitives::prim::IndexSize(Pr.IndexType)),
+                              (INT)NumOfInstances);
     else
-      glDrawArrays(Type, 0, Pr.NumOfElements);
-    glBindVertexArray(0);
-  } /* End of 'Draw' function */
+      glDrawElements(Type, Count, Pr.IndexType, (VOID *)(Start * primitives::prim::IndexSize(Pr.IndexType)));
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+  }
+  else if (NumOfInstances > 0)
+    glDrawArraysInstanced(Type, 0, Pr.NumOfElements, (INT)NumOfInstances);
+  else
+    glDrawArrays(Type, 0, Pr.NumOfElements);
+  if (NumOfInstances > 0)
+    for (INT k = 0; k < 5; k++)
+      glDisableVertexAttribArray(primitives::InstanceLocation + k);
+  glBindVertexArray(0);
+} /* End of 'digl::render::Submit' function */
+
+/* Draw primitive function.
+ * ARGUMENTS:
+ *   - primitive to draw:
+ *       const prim Pr;
+ *   - level of detail (clamped to primitive levels):
+ *       INT Lod;
+ * RETURNS: None.
+ */
+VOID digl::render::Draw( const primitives::prim &Pr, const matr &World, INT Lod )
+{
+  Apply(Pr, World, FALSE);
+  Submit(Pr, Lod, 0, 0);
+} /* End of 'Draw' function */
+
+/* Draw instances of primitives function.
+ * ARGUMENTS:
+ *   - primitives to draw:
+ *       const primitives::primitives &Prs;
+ *   - instances:
+ *       const primitives::instance *Instances;
+ *       size_t NumOfInstances;
+ *   - selected levels of detail storage, one per instance (nullptr to draw full meshes):
+ *       INT *LodStates;
+ * RETURNS: None.
+ */
+VOID digl::render::DrawInstanced( const primitives::primitives &Prs, const primitives::instance *Instances,
+                                  size_t NumOfInstances, INT *LodStates )
+{
+  if (NumOfInstances == 0)
+    return;
+
+  /* Sort instances by level of detail (stable counting sort) */
+  INT NumOfLods = 1;
+
+  for (auto Pr : Prs.Prims)
+    NumOfLods = (INT)Pr->Lods.size() > NumOfLods ? (INT)Pr->Lods.size() : NumOfLods;
+
+  std::vector<size_t> First(NumOfLods + 1, 0);
+
+  InstanceData.resize(NumOfInstances);
+  if (LodStates != nullptr)
+  {
+    for (size_t i = 0; i < NumOfInstances; i++)
+      First[(LodStates[i] = SelectLod(Prs, Instances[i].World, LodStates[i])) + 1]++;
+    for (INT l = 0; l < NumOfLods; l++)
+      First[l + 1] += First[l];
+
+    std::vector<size_t> Pos(First.begin(), First.end() - 1);
+
+    for (size_t i = 0; i < NumOfInstances; i++)
+      InstanceData[Pos[LodStates[i]]++] = Instances[i];
+  }
+  else
+  {
+    InstanceData.assign(Instances, Instances + NumOfInstances);
+    First[1] = NumOfInstances;
+    for (INT l = 1; l < NumOfLods; l++)
+      First[l + 1] = NumOfInstances;
+  }
+
+  /* Upload (buffer is reallocated only to grow) */
+  size_t Size = sizeof(primitives::instance) * NumOfInstances;
+
+  if (InstanceBuf == 0)
+    glGenBuffers(1, &InstanceBuf);
+  glBindBuffer(GL_ARRAY_BUFFER, InstanceBuf);
+  if (Size > InstanceBufSize)
+  {
+    InstanceBufSize = Size;
+    glBufferData(GL_ARRAY_BUFFER, Size, InstanceData.data(), GL_STREAM_DRAW);
+  }
+  else
+  {
+    glBufferData(GL_ARRAY_BUFFER, InstanceBufSize, nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, Size, InstanceData.data());
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  /* Same passes as 'DrawPrims' */
+  auto Pass = [&]( BOOL IsOpaqueOnly )
+  {
+    for (auto Pr : Prs.Prims)
+      if (!IsOpaqueOnly || Pr->Material->Trans >= 1)
+      {
+        Apply(*Pr, Pr->Transform, TRUE);
+        for (INT l = 0; l < NumOfLods; l++)
+          if (First[l + 1] > First[l])
+            Submit(*Pr, l, First[l], First[l + 1] - First[l]);
+      }
+  };
+
+  Pass(FALSE);
+
+  glEnable(GL_CULL_FACE);
+  glCullFace(GL_FRONT);
+  Pass(TRUE);
+
+  glCullFace(GL_BACK);
+  Pass(TRUE);
+
+  glDisable(GL_CULL_FACE);
+} /* End of 'digl::render::DrawInstanced' function */
+
 /* END OF 'render.cpp' FILE */
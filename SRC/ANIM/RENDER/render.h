@@ -20,6 +20,7 @@
 
 #include "res.h"
 #include "pipeline.h"
+#include "resources/meshopt.h"
 #include "../../def.h"
 
 /* Project namespace */
@@ -28,7 +29,7 @@ namespace digl
   /* Render system representation class */
   class render : public manager_texture, public manager_shader, 
     public manager_material, public manager_prim, public manager_prims, public manager_font,
-    public manager_geom, public manager_emitter, public pipeline
+    public manager_geom, public manager_emitter, public manager_heightfield, public pipeline
   {
   private:
     HWND &hWnd;  // Window handle
@@ -36,9 +37,14 @@ namespace digl
     HDC hDC;     // Device context handle
     HGLRC hGLRC; // Render context handle
 
+    UINT InstanceBuf = 0;       // Per instance data buffer
+    size_t InstanceBufSize = 0; // Per instance data buffer size in bytes
+    std::vector<primitives::instance> InstanceData; // Instances sorted by level of detail
+
   public:
     INT &FrameW, &FrameH;  // Window sizes
     mth::camera Cam;  // Render main camera
+    meshopt::lod_settings LodSettings; // Level of detail generation and selection settings
 
     /* Render constructor function.
      * ARGUMENTS:
@@ -92,6 +98,31 @@ namespace digl
     cs PushedCS;     // Pushed coordinate system type
     fill PushedFill; // Pushed drawing fill type
 
+    /* Apply primitive material and transformation uniforms function.
+     * ARGUMENTS:
+     *   - primitive:
+     *       const primitives::prim &Pr;
+     *   - world transformation (primitive own one for instanced drawing):
+     *       const matr &World;
+     *   - instanced drawing flag:
+     *       BOOL IsInstanced;
+     * RETURNS:
+     *   (INT) shader program id.
+     */
+    INT Apply( const primitives::prim &Pr, const matr &World, BOOL IsInstanced );
+
+    /* Issue primitive draw call function.
+     * ARGUMENTS:
+     *   - primitive:
+     *       const primitives::prim &Pr;
+     *   - level of detail (clamped to primitive levels):
+     *       INT Lod;
+     *   - range of 'InstanceBuf' instances (count 0 for not instanced drawing):
+     *       size_t FirstInstance, NumOfInstances;
+     * RETURNS: None.
+     */
+    VOID Submit( const primitives::prim &Pr, INT Lod, size_t FirstInstance, size_t NumOfInstances );
+
   public:
     /* Set current coordinate system function.
      * ARGUMENTS:
@@ -141,17 +172,69 @@ namespace digl
       * ARGUMENTS:
       *   - primitive to draw:
       *       const prim Pr;
+      *   - level of detail (clamped to primitive levels):
+      *       INT Lod;
       * RETURNS: None.
       */
-    VOID Draw( const primitives::prim &Pr, const matr &World);
+    VOID Draw( const primitives::prim &Pr, const matr &World, INT Lod = 0 );
 
     /* Draw primitives function.
      * ARGUMENTS:
      *   - primitives to draw:
      *       const stock<primitives::prim> &Prs;
+     *   - selected level of detail storage (nullptr to use 'Prs.Lod'):
+     *       INT *LodState;
+     * RETURNS: None.
+     */
+    VOID DrawPrims( const primitives::primitives &Prs, const matr &World, INT *LodState = nullptr );
+
+    /* Draw instances of primitives function.
+     * Instance data is uploaded once, every primitive is drawn with one
+     * instanced draw call per used level of detail. Shader gets primitive
+     * transformation in 'MatrW', 'MatrVP' and 'IsInstanced' uniforms and
+     * instance data in attributes from 'primitives::InstanceLocation'.
+     * ARGUMENTS:
+     *   - primitives to draw:
+     *       const primitives::primitives &Prs;
+     *   - instances:
+     *       const primitives::instance *Instances;
+     *       size_t NumOfInstances;
+     *   - selected levels of detail storage, one per instance (nullptr to draw full meshes):
+     *       INT *LodStates;
      * RETURNS: None.
      */
-    VOID DrawPrims( const primitives::primitives &Prs, const matr &World);
+    VOID DrawInstanced( const primitives::primitives &Prs, const primitives::instance *Instances, size_t NumOfInstances,
+                        INT *LodStates = nullptr );
+
+    /* Draw instances of primitives function.
+     * ARGUMENTS:
+     *   - primitives to draw:
+     *       const primitives::primitives &Prs;
+     *   - instances:
+     *       const std::vector<primitives::instance> &Instances;
+     *   - selected levels of detail storage (nullptr or same size as 'Instances'):
+     *       std::vector<INT> *LodStates;
+     * RETURNS: None.
+     */
+    VOID DrawInstanced( const primitives::primitives &Prs, const std::vector<primitives::instance> &Instances,
+                        std::vector<INT> *LodStates = nullptr )
+    {
+      if (LodStates != nullptr)
+        LodStates->resize(Instances.size());
+      DrawInstanced(Prs, Instances.data(), Instances.size(), LodStates != nullptr ? LodStates->data() : nullptr);
+    } /* End of 'DrawInstanced' function */
+
+    /* Select level of detail by projected error function.
+     * ARGUMENTS:
+     *   - primitives and their world transformation:
+     *       const primitives::primitives &Prs;
+     *       const matr &World;
+     *   - currently selected level:
+     *       INT Current;
+     * RETURNS:
+     *   (INT) new level of detail.
+     */
+    INT SelectLod( const primitives::primitives &Prs, const matr &World, INT Current ) const;
   }; /* End of 'render' class */
 } /* end of 'dagl' namespace */
 
@@ -24,6 +24,11 @@
 #include "resources/shader.h"
 #include "resources/fonts.h"
 #include "../../UTILS/geom.h"
+#include "../../UTILS/heightfield.h"
+#include "../../UTILS/hash.h"
+
+#include <cstring>
+#include <unordered_map>
 
 /* Animation project namnespace */
 namespace digl
@@ -131,25 +136,93 @@ namespace digl
   /* Primitive manager type */
   class manager_prim : public manager<primitives::prim>
   {
+    /* Geometry hash table entry */
+    struct prim_entry
+    {
+      primitives::prim *Owner; // Primitive owning buffers
+      const VOID *Layout;      // Vertex layout table of buffers
+      digest::value Digest;    // Vertex and index bytes digest
+      size_t VSize, ISize;     // Vertex and index data sizes in bytes
+    }; /* End of 'prim_entry' struct */
+
+    std::unordered_multimap<UINT64, prim_entry> PrimHashes; // Geometry digest to buffers owners table
+
+    /* Compare primitive geometry with topology function.
+     * Geometry bytes are compared by digest, so GPU buffers are never read back.
+     * ARGUMENTS:
+     *   - table entry of primitive owning buffers:
+     *       const prim_entry &Entry;
+     *   - topology and its table entry:
+     *       const topology::base<vertex_type, index_type> &Topo;
+     *       const prim_entry &New;
+     * RETURNS:
+     *   (BOOL) TRUE if geometry is same, FALSE otherwise.
+     */
+    template<class vertex_type, class index_type>
+      static BOOL IsSamePrim( const prim_entry &Entry, const topology::base<vertex_type, index_type> &Topo, const prim_entry &New )
+      {
+        const primitives::prim *Pr = Entry.Owner;
+        UINT IndexType = Topo.Index.empty() ? 0 : primitives::prim::IndexTypeFor(Topo.Index, Topo.Vertex.size());
+        size_t NumOfElements = Topo.Index.empty() ? Topo.Vertex.size() : Topo.Index.size();
+        std::vector<topology::lod> Lods = Topo.Lods;
+
+        if (Lods.empty())
+          Lods.push_back({0, (INT)NumOfElements, 0});
+        if (Entry.Layout != New.Layout || Entry.VSize != New.VSize || Entry.ISize != New.ISize ||
+            !(Entry.Digest == New.Digest) || Pr->Type != Topo.PrimType ||
+            Pr->IndexType != IndexType || Pr->Lods.size() != Lods.size())
+          return FALSE;
+        for (size_t i = 0; i < Lods.size(); i++)
+          if (Pr->Lods[i].Start != Lods[i].Start || Pr->Lods[i].Count != Lods[i].Count || Pr->Lods[i].Error != Lods[i].Error)
+            return FALSE;
+        return TRUE;
+      } /* End of 'IsSamePrim' function */
+
   public:
+    UINT64 PrimDedupBytes; // Number of geometry bytes not uploaded due to sharing
+
     /* Primitive manager constructor.
      * ARGUMENTS: None.
      * RETURNS: None.
      */
-    manager_prim(VOID) : manager()
+    manager_prim(VOID) : manager(), PrimHashes(), PrimDedupBytes(0)
     {
     } /* End of 'manager_prim' function */
 
-    /* Create primitive function
-     * ARGUMENTS: None.
+    /* Create primitive function.
+     * Primitives with identical geometry share GPU buffers, every call
+     * still returns new primitive (own material and transform). Geometry
+     * is identified by 128-bit digest of its bytes and their sizes.
+     * ARGUMENTS:
+     *   - topology:
+     *       const topology::base<vertex_type, index_type> &Topo;
      * RETURNS:
      *  (primitives::prim &) New primitive.
      */
-    template<class vertex_type>
-      primitives::prim* PrimCreate( const topology::base<vertex_type>& Topo )
+    template<class vertex_type, class index_type>
+      primitives::prim* PrimCreate( const topology::base<vertex_type, index_type>& Topo )
       {
         primitives::prim* Pr;
+        size_t
+          VSize = sizeof(vertex_type) * Topo.Vertex.size(),
+          ISize = sizeof(index_type) * Topo.Index.size();
+        digest D;
+
+        D << Topo.PrimType << sizeof(vertex_type) << sizeof(index_type) << Topo.Vertex.size() << Topo.Index.size();
+        D(Topo.Vertex.data(), VSize)(Topo.Index.data(), ISize);
+
+        prim_entry New = {nullptr, vertex::layout<vertex_type>::Attributes, D.Get(), VSize, ISize};
+        auto Range = PrimHashes.equal_range(New.Digest.Lo);
+        for (auto el = Range.first; el != Range.second; el++)
+          if (IsSamePrim(el->second, Topo, New))
+          {
+            Add(Pr = new primitives::prim(el->second.Owner));
+            PrimDedupBytes += VSize + Pr->IndexSize(Pr->IndexType) * Topo.Index.size();
+            return Pr;
+          }
         Add(Pr = new primitives::prim(Topo));
+        New.Owner = Pr;
+        PrimHashes.insert({New.Digest.Lo, New});
         return Pr;
       } /* End of 'PrimCreate' function */
 
@@ -160,12 +233,10 @@ namespace digl
      */
     primitives::prim* PrimLoad(const std::string& FileName)
     {
-      primitives::prim* Pr;
       topology::trimesh<vertex::std> Topo;
       Topo.LoadFile(FileName);
 
-      Add(Pr = new primitives::prim(Topo));
-      return Pr;
+      return PrimCreate(Topo);
     } /* End of 'PrimCreate' function */
 
   }; /* End of 'manager_prim' class */
@@ -200,15 +271,59 @@ namespace digl
   /* Material manager type */
   class manager_material : public manager<material>
   {
+    std::unordered_multimap<UINT64, material *> MaterialHashes; // Complete materials hash table
+
   public:
+    UINT64 MaterialDedupCount; // Number of materials resolved to existing ones
+
     /* Material manager constructor.
      * ARGUMENTS: None.
      * RETURNS: None.
      */
-    manager_material( VOID ) : manager()
+    manager_material( VOID ) : manager(), MaterialHashes(), MaterialDedupCount(0)
     {
     } /* End of 'manager_material' function */
 
+    /* Create or find complete material function.
+     * Returned material may be shared, so it should not be changed.
+     * ARGUMENTS:
+     *   - shader:
+     *       shader *Shader;
+     *   - coefficients:
+     *       const vec3 &Ka, &Kd, &Ks;
+     *       const FLT Ph, Trans;
+     *   - textures:
+     *       const std::vector<texture *> &Textures;
+     * RETURNS:
+     *  (material *) Material.
+     */
+    material * MaterialCreate( shader *Shader, const vec3 &Ka, const vec3 &Kd, const vec3 &Ks,
+                               const FLT Ph, const FLT Trans, const std::vector<texture *> &Textures )
+    {
+      material *Mtl;
+      hash H;
+
+      H << Shader << Ka << Kd << Ks << Ph << Trans << Textures.size();
+      H(Textures.data(), sizeof(texture *) * Textures.size());
+
+      /* Materials may be changed after creation, so compare current state */
+      auto Range = MaterialHashes.equal_range(H);
+      for (auto el = Range.first; el != Range.second; el++)
+      {
+        Mtl = el->second;
+        if (Mtl->Shader == Shader && Mtl->Ka == Ka && Mtl->Kd == Kd && Mtl->Ks == Ks &&
+            Mtl->Ph == Ph && Mtl->Trans == Trans && Mtl->Textures == Textures)
+        {
+          MaterialDedupCount++;
+          return Mtl;
+        }
+      }
+      Add( Mtl = new material(Shader, Ka, Kd, Ks, Ph, Trans) );
+      Mtl->Textures = Textures;
+      MaterialHashes.insert({(UINT64)H, Mtl});
+      return Mtl;
+    } /* End of 'MaterialCreate' function */
+
     /* Create material function.
      * ARGUMENTS: None.
      * RETURNS:
@@ -240,12 +355,58 @@ namespace digl
   /* Texture manager type */
   class manager_texture : public manager<texture>
   {
+    /* Pixels hash table entry */
+    struct texture_entry
+    {
+      texture *Tex;         // Texture with these pixels
+      digest::value Digest; // Size and pixels digest
+    }; /* End of 'texture_entry' struct */
+
+    std::unordered_multimap<UINT64, texture_entry> TextureHashes; // Pixels digest to textures table
+
+    /* Find texture with same pixels function.
+     * Pixels are compared by 128-bit digest, so textures are never read back.
+     * ARGUMENTS:
+     *   - size:
+     *       const INT InW, InH;
+     *   - pixels (4 bytes per pixel, nullptr never matches):
+     *       const VOID *Img;
+     *   - pixels digest to fill:
+     *       digest::value &Digest;
+     * RETURNS:
+     *  (texture *) Found texture or nullptr.
+     */
+    texture * TextureFind( const INT InW, const INT InH, const VOID *Img, digest::value &Digest )
+    {
+      digest D;
+      size_t Size = (size_t)InW * InH * 4;
+
+      D << InW << InH;
+      if (Img != nullptr)
+        D(Img, Size);
+      Digest = D.Get();
+      if (Img == nullptr)
+        return nullptr;
+
+      auto Range = TextureHashes.equal_range(Digest.Lo);
+
+      for (auto el = Range.first; el != Range.second; el++)
+        if (el->second.Digest == Digest && el->second.Tex->W == InW && el->second.Tex->H == InH)
+        {
+          TextureDedupBytes += Size;
+          return el->second.Tex;
+        }
+      return nullptr;
+    } /* End of 'TextureFind' function */
+
   public:
+    UINT64 TextureDedupBytes; // Number of pixel bytes not uploaded due to sharing
+
     /* Texture manager constructor.
      * ARGUMENTS: None.
      * RETURNS: None.
      */
-    manager_texture( VOID ) : manager()
+    manager_texture( VOID ) : manager(), TextureHashes(), TextureDedupBytes(0)
     {
     } /* End of 'manager_texture' function */
 
@@ -288,19 +449,47 @@ namespace digl
     texture * TextureCreate( const std::string &InName, const std::string &FileName )
     {
       texture *Tex;
-      Add( Tex = new texture(InName, FileName) );
+      image Img(FileName);
+      digest::value Digest;
+
+      if (Img.RowsD.size() != 0 && (Tex = TextureFind(Img.W, Img.H, Img.RowsD[0], Digest)) != nullptr)
+        return Tex;
+      Add( Tex = new texture(InName, Img) );
+      if (Img.RowsD.size() != 0)
+        TextureHashes.insert({Digest.Lo, {Tex, Digest}});
       return Tex;
     } /* End of 'TextureCreate' function */
 
     /* Create texture function.
-     * ARGUMENTS: None.
+     * Texture with same pixels is shared unless 'IsShared' is FALSE
+     * (texture is going to be changed, e.g. its sampling parameters).
+     * ARGUMENTS:
+     *   - name:
+     *       const std::string &InName;
+     *   - size:
+     *       const INT InW, InH;
+     *   - pixels:
+     *       const DWORD *Img;
+     *   - sharing flag:
+     *       BOOL IsShared;
      * RETURNS:
      *  (rexture &) New texture.
      */
-    texture * TextureCreate( const std::string &InName, const INT InW, const INT InH, const DWORD *Img )
+    texture * TextureCreate( const std::string &InName, const INT InW, const INT InH, const DWORD *Img, BOOL IsShared = TRUE )
     {
       texture *Tex;
+      digest::value Digest;
+
+      if (!IsShared)
+      {
+        Add( Tex = new texture(InName, InW, InH, Img) );
+        return Tex;
+      }
+      if ((Tex = TextureFind(InW, InH, Img, Digest)) != nullptr)
+        return Tex;
       Add( Tex = new texture(InName, InW, InH, Img) );
+      if (Img != nullptr)
+        TextureHashes.insert({Digest.Lo, {Tex, Digest}});
       return Tex;
     } /* End of 'TextureCreate' function */
 
@@ -312,7 +501,13 @@ namespace digl
     texture * TextureCreate( const std::string &InName, const INT InW, const INT InH, const BYTE *Img )
     {
       texture *Tex;
+      digest::value Digest;
+
+      if ((Tex = TextureFind(InW, InH, Img, Digest)) != nullptr)
+        return Tex;
       Add( Tex = new texture(InName, InW, InH, Img) );
+      if (Img != nullptr)
+        TextureHashes.insert({Digest.Lo, {Tex, Digest}});
       return Tex;
     } /* End of 'TextureCreate' function */
 
@@ -372,6 +567,11 @@ namespace digl
   class manager_emitter : public manager<emitter>
   {
   public:
+    particle_budget Budget;      // Global particle budget
+    UINT64
+      EmittersSeed = 0,          // Base random seed of emitters (replay seed)
+      NumOfCreated = 0;          // Number of created emitters (seed offset of next one)
+
     /* Emitter manager constructor.
      * ARGUMENTS: None.
      * RETURNS: None.
@@ -380,7 +580,7 @@ namespace digl
     {
     } /* End of 'manager_emitter' function */
 
-    /* Create emitter function.
+    /* Create emitter function (emitter gets its own random seed).
      * ARGUMENTS: None.
      * RETURNS:
      *  (emitter *) New emitter.
@@ -390,10 +590,55 @@ namespace digl
     {
       EmitterType *Emitter;
       Add(Emitter = new EmitterType());
+      Emitter->Seed = EmittersSeed + NumOfCreated++;
       return Emitter;
     } /* End of 'EmitterCreate' function */
+
+    /* Simulate emitters queued by 'emitter::Response' this frame function.
+     * ARGUMENTS: None.
+     * RETURNS: None.
+     */
+    VOID EmittersSimulate( VOID )
+    {
+      emitter::Simulate(Stock, &Budget);
+    } /* End of 'EmittersSimulate' function */
   }; /* End of 'manager_emitter' class */
 
+  /* Height field manager type */
+  class manager_heightfield : public manager<heightfield>
+  {
+  public:
+    /* Height field manager constructor.
+     * ARGUMENTS: None.
+     * RETURNS: None.
+     */
+    manager_heightfield( VOID ) : manager()
+    {
+    } /* End of 'manager_heightfield' function */
+
+    /* Create height field function.
+     * Height map file is loaded once, next calls with same file name
+     * return loaded field (flat fields are always new).
+     * ARGUMENTS:
+     *   - height map file name (empty for flat field):
+     *       const std::string &FileName;
+     *   - world space corner of height map square, its side and height scale:
+     *       const vec3 &Origin;
+     *       FLT Size, Height;
+     * RETURNS:
+     *  (heightfield *) Height field.
+     */
+    heightfield * HeightfieldCreate( const std::string &FileName, const vec3 &Origin, FLT Size, FLT Height )
+    {
+      heightfield *Field;
+
+      if (FileName != "" && (Field = Find(FileName)) != nullptr)
+        return Field;
+      Add(Field = new heightfield(FileName, Origin, Size, Height));
+      return Field;
+    } /* End of 'HeightfieldCreate' function */
+  }; /* End of 'manager_heightfield' class */
+
 } /* end of 'digl' namespace */
 
 
@@ -104,7 +104,7 @@ VOID digl::anim::Render( VOID )
 
   /* Responses */
   timer::Response();
-  input::Response();
+  input::Response(Replay);
   FPS;
 
   /* Render */
@@ -124,6 +124,8 @@ VOID digl::anim::Render( VOID )
   if (Scene != nullptr)
   {
     (dynamic_cast<units::scene *>(Scene))->Response(this);
+    Replay.EndTick();
+    render::EmittersSimulate();
     (dynamic_cast<units::scene *>(Scene))->Render(this);
   }
   render::pipeline::End();
@@ -131,6 +133,13 @@ VOID digl::anim::Render( VOID )
   render::FrameEnd();
   render::FrameCopy();
 
+  /* Replayed log is over - close window once */
+  if (Replay.IsPlay && Replay.IsEnd && !Replay.IsClosed)
+  {
+    Replay.IsClosed = TRUE;
+    PostMessage(win::hWnd, WM_CLOSE, 0, 0);
+  }
+
 } /* End of 'Render' function */
 
 /* Set scene function.
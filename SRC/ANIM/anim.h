@@ -144,6 +144,7 @@ namespace digl
 
   public:
     std::map<std::string, units::unit * (*)( VOID )> UnitNames;
+    replay Replay; // Input log of deterministic mode
 
     template<class UnitType>
       class unit_register
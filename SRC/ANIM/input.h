@@ -16,6 +16,7 @@
 #define _INPUT_H_
 
 #include "../def.h"
+#include "../UTILS/replay.h"
 #include <mmsystem.h>
 #pragma comment(lib, "winmm")
 
@@ -82,19 +83,26 @@ namespace digl
     {
     } /* End of 'keyboard' function */
 
-    /* Keyboard responsefunction.
+    /* Keyboard state read function.
      * ARGUMENTS: None.
      * RETURNS: None.
      */
-    VOID Response( VOID )
+    VOID Read( VOID )
     {
       GetKeyboardState(Keys);
 
       for (int i = 0; i < 256; i++)
-      {
         Keys[i] >>= 7;
+    } /* End of 'Read' function */
+
+    /* Keyboard responsefunction.
+     * ARGUMENTS: None.
+     * RETURNS: None.
+     */
+    VOID Response( VOID )
+    {
+      for (int i = 0; i < 256; i++)
         KeysClick[i] = Keys[i] && !KeysOld[i];
-      }
       memcpy(KeysOld, Keys, 256);
     } /* End of 'esponse' function */
   }; /* End of 'keyboard' class */
@@ -153,10 +161,18 @@ namespace digl
     {
     } /* End of 'input' function */
 
-    VOID Response( VOID )
+    /* Input response function.
+     * ARGUMENTS:
+     *   - input log (records or replaces read input):
+     *       replay &Log;
+     * RETURNS: None.
+     */
+    VOID Response( replay &Log )
     {
-      keyboard::Response();
+      keyboard::Read();
       mouse::Response();
+      Log.Input(Keys, Dx, Dy, Dz);
+      keyboard::Response();
     } /* End of 'response' function */
 
   }; /* End of 'input' class */
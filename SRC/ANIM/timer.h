@@ -37,7 +37,8 @@ namespace digl
         GlobalDeltaTime,   // Time from last frame
         Time,              // Time from program start (with pause)
         DeltaTime,         // Time from last frame (with pause)
-        FPS;               // Frames-per-second value
+        FPS,               // Frames-per-second value
+        FixedDeltaTime;    // Fixed frame time for deterministic mode (0 for real time)
   
     /* Pause flag */
     BOOL IsPause;
@@ -48,7 +49,7 @@ namespace digl
      */
     timer( VOID ) : StartTime(0), OldTime(0), OldTimeFPS(0), PauseTime(0),
         TimePerSec(0), FrameCounter(0), GlobalTime(0), GlobalDeltaTime(0),
-        Time(0), DeltaTime(0), FPS(30.0), IsPause(FALSE)
+        Time(0), DeltaTime(0), FPS(30.0), FixedDeltaTime(0), IsPause(FALSE)
     {
       LARGE_INTEGER t;
       QueryPerformanceFrequency(&t);
@@ -67,19 +68,30 @@ namespace digl
 
       QueryPerformanceCounter(&t);
 
-      GlobalTime = (DBL)(t.QuadPart - StartTime) / TimePerSec;
-      GlobalDeltaTime = (DBL)(t.QuadPart - OldTime) / TimePerSec;
-
-      /* Time with pause */
-      if (IsPause)
+      if (FixedDeltaTime > 0)
       {
-        DeltaTime = 0;
-        PauseTime += t.QuadPart - OldTime;
+        /* Deterministic mode: every frame is same time step */
+        GlobalDeltaTime = FixedDeltaTime;
+        GlobalTime += FixedDeltaTime;
+        DeltaTime = IsPause ? 0 : FixedDeltaTime;
+        Time += DeltaTime;
       }
       else
       {
-        DeltaTime = GlobalDeltaTime;
-        Time = (DBL)(t.QuadPart - PauseTime - StartTime) / TimePerSec;
+        GlobalTime = (DBL)(t.QuadPart - StartTime) / TimePerSec;
+        GlobalDeltaTime = (DBL)(t.QuadPart - OldTime) / TimePerSec;
+
+        /* Time with pause */
+        if (IsPause)
+        {
+          DeltaTime = 0;
+          PauseTime += t.QuadPart - OldTime;
+        }
+        else
+        {
+          DeltaTime = GlobalDeltaTime;
+          Time = (DBL)(t.QuadPart - PauseTime - StartTime) / TimePerSec;
+        }
       }
 
       /* FPS */
@@ -4,10 +4,14 @@ layout(location = 0) in vec3 InPosition;
 layout(location = 1) in vec2 InTexCoord;
 layout(location = 2) in vec3 InNormal;
 layout(location = 3) in vec4 InColor;
+layout(location = 4) in mat4 InInstWorld;  // Instance data (see 'render::DrawInstanced')
+layout(location = 8) in vec4 InInstParams;
 
 uniform float Time;
 uniform mat4 MatrWVP;
 uniform mat4 MatrW;
+uniform mat4 MatrVP;
+uniform bool IsInstanced;
 
 out vec4 DrawColor;
 out vec3 DrawPos;
@@ -17,13 +21,16 @@ out vec2 DrawTexCoord;
 /* Shader entry point */
 void main( void )
 {
-  gl_Position = MatrWVP * vec4(InPosition.x + 0 * cos(InPosition.z * 0.1 + Time * 2) * 5, 
-                               InPosition.y + 0 * sin(InPosition.z * 0.1 + Time * 2) * 5, 
-                               InPosition.z, 1);
- // gl_Position = MatrWVP * vec4(InPosition * 1, 1);
-  DrawColor = InColor;
-  DrawNormal = normalize(transpose(inverse(mat3(MatrW))) * InNormal);
-  DrawPos = (MatrW * vec4(InPosition, 1)).xyz;
+  mat4 World = IsInstanced ? InInstWorld * MatrW : MatrW;
+  mat4 WVP = IsInstanced ? MatrVP * World : MatrWVP;
+
+  gl_Position = WVP * vec4(InPosition, 1);
+  /* Instance parameters are speed and desired speed: slow vehicles are red */
+  DrawColor = IsInstanced ?
+    InColor * vec4(mix(vec3(1, 0.2, 0.1), vec3(0.2, 0.9, 0.3), clamp(InInstParams.x / InInstParams.y, 0, 1)), 1) :
+    InColor;
+  DrawNormal = normalize(transpose(inverse(mat3(World))) * InNormal);
+  DrawPos = (World * vec4(InPosition, 1)).xyz;
   DrawTexCoord = InTexCoord;
 
 } /* End of 'main' function */
@@ -4,19 +4,18 @@ layout(location = 0) out vec4 OutColor;
 
 layout(binding = 0) uniform sampler2D Tex;
 
-uniform float Trans;
-
 in vec2 DrawTexCoord;
+in float DrawTrans;
 
 /* Shader entry point */
 void main( void )
 {
   OutColor = texture(Tex, DrawTexCoord);
-  //ResTrans = 1 - length(DrawTexCoord * 2 - vec2(1, 1))) * Trans;
+  //ResTrans = 1 - length(DrawTexCoord * 2 - vec2(1, 1))) * DrawTrans;
   if (length(DrawTexCoord * 2 - vec2(1, 1)) < 1)
-    OutColor.w = Trans;
+    OutColor.w = DrawTrans;
   else
     OutColor.w = 0;
-  OutColor.w = Trans;
+  OutColor.w = DrawTrans;
 
 } /* End of 'main' function */
@@ -11,23 +11,26 @@ layout(points) in;
 layout(triangle_strip, max_vertices = 4) out;
 
 uniform mat4 MatrVP;
-uniform mat4 MatrW;
-uniform vec3 Position;
 uniform vec3 CamLoc;
 
-uniform float Size;
+in float VertSize[];
+in float VertTrans[];
 
 out vec2 DrawTexCoord;
+out float DrawTrans;
 
 /* Shader entry point */
 void main( void )
 {
-  vec3 Pos = (MatrW * vec4(Position, 1)).xyz;
+  vec3 Pos = gl_in[0].gl_Position.xyz;
+  float Size = VertSize[0];
 
   vec3 Dir = CamLoc - Pos;
   vec3 Right = normalize(cross(vec3(0, 1, 0), Dir));
   vec3 Up = normalize(cross(Dir, Right));
 
+  DrawTrans = VertTrans[0];
+
   DrawTexCoord = vec2(0, 1);
   gl_Position = MatrVP * vec4(Pos + (-Right + Up) * Size, 1);
   EmitVertex();
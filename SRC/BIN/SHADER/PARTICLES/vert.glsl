@@ -1,8 +1,17 @@
 #version 420
 
+layout(location = 0) in vec3 InPosition;
+layout(location = 1) in float InSize;
+layout(location = 2) in float InTrans;
+
+out float VertSize;
+out float VertTrans;
+
 /* Shader entry point */
 
 void main( void )
 {
-  gl_Position = vec4(0);
+  gl_Position = vec4(InPosition, 1);
+  VertSize = InSize;
+  VertTrans = InTrans;
 } /* End of 'main' function */
@@ -4,10 +4,14 @@ layout(location = 0) in vec3 InPosition;
 layout(location = 1) in vec2 InTexCoord;
 layout(location = 2) in vec3 InNormal;
 layout(location = 3) in vec4 InColor;
+layout(location = 4) in mat4 InInstWorld;  // Instance data (see 'render::DrawInstanced')
+layout(location = 8) in vec4 InInstParams;
 
 uniform float Time;
 uniform mat4 MatrWVP;
 uniform mat4 MatrW;
+uniform mat4 MatrVP;
+uniform bool IsInstanced;
 
 out vec4 DrawColor;
 out vec3 DrawPos;
@@ -17,15 +21,19 @@ out vec2 DrawTexCoord;
 /* Shader entry point */
 void main( void )
 {
-  float swing = abs(InPosition.x) > 0.8 ? (sin(abs(InPosition.x) * 0.1 + Time * 4) * abs(InPosition.x) * 0.5) :
-                -InPosition.z * sin(Time * 4) * 0.1;
-  gl_Position = MatrWVP * vec4(InPosition.x, 
+  mat4 World = IsInstanced ? InInstWorld * MatrW : MatrW;
+  mat4 WVP = IsInstanced ? MatrVP * World : MatrWVP;
+  /* Instance parameter X is wing phase */
+  float t = Time * 4 + (IsInstanced ? InInstParams.x : 0);
+  float swing = abs(InPosition.x) > 0.8 ? (sin(abs(InPosition.x) * 0.1 + t) * abs(InPosition.x) * 0.5) :
+                -InPosition.z * sin(t) * 0.1;
+  gl_Position = WVP * vec4(InPosition.x, 
                                InPosition.y + swing, 
                                InPosition.z + (abs(InPosition.x) > 0.8 ? 0.2 : 0), 1);
  // gl_Position = MatrWVP * vec4(InPosition * 1, 1);
   DrawColor = InColor;
-  DrawNormal = normalize(transpose(inverse(mat3(MatrW))) * InNormal);
-  DrawPos = (MatrW * vec4(InPosition, 1)).xyz;
+  DrawNormal = normalize(transpose(inverse(mat3(World))) * InNormal);
+  DrawPos = (World * vec4(InPosition, 1)).xyz;
   DrawTexCoord = InTexCoord;
 
 } /* End of 'main' function */
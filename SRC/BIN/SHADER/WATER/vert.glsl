@@ -9,6 +9,13 @@ uniform float Time;
 uniform mat4 MatrWVP;
 uniform mat4 MatrW;
 
+/* Terrain chunk (see 'terrain' class) */
+uniform vec3 LandOrigin;
+uniform float LandSize;
+uniform vec2 ChunkOrigin;
+uniform float ChunkSize;
+uniform float SkirtDepth;
+
 out vec4 DrawColor;
 out vec3 DrawPos;
 out vec3 DrawNormal;
@@ -17,13 +24,16 @@ out vec2 DrawTexCoord;
 /* Shader entry point */
 void main( void )
 {
-  gl_Position = MatrWVP * vec4(InPosition.x + 1 * cos(InPosition.z * 0.1 + Time * 0.5) * 3, 
-                               InPosition.y + 1 * sin(InPosition.z * 0.1 + Time * 2) * 1 , 
-                               InPosition.z, 1);
+  vec2 TexCoord = ChunkOrigin + InPosition.zx * ChunkSize;
+  vec3 Pos = LandOrigin + vec3(TexCoord.y * LandSize, -InPosition.y * SkirtDepth, TexCoord.x * LandSize);
+
+  gl_Position = MatrWVP * vec4(Pos.x + 1 * cos(Pos.z * 0.1 + Time * 0.5) * 3, 
+                               Pos.y + 1 * sin(Pos.z * 0.1 + Time * 2) * 1 , 
+                               Pos.z, 1);
   DrawColor = InColor;
   DrawNormal = normalize(transpose(inverse(mat3(MatrW))) * InNormal);
-  DrawPos = (MatrW * vec4(InPosition, 1)).xyz;
-  DrawTexCoord = InTexCoord;
-  DrawTexCoord.x += sin(InPosition.z * 0.1 + Time * 2) * 0.002;
+  DrawPos = (MatrW * vec4(Pos, 1)).xyz;
+  DrawTexCoord = TexCoord;
+  DrawTexCoord.x += sin(Pos.z * 0.1 + Time * 2) * 0.002;
 
 } /* End of 'main' function */
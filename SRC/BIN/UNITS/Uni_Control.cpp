@@ -152,6 +152,9 @@ public:
 
       AC->Cam.SetView(Loc + V, At + V, vec3(0, 1, 0));
     }
+
+    /* Replay check state */
+    AC->Replay.State << Loc << At;
   }
 };
 
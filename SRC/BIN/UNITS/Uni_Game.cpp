@@ -15,71 +15,50 @@
 
 #include "../../ANIM/anim.h"
 #include "../../UTILS/physics.h"
+#include "../../UTILS/kinematics_system.h"
+#include "../../UTILS/flock.h"
 
 using namespace digl;
 
-/* Target representation type */
+/* Target representation type (targets are steered together by 'game_unit' flock) */
 class target
 {
 private:
-  kinematicsVec Position;
-  primitives::primitives *Prims;
+  kinematics_system *Motion; // Motion of all targets
+  INT Body;                   // Target body in 'Motion'
   vec3 Center;
-  FLT MaxDistance;
-  DBL LastTimeChangeAccel, DeltaTimeChangeAccel;
-  FLT Accel = 15;
+  FLT Speed = 15;     // Start speed
+  FLT Clearance = 10; // Minimal height above ground
 
 public:
   /* Constructor */
-  target( const vec3 &InCenter, const FLT InMaxDistance,
-    const DBL InDeltaTimeChangeAccel, shader *InShader,
-    primitives::primitives *InModel ) :
-    Center(InCenter), MaxDistance(InMaxDistance), Prims(nullptr),
-    LastTimeChangeAccel(0), Position(), DeltaTimeChangeAccel(InDeltaTimeChangeAccel)
+  target( const vec3 &InCenter, kinematics_system *InMotion, rng *InRandom ) :
+    Motion(InMotion), Center(InCenter)
   {
-    anim *AC = anim::GetPtr();
-    shader *Sh = InShader;
-    Prims = InModel;
-    vec3 V = vec3().Rnd1();
-    V[1] = 0;
-    Position.Init(FALSE, vec3(0, Center[1], 0), 0, 15, V * Accel);
+    vec3 V(InRandom->Rnd1(), 0, InRandom->Rnd1());
+
+    Body = Motion->AddVector(vec3(0, Center[1], 0), 0, 15, V * Speed);
   } /* End of 'target' function */
 
-  /* Response function. */
-  VOID Response( VOID )
+  /* Get position function. */
+  vec3 GetPos( VOID ) const
   {
-    anim *AC = anim::GetPtr();
-
-    if (AC->Time - LastTimeChangeAccel > DeltaTimeChangeAccel)
-    {
-      LastTimeChangeAccel = AC->Time;
-      vec3 V = vec3().Rnd1();
-      V[1] = 0;
-      Position.SetAccel(V * Accel);
-    }
-
-    if ( (!(Position.Value - Center) >= MaxDistance) )
-    {
-      LastTimeChangeAccel = AC->Time;
-      vec3 V = (Center - Position.Value).Normalizing();
-      V[1] = 0;
-      Position.SetAccel(V * Accel);
-    }
-
-    Position.Compute();
-
-  } /* End of 'Response' function */
-
-  /* Draw function. */
-  VOID Draw( VOID )
+    return Motion->GetValue(Body);
+  } /* End of 'GetPos' function */
+
+  /* Keep target above ground function (after motion step).
+   * ARGUMENTS:
+   *   - ground height under target:
+   *       FLT Ground;
+   * RETURNS: None.
+   */
+  VOID Land( FLT Ground )
   {
-    anim *AC = anim::GetPtr();
-    vec3 V = Position.SpeedCur.Normalizing();
+    vec3 Pos = GetPos();
 
-    AC->DrawPrims(*Prims, Prims->Transform *
-        matr::Basis(V % vec3(0, 1, 0), vec3(0, 1, 0), V) *
-        matr::Translate(Position.Value));
-  } /* End of 'Draw' function */
+    Pos[1] = mth::Max(Pos[1], Ground + Clearance);
+    Motion->SetValue(Body, Pos);
+  } /* End of 'Land' function */
 
 };
 
@@ -98,6 +77,15 @@ class game_unit : public units::unit
 {
 public:
   std::vector<target *> Targets;
+  kinematics_system TargetsMotion;                    // Targets are moved together
+  flock Flock;                                        // Targets steering
+  rng Random;                                         // Targets random stream (seeded in deterministic mode)
+  std::vector<FLT> TargetsGround;                     // Batched ground height query
+  std::vector<FLT> TargetPhases;                      // Wing phases
+  std::vector<primitives::instance> TargetInstances;  // Targets are drawn instanced
+  std::vector<INT> TargetLods;
+  primitives::primitives *TargetModel;
+  heightfield *Field;
   geom *Player;
   INT NumOfTargets = 10;
   FLT PlayerAccel = 20;
@@ -107,15 +95,26 @@ public:
   FLT MaxDist = 70;
   emitterWaterDrop *Emitter;
   geom *Stick;
+  kinematicsLazy StickAngle;  // Stick spin (evaluated at frame time only)
+  scene_bvh Obstacles;        // Tower on player hiding it from camera
 
 
   game_unit( anim *AC )
   {
+    /* Same height field as 'Ground' unit (loaded once by manager) */
+    Field = AC->HeightfieldCreate("SRC/BIN/TEXTURES/LANDSCAPE/texture_height2.bmp", vec3(-250, 0, -250), 500, 65);
+
     /* Targets */
+    Random = AC->Replay.Random(0);
     shader *Sh = AC->ShaderCreate("SRC/BIN/SHADER/SEAGUL/");
-    primitives::primitives *Pr1 = AC->PrimsLoad("SRC/BIN/MODELS/G3DM/SEAGUL.g3dm", Sh);
+    TargetModel = AC->PrimsLoad("SRC/BIN/MODELS/G3DM/SEAGUL.g3dm", Sh);
     for (int i = 0; i < NumOfTargets; i++)
-      Targets.push_back(new target(Center + vec3(0, 40, 0), MaxDist, 4 + sin(i) * 1, Sh, Pr1));
+    {
+      Targets.push_back(new target(Center + vec3(0, 40, 0), &TargetsMotion, &Random));
+      TargetPhases.push_back((4 + sin(i) * 1) * 10);
+    }
+    Flock.Center = Center + vec3(0, 40, 0);
+    Flock.MaxDistance = MaxDist;
 
     /* Player */
     Sh = AC->ShaderCreate("SRC/BIN/SHADER/DEFAULT2/");
@@ -157,7 +156,9 @@ public:
     Stick->AddEmitter(Emitter);
 
     Stick->SetMatrix(matr::Translate(vec3(0, 8, 5)));
-
+    Box->AddToScene(&Obstacles);
+    /* Stick spins up to 35 degrees per second */
+    StickAngle = kinematicsLazy(AC->Time, 0, -35, 35, 0, -20);
   }
 
   ~game_unit( VOID )
@@ -166,10 +167,13 @@ public:
 
   VOID Response( anim *AC ) override
   {
-    static DBL LastTime = AC->Time;
-    /* Targets */
-    for (auto el : Targets)
-      el->Response();
+    /* Targets (ground is sampled under positions after motion step) */
+    Flock.Steer(TargetsMotion);
+    TargetsMotion.Compute((FLT)AC->DeltaTime);
+    TargetsGround.resize(Targets.size());
+    Field->GetHeights(TargetsMotion.Vectors.X.data(), TargetsMotion.Vectors.Z.data(), TargetsGround.data(), Targets.size());
+    for (size_t i = 0; i < Targets.size(); i++)
+      Targets[i]->Land(TargetsGround[i]);
 
     /* Player control */
     FLT
@@ -194,6 +198,8 @@ public:
     }
 
     PlayerPos.Compute();
+    /* Player floats on water and climbs on ground */
+    PlayerPos.Value[1] = mth::Max(Center[1] + 3, Field->GetHeight(PlayerPos.Value[0], PlayerPos.Value[2]));
       /*
     vec3 V = AC->Cam.Dir;
     Player->ApplyMatrix(matr::Translate(vec3(V[0], 0, V[1]) * PlayerSpeed * StrideUp));
@@ -213,19 +219,35 @@ public:
       Player->SetMatrix(matr::Basis(OldV % vec3(0, 1, 0), vec3(0, 1, 0), OldV) * matr::Translate(PlayerPos.Value));
     }
 
-    AC->Cam.SetView(AC->Cam.Loc, PlayerPos.Value, vec3(0, 1, 0));
+    /* Camera is pulled in front of ground and tower between it and player */
+    vec3 CamLoc = AC->Cam.Loc, ToCam = CamLoc - PlayerPos.Value, Org = PlayerPos.Value + vec3(0, 1, 0);
+    FLT CamT = 1, FieldT;
+    bvh_hit Hit;
+
+    if (Field->Intersect(Org, ToCam, 1, FieldT))
+      CamT = FieldT;
+    Obstacles.Update();
+    if (Obstacles.Intersect(Org, ToCam, CamT, Hit))
+      CamT = Hit.T;
+    if (CamT < 1)
+      CamLoc = Org + ToCam * (CamT * 0.9f);
+    AC->Cam.SetView(CamLoc, PlayerPos.Value, vec3(0, 1, 0));
 
-    Stick->ApplyMatrix(matr::RotateY(-35 * (AC->Time - LastTime)));
+    Stick->SetMatrix(matr::Translate(vec3(0, 8, 5)) * matr::RotateY(StickAngle.GetValue(AC->Time)));
 
     Player->Response();
-    LastTime = AC->Time;
+
+    /* Replay check state */
+    AC->Replay.State << PlayerPos.Value;
+    for (auto el : Targets)
+      AC->Replay.State << el->GetPos();
   }
 
   VOID Render( anim *AC ) override
   {
     /* Targets */
-    for (auto el : Targets)
-      el->Draw();
+    Flock.GetInstances(TargetsMotion, TargetModel->Transform, TargetPhases.data(), TargetInstances);
+    AC->DrawInstanced(*TargetModel, TargetInstances, &TargetLods);
     /* Player */
     Player->Draw();
   }
@@ -14,6 +14,7 @@
  */
 
 #include "../../ANIM/anim.h"
+#include "../../UTILS/terrain.h"
 #include <vector>
 #include <cmath>
 
@@ -21,69 +22,64 @@ using namespace digl;
 
 class ground_unit : public units::unit
 {
-  primitives::prim *Ground;
-  primitives::prim *Water;
-  std::vector<primitives::primitives *> Trees;
-  std::vector<vec3> TreePositions;
+  terrain Ground;
+  terrain Water;
+  primitives::primitives *Tree;
+  std::vector<primitives::instance> Trees; // Tree instances (ground normal in parameters)
+  std::vector<INT> TreeLods;
   INT NumOfTrees = 20;
   FLT LandscapeSize = 500;
-  shader *TreeSh;
 
 public:
   ground_unit( anim *AC )
   {
-    /* Water */
+    /* Water (flat, waves are made in shader) */
     shader* Sh = AC->ShaderCreate("SRC/BIN/SHADER/WATER/");
-    topology::plane<digl::vertex::std> Topo1(vec3(-0.5 * LandscapeSize, 0, -0.5 * LandscapeSize),
-                                            vec3(LandscapeSize, 0, 0),
-                                            vec3(0, 0, LandscapeSize), 300, 300);
-    Water = AC->PrimCreate(Topo1);
-    Water->SetMaterial(AC->MaterialCreate(Sh));
+    material *Mtl = AC->MaterialCreate(Sh);
 
-    Water->Material->Textures.push_back(
+    Mtl->Textures.push_back(
       AC->TextureCreate("", "SRC/BIN/TEXTURES/LANDSCAPE/water.bmp"));
-    Water->Transform = matr::Translate(vec3(0, 13, 0));
+    Water.DetailError = 0.1;
+    Water.Init(Mtl, AC->HeightfieldCreate("", vec3(-0.5 * LandscapeSize, 13, -0.5 * LandscapeSize), LandscapeSize, 0), 3);
     /* Ground */
     Sh = AC->ShaderCreate("SRC/BIN/SHADER/LANDSCAPE/");
-    topology::plane<digl::vertex::std> Topo(vec3(-0.5 * LandscapeSize, 0, -0.5 * LandscapeSize),
-                                            vec3(LandscapeSize, 0, 0),
-                                            vec3(0, 0, LandscapeSize), 300, 300);
-    Ground = AC->PrimCreate(Topo);
+    Mtl = AC->MaterialCreate(Sh);
 
-    Ground->SetMaterial(AC->MaterialCreate(Sh));
-
-    texture *Height;
-    Ground->Material->Textures.push_back(
+    heightfield *Field = AC->HeightfieldCreate("SRC/BIN/TEXTURES/LANDSCAPE/texture_height2.bmp",
+                                               vec3(-0.5 * LandscapeSize, 0, -0.5 * LandscapeSize), LandscapeSize, 65);
+    Mtl->Textures.push_back(
       AC->TextureCreate("", "SRC/BIN/TEXTURES/LANDSCAPE/texture_materials2.bmp"));
-    Ground->Material->Textures.push_back(
+    Mtl->Textures.push_back(
       AC->TextureCreate("", "SRC/BIN/TEXTURES/LANDSCAPE/texture_grass.bmp"));
-    Ground->Material->Textures.push_back(
+    Mtl->Textures.push_back(
       AC->TextureCreate("", "SRC/BIN/TEXTURES/LANDSCAPE/texture_stone.bmp"));
-    Ground->Material->Textures.push_back(
+    Mtl->Textures.push_back(
       AC->TextureCreate("", "SRC/BIN/TEXTURES/LANDSCAPE/texture_dirt.bmp"));
-    Ground->Material->Textures.push_back(
+    Mtl->Textures.push_back(
       AC->TextureCreate("", "SRC/BIN/TEXTURES/LANDSCAPE/texture_sand.bmp"));
-    Ground->Material->Textures.push_back(
-      Height = AC->TextureCreate("", "SRC/BIN/TEXTURES/LANDSCAPE/texture_height2.bmp"));
-
-    Ground->Transform = matr::Translate(vec3(0, 0, 0));
+    Mtl->Textures.push_back(Field->HeightTex);
+    Mtl->Textures.push_back(Field->NormalTex);
+    Ground.Init(Mtl, Field);
 
     /* Trees */
-    TreeSh = AC->ShaderCreate("SRC/BIN/SHADER/TREES/");
-    primitives::primitives *Source = AC->PrimsLoad((const CHAR *)"SRC/BIN/MODELS/G3DM/ficus.g3dm", TreeSh, matr::Scale(vec3(0.1)));
+    Tree = AC->PrimsLoad((const CHAR *)"SRC/BIN/MODELS/G3DM/ficus.g3dm", AC->ShaderCreate("SRC/BIN/SHADER/TREES/"),
+                         matr::Scale(vec3(0.1)));
+
+    std::vector<FLT> X(NumOfTrees), Z(NumOfTrees), Y(NumOfTrees);
 
     for (INT i = 0; i < NumOfTrees; ++i)
     {
-      primitives::primitives *Tree = AC->PrimsCreate();
-      Tree->Prims = Source->Prims;
       vec3 Pos = vec3(std::cos(i + 16), 0, std::sin(i + 16)) *
                       (LandscapeSize * 0.5 * 0.87  + std::cos(i - 102) * LandscapeSize * 0.5 * 0.05);
-      TreePositions.push_back(Pos);
-      Tree->Transform = matr::Translate(Pos);
+      X[i] = Pos[0];
+      Z[i] = Pos[2];
+    }
+    Field->GetHeights(X.data(), Z.data(), Y.data(), NumOfTrees);
+    for (INT i = 0; i < NumOfTrees; ++i)
+    {
+      vec3 N = Field->GetNormal(X[i], Z[i]);
 
-      for (auto el: Tree->Prims)
-        el->Material->Textures.push_back(Height);
-      Trees.push_back(Tree);
+      Trees.push_back({matr::Translate(vec3(X[i], Y[i], Z[i])), vec4(N[0], N[1], N[2], 0)});
     }
   }
 
@@ -97,16 +93,9 @@ public:
 
   VOID Render( anim *AC ) override
   {
-    AC->Draw(*Ground, Ground->Transform);
-    AC->Draw(*Water, Water->Transform);
-    glUseProgram(TreeSh->ProgId);
-    for (INT i = 0; i < NumOfTrees; ++i)
-    {
-      INT loc;
-      if ((loc = glGetUniformLocation(TreeSh->ProgId, "TreePos")) != -1)
-        glUniform3fv(loc, 1, TreePositions[i]);
-      AC->DrawPrims(*Trees[i], Trees[i]->Transform);
-    }
+    Ground.Draw();
+    Water.Draw();
+    AC->DrawInstanced(*Tree, Trees, &TreeLods);
   }
 };
 
@@ -0,0 +1,220 @@
+/***************************************************************
+ * Copyright (C) 2020
+ *    Computer Graphics Support Group of 30 Phys-Math Gymnasium
+ ***************************************************************/
+
+/* FILE NAME   : Uni_Traffic.cpp
+ * PURPOSE     : Unit traffic file.
+ * PROGRAMMER  : Dmitriy Vlasov.
+ * LAST UPDATE : 19.10.2020
+ * NOTE        : Namespace 'digl'.
+ *
+ * No part of this file may be changed without agreement of
+ * Computer Graphics Support Group of 30 Phys-Math Gymnasium.
+ */
+
+#include "../../ANIM/anim.h"
+#include "../../UTILS/traffic.h"
+#include "../../UTILS/broadphase.h"
+
+#include <algorithm>
+
+using namespace digl;
+
+/* Traffic unit class */
+class traffic_unit : public units::unit
+{
+private:
+  traffic Traffic;
+  primitives::primitives *CarModel;
+  heightfield *Field;
+  std::vector<primitives::instance> Instances; // Vehicles are drawn instanced
+  std::vector<FLT> CarsX, CarsZ, CarsGround;     // Batched ground height query
+  std::vector<INT> Lods;
+  FLT WaterLevel = 10;                           // Vehicles float on water as player does
+  broadphase Crossing;                           // Vehicle safety boxes (straight road crosses ring)
+  std::vector<INT> Bodies;                       // Broad phase bodies of instances
+  std::vector<INT> BodyInstance;                 // Instances of broad phase bodies
+  std::vector<std::vector<FLT>> Entries;         // Ring road entries along straight road lanes (sorted)
+
+public:
+  /* Constructor */
+  traffic_unit( anim *AC )
+  {
+    /* Same height field as 'Ground' unit (loaded once by manager) */
+    Field = AC->HeightfieldCreate("SRC/BIN/TEXTURES/LANDSCAPE/texture_height2.bmp", vec3(-250, 0, -250), 500, 65);
+
+    /* Ring road around scene center and straight road across it */
+    Traffic.Fill(Traffic.AddRing(vec3(0), 180, 3), 40, 12, 30, AC->Replay.Seed);
+    Traffic.Fill(Traffic.AddRoad(vec3(-240, 0, -20), vec3(240, 0, -20), 2), 10, 15, 25, AC->Replay.Seed);
+
+    /* Straight lanes enter ring road band at its outer and then inner edge */
+    const traffic::road &Ring = Traffic.Roads[0], &Road = Traffic.Roads[1];
+    FLT
+      Inner = Ring.Radius - Ring.LaneWidth / 2,
+      Outer = Ring.Radius + (Ring.NumOfLanes - 0.5f) * Ring.LaneWidth;
+
+    Entries.resize(Road.NumOfLanes);
+    for (INT l = 0; l < Road.NumOfLanes; l++)
+    {
+      vec3 Q = Road.Org + (Road.Dir % vec3(0, 1, 0)) * (l * Road.LaneWidth) - Ring.Org;
+      FLT
+        b = Road.Dir & Q,
+        DOuter = b * b - (Q & Q) + Outer * Outer,
+        DInner = b * b - (Q & Q) + Inner * Inner;
+
+      if (DOuter > 0)
+        Entries[l].push_back(-b - sqrt(DOuter));
+      if (DInner > 0)
+        Entries[l].push_back(-b + sqrt(DInner));
+    }
+
+    shader *Sh = AC->ShaderCreate("SRC/BIN/SHADER/CAR/");
+    topology::cube<digl::vertex::std> Topo(1.8, 1.4, Traffic.Driver.Length, 2);
+    primitives::prim *Pr = AC->PrimCreate(Topo);
+
+    Pr->SetMaterial(AC->MaterialCreate(Sh));
+    CarModel = AC->PrimsCreate();
+    *CarModel << Pr;
+  } /* End of 'traffic_unit' function */
+
+  /* Stop straight road vehicles at ring road crossing function.
+   * Straight road vehicle whose safety box (vehicle length around it)
+   * overlaps ring road vehicle one before ring road entry puts stop line
+   * at this entry, lane vehicles stop at it (next steps) until ring vehicle passes.
+   * ARGUMENTS: None.
+   * RETURNS: None.
+   */
+  VOID Yield( VOID )
+  {
+    const FLT Half = Traffic.Driver.Length;
+
+    /* Same number of bodies as instances */
+    while (Bodies.size() < Instances.size())
+      Bodies.push_back(Crossing.Add(vec3(0), vec3(0)));
+    while (Bodies.size() > Instances.size())
+    {
+      Crossing.Remove(Bodies.back());
+      Bodies.pop_back();
+    }
+    for (size_t i = 0; i < Instances.size(); i++)
+    {
+      vec3 P = Instances[i].World.TransformPoint(vec3(0));
+      INT B = Bodies[i];
+
+      Crossing.Update(B, P - vec3(Half, 1, Half), P + vec3(Half, 1, Half));
+      if (B >= (INT)BodyInstance.size())
+        BodyInstance.resize(B + 1);
+      BodyInstance[B] = (INT)i;
+    }
+    Crossing.Compute();
+
+    /* Instance to lane and vehicle (instances are filled lane by lane) */
+    const traffic::road &Ring = Traffic.Roads[0];
+    std::vector<size_t> Start(Traffic.Lanes.size() + 1, 0);
+    auto GetLane = [&]( INT Instance )
+    {
+      return (INT)(std::upper_bound(Start.begin(), Start.end(), (size_t)Instance) - Start.begin()) - 1;
+    };
+    auto IsRing = [&]( INT Lane )
+    {
+      return Lane >= Ring.FirstLane && Lane < Ring.FirstLane + Ring.NumOfLanes;
+    };
+
+    const traffic::road &Road = Traffic.Roads[1];
+
+    for (size_t k = 0; k < Traffic.Lanes.size(); k++)
+      Start[k + 1] = Start[k] + Traffic.Lanes[k].Pos.size();
+    for (INT l = 0; l < Road.NumOfLanes; l++)
+      Traffic.Lanes[Road.FirstLane + l].Stops.clear();
+    for (auto *List : {&Crossing.Began, &Crossing.Persisted})
+      for (const broadphase::pair &P : *List)
+      {
+        INT
+          A = BodyInstance[P.A], B = BodyInstance[P.B],
+          LaneA = GetLane(A), LaneB = GetLane(B);
+
+        /* Vehicles of same road follow lane rules */
+        if (IsRing(LaneA) == IsRing(LaneB))
+          continue;
+
+        INT Vehicle = IsRing(LaneA) ? B : A, Lane = IsRing(LaneA) ? LaneB : LaneA;
+
+        /* Entry ahead close enough to be one vehicle is about to cross */
+        traffic::lane &L = Traffic.Lanes[Lane];
+        const std::vector<FLT> &E = Entries[Lane - Road.FirstLane];
+        FLT Pos = L.Pos[Vehicle - Start[Lane]];
+        auto Entry = std::lower_bound(E.begin(), E.end(), Pos);
+
+        if (Entry != E.end() && *Entry - Pos < 2 * Half)
+          if (std::find(L.Stops.begin(), L.Stops.end(), *Entry) == L.Stops.end())
+          {
+            L.Stops.push_back(*Entry);
+            std::sort(L.Stops.begin(), L.Stops.end());
+          }
+      }
+  } /* End of 'Yield' function */
+
+  /* Response function.
+   * ARGUMENTS:
+   *   - animation context:
+   *       anim *AC;
+   * RETURNS: None.
+   */
+  VOID Response( anim *AC ) override
+  {
+    /* Long frames are split to keep IDM stable */
+    FLT Dt = (FLT)AC->DeltaTime;
+
+    for (INT i = 0; i < 4 && Dt > 0; i++, Dt -= 0.05f)
+      Traffic.Step(mth::Min(Dt, 0.05f));
+
+    /* Straight road is fed at its start */
+    const traffic::road &R = Traffic.Roads[1];
+
+    for (INT l = 0; l < R.NumOfLanes; l++)
+    {
+      const traffic::lane &L = Traffic.Lanes[R.FirstLane + l];
+
+      if (L.Pos.empty() || L.Pos[0] > 40)
+        Traffic.AddVehicle(1, l, 0, 15, 20 + l * 5);
+    }
+
+    /* Vehicles on ground */
+    Traffic.GetInstances(matr::Translate(vec3(0, 0.7, 0)), Instances);
+    Yield();
+    CarsX.resize(Instances.size());
+    CarsZ.resize(Instances.size());
+    CarsGround.resize(Instances.size());
+    for (size_t i = 0; i < Instances.size(); i++)
+    {
+      vec3 P = Instances[i].World.TransformPoint(vec3(0));
+
+      CarsX[i] = P[0];
+      CarsZ[i] = P[2];
+    }
+    Field->GetHeights(CarsX.data(), CarsZ.data(), CarsGround.data(), Instances.size());
+    for (size_t i = 0; i < Instances.size(); i++)
+      Instances[i].World = Instances[i].World * matr::Translate(vec3(0, mth::Max(CarsGround[i], WaterLevel), 0));
+
+    /* Replay check state */
+    if (AC->Replay.IsActive())
+      for (auto &L : Traffic.Lanes)
+        AC->Replay.State(L.Pos.data(), L.Pos.size() * sizeof(FLT));
+  } /* End of 'Response' function */
+
+  /* Render function.
+   * ARGUMENTS:
+   *   - animation context:
+   *       anim *AC;
+   * RETURNS: None.
+   */
+  VOID Render( anim *AC ) override
+  {
+    AC->DrawInstanced(*CarModel, Instances, &Lods);
+  } /* End of 'Render' function */
+}; /* End of 'traffic_unit' class */
+
+static digl::anim::unit_register<traffic_unit> _("Traffic");
+
+/* END OF 'Uni_Traffic.cpp' FILE */
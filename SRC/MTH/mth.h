@@ -22,6 +22,7 @@
 #include "mth_vec.h"
 #include "mth_matr.h"
 #include "mth_cam.h"
+#include "mth_pack.h"
 
 #endif /* __MATH_H_ */
 
@@ -0,0 +1,277 @@
+/***************************************************************
+ * Copyright (C) 2020
+ *    Computer Graphics Support Group of 30 Phys-Math Gymnasium
+ ***************************************************************/
+
+/* FILE NAME   : mth_pack.h
+ * PURPOSE     : Math packing (quantization) header file.
+ * PROGRAMMER  : Dmitriy Vlasov.
+ * LAST UPDATE : 19.10.2020
+ * NOTE        : Namespace 'mth'.
+ *
+ * No part of this file may be changed without agreement of
+ * Computer Graphics Support Group of 30 Phys-Math Gymnasium.
+ */
+
+#ifndef __MTH_PACK_H_
+#define __MTH_PACK_H_
+
+#include "mthdef.h"
+#include "mth_utils.h"
+#include "mth_vec.h"
+
+#include <string.h>
+
+/* Space math namespace */
+namespace mth
+{
+  /* Convert float to half float function.
+   * ARGUMENTS:
+   *   - value to convert:
+   *       FLT F;
+   * RETURNS:
+   *   (WORD) half float bits (round to nearest even).
+   */
+  inline WORD FloatToHalf( FLT F )
+  {
+    UINT32 x, sign, mant;
+    INT exp;
+
+    memcpy(&x, &F, 4);
+    sign = (x >> 16) & 0x8000;
+    exp = (INT)((x >> 23) & 0xFF) - 127 + 15;
+    mant = x & 0x7FFFFF;
+
+    /* NaN and infinity */
+    if (((x >> 23) & 0xFF) == 0xFF)
+      return (WORD)(sign | 0x7C00 | (mant != 0 ? 0x200 : 0));
+    /* Overflow */
+    if (exp >= 31)
+      return (WORD)(sign | 0x7C00);
+    /* Denormals and underflow */
+    if (exp <= 0)
+    {
+      if (exp < -10)
+        return (WORD)sign;
+      mant |= 0x800000;
+      UINT32 shift = 14 - exp,
+        half = mant >> shift,
+        rest = mant & ((1 << shift) - 1),
+        mid = 1 << (shift - 1);
+      if (rest > mid || (rest == mid && (half & 1)))
+        half++;
+      return (WORD)(sign | half);
+    }
+
+    UINT32 half = sign | (exp << 10) | (mant >> 13),
+      rest = mant & 0x1FFF;
+    if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+      half++;
+    return (WORD)half;
+  } /* End of 'FloatToHalf' function */
+
+  /* Convert half float to float function.
+   * ARGUMENTS:
+   *   - half float bits:
+   *       WORD H;
+   * RETURNS:
+   *   (FLT) float value.
+   */
+  inline FLT HalfToFloat( WORD H )
+  {
+    UINT32
+      sign = (UINT32)(H & 0x8000) << 16,
+      exp = (H >> 10) & 0x1F,
+      mant = H & 0x3FF,
+      x;
+
+    if (exp == 0)
+    {
+      if (mant == 0)
+        x = sign;
+      else
+      {
+        /* Normalize denormal */
+        exp = 127 - 15 + 1;
+        while ((mant & 0x400) == 0)
+          mant <<= 1, exp--;
+        x = sign | (exp << 23) | ((mant & 0x3FF) << 13);
+      }
+    }
+    else if (exp == 31)
+      x = sign | 0x7F800000 | (mant << 13);
+    else
+      x = sign | ((exp - 15 + 127) << 23) | (mant << 13);
+
+    FLT F;
+    memcpy(&F, &x, 4);
+    return F;
+  } /* End of 'HalfToFloat' function */
+
+  /* Quantize value in range to unsigned 16-bit function.
+   * ARGUMENTS:
+   *   - value and its range:
+   *       FLT V, MinV, MaxV;
+   * RETURNS:
+   *   (WORD) quantized value.
+   */
+  inline WORD QuantizeUnorm16( FLT V, FLT MinV, FLT MaxV )
+  {
+    if (MaxV <= MinV)
+      return 0;
+    return (WORD)(Span<FLT>(0, 1, (V - MinV) / (MaxV - MinV)) * 65535.0f + 0.5f);
+  } /* End of 'QuantizeUnorm16' function */
+
+  /* Dequantize unsigned 16-bit value to range function.
+   * ARGUMENTS:
+   *   - quantized value:
+   *       WORD Q;
+   *   - value range:
+   *       FLT MinV, MaxV;
+   * RETURNS:
+   *   (FLT) value.
+   */
+  inline FLT DequantizeUnorm16( WORD Q, FLT MinV, FLT MaxV )
+  {
+    return MinV + (MaxV - MinV) * (Q / 65535.0f);
+  } /* End of 'DequantizeUnorm16' function */
+
+  /* Convert float in [-1; 1] to signed normalized 16-bit function.
+   * ARGUMENTS:
+   *   - value:
+   *       FLT V;
+   * RETURNS:
+   *   (SHORT) normalized value.
+   */
+  inline SHORT FloatToSnorm16( FLT V )
+  {
+    V = Span<FLT>(-1, 1, V) * 32767.0f;
+    return (SHORT)(V >= 0 ? V + 0.5f : V - 0.5f);
+  } /* End of 'FloatToSnorm16' function */
+
+  /* Convert signed normalized 16-bit to float function.
+   * ARGUMENTS:
+   *   - normalized value:
+   *       SHORT S;
+   * RETURNS:
+   *   (FLT) value in [-1; 1].
+   */
+  inline FLT Snorm16ToFloat( SHORT S )
+  {
+    return Max<FLT>(S / 32767.0f, -1);
+  } /* End of 'Snorm16ToFloat' function */
+
+  /* Encode unit vector to octahedral coordinates function.
+   * ARGUMENTS:
+   *   - unit vector:
+   *       const vec3<FLT> &N;
+   *   - output coordinates (signed normalized 16-bit):
+   *       SHORT *Out;
+   * RETURNS: None.
+   */
+  inline VOID OctEncode( const vec3<FLT> &N, SHORT *Out )
+  {
+    FLT
+      l = fabs(N[0]) + fabs(N[1]) + fabs(N[2]),
+      x, y;
+
+    if (l == 0)
+    {
+      Out[0] = Out[1] = 0;
+      return;
+    }
+    x = N[0] / l;
+    y = N[1] / l;
+    if (N[2] < 0)
+    {
+      FLT ox = x;
+
+      x = (1 - fabs(y)) * (ox >= 0 ? 1 : -1);
+      y = (1 - fabs(ox)) * (y >= 0 ? 1 : -1);
+    }
+    Out[0] = FloatToSnorm16(x);
+    Out[1] = FloatToSnorm16(y);
+  } /* End of 'OctEncode' function */
+
+  /* Decode unit vector from octahedral coordinates function.
+   * ARGUMENTS:
+   *   - coordinates (signed normalized 16-bit):
+   *       const SHORT *In;
+   * RETURNS:
+   *   (vec3<FLT>) unit vector.
+   */
+  inline vec3<FLT> OctDecode( const SHORT *In )
+  {
+    FLT
+      x = Snorm16ToFloat(In[0]),
+      y = Snorm16ToFloat(In[1]),
+      z = 1 - fabs(x) - fabs(y),
+      t = Max<FLT>(-z, 0);
+
+    x += x >= 0 ? -t : t;
+    y += y >= 0 ? -t : t;
+    return vec3<FLT>(x, y, z).Normalizing();
+  } /* End of 'OctDecode' function */
+
+  /* Pack vector to signed normalized 10-10-10-2 value function.
+   * ARGUMENTS:
+   *   - vector (components in [-1; 1]):
+   *       const vec3<FLT> &V;
+   *   - 2-bit W component (-2..1):
+   *       INT W;
+   * RETURNS:
+   *   (DWORD) packed value (X in low bits, 'GL_INT_2_10_10_10_REV' layout).
+   */
+  inline DWORD PackSnorm1010102( const vec3<FLT> &V, INT W = 0 )
+  {
+    DWORD Res = ((DWORD)W & 3) << 30;
+
+    for (INT i = 0; i < 3; i++)
+    {
+      FLT c = Span<FLT>(-1, 1, V[i]) * 511.0f;
+
+      Res |= ((DWORD)(INT)(c >= 0 ? c + 0.5f : c - 0.5f) & 0x3FF) << (i * 10);
+    }
+    return Res;
+  } /* End of 'PackSnorm1010102' function */
+
+  /* Unpack vector from signed normalized 10-10-10-2 value function.
+   * ARGUMENTS:
+   *   - packed value:
+   *       DWORD P;
+   * RETURNS:
+   *   (vec3<FLT>) vector (W component is dropped).
+   */
+  inline vec3<FLT> UnpackSnorm1010102( DWORD P )
+  {
+    vec3<FLT> V;
+
+    for (INT i = 0; i < 3; i++)
+    {
+      INT c = (INT)((P >> (i * 10)) & 0x3FF);
+
+      V[i] = Max<FLT>((c >= 512 ? c - 1024 : c) / 511.0f, -1);
+    }
+    return V;
+  } /* End of 'UnpackSnorm1010102' function */
+
+  /* Pack vector to unsigned normalized 8-bit components function.
+   * ARGUMENTS:
+   *   - vector (components in [0; 1]):
+   *       const vec4<FLT> &V;
+   * RETURNS:
+   *   (DWORD) packed value (X in low byte).
+   */
+  inline DWORD PackUnorm8x4( const vec4<FLT> &V )
+  {
+    DWORD Res = 0;
+
+    for (INT i = 0; i < 4; i++)
+      Res |= (DWORD)(Span<FLT>(0, 1, V[i]) * 255.0f + 0.5f) << (i * 8);
+    return Res;
+  } /* End of 'PackUnorm8x4' function */
+} /* end of 'mth' namespace */
+
+#endif /* __MTH_PACK_H_ */
+
+/* END OF 'mth_pack.h' FILE */
@@ -750,6 +750,28 @@ namespace mth
         return sqrt(dX * dX + dY * dY + dZ * dZ);
       } /* End of 'Distance' function */
 
+      /* Componentwise minimum function.
+       * ARGUMENTS:
+       *   - vectors:
+       *       const vec3 &A, &B;
+       * RETURNS: (vec3) minimum vector.
+       */
+      static vec3 Min( const vec3 &A, const vec3 &B )
+      {
+        return vec3(A.X < B.X ? A.X : B.X, A.Y < B.Y ? A.Y : B.Y, A.Z < B.Z ? A.Z : B.Z);
+      } /* End of 'Min' function */
+
+      /* Componentwise maximum function.
+       * ARGUMENTS:
+       *   - vectors:
+       *       const vec3 &A, &B;
+       * RETURNS: (vec3) maximum vector.
+       */
+      static vec3 Max( const vec3 &A, const vec3 &B )
+      {
+        return vec3(A.X > B.X ? A.X : B.X, A.Y > B.Y ? A.Y : B.Y, A.Z > B.Z ? A.Z : B.Z);
+      } /* End of 'Max' function */
+
       /* Set zero components function.
        * ARGUMENTS: None.
        * RETURNS: (vec3 &) this vector.
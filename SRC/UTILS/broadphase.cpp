@@ -0,0 +1,366 @@
+/***************************************************************
+ * Copyright (C) 2020
+ *    Computer Graphics Support Group of 30 Phys-Math Gymnasium
+ ***************************************************************/
+
+/* FILE NAME   : broadphase.cpp
+ * PURPOSE     : Collision broad phase file.
+ * PROGRAMMER  : Dmitriy Vlasov.
+ * LAST UPDATE : 19.10.2020
+ * NOTE        : Namespace 'digl'.
+ *
+ * No part of this file may be changed without agreement of
+ * Computer Graphics Support Group of 30 Phys-Math Gymnasium.
+ */
+
+/* Includes */
+#include "parallel.h"
+#include "radix.h"
+#include "rng.h"
+#include "broadphase.h"
+
+#include <algorithm>
+#include <cstdio>
+
+/* Animation project namespace */
+namespace digl
+{
+  /* Add body function.
+   * ARGUMENTS:
+   *   - body box:
+   *       const vec3 &Min, &Max;
+   * RETURNS:
+   *   (INT) body index.
+   */
+  INT broadphase::Add( const vec3 &Min, const vec3 &Max )
+  {
+    INT Body;
+
+    if (!Free.empty())
+    {
+      Body = Free.back();
+      Free.pop_back();
+    }
+    else
+    {
+      Body = (INT)IsAlive.size();
+      IsAlive.push_back(0);
+      MinX.push_back(0), MinY.push_back(0), MinZ.push_back(0);
+      MaxX.push_back(0), MaxY.push_back(0), MaxZ.push_back(0);
+    }
+    IsAlive[Body] = 1;
+    Update(Body, Min, Max);
+    Order.push_back(Body);
+    return Body;
+  } /* End of 'broadphase::Add' function */
+
+  /* Remove body function.
+   * ARGUMENTS:
+   *   - body index:
+   *       INT Body;
+   * RETURNS: None.
+   */
+  VOID broadphase::Remove( INT Body )
+  {
+    if (Body < 0 || Body >= (INT)IsAlive.size() || !IsAlive[Body])
+      return;
+    IsAlive[Body] = 0;
+    /* Slot is reused only after its pairs are ended */
+    Removed.push_back(Body);
+    IsOrderDirty = TRUE;
+  } /* End of 'broadphase::Remove' function */
+
+  /* Find pairs by sweep and prune function.
+   * ARGUMENTS: None.
+   * RETURNS: None.
+   */
+  VOID broadphase::SweepAndPrune( VOID )
+  {
+    if (IsOrderDirty)
+    {
+      Order.erase(std::remove_if(Order.begin(), Order.end(),
+        [&]( INT Body ){ return !IsAlive[Body]; }), Order.end());
+      IsOrderDirty = FALSE;
+    }
+
+    /* Insertion sort: order of previous call is almost right */
+    INT *O = Order.data();
+    size_t Count = Order.size();
+
+    for (size_t i = 1; i < Count; i++)
+    {
+      INT Body = O[i];
+      FLT X = MinX[Body];
+      size_t j = i;
+
+      for (; j > 0 && MinX[O[j - 1]] > X; j--)
+        O[j] = O[j - 1];
+      O[j] = Body;
+    }
+
+    /* Boxes in sweep order (sweep reads memory sequentially) */
+    for (auto *S : {&SortedMinX, &SortedMaxX, &SortedMinY, &SortedMaxY, &SortedMinZ, &SortedMaxZ})
+      S->resize(Count);
+    parallel::For(Count,
+      [&]( size_t Begin, size_t End, INT )
+      {
+        for (size_t i = Begin; i < End; i++)
+        {
+          INT Body = O[i];
+
+          SortedMinX[i] = MinX[Body], SortedMaxX[i] = MaxX[Body];
+          SortedMinY[i] = MinY[Body], SortedMaxY[i] = MaxY[Body];
+          SortedMinZ[i] = MinZ[Body], SortedMaxZ[i] = MaxZ[Body];
+        }
+      }, MinBlock);
+
+    /* Sweep: each body is tested with next ones up to its maximum X */
+    BlockPairs.resize(parallel::NumOfBlocks(Count, MinBlock));
+    parallel::For(Count,
+      [&]( size_t Begin, size_t End, INT Block )
+      {
+        std::vector<UINT64> &P = BlockPairs[Block];
+        const FLT
+          *X0 = SortedMinX.data(),
+          *Y0 = SortedMinY.data(), *Y1 = SortedMaxY.data(),
+          *Z0 = SortedMinZ.data(), *Z1 = SortedMaxZ.data();
+
+        P.clear();
+        for (size_t i = Begin; i < End; i++)
+        {
+          FLT
+            X = SortedMaxX[i],
+            MinYA = Y0[i], MaxYA = Y1[i],
+            MinZA = Z0[i], MaxZA = Z1[i];
+
+          for (size_t j = i + 1; j < Count && X0[j] <= X; j++)
+            if (MinYA <= Y1[j] && Y0[j] <= MaxYA && MinZA <= Z1[j] && Z0[j] <= MaxZA)
+            {
+              INT A = O[i], B = O[j];
+
+              P.push_back(A < B ? (UINT64)A << 32 | (UINT)B : (UINT64)B << 32 | (UINT)A);
+            }
+        }
+      }, MinBlock);
+  } /* End of 'broadphase::SweepAndPrune' function */
+
+  /* Find pairs by spatial hash function.
+   * ARGUMENTS: None.
+   * RETURNS: None.
+   */
+  VOID broadphase::SpatialHash( VOID )
+  {
+    size_t NumOfSlots = IsAlive.size();
+    FLT InvCell = 1 / CellSize;
+
+    /* Cell key of integer cell coordinates */
+    auto Key = []( INT X, INT Y, INT Z ) -> UINT
+    {
+      return (UINT)X * 73856093u ^ (UINT)Y * 19349663u ^ (UINT)Z * 83492791u;
+    };
+    auto Cell = [&]( FLT X ) -> INT
+    {
+      return (INT)floor(X * InvCell);
+    };
+
+    /* Number of body cells, then first item of each body */
+    CellStart.resize(NumOfSlots + 1);
+    parallel::For(NumOfSlots,
+      [&]( size_t Begin, size_t End, INT )
+      {
+        for (size_t i = Begin; i < End; i++)
+          CellStart[i + 1] = !IsAlive[i] ? 0 :
+            (size_t)(Cell(MaxX[i]) - Cell(MinX[i]) + 1) *
+            (Cell(MaxY[i]) - Cell(MinY[i]) + 1) *
+            (Cell(MaxZ[i]) - Cell(MinZ[i]) + 1);
+      }, MinBlock);
+    CellStart[0] = 0;
+    for (size_t i = 0; i < NumOfSlots; i++)
+      CellStart[i + 1] += CellStart[i];
+
+    Cells.resize(CellStart[NumOfSlots]);
+    parallel::For(NumOfSlots,
+      [&]( size_t Begin, size_t End, INT )
+      {
+        for (size_t i = Begin; i < End; i++)
+        {
+          if (!IsAlive[i])
+            continue;
+
+          UINT64 *C = &Cells[CellStart[i]];
+
+          for (INT z = Cell(MinZ[i]); z <= Cell(MaxZ[i]); z++)
+            for (INT y = Cell(MinY[i]); y <= Cell(MaxY[i]); y++)
+              for (INT x = Cell(MinX[i]); x <= Cell(MaxX[i]); x++)
+                *C++ = (UINT64)Key(x, y, z) << 32 | (UINT)i;
+        }
+      }, MinBlock);
+    radix::Sort(Cells, CellsTmp);
+
+    /* Pairs inside cells; block handles cells started in its range */
+    size_t Count = Cells.size();
+
+    BlockPairs.resize(parallel::NumOfBlocks(Count, MinBlock));
+    parallel::For(Count,
+      [&]( size_t Begin, size_t End, INT Block )
+      {
+        std::vector<UINT64> &P = BlockPairs[Block];
+
+        P.clear();
+        for (size_t s = Begin; s < Count; )
+        {
+          UINT K = (UINT)(Cells[s] >> 32);
+          size_t e = s + 1;
+
+          while (e < Count && (UINT)(Cells[e] >> 32) == K)
+            e++;
+          if (s == Begin && s > 0 && (UINT)(Cells[s - 1] >> 32) == K)
+          {
+            /* Cell is started in previous block */
+            s = e;
+            continue;
+          }
+          if (s >= End)
+            break;
+          for (size_t i = s; i < e; i++)
+            for (size_t j = i + 1; j < e; j++)
+            {
+              INT
+                A = (INT)(UINT)Cells[i],
+                B = (INT)(UINT)Cells[j];
+
+              /* Pair is reported in cell of its overlap minimum only */
+              if (IsOverlap(A, B) &&
+                  Key(Cell(mth::Max(MinX[A], MinX[B])),
+                      Cell(mth::Max(MinY[A], MinY[B])),
+                      Cell(mth::Max(MinZ[A], MinZ[B]))) == K)
+                P.push_back(A < B ? (UINT64)A << 32 | (UINT)B : (UINT64)B << 32 | (UINT)A);
+            }
+          s = e;
+        }
+      }, MinBlock);
+  } /* End of 'broadphase::SpatialHash' function */
+
+  /* Find overlapping pairs and pair events function.
+   * ARGUMENTS: None.
+   * RETURNS: None.
+   */
+  VOID broadphase::Compute( VOID )
+  {
+    if (IsHash)
+      SpatialHash();
+    else
+      SweepAndPrune();
+
+    /* Gather block pairs */
+    Pairs.swap(OldPairs);
+    Pairs.clear();
+    for (auto &P : BlockPairs)
+      Pairs.insert(Pairs.end(), P.begin(), P.end());
+    std::sort(Pairs.begin(), Pairs.end());
+    /* Hash key collisions can give same pair twice */
+    Pairs.erase(std::unique(Pairs.begin(), Pairs.end()), Pairs.end());
+
+    /* Pair events by sorted lists merge */
+    Began.clear();
+    Persisted.clear();
+    Ended.clear();
+    size_t i = 0, j = 0;
+
+    while (i < Pairs.size() || j < OldPairs.size())
+      if (j == OldPairs.size() || (i < Pairs.size() && Pairs[i] < OldPairs[j]))
+        Began.push_back({(INT)(Pairs[i] >> 32), (INT)(UINT)Pairs[i]}), i++;
+      else if (i == Pairs.size() || OldPairs[j] < Pairs[i])
+        Ended.push_back({(INT)(OldPairs[j] >> 32), (INT)(UINT)OldPairs[j]}), j++;
+      else
+        Persisted.push_back({(INT)(Pairs[i] >> 32), (INT)(UINT)Pairs[i]}), i++, j++;
+
+    /* Removed bodies pairs are ended - slots can be reused */
+    Free.insert(Free.end(), Removed.begin(), Removed.end());
+    Removed.clear();
+  } /* End of 'broadphase::Compute' function */
+
+  /* Headless benchmark of sweep and prune and spatial hash function.
+   * ARGUMENTS:
+   *   - number of bodies and steps:
+   *       INT NumOfBodies, NumOfSteps;
+   * RETURNS:
+   *   (BOOL) TRUE if both methods find brute force pairs.
+   */
+  BOOL broadphase::Benchmark( INT NumOfBodies, INT NumOfSteps )
+  {
+    const FLT DeltaTime = 1.0f / 60, Size = 3, Side = (FLT)sqrt(NumOfBodies * 30.0), Height = 20;
+    const INT NumOfChecked = mth::Min(NumOfBodies, 10000);
+    rng Rnd(30, 0);
+    std::vector<vec3> Pos(NumOfBodies), Speed(NumOfBodies), Half(NumOfBodies);
+    broadphase Sap(FALSE), Hash(TRUE, Size * 2);
+    CHAR Buf[300];
+
+    /* 10 bodies per 300 square meters, up to 3 meters wide */
+    for (INT i = 0; i < NumOfBodies; i++)
+    {
+      Pos[i] = vec3(Rnd.Rnd0() * Side, Rnd.Rnd0() * Height, Rnd.Rnd0() * Side);
+      Speed[i] = Rnd.Vec1() * 5;
+      Half[i] = vec3(0.5f + Rnd.Rnd0(), 0.5f + Rnd.Rnd0(), 0.5f + Rnd.Rnd0()) * (Size / 3);
+      Sap.Add(Pos[i] - Half[i], Pos[i] + Half[i]);
+      Hash.Add(Pos[i] - Half[i], Pos[i] + Half[i]);
+    }
+
+    LARGE_INTEGER Freq, t0, t1;
+    DBL SapTime = 0, HashTime = 0;
+
+    QueryPerformanceFrequency(&Freq);
+    for (INT s = 0; s < NumOfSteps; s++)
+    {
+      for (INT i = 0; i < NumOfBodies; i++)
+      {
+        Pos[i] += Speed[i] * DeltaTime;
+        Sap.Update(i, Pos[i] - Half[i], Pos[i] + Half[i]);
+        Hash.Update(i, Pos[i] - Half[i], Pos[i] + Half[i]);
+      }
+      QueryPerformanceCounter(&t0);
+      Sap.Compute();
+      QueryPerformanceCounter(&t1);
+      SapTime += (DBL)(t1.QuadPart - t0.QuadPart) * 1000 / Freq.QuadPart;
+      QueryPerformanceCounter(&t0);
+      Hash.Compute();
+      QueryPerformanceCounter(&t1);
+      HashTime += (DBL)(t1.QuadPart - t0.QuadPart) * 1000 / Freq.QuadPart;
+    }
+
+    /* Brute force pairs of checked bodies (with all bodies) */
+    std::vector<UINT64> Brute;
+
+    for (INT a = 0; a < NumOfChecked; a++)
+      for (INT b = 0; b < NumOfBodies; b++)
+        if (b != a && (b > a || b >= NumOfChecked) && Sap.IsOverlap(a, b))
+          Brute.push_back(a < b ? (UINT64)a << 32 | (UINT)b : (UINT64)b << 32 | (UINT)a);
+    std::sort(Brute.begin(), Brute.end());
+
+    /* Pairs of method with checked bodies */
+    auto Found = [&]( const broadphase &B )
+    {
+      std::vector<UINT64> P;
+
+      for (auto *List : {&B.Began, &B.Persisted})
+        for (const pair &Pr : *List)
+          if (Pr.A < NumOfChecked || Pr.B < NumOfChecked)
+            P.push_back((UINT64)Pr.A << 32 | (UINT)Pr.B);
+      std::sort(P.begin(), P.end());
+      return P;
+    };
+    BOOL
+      IsSapOk = Found(Sap) == Brute,
+      IsHashOk = Found(Hash) == Brute;
+
+    sprintf(Buf, "Broad phase: %i bodies, %i steps, %zu pairs, sweep and prune %.3f ms (%s), "
+      "spatial hash %.3f ms (%s) per step\n", NumOfBodies, NumOfSteps, Sap.Began.size() + Sap.Persisted.size(),
+      SapTime / mth::Max(NumOfSteps, 1), IsSapOk ? "ok" : "MISMATCH",
+      HashTime / mth::Max(NumOfSteps, 1), IsHashOk ? "ok" : "MISMATCH");
+    OutputDebugString(Buf);
+    printf("%s", Buf);
+    return IsSapOk && IsHashOk;
+  } /* End of 'broadphase::Benchmark' function */
+} /* end of 'digl' namespace */
+
+/* END OF 'broadphase.cpp' FILE */
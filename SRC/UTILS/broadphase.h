@@ -0,0 +1,177 @@
+/***************************************************************
+ * Copyright (C) 2020
+ *    Computer Graphics Support Group of 30 Phys-Math Gymnasium
+ ***************************************************************/
+
+/* FILE NAME   : broadphase.h
+ * PURPOSE     : Collision broad phase header file.
+ * PROGRAMMER  : Dmitriy Vlasov.
+ * LAST UPDATE : 19.10.2020
+ * NOTE        : Namespace 'digl'.
+ *
+ *   Bodies are axis aligned boxes. Overlapping pairs are found either by
+ *   sweep and prune (body order by box minimum X is kept between calls and
+ *   fixed by insertion sort, which is linear for coherent motion) or by
+ *   uniform spatial hash (cell keys are radix sorted, pair is reported by
+ *   cell of its overlap minimum only). Pairs are compared with previous
+ *   call ones to get begin/persist/end events.
+ *
+ * No part of this file may be changed without agreement of
+ * Computer Graphics Support Group of 30 Phys-Math Gymnasium.
+ */
+
+#ifndef __BROADPHASE_H_
+#define __BROADPHASE_H_
+
+#include "../def.h"
+
+#include <vector>
+
+/* Animation project namespace */
+namespace digl
+{
+  /* Collision broad phase representation type */
+  class broadphase
+  {
+  public:
+    /* Minimal number of bodies in one thread block */
+    static const size_t MinBlock = 1 << 10;
+
+    /* Overlapping bodies pair (A < B) */
+    struct pair
+    {
+      INT A, B;
+    }; /* End of 'pair' structure */
+
+    BOOL IsHash;      // Use spatial hash instead of sweep and prune
+    FLT CellSize;     // Spatial hash cell size
+
+    std::vector<pair>
+      Began,          // Pairs started overlapping in last 'Compute' call
+      Persisted,      // Pairs still overlapping
+      Ended;          // Pairs stopped overlapping (or removed bodies)
+
+  private:
+    std::vector<FLT>
+      MinX, MinY, MinZ,          // Box minimums
+      MaxX, MaxY, MaxZ;          // Box maximums
+    std::vector<BYTE> IsAlive;   // Body slot is used flags
+    std::vector<INT>
+      Free,                      // Free body slots
+      Removed,                   // Slots freed after next 'Compute' call
+      Order;                     // Alive bodies sorted by box minimum X
+    std::vector<FLT>
+      SortedMinX, SortedMaxX,    // Boxes in 'Order' order
+      SortedMinY, SortedMaxY,
+      SortedMinZ, SortedMaxZ;
+    BOOL IsOrderDirty;           // Removed bodies are still in 'Order'
+    std::vector<UINT64>
+      Pairs, OldPairs,           // Sorted current and previous pair keys
+      Cells, CellsTmp;           // Spatial hash cell keys (key and body)
+    std::vector<size_t> CellStart; // Spatial hash first cell item of body
+    std::vector<std::vector<UINT64>> BlockPairs; // Pairs found by thread blocks
+
+    /* Find pairs by sweep and prune function.
+     * ARGUMENTS: None.
+     * RETURNS: None.
+     */
+    VOID SweepAndPrune( VOID );
+
+    /* Find pairs by spatial hash function.
+     * ARGUMENTS: None.
+     * RETURNS: None.
+     */
+    VOID SpatialHash( VOID );
+
+    /* Check bodies boxes overlap function.
+     * ARGUMENTS:
+     *   - bodies:
+     *       INT A, B;
+     * RETURNS:
+     *   (BOOL) TRUE if boxes overlap.
+     */
+    BOOL IsOverlap( INT A, INT B ) const
+    {
+      return
+        MinX[A] <= MaxX[B] && MinX[B] <= MaxX[A] &&
+        MinY[A] <= MaxY[B] && MinY[B] <= MaxY[A] &&
+        MinZ[A] <= MaxZ[B] && MinZ[B] <= MaxZ[A];
+    } /* End of 'IsOverlap' function */
+
+  public:
+    /* Broad phase constructor function.
+     * ARGUMENTS:
+     *   - use spatial hash flag:
+     *       BOOL InIsHash;
+     *   - spatial hash cell size:
+     *       FLT InCellSize;
+     */
+    broadphase( BOOL InIsHash = FALSE, FLT InCellSize = 10 ) :
+      IsHash(InIsHash), CellSize(InCellSize), IsOrderDirty(FALSE)
+    {
+    } /* End of 'broadphase' function */
+
+    /* Add body function.
+     * ARGUMENTS:
+     *   - body box:
+     *       const vec3 &Min, &Max;
+     * RETURNS:
+     *   (INT) body index.
+     */
+    INT Add( const vec3 &Min, const vec3 &Max );
+
+    /* Remove body function.
+     * ARGUMENTS:
+     *   - body index:
+     *       INT Body;
+     * RETURNS: None.
+     */
+    VOID Remove( INT Body );
+
+    /* Move body function.
+     * ARGUMENTS:
+     *   - body index:
+     *       INT Body;
+     *   - new body box:
+     *       const vec3 &Min, &Max;
+     * RETURNS: None.
+     */
+    VOID Update( INT Body, const vec3 &Min, const vec3 &Max )
+    {
+      MinX[Body] = Min[0], MinY[Body] = Min[1], MinZ[Body] = Min[2];
+      MaxX[Body] = Max[0], MaxY[Body] = Max[1], MaxZ[Body] = Max[2];
+    } /* End of 'Update' function */
+
+    /* Get number of alive bodies function.
+     * ARGUMENTS: None.
+     * RETURNS:
+     *   (size_t) number of bodies.
+     */
+    size_t GetNumOfBodies( VOID ) const
+    {
+      return IsAlive.size() - Free.size() - Removed.size();
+    } /* End of 'GetNumOfBodies' function */
+
+    /* Find overlapping pairs and pair events function.
+     * ARGUMENTS: None.
+     * RETURNS: None.
+     */
+    VOID Compute( VOID );
+
+    /* Headless benchmark of sweep and prune and spatial hash function.
+     * Moving boxes of same density for any number of bodies; pairs of
+     * last step are compared with brute force (for bodies sample when
+     * there are more than 10000 bodies).
+     * ARGUMENTS:
+     *   - number of bodies and steps:
+     *       INT NumOfBodies, NumOfSteps;
+     * RETURNS:
+     *   (BOOL) TRUE if both methods find brute force pairs.
+     */
+    static BOOL Benchmark( INT NumOfBodies, INT NumOfSteps );
+  }; /* End of 'broadphase' class */
+} /* end of 'digl' namespace */
+
+#endif /* __BROADPHASE_H_ */
+
+/* END OF 'broadphase.h' FILE */
@@ -0,0 +1,1057 @@
+/***************************************************************
+ * Copyright (C) 2020
+ *    Computer Graphics Support Group of 30 Phys-Math Gymnasium
+ ***************************************************************/
+
+/* FILE NAME   : bvh.cpp
+ * PURPOSE     : Bounding volume hierarchy file.
+ * PROGRAMMER  : Dmitriy Vlasov.
+ * LAST UPDATE : 19.10.2020
+ * NOTE        : Namespace 'digl'.
+ *
+ * No part of this file may be changed without agreement of
+ * Computer Graphics Support Group of 30 Phys-Math Gymnasium.
+ */
+
+/* Includes */
+#include "parallel.h"
+#include "bvh.h"
+
+#include <algorithm>
+#include <xmmintrin.h>
+
+/* Animation project namespace */
+namespace digl
+{
+  /* Maximal tree depth (traversal stack size) */
+  static const INT MaxDepth = 64;
+
+  /* Binary tree node used while building */
+  struct bvh_build_node
+  {
+    vec3 Min, Max;      // Node box
+    INT Left, Right;    // Children (-1 for leaf)
+    INT First, Count;   // Leaf items in 'Order'
+  }; /* End of 'bvh_build_node' struct */
+
+  /* Box with number of items (SAH bin) */
+  struct bvh_bin
+  {
+    vec3 Min, Max;
+    INT Count;
+
+    /* Bin constructor function.
+     * ARGUMENTS: None.
+     */
+    bvh_bin( VOID ) : Min(1e30f), Max(-1e30f), Count(0)
+    {
+    } /* End of 'bvh_bin' function */
+
+    /* Add box function.
+     * ARGUMENTS:
+     *   - box:
+     *       const vec3 &BMin, &BMax;
+     *   - number of items:
+     *       INT N;
+     * RETURNS: None.
+     */
+    VOID Add( const vec3 &BMin, const vec3 &BMax, INT N = 1 )
+    {
+      Min = vec3::Min(Min, BMin);
+      Max = vec3::Max(Max, BMax);
+      Count += N;
+    } /* End of 'Add' function */
+
+    /* Get half surface area function.
+     * ARGUMENTS: None.
+     * RETURNS:
+     *   (FLT) area (0 for empty bin).
+     */
+    FLT Area( VOID ) const
+    {
+      if (Count == 0)
+        return 0;
+
+      vec3 S = Max - Min;
+
+      return S[0] * S[1] + S[1] * S[2] + S[2] * S[0];
+    } /* End of 'Area' function */
+  }; /* End of 'bvh_bin' struct */
+
+  /* Tree builder (one instance per thread) */
+  struct bvh_builder
+  {
+    const vec3 *Mins, *Maxs;           // Item boxes
+    const vec3 *Centers;               // Item box centers
+    INT *Order;                        // Items order
+    std::vector<bvh_build_node> Nodes; // Built nodes
+
+    /* Deferred subtree to build in parallel */
+    struct task
+    {
+      INT Node, Depth;
+      size_t Begin, End;
+    }; /* End of 'task' struct */
+
+    /* Get bin of center function.
+     * ARGUMENTS:
+     *   - center coordinate and bins range:
+     *       FLT C, CMin, Scale;
+     * RETURNS:
+     *   (INT) bin number.
+     */
+    static INT BinOf( FLT C, FLT CMin, FLT Scale )
+    {
+      INT b = (INT)((C - CMin) * Scale);
+
+      return b < 0 ? 0 : b >= bvh::NumOfBins ? bvh::NumOfBins - 1 : b;
+    } /* End of 'BinOf' function */
+
+    /* Split items range function.
+     * ARGUMENTS:
+     *   - items range:
+     *       size_t Begin, End;
+     *   - range box (result):
+     *       vec3 &BoxMin, &BoxMax;
+     * RETURNS:
+     *   (size_t) split position ('Begin' to make leaf).
+     */
+    size_t Split( size_t Begin, size_t End, vec3 &BoxMin, vec3 &BoxMax )
+    {
+      size_t Count = End - Begin;
+      BOOL IsParallel = Count >= bvh::ParallelMin;
+      INT NumOfBlocks = IsParallel ? parallel::NumOfBlocks(Count, bvh::ParallelMin / 4) : 1;
+
+      /* Box and center box (heap only for parallel blocks) */
+      bvh_bin LocalBox[2], LocalBins[3 * bvh::NumOfBins];
+      std::vector<bvh_bin> BlockBoxes, BlockBins;
+      bvh_bin
+        *Box = LocalBox, *CBox = LocalBox + 1, *Bins = LocalBins;
+
+      if (IsParallel)
+      {
+        BlockBoxes.resize((size_t)NumOfBlocks * 2);
+        BlockBins.resize((size_t)NumOfBlocks * 3 * bvh::NumOfBins);
+        Box = BlockBoxes.data();
+        CBox = Box + NumOfBlocks;
+        Bins = BlockBins.data();
+      }
+      auto Bound = [&]( size_t B, size_t E, INT Block )
+      {
+        for (size_t i = Begin + B; i < Begin + E; i++)
+        {
+          INT n = Order[i];
+
+          Box[Block].Add(Mins[n], Maxs[n]);
+          CBox[Block].Add(Centers[n], Centers[n]);
+        }
+      };
+
+      if (IsParallel)
+        parallel::For(Count, Bound, bvh::ParallelMin / 4);
+      else
+        Bound(0, Count, 0);
+      for (INT b = 1; b < NumOfBlocks; b++)
+      {
+        Box[0].Add(Box[b].Min, Box[b].Max, Box[b].Count);
+        CBox[0].Add(CBox[b].Min, CBox[b].Max, CBox[b].Count);
+      }
+      BoxMin = Box[0].Min;
+      BoxMax = Box[0].Max;
+      if (Count <= bvh::MaxLeafSize)
+        return Begin;
+
+      vec3 CMin = CBox[0].Min, CSize = CBox[0].Max - CMin;
+      FLT Scale[3];
+
+      for (INT a = 0; a < 3; a++)
+        Scale[a] = CSize[a] > 0 ? bvh::NumOfBins / CSize[a] : 0;
+      if (Scale[0] == 0 && Scale[1] == 0 && Scale[2] == 0)
+        return Begin + Count / 2;
+
+      /* Bins of all axes */
+      auto Bin = [&]( size_t B, size_t E, INT Block )
+      {
+        bvh_bin *Bn = &Bins[(size_t)Block * 3 * bvh::NumOfBins];
+
+        for (size_t i = Begin + B; i < Begin + E; i++)
+        {
+          INT n = Order[i];
+
+          for (INT a = 0; a < 3; a++)
+            if (Scale[a] > 0)
+              Bn[a * bvh::NumOfBins + BinOf(Centers[n][a], CMin[a], Scale[a])].Add(Mins[n], Maxs[n]);
+        }
+      };
+
+      if (IsParallel)
+        parallel::For(Count, Bin, bvh::ParallelMin / 4);
+      else
+        Bin(0, Count, 0);
+      for (INT b = 1; b < NumOfBlocks; b++)
+        for (INT i = 0; i < 3 * bvh::NumOfBins; i++)
+          Bins[i].Add(Bins[(size_t)b * 3 * bvh::NumOfBins + i].Min,
+                      Bins[(size_t)b * 3 * bvh::NumOfBins + i].Max,
+                      Bins[(size_t)b * 3 * bvh::NumOfBins + i].Count);
+
+      /* SAH: child areas by numbers of items */
+      FLT BestCost = 1e30f;
+      INT BestAxis = -1, BestBin = 0;
+
+      for (INT a = 0; a < 3; a++)
+      {
+        if (Scale[a] == 0)
+          continue;
+
+        bvh_bin *Bn = &Bins[a * bvh::NumOfBins], Right;
+        FLT RightCost[bvh::NumOfBins];
+
+        for (INT b = bvh::NumOfBins - 1; b > 0; b--)
+        {
+          Right.Add(Bn[b].Min, Bn[b].Max, Bn[b].Count);
+          RightCost[b] = Right.Area() * Right.Count;
+        }
+
+        bvh_bin Left;
+
+        for (INT b = 1; b < bvh::NumOfBins; b++)
+        {
+          Left.Add(Bn[b - 1].Min, Bn[b - 1].Max, Bn[b - 1].Count);
+
+          FLT Cost = Left.Area() * Left.Count + RightCost[b];
+
+          if (Left.Count > 0 && Left.Count < (INT)Count && Cost < BestCost)
+            BestCost = Cost, BestAxis = a, BestBin = b;
+        }
+      }
+
+      if (BestAxis < 0)
+        return Begin + Count / 2;
+
+      /* Partition by best bin */
+      FLT C0 = CMin[BestAxis], S = Scale[BestAxis];
+      INT *Mid = std::partition(Order + Begin, Order + End,
+        [&]( INT n ){ return BinOf(Centers[n][BestAxis], C0, S) < BestBin; });
+
+      return Mid - Order;
+    } /* End of 'Split' function */
+
+    /* Build subtree function.
+     * ARGUMENTS:
+     *   - items range:
+     *       size_t Begin, End;
+     *   - node depth:
+     *       INT Depth;
+     *   - deferred subtrees (nullptr to build all here):
+     *       std::vector<task> *Tasks;
+     * RETURNS:
+     *   (INT) node index.
+     */
+    INT Build( size_t Begin, size_t End, INT Depth, std::vector<task> *Tasks )
+    {
+      INT Node = (INT)Nodes.size();
+
+      Nodes.push_back({vec3(0), vec3(0), -1, -1, (INT)Begin, (INT)(End - Begin)});
+      if (Tasks != nullptr && End - Begin < bvh::SubtreeMin)
+      {
+        Tasks->push_back({Node, Depth, Begin, End});
+        return Node;
+      }
+
+      vec3 BoxMin, BoxMax;
+      size_t Mid = Split(Begin, End, BoxMin, BoxMax);
+
+      Nodes[Node].Min = BoxMin;
+      Nodes[Node].Max = BoxMax;
+      if (Mid == Begin || Depth >= MaxDepth - 1)
+        return Node;
+
+      INT
+        Left = Build(Begin, Mid, Depth + 1, Tasks),
+        Right = Build(Mid, End, Depth + 1, Tasks);
+
+      Nodes[Node].Left = Left;
+      Nodes[Node].Right = Right;
+      return Node;
+    } /* End of 'Build' function */
+  }; /* End of 'bvh_builder' struct */
+
+  /* Build tree by item boxes function.
+   * ARGUMENTS:
+   *   - item boxes:
+   *       const vec3 *Mins, *Maxs;
+   *   - number of items:
+   *       size_t Count;
+   * RETURNS: None.
+   */
+  VOID bvh::Build( const vec3 *Mins, const vec3 *Maxs, size_t Count )
+  {
+    Clear();
+    if (Count == 0)
+      return;
+
+    std::vector<vec3> Centers(Count);
+
+    Order.resize(Count);
+    parallel::For(Count,
+      [&]( size_t Begin, size_t End, INT )
+      {
+        for (size_t i = Begin; i < End; i++)
+          Centers[i] = (Mins[i] + Maxs[i]) * 0.5f, Order[i] = (INT)i;
+      }, ParallelMin);
+
+    /* Top levels here (parallel binning), subtrees in parallel */
+    bvh_builder Top {Mins, Maxs, Centers.data(), Order.data()};
+    std::vector<bvh_builder::task> Tasks;
+    std::vector<bvh_builder> Sub;
+
+    Top.Build(0, Count, 0, &Tasks);
+    Sub.resize(Tasks.size(), bvh_builder {Mins, Maxs, Centers.data(), Order.data()});
+    parallel::For(Tasks.size(),
+      [&]( size_t Begin, size_t End, INT )
+      {
+        for (size_t t = Begin; t < End; t++)
+          Sub[t].Build(Tasks[t].Begin, Tasks[t].End, Tasks[t].Depth, nullptr);
+      });
+
+    /* Put subtrees to task nodes */
+    std::vector<bvh_build_node> &N = Top.Nodes;
+
+    for (size_t t = 0; t < Tasks.size(); t++)
+    {
+      std::vector<bvh_build_node> &S = Sub[t].Nodes;
+      INT Base = (INT)N.size() - 1;
+
+      for (auto &Nd : S)
+        if (Nd.Left >= 0)
+          Nd.Left += Base, Nd.Right += Base;
+      N[Tasks[t].Node] = S[0];
+      N.insert(N.end(), S.begin() + 1, S.end());
+    }
+
+    /* Two children nodes (parents before children) */
+    Min = N[0].Min;
+    Max = N[0].Max;
+
+    struct item
+    {
+      INT Build, Node, Side;
+    };
+    std::vector<item> Stack;
+    auto Put = [&]( INT Node, INT Side, const bvh_build_node &B )
+    {
+      node &Nd = Nodes[Node];
+
+      Nd.X[Side] = B.Min[0], Nd.X[Side + 2] = B.Max[0];
+      Nd.Y[Side] = B.Min[1], Nd.Y[Side + 2] = B.Max[1];
+      Nd.Z[Side] = B.Min[2], Nd.Z[Side + 2] = B.Max[2];
+      if (B.Left < 0)
+        Nd.Child[Side] = B.First, Nd.Count[Side] = B.Count;
+      else
+        Nd.Count[Side] = 0, Stack.push_back({(INT)(&B - N.data()), Node, Side});
+    };
+
+    Nodes.reserve(N.size() / 2 + 1);
+    Nodes.push_back(node());
+    if (N[0].Left < 0)
+    {
+      /* Only one leaf: second child is empty */
+      Put(0, 0, N[0]);
+      Put(0, 1, bvh_build_node {vec3(1e30f), vec3(-1e30f), -1, -1, -1, 0});
+    }
+    else
+    {
+      Put(0, 0, N[N[0].Left]);
+      Put(0, 1, N[N[0].Right]);
+    }
+    while (!Stack.empty())
+    {
+      item It = Stack.back();
+      INT Node = (INT)Nodes.size();
+
+      Stack.pop_back();
+      Nodes[It.Node].Child[It.Side] = Node;
+      Nodes.push_back(node());
+      Put(Node, 0, N[N[It.Build].Left]);
+      Put(Node, 1, N[N[It.Build].Right]);
+    }
+  } /* End of 'bvh::Build' function */
+
+  /* Update node boxes for moved items function.
+   * ARGUMENTS:
+   *   - item boxes (same items as in 'Build'):
+   *       const vec3 *Mins, *Maxs;
+   * RETURNS: None.
+   */
+  VOID bvh::Refit( const vec3 *Mins, const vec3 *Maxs )
+  {
+    for (size_t n = Nodes.size(); n-- > 0; )
+    {
+      node &Nd = Nodes[n];
+
+      for (INT c = 0; c < 2; c++)
+      {
+        if (Nd.Child[c] < 0)
+          continue;
+
+        bvh_bin B;
+
+        if (Nd.Count[c] > 0)
+          for (INT i = Nd.Child[c]; i < Nd.Child[c] + Nd.Count[c]; i++)
+            B.Add(Mins[Order[i]], Maxs[Order[i]]);
+        else
+        {
+          const node &Ch = Nodes[Nd.Child[c]];
+
+          for (INT k = 0; k < 2; k++)
+            if (Ch.Child[k] >= 0)
+              B.Add(vec3(Ch.X[k], Ch.Y[k], Ch.Z[k]), vec3(Ch.X[k + 2], Ch.Y[k + 2], Ch.Z[k + 2]));
+        }
+        Nd.X[c] = B.Min[0], Nd.X[c + 2] = B.Max[0];
+        Nd.Y[c] = B.Min[1], Nd.Y[c + 2] = B.Max[1];
+        Nd.Z[c] = B.Min[2], Nd.Z[c + 2] = B.Max[2];
+      }
+    }
+    if (!Nodes.empty())
+    {
+      const node &R = Nodes[0];
+
+      Min = vec3(R.X[0], R.Y[0], R.Z[0]);
+      Max = vec3(R.X[2], R.Y[2], R.Z[2]);
+      if (R.Child[1] >= 0)
+      {
+        Min = vec3::Min(Min, vec3(R.X[1], R.Y[1], R.Z[1]));
+        Max = vec3::Max(Max, vec3(R.X[3], R.Y[3], R.Z[3]));
+      }
+    }
+  } /* End of 'bvh::Refit' function */
+
+  /* Trace ray through tree function.
+   * ARGUMENTS:
+   *   - tree:
+   *       const bvh &Tree;
+   *   - ray origin and direction:
+   *       const vec3 &Org, &Dir;
+   *   - maximal ray parameter (leaf function can decrease it):
+   *       FLT &MaxT;
+   *   - leaf function ('BOOL Leaf(INT First, INT Count)', TRUE to stop):
+   *       LeafFunc Leaf;
+   * RETURNS: None.
+   */
+  template<class LeafFunc>
+    static VOID TraceRay( const bvh &Tree, const vec3 &Org, const vec3 &Dir, FLT &MaxT, LeafFunc Leaf )
+    {
+      if (Tree.Nodes.empty())
+        return;
+
+      __m128
+        OX = _mm_set1_ps(Org[0]), OY = _mm_set1_ps(Org[1]), OZ = _mm_set1_ps(Org[2]),
+        IX = _mm_set1_ps(1 / Dir[0]), IY = _mm_set1_ps(1 / Dir[1]), IZ = _mm_set1_ps(1 / Dir[2]),
+        Zero = _mm_setzero_ps();
+      INT StackNode[MaxDepth * 2], Sp = 0, Node = 0;
+      FLT StackNear[MaxDepth * 2];
+      alignas(16) FLT Near[4];
+
+      while (TRUE)
+      {
+        const bvh::node &Nd = Tree.Nodes[Node];
+
+        /* Both children slabs: lanes are [MinL, MinR, MaxL, MaxR] */
+        __m128
+          TX = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(Nd.X), OX), IX),
+          TY = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(Nd.Y), OY), IY),
+          TZ = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(Nd.Z), OZ), IZ),
+          SX = _mm_shuffle_ps(TX, TX, _MM_SHUFFLE(1, 0, 3, 2)),
+          SY = _mm_shuffle_ps(TY, TY, _MM_SHUFFLE(1, 0, 3, 2)),
+          SZ = _mm_shuffle_ps(TZ, TZ, _MM_SHUFFLE(1, 0, 3, 2)),
+          TNear = _mm_max_ps(_mm_max_ps(_mm_min_ps(TX, SX), _mm_min_ps(TY, SY)), _mm_max_ps(_mm_min_ps(TZ, SZ), Zero)),
+          TFar = _mm_min_ps(_mm_min_ps(_mm_max_ps(TX, SX), _mm_max_ps(TY, SY)), _mm_min_ps(_mm_max_ps(TZ, SZ), _mm_set1_ps(MaxT)));
+        INT Mask = _mm_movemask_ps(_mm_cmple_ps(TNear, TFar)) & (Nd.Child[1] >= 0 ? 3 : 1);
+
+        _mm_store_ps(Near, TNear);
+
+        /* Leaves first (they can shorten ray) */
+        for (INT c = 0; c < 2; c++)
+          if ((Mask >> c & 1) && Nd.Count[c] > 0)
+          {
+            if (Leaf(Nd.Child[c], Nd.Count[c]))
+              return;
+            Mask &= ~(1 << c);
+          }
+        for (INT c = 0; c < 2; c++)
+          if ((Mask >> c & 1) && Near[c] > MaxT)
+            Mask &= ~(1 << c);
+
+        if (Mask == 3)
+        {
+          INT First = Near[1] < Near[0];
+
+          StackNode[Sp] = Nd.Child[1 - First];
+          StackNear[Sp++] = Near[1 - First];
+          Node = Nd.Child[First];
+          continue;
+        }
+        if (Mask != 0)
+        {
+          Node = Nd.Child[Mask >> 1];
+          continue;
+        }
+
+        /* Next stacked node still in ray range */
+        while (Sp > 0 && StackNear[Sp - 1] > MaxT)
+          Sp--;
+        if (Sp == 0)
+          return;
+        Node = StackNode[--Sp];
+      }
+    } /* End of 'TraceRay' function */
+
+  /* Trace sphere through tree function.
+   * ARGUMENTS:
+   *   - tree:
+   *       const bvh &Tree;
+   *   - sphere center:
+   *       const vec3 &Center;
+   *   - sphere radius (leaf function can decrease it):
+   *       FLT &Radius;
+   *   - leaf function ('VOID Leaf(INT First, INT Count)'):
+   *       LeafFunc Leaf;
+   * RETURNS: None.
+   */
+  template<class LeafFunc>
+    static VOID TraceSphere( const bvh &Tree, const vec3 &Center, FLT &Radius, LeafFunc Leaf )
+    {
+      if (Tree.Nodes.empty())
+        return;
+
+      INT StackNode[MaxDepth * 2], Sp = 0, Node = 0;
+      FLT StackDist[MaxDepth * 2];
+
+      while (TRUE)
+      {
+        const bvh::node &Nd = Tree.Nodes[Node];
+        FLT Dist[2];
+        INT Mask = 0;
+
+        for (INT c = 0; c < 2; c++)
+        {
+          if (Nd.Child[c] < 0)
+            continue;
+
+          FLT
+            dx = mth::Max(mth::Max(Nd.X[c] - Center[0], Center[0] - Nd.X[c + 2]), 0.0f),
+            dy = mth::Max(mth::Max(Nd.Y[c] - Center[1], Center[1] - Nd.Y[c + 2]), 0.0f),
+            dz = mth::Max(mth::Max(Nd.Z[c] - Center[2], Center[2] - Nd.Z[c + 2]), 0.0f);
+
+          Dist[c] = dx * dx + dy * dy + dz * dz;
+          if (Dist[c] <= Radius * Radius)
+            Mask |= 1 << c;
+        }
+
+        /* Nearer child first (radius decreases in nearest search) */
+        INT First = (Mask == 3 && Dist[1] < Dist[0]) ? 1 : 0;
+
+        for (INT k = 0; k < 2; k++)
+        {
+          INT c = k ^ First;
+
+          if ((Mask >> c & 1) && Nd.Count[c] > 0)
+          {
+            Leaf(Nd.Child[c], Nd.Count[c]);
+            Mask &= ~(1 << c);
+          }
+        }
+        for (INT c = 0; c < 2; c++)
+          if ((Mask >> c & 1) && Dist[c] > Radius * Radius)
+            Mask &= ~(1 << c);
+
+        if (Mask == 3)
+        {
+          StackNode[Sp] = Nd.Child[1 - First];
+          StackDist[Sp++] = Dist[1 - First];
+          Node = Nd.Child[First];
+          continue;
+        }
+        if (Mask != 0)
+        {
+          Node = Nd.Child[Mask >> 1];
+          continue;
+        }
+        while (Sp > 0 && StackDist[Sp - 1] > Radius * Radius)
+          Sp--;
+        if (Sp == 0)
+          return;
+        Node = StackNode[--Sp];
+      }
+    } /* End of 'TraceSphere' function */
+
+  /* Ray and triangle intersection function.
+   * ARGUMENTS:
+   *   - ray origin and direction:
+   *       const vec3 &Org, &Dir;
+   *   - triangle vertices:
+   *       const vec3 *V;
+   *   - maximal ray parameter:
+   *       FLT MaxT;
+   *   - hit parameter and barycentric coordinates:
+   *       FLT &T, &U, &W;
+   * RETURNS:
+   *   (BOOL) TRUE if there is hit in (0, MaxT).
+   */
+  static BOOL RayTriangle( const vec3 &Org, const vec3 &Dir, const vec3 *V, FLT MaxT, FLT &T, FLT &U, FLT &W )
+  {
+    vec3
+      E1 = V[1] - V[0],
+      E2 = V[2] - V[0],
+      P = Dir % E2;
+    FLT Det = E1 & P;
+
+    if (Det == 0)
+      return FALSE;
+
+    FLT InvDet = 1 / Det;
+    vec3 S = Org - V[0];
+
+    U = (S & P) * InvDet;
+    if (U < 0 || U > 1)
+      return FALSE;
+
+    vec3 Q = S % E1;
+
+    W = (Dir & Q) * InvDet;
+    if (W < 0 || U + W > 1)
+      return FALSE;
+    T = (E2 & Q) * InvDet;
+    return T > 0 && T < MaxT;
+  } /* End of 'RayTriangle' function */
+
+  /* Closest triangle point function.
+   * ARGUMENTS:
+   *   - point:
+   *       const vec3 &P;
+   *   - triangle vertices:
+   *       const vec3 *V;
+   * RETURNS:
+   *   (vec3) closest point.
+   */
+  static vec3 ClosestOnTriangle( const vec3 &P, const vec3 *V )
+  {
+    const vec3 &A = V[0], &B = V[1], &C = V[2];
+    vec3 AB = B - A, AC = C - A, AP = P - A;
+    FLT d1 = AB & AP, d2 = AC & AP;
+
+    if (d1 <= 0 && d2 <= 0)
+      return A;
+
+    vec3 BP = P - B;
+    FLT d3 = AB & BP, d4 = AC & BP;
+
+    if (d3 >= 0 && d4 <= d3)
+      return B;
+
+    FLT vc = d1 * d4 - d3 * d2;
+
+    if (vc <= 0 && d1 >= 0 && d3 <= 0)
+      return A + AB * (d1 / (d1 - d3));
+
+    vec3 CP = P - C;
+    FLT d5 = AB & CP, d6 = AC & CP;
+
+    if (d6 >= 0 && d5 <= d6)
+      return C;
+
+    FLT vb = d5 * d2 - d1 * d6;
+
+    if (vb <= 0 && d2 >= 0 && d6 <= 0)
+      return A + AC * (d2 / (d2 - d6));
+
+    FLT va = d3 * d6 - d5 * d4;
+
+    if (va <= 0 && d4 - d3 >= 0 && d5 - d6 >= 0)
+      return B + (C - B) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+
+    FLT Denom = 1 / (va + vb + vc);
+
+    return A + AB * (vb * Denom) + AC * (vc * Denom);
+  } /* End of 'ClosestOnTriangle' function */
+
+  /* Build tree by triangle list function.
+   * ARGUMENTS:
+   *   - vertex positions:
+   *       const vec3 *Points;
+   *   - triangle vertex indices (3 per triangle, nullptr for not indexed):
+   *       const INT *Index;
+   *   - number of triangles:
+   *       size_t NumOfTris;
+   * RETURNS: None.
+   */
+  VOID mesh_bvh::Build( const vec3 *Points, const INT *Index, size_t NumOfTris )
+  {
+    std::vector<vec3> Mins(NumOfTris), Maxs(NumOfTris);
+    auto Vertex = [&]( size_t Tri, INT k ) -> const vec3 &
+    {
+      return Points[Index != nullptr ? Index[Tri * 3 + k] : Tri * 3 + k];
+    };
+
+    parallel::For(NumOfTris,
+      [&]( size_t Begin, size_t End, INT )
+      {
+        for (size_t i = Begin; i < End; i++)
+        {
+          Mins[i] = vec3::Min(vec3::Min(Vertex(i, 0), Vertex(i, 1)), Vertex(i, 2));
+          Maxs[i] = vec3::Max(vec3::Max(Vertex(i, 0), Vertex(i, 1)), Vertex(i, 2));
+        }
+      }, bvh::ParallelMin);
+    Tree.Build(Mins.data(), Maxs.data(), NumOfTris);
+
+    /* Vertices in leaves order */
+    Vertices.resize(NumOfTris * 3);
+    parallel::For(NumOfTris,
+      [&]( size_t Begin, size_t End, INT )
+      {
+        for (size_t i = Begin; i < End; i++)
+          for (INT k = 0; k < 3; k++)
+            Vertices[i * 3 + k] = Vertex(Tree.Order[i], k);
+      }, bvh::ParallelMin);
+  } /* End of 'mesh_bvh::Build' function */
+
+  /* Find closest ray hit function.
+   * ARGUMENTS:
+   *   - ray origin and direction:
+   *       const vec3 &Org, &Dir;
+   *   - maximal ray parameter:
+   *       FLT MaxT;
+   *   - hit result:
+   *       bvh_hit &Hit;
+   * RETURNS:
+   *   (BOOL) TRUE if there is hit before 'MaxT'.
+   */
+  BOOL mesh_bvh::Intersect( const vec3 &Org, const vec3 &Dir, FLT MaxT, bvh_hit &Hit ) const
+  {
+    BOOL IsHit = FALSE;
+
+    TraceRay(Tree, Org, Dir, MaxT,
+      [&]( INT First, INT Count )
+      {
+        FLT T, U, W;
+
+        for (INT i = First; i < First + Count; i++)
+          if (RayTriangle(Org, Dir, &Vertices[i * 3], MaxT, T, U, W))
+          {
+            MaxT = T;
+            Hit = {T, U, W, Tree.Order[i], -1};
+            IsHit = TRUE;
+          }
+        return FALSE;
+      });
+    return IsHit;
+  } /* End of 'mesh_bvh::Intersect' function */
+
+  /* Check any ray hit function (line of sight).
+   * ARGUMENTS:
+   *   - ray origin and direction:
+   *       const vec3 &Org, &Dir;
+   *   - maximal ray parameter:
+   *       FLT MaxT;
+   * RETURNS:
+   *   (BOOL) TRUE if there is hit before 'MaxT'.
+   */
+  BOOL mesh_bvh::IsOccluded( const vec3 &Org, const vec3 &Dir, FLT MaxT ) const
+  {
+    BOOL IsHit = FALSE;
+
+    TraceRay(Tree, Org, Dir, MaxT,
+      [&]( INT First, INT Count )
+      {
+        FLT T, U, W;
+
+        for (INT i = First; i < First + Count; i++)
+          if (RayTriangle(Org, Dir, &Vertices[i * 3], MaxT, T, U, W))
+            return IsHit = TRUE;
+        return FALSE;
+      });
+    return IsHit;
+  } /* End of 'mesh_bvh::IsOccluded' function */
+
+  /* Find triangles overlapping sphere function.
+   * ARGUMENTS:
+   *   - sphere:
+   *       const vec3 &Center;
+   *       FLT Radius;
+   *   - triangle numbers to add to:
+   *       std::vector<INT> &Tris;
+   * RETURNS: None.
+   */
+  VOID mesh_bvh::SphereOverlap( const vec3 &Center, FLT Radius, std::vector<INT> &Tris ) const
+  {
+    TraceSphere(Tree, Center, Radius,
+      [&]( INT First, INT Count )
+      {
+        for (INT i = First; i < First + Count; i++)
+        {
+          vec3 D = ClosestOnTriangle(Center, &Vertices[i * 3]) - Center;
+
+          if ((D & D) <= Radius * Radius)
+            Tris.push_back(Tree.Order[i]);
+        }
+      });
+  } /* End of 'mesh_bvh::SphereOverlap' function */
+
+  /* Find nearest surface point function.
+   * ARGUMENTS:
+   *   - point:
+   *       const vec3 &P;
+   *   - maximal distance (changed to found one):
+   *       FLT &Dist;
+   *   - nearest point and its triangle:
+   *       vec3 &Nearest;
+   *       INT &Tri;
+   * RETURNS:
+   *   (BOOL) TRUE if point closer than 'Dist' is found.
+   */
+  BOOL mesh_bvh::Nearest( const vec3 &P, FLT &Dist, vec3 &Nearest, INT &Tri ) const
+  {
+    BOOL IsFound = FALSE;
+
+    TraceSphere(Tree, P, Dist,
+      [&]( INT First, INT Count )
+      {
+        for (INT i = First; i < First + Count; i++)
+        {
+          vec3 C = ClosestOnTriangle(P, &Vertices[i * 3]), D = C - P;
+          FLT D2 = D & D;
+
+          if (D2 < Dist * Dist)
+          {
+            Dist = sqrt(D2);
+            Nearest = C;
+            Tri = Tree.Order[i];
+            IsFound = TRUE;
+          }
+        }
+      });
+    return IsFound;
+  } /* End of 'mesh_bvh::Nearest' function */
+
+  /* Evaluate instance world box function.
+   * ARGUMENTS:
+   *   - instance number:
+   *       INT Instance;
+   * RETURNS: None.
+   */
+  VOID scene_bvh::EvalBox( INT Instance )
+  {
+    const instance &In = Instances[Instance];
+    const bvh &T = In.Mesh->Tree;
+    vec3 &BMin = Mins[Instance], &BMax = Maxs[Instance];
+
+    BMin = BMax = In.Matr.TransformPoint(T.Min);
+    for (INT i = 1; i < 8; i++)
+    {
+      vec3 P = In.Matr.TransformPoint(vec3(
+        (i & 1 ? T.Max : T.Min)[0],
+        (i & 2 ? T.Max : T.Min)[1],
+        (i & 4 ? T.Max : T.Min)[2]));
+
+      BMin = vec3::Min(BMin, P);
+      BMax = vec3::Max(BMax, P);
+    }
+  } /* End of 'scene_bvh::EvalBox' function */
+
+  /* Add mesh instance function.
+   * ARGUMENTS:
+   *   - mesh tree:
+   *       const mesh_bvh *Mesh;
+   *   - mesh to world matrix:
+   *       const matr &Matr;
+   *   - user data:
+   *       VOID *Data;
+   * RETURNS:
+   *   (INT) instance number.
+   */
+  INT scene_bvh::Add( const mesh_bvh *Mesh, const matr &Matr, VOID *Data )
+  {
+    INT Instance = (INT)Instances.size();
+
+    Instances.push_back({Mesh, matr::Identity(), matr::Identity(), 1, Data});
+    Mins.push_back(vec3(0));
+    Maxs.push_back(vec3(0));
+    SetMatrix(Instance, Matr);
+    IsBuilt = FALSE;
+    return Instance;
+  } /* End of 'scene_bvh::Add' function */
+
+  /* Set instance matrix function.
+   * ARGUMENTS:
+   *   - instance number:
+   *       INT Instance;
+   *   - mesh to world matrix:
+   *       const matr &Matr;
+   * RETURNS: None.
+   */
+  VOID scene_bvh::SetMatrix( INT Instance, const matr &Matr )
+  {
+    instance &In = Instances[Instance];
+
+    In.Matr = Matr;
+    In.InvMatr = matr(Matr).Inverse();
+    In.InvScale = mth::Max(mth::Max(
+      !In.InvMatr.TransformVector(vec3(1, 0, 0)),
+      !In.InvMatr.TransformVector(vec3(0, 1, 0))),
+      !In.InvMatr.TransformVector(vec3(0, 0, 1)));
+    EvalBox(Instance);
+  } /* End of 'scene_bvh::SetMatrix' function */
+
+  /* Update tree function (rebuild after 'Add', refit after moves).
+   * ARGUMENTS: None.
+   * RETURNS: None.
+   */
+  VOID scene_bvh::Update( VOID )
+  {
+    if (!IsBuilt)
+      Tree.Build(Mins.data(), Maxs.data(), Instances.size());
+    else
+      Tree.Refit(Mins.data(), Maxs.data());
+    IsBuilt = TRUE;
+  } /* End of 'scene_bvh::Update' function */
+
+  /* Find closest ray hit function.
+   * ARGUMENTS:
+   *   - ray origin and direction:
+   *       const vec3 &Org, &Dir;
+   *   - maximal ray parameter:
+   *       FLT MaxT;
+   *   - hit result:
+   *       bvh_hit &Hit;
+   * RETURNS:
+   *   (BOOL) TRUE if there is hit before 'MaxT'.
+   */
+  BOOL scene_bvh::Intersect( const vec3 &Org, const vec3 &Dir, FLT MaxT, bvh_hit &Hit ) const
+  {
+    BOOL IsHit = FALSE;
+
+    /* Mesh ray is not normalized, so ray parameter is same */
+    TraceRay(Tree, Org, Dir, MaxT,
+      [&]( INT First, INT Count )
+      {
+        for (INT i = First; i < First + Count; i++)
+        {
+          const instance &In = Instances[Tree.Order[i]];
+
+          if (In.Mesh->Intersect(In.InvMatr.TransformPoint(Org), In.InvMatr.TransformVector(Dir), MaxT, Hit))
+          {
+            MaxT = Hit.T;
+            Hit.Instance = Tree.Order[i];
+            IsHit = TRUE;
+          }
+        }
+        return FALSE;
+      });
+    return IsHit;
+  } /* End of 'scene_bvh::Intersect' function */
+
+  /* Check any ray hit function (line of sight).
+   * ARGUMENTS:
+   *   - ray origin and direction:
+   *       const vec3 &Org, &Dir;
+   *   - maximal ray parameter:
+   *       FLT MaxT;
+   * RETURNS:
+   *   (BOOL) TRUE if there is hit before 'MaxT'.
+   */
+  BOOL scene_bvh::IsOccluded( const vec3 &Org, const vec3 &Dir, FLT MaxT ) const
+  {
+    BOOL IsHit = FALSE;
+
+    TraceRay(Tree, Org, Dir, MaxT,
+      [&]( INT First, INT Count )
+      {
+        for (INT i = First; i < First + Count; i++)
+        {
+          const instance &In = Instances[Tree.Order[i]];
+
+          if (In.Mesh->IsOccluded(In.InvMatr.TransformPoint(Org), In.InvMatr.TransformVector(Dir), MaxT))
+            return IsHit = TRUE;
+        }
+        return FALSE;
+      });
+    return IsHit;
+  } /* End of 'scene_bvh::IsOccluded' function */
+
+  /* Find instance triangles overlapping sphere function.
+   * Non uniform instance scale makes result conservative.
+   * ARGUMENTS:
+   *   - sphere:
+   *       const vec3 &Center;
+   *       FLT Radius;
+   *   - instance and triangle numbers to add to:
+   *       std::vector<std::pair<INT, INT>> &Tris;
+   * RETURNS: None.
+   */
+  VOID scene_bvh::SphereOverlap( const vec3 &Center, FLT Radius, std::vector<std::pair<INT, INT>> &Tris ) const
+  {
+    std::vector<INT> MeshTris;
+
+    TraceSphere(Tree, Center, Radius,
+      [&]( INT First, INT Count )
+      {
+        for (INT i = First; i < First + Count; i++)
+        {
+          const instance &In = Instances[Tree.Order[i]];
+
+          MeshTris.clear();
+          In.Mesh->SphereOverlap(In.InvMatr.TransformPoint(Center), Radius * In.InvScale, MeshTris);
+          for (INT Tri : MeshTris)
+            Tris.push_back({Tree.Order[i], Tri});
+        }
+      });
+  } /* End of 'scene_bvh::SphereOverlap' function */
+
+  /* Find nearest surface point function.
+   * ARGUMENTS:
+   *   - point:
+   *       const vec3 &P;
+   *   - maximal distance (changed to found one):
+   *       FLT &Dist;
+   *   - nearest point:
+   *       vec3 &Nearest;
+   *   - nearest instance and triangle:
+   *       INT &Instance, &Tri;
+   * RETURNS:
+   *   (BOOL) TRUE if point closer than 'Dist' is found.
+   */
+  BOOL scene_bvh::Nearest( const vec3 &P, FLT &Dist, vec3 &Nearest, INT &Instance, INT &Tri ) const
+  {
+    BOOL IsFound = FALSE;
+
+    TraceSphere(Tree, P, Dist,
+      [&]( INT First, INT Count )
+      {
+        for (INT i = First; i < First + Count; i++)
+        {
+          const instance &In = Instances[Tree.Order[i]];
+          FLT LocalDist = Dist * In.InvScale;
+          vec3 Local;
+          INT LocalTri;
+
+          if (In.Mesh->Nearest(In.InvMatr.TransformPoint(P), LocalDist, Local, LocalTri))
+          {
+            vec3 World = In.Matr.TransformPoint(Local);
+            FLT D = !(World - P);
+
+            if (D < Dist)
+            {
+              Dist = D;
+              Nearest = World;
+              Instance = Tree.Order[i];
+              Tri = LocalTri;
+              IsFound = TRUE;
+            }
+          }
+        }
+      });
+    return IsFound;
+  } /* End of 'scene_bvh::Nearest' function */
+} /* end of 'digl' namespace */
+
+/* END OF 'bvh.cpp' FILE */
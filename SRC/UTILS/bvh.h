@@ -0,0 +1,296 @@
+/***************************************************************
+ * Copyright (C) 2020
+ *    Computer Graphics Support Group of 30 Phys-Math Gymnasium
+ ***************************************************************/
+
+/* FILE NAME   : bvh.h
+ * PURPOSE     : Bounding volume hierarchy header file.
+ * PROGRAMMER  : Dmitriy Vlasov.
+ * LAST UPDATE : 19.10.2020
+ * NOTE        : Namespace 'digl'.
+ *
+ *   Two levels: 'mesh_bvh' over triangles of one mesh (binned SAH build,
+ *   top splits are serial with parallel binning, subtrees are built in
+ *   parallel) and 'scene_bvh' over mesh instances (rebuilt on instance
+ *   set change, refitted on instance moves). Each tree node keeps boxes of
+ *   both children, so ray is tested with two boxes by one SSE pass.
+ *
+ * No part of this file may be changed without agreement of
+ * Computer Graphics Support Group of 30 Phys-Math Gymnasium.
+ */
+
+#ifndef __BVH_H_
+#define __BVH_H_
+
+#include "../def.h"
+
+#include <utility>
+#include <vector>
+
+/* Animation project namespace */
+namespace digl
+{
+  /* Ray hit representation type */
+  struct bvh_hit
+  {
+    FLT T;          // Ray parameter of hit
+    FLT U, V;       // Barycentric coordinates of hit in triangle
+    INT Tri;        // Triangle number (in source index order)
+    INT Instance;   // Scene instance number (-1 for mesh query)
+  }; /* End of 'bvh_hit' struct */
+
+  /* Bounding box tree representation type */
+  class bvh
+  {
+  public:
+    /* Build settings */
+    static const INT
+      NumOfBins = 16,          // SAH bins per axis
+      MaxLeafSize = 4;         // Maximal number of items in leaf
+    static const size_t
+      ParallelMin = 1 << 16,   // Minimal number of items for parallel binning
+      SubtreeMin = 1 << 12;    // Minimal number of items in parallel built subtree
+
+    /* Tree node: boxes of both children ([MinL, MinR, MaxL, MaxR] by axes) */
+    struct node
+    {
+      FLT X[4], Y[4], Z[4];
+      INT
+        Child[2],  // Child node index or first item in 'Order' for leaf (-1 for none)
+        Count[2];  // Number of leaf items (0 for inner node)
+    }; /* End of 'node' struct */
+
+    std::vector<node> Nodes;   // Nodes (parents before children)
+    std::vector<INT> Order;    // Items in leaves order
+    vec3 Min, Max;             // Tree box
+
+    /* Build tree by item boxes function.
+     * ARGUMENTS:
+     *   - item boxes:
+     *       const vec3 *Mins, *Maxs;
+     *   - number of items:
+     *       size_t Count;
+     * RETURNS: None.
+     */
+    VOID Build( const vec3 *Mins, const vec3 *Maxs, size_t Count );
+
+    /* Update node boxes for moved items function.
+     * ARGUMENTS:
+     *   - item boxes (same items as in 'Build'):
+     *       const vec3 *Mins, *Maxs;
+     * RETURNS: None.
+     */
+    VOID Refit( const vec3 *Mins, const vec3 *Maxs );
+
+    /* Clear tree function.
+     * ARGUMENTS: None.
+     * RETURNS: None.
+     */
+    VOID Clear( VOID )
+    {
+      Nodes.clear();
+      Order.clear();
+      Min = Max = vec3(0);
+    } /* End of 'Clear' function */
+  }; /* End of 'bvh' class */
+
+  /* Mesh triangles tree representation type */
+  class mesh_bvh
+  {
+  public:
+    bvh Tree;                   // Triangle boxes tree
+    std::vector<vec3> Vertices; // Triangle vertices in 'Tree.Order' order (3 per triangle)
+
+    /* Build tree by triangle list function.
+     * ARGUMENTS:
+     *   - vertex positions:
+     *       const vec3 *Points;
+     *   - triangle vertex indices (3 per triangle, nullptr for not indexed):
+     *       const INT *Index;
+     *   - number of triangles:
+     *       size_t NumOfTris;
+     * RETURNS: None.
+     */
+    VOID Build( const vec3 *Points, const INT *Index, size_t NumOfTris );
+
+    /* Check if tree is empty function.
+     * ARGUMENTS: None.
+     * RETURNS:
+     *   (BOOL) TRUE if there are no triangles.
+     */
+    BOOL IsEmpty( VOID ) const
+    {
+      return Vertices.empty();
+    } /* End of 'IsEmpty' function */
+
+    /* Find closest ray hit function.
+     * ARGUMENTS:
+     *   - ray origin and direction:
+     *       const vec3 &Org, &Dir;
+     *   - maximal ray parameter:
+     *       FLT MaxT;
+     *   - hit result:
+     *       bvh_hit &Hit;
+     * RETURNS:
+     *   (BOOL) TRUE if there is hit before 'MaxT'.
+     */
+    BOOL Intersect( const vec3 &Org, const vec3 &Dir, FLT MaxT, bvh_hit &Hit ) const;
+
+    /* Check any ray hit function (line of sight).
+     * ARGUMENTS:
+     *   - ray origin and direction:
+     *       const vec3 &Org, &Dir;
+     *   - maximal ray parameter:
+     *       FLT MaxT;
+     * RETURNS:
+     *   (BOOL) TRUE if there is hit before 'MaxT'.
+     */
+    BOOL IsOccluded( const vec3 &Org, const vec3 &Dir, FLT MaxT ) const;
+
+    /* Find triangles overlapping sphere function.
+     * ARGUMENTS:
+     *   - sphere:
+     *       const vec3 &Center;
+     *       FLT Radius;
+     *   - triangle numbers to add to:
+     *       std::vector<INT> &Tris;
+     * RETURNS: None.
+     */
+    VOID SphereOverlap( const vec3 &Center, FLT Radius, std::vector<INT> &Tris ) const;
+
+    /* Find nearest surface point function.
+     * ARGUMENTS:
+     *   - point:
+     *       const vec3 &P;
+     *   - maximal distance (changed to found one):
+     *       FLT &Dist;
+     *   - nearest point and its triangle:
+     *       vec3 &Nearest;
+     *       INT &Tri;
+     * RETURNS:
+     *   (BOOL) TRUE if point closer than 'Dist' is found.
+     */
+    BOOL Nearest( const vec3 &P, FLT &Dist, vec3 &Nearest, INT &Tri ) const;
+  }; /* End of 'mesh_bvh' class */
+
+  /* Mesh instances tree representation type */
+  class scene_bvh
+  {
+  public:
+    /* Mesh instance */
+    struct instance
+    {
+      const mesh_bvh *Mesh;  // Instance mesh
+      matr Matr, InvMatr;    // Mesh to world and world to mesh matrices
+      FLT InvScale;          // Maximal world to mesh length scale
+      VOID *Data;            // User data
+    }; /* End of 'instance' struct */
+
+    std::vector<instance> Instances;
+
+  private:
+    bvh Tree;                     // Instance boxes tree
+    std::vector<vec3> Mins, Maxs; // Instance world boxes
+    BOOL IsBuilt;                 // Tree is built for current instance set
+
+    /* Evaluate instance world box function.
+     * ARGUMENTS:
+     *   - instance number:
+     *       INT Instance;
+     * RETURNS: None.
+     */
+    VOID EvalBox( INT Instance );
+
+  public:
+    /* Scene tree constructor function.
+     * ARGUMENTS: None.
+     */
+    scene_bvh( VOID ) : IsBuilt(FALSE)
+    {
+    } /* End of 'scene_bvh' function */
+
+    /* Add mesh instance function.
+     * ARGUMENTS:
+     *   - mesh tree:
+     *       const mesh_bvh *Mesh;
+     *   - mesh to world matrix:
+     *       const matr &Matr;
+     *   - user data:
+     *       VOID *Data;
+     * RETURNS:
+     *   (INT) instance number.
+     */
+    INT Add( const mesh_bvh *Mesh, const matr &Matr, VOID *Data = nullptr );
+
+    /* Set instance matrix function.
+     * ARGUMENTS:
+     *   - instance number:
+     *       INT Instance;
+     *   - mesh to world matrix:
+     *       const matr &Matr;
+     * RETURNS: None.
+     */
+    VOID SetMatrix( INT Instance, const matr &Matr );
+
+    /* Update tree function (rebuild after 'Add', refit after moves).
+     * ARGUMENTS: None.
+     * RETURNS: None.
+     */
+    VOID Update( VOID );
+
+    /* Find closest ray hit function.
+     * ARGUMENTS:
+     *   - ray origin and direction:
+     *       const vec3 &Org, &Dir;
+     *   - maximal ray parameter:
+     *       FLT MaxT;
+     *   - hit result:
+     *       bvh_hit &Hit;
+     * RETURNS:
+     *   (BOOL) TRUE if there is hit before 'MaxT'.
+     */
+    BOOL Intersect( const vec3 &Org, const vec3 &Dir, FLT MaxT, bvh_hit &Hit ) const;
+
+    /* Check any ray hit function (line of sight).
+     * ARGUMENTS:
+     *   - ray origin and direction:
+     *       const vec3 &Org, &Dir;
+     *   - maximal ray parameter:
+     *       FLT MaxT;
+     * RETURNS:
+     *   (BOOL) TRUE if there is hit before 'MaxT'.
+     */
+    BOOL IsOccluded( const vec3 &Org, const vec3 &Dir, FLT MaxT ) const;
+
+    /* Find instance triangles overlapping sphere function.
+     * Non uniform instance scale makes result conservative.
+     * ARGUMENTS:
+     *   - sphere:
+     *       const vec3 &Center;
+     *       FLT Radius;
+     *   - instance and triangle numbers to add to:
+     *       std::vector<std::pair<INT, INT>> &Tris;
+     * RETURNS: None.
+     */
+    VOID SphereOverlap( const vec3 &Center, FLT Radius, std::vector<std::pair<INT, INT>> &Tris ) const;
+
+    /* Find nearest surface point function.
+     * ARGUMENTS:
+     *   - point:
+     *       const vec3 &P;
+     *   - maximal distance (changed to found one):
+     *       FLT &Dist;
+     *   - nearest point:
+     *       vec3 &Nearest;
+     *   - nearest instance and triangle:
+     *       INT &Instance, &Tri;
+     * RETURNS:
+     *   (BOOL) TRUE if point closer than 'Dist' is found.
+     */
+    BOOL Nearest( const vec3 &P, FLT &Dist, vec3 &Nearest, INT &Instance, INT &Tri ) const;
+  }; /* End of 'scene_bvh' class */
+} /* end of 'digl' namespace */
+
+#endif /* __BVH_H_ */
+
+/* END OF 'bvh.h' FILE */
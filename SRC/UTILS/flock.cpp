@@ -0,0 +1,312 @@
+/***************************************************************
+ * Copyright (C) 2020
+ *    Computer Graphics Support Group of 30 Phys-Math Gymnasium
+ ***************************************************************/
+
+/* FILE NAME   : flock.cpp
+ * PURPOSE     : Flocking behaviour file.
+ * PROGRAMMER  : Dmitriy Vlasov.
+ * LAST UPDATE : 19.10.2020
+ * NOTE        : Namespace 'digl'.
+ *
+ * No part of this file may be changed without agreement of
+ * Computer Graphics Support Group of 30 Phys-Math Gymnasium.
+ */
+
+/* Includes */
+#include "parallel.h"
+#include "rng.h"
+#include "flock.h"
+
+#include <cmath>
+#include <cstdio>
+#include <emmintrin.h>
+
+/* Animation project namespace */
+namespace digl
+{
+  /* Sum register elements function.
+   * ARGUMENTS:
+   *   - register:
+   *       __m128 A;
+   * RETURNS:
+   *   (FLT) sum.
+   */
+  static FLT Sum( __m128 A )
+  {
+    alignas(16) FLT V[4];
+
+    _mm_store_ps(V, A);
+    return (V[0] + V[1]) + (V[2] + V[3]);
+  } /* End of 'Sum' function */
+
+  /* Set accelerations of all vector bodies function (parallel).
+   * ARGUMENTS:
+   *   - birds motion:
+   *       kinematics_system &Motion;
+   * RETURNS: None.
+   */
+  VOID flock::Steer( kinematics_system &Motion )
+  {
+    kinematics_system::vector_bodies &B = Motion.Vectors;
+    size_t N = B.X.size();
+
+    Grid.CellSize = Rules.Radius;
+    Grid.Build(B.X.data(), B.Y.data(), B.Z.data(), N);
+    for (std::vector<FLT> *A : {&PosX, &PosY, &PosZ, &SpeedX, &SpeedY, &SpeedZ})
+      A->resize(N + 3, 0);
+    BlockNeighbours.assign(parallel::NumOfBlocks(N, MinBlock), 0);
+
+    /* Positions and speeds in grid order */
+    parallel::For(N,
+      [&]( size_t Begin, size_t End, INT )
+      {
+        for (size_t p = Begin; p < End; p++)
+        {
+          INT i = Grid.Index[p];
+
+          PosX[p] = Grid.X[p];
+          PosY[p] = Grid.Y[p];
+          PosZ[p] = Grid.Z[p];
+          SpeedX[p] = B.SpeedX[i];
+          SpeedY[p] = B.SpeedY[i];
+          SpeedZ[p] = B.SpeedZ[i];
+        }
+      }, MinBlock);
+
+    /* Rules by chunks of grid order */
+    parallel::For(N,
+      [&]( size_t Begin, size_t End, INT Block )
+      {
+        const rules &R = Rules;
+        const FLT Damping = 2 * sqrt(R.Level);
+        const __m128
+          Zero = _mm_setzero_ps(), One = _mm_set1_ps(1), Eps = _mm_set1_ps(1e-6f),
+          RR = _mm_set1_ps(R.Radius * R.Radius), SS = _mm_set1_ps(R.SeparationRadius * R.SeparationRadius);
+        const __m128i Lanes = _mm_set_epi32(3, 2, 1, 0);
+
+        for (size_t p = Begin; p < End; p++)
+        {
+          vec3
+            P(PosX[p], PosY[p], PosZ[p]),
+            V(SpeedX[p], SpeedY[p], SpeedZ[p]);
+          const __m128 px = _mm_set1_ps(P[0]), py = _mm_set1_ps(P[1]), pz = _mm_set1_ps(P[2]);
+          __m128
+            Cnt = Zero,
+            Dx = Zero, Dy = Zero, Dz = Zero,     // Sum of offsets (cohesion)
+            Vx = Zero, Vy = Zero, Vz = Zero,     // Sum of speeds (alignment)
+            Sx = Zero, Sy = Zero, Sz = Zero;     // Sum of inverse distance pushes (separation)
+
+          Grid.WalkRuns(P, R.Radius,
+            [&]( size_t b, size_t e )
+            {
+              const __m128i End = _mm_set1_epi32((INT)e);
+
+              for (size_t j = b; j < e; j += 4)
+              {
+                __m128
+                  dx = _mm_sub_ps(_mm_loadu_ps(&PosX[j]), px),
+                  dy = _mm_sub_ps(_mm_loadu_ps(&PosY[j]), py),
+                  dz = _mm_sub_ps(_mm_loadu_ps(&PosZ[j]), pz),
+                  d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)),
+                  In = _mm_castsi128_ps(_mm_cmplt_epi32(_mm_add_epi32(_mm_set1_epi32((INT)j), Lanes), End)),
+                  m = _mm_and_ps(In, _mm_and_ps(_mm_cmplt_ps(d2, RR), _mm_cmpgt_ps(d2, Zero))),
+                  s = _mm_and_ps(_mm_and_ps(m, _mm_cmplt_ps(d2, SS)), _mm_div_ps(One, _mm_max_ps(d2, Eps)));
+
+                Cnt = _mm_add_ps(Cnt, _mm_and_ps(m, One));
+                Dx = _mm_add_ps(Dx, _mm_and_ps(m, dx));
+                Dy = _mm_add_ps(Dy, _mm_and_ps(m, dy));
+                Dz = _mm_add_ps(Dz, _mm_and_ps(m, dz));
+                Vx = _mm_add_ps(Vx, _mm_and_ps(m, _mm_loadu_ps(&SpeedX[j])));
+                Vy = _mm_add_ps(Vy, _mm_and_ps(m, _mm_loadu_ps(&SpeedY[j])));
+                Vz = _mm_add_ps(Vz, _mm_and_ps(m, _mm_loadu_ps(&SpeedZ[j])));
+                Sx = _mm_sub_ps(Sx, _mm_mul_ps(dx, s));
+                Sy = _mm_sub_ps(Sy, _mm_mul_ps(dy, s));
+                Sz = _mm_sub_ps(Sz, _mm_mul_ps(dz, s));
+              }
+            });
+
+          FLT n = Sum(Cnt);
+          vec3 A(0);
+
+          if (n > 0)
+          {
+            FLT Inv = 1 / n;
+
+            A += vec3(Sum(Dx), Sum(Dy), Sum(Dz)) * (Inv * R.Cohesion);
+            A += (vec3(Sum(Vx), Sum(Vy), Sum(Vz)) * Inv - V) * R.Alignment;
+            A += vec3(Sum(Sx), Sum(Sy), Sum(Sz)) * R.Separation;
+            BlockNeighbours[Block] += (INT)n;
+          }
+
+          /* Cruise speed */
+          FLT Speed = !V;
+
+          if (Speed > 1e-3f)
+            A += V * ((R.CruiseSpeed - Speed) / Speed * R.Cruise);
+
+          /* Bounds circle and flight level */
+          FLT
+            hx = Center[0] - P[0], hz = Center[2] - P[2],
+            h = sqrt(hx * hx + hz * hz);
+
+          if (h > MaxDistance)
+            A += vec3(hx, 0, hz) * ((h - MaxDistance) / h * R.Bounds);
+          A[1] += (Center[1] - P[1]) * R.Level - V[1] * Damping;
+
+          FLT Len = !A;
+
+          if (Len > R.MaxAccel)
+            A *= R.MaxAccel / Len;
+
+          INT i = Grid.Index[p];
+
+          B.AccelX[i] = A[0];
+          B.AccelY[i] = A[1];
+          B.AccelZ[i] = A[2];
+        }
+      }, MinBlock);
+
+    NumOfNeighbours = 0;
+    for (INT n : BlockNeighbours)
+      NumOfNeighbours += n;
+  } /* End of 'flock::Steer' function */
+
+  /* Get birds instances function (parallel).
+   * ARGUMENTS:
+   *   - birds motion:
+   *       const kinematics_system &Motion;
+   *   - bird model transformation:
+   *       const matr &Model;
+   *   - wing phases of birds (nullptr for zero):
+   *       const FLT *Phases;
+   *   - instances to fill (parameter X is wing phase):
+   *       std::vector<primitives::instance> &Instances;
+   * RETURNS: None.
+   */
+  VOID flock::GetInstances( const kinematics_system &Motion, const matr &Model, const FLT *Phases,
+                            std::vector<primitives::instance> &Instances ) const
+  {
+    const kinematics_system::vector_bodies &B = Motion.Vectors;
+
+    Instances.resize(B.X.size());
+    parallel::For(B.X.size(),
+      [&]( size_t Begin, size_t End, INT )
+      {
+        for (size_t i = Begin; i < End; i++)
+        {
+          vec3 V(B.SpeedX[i], B.SpeedY[i], B.SpeedZ[i]), F, Right, Up;
+          FLT Len = !V, RightLen;
+
+          /* Bird looks along speed and keeps wings level (basis and translation) */
+          F = Len > 1e-3f ? V / Len : vec3(0, 0, 1);
+          Right = F % vec3(0, 1, 0);
+          RightLen = !Right;
+          Right = RightLen > 1e-3f ? Right / RightLen : vec3(-1, 0, 0);
+          Up = Right % F;
+          Instances[i].World = Model *
+            matr(Right[0], Right[1], Right[2], 0,
+                 Up[0], Up[1], Up[2], 0,
+                 F[0], F[1], F[2], 0,
+                 B.X[i], B.Y[i], B.Z[i], 1);
+          Instances[i].Params = vec4(Phases != nullptr ? Phases[i] : 0, Len, 0, 0);
+        }
+      }, MinBlock);
+  } /* End of 'flock::GetInstances' function */
+
+  /* Headless benchmark function (same density for any number of birds, 60 Hz steps).
+   * ARGUMENTS:
+   *   - number of birds and steps:
+   *       INT NumOfBirds, NumOfSteps;
+   * RETURNS:
+   *   (BOOL) TRUE if accelerations match.
+   */
+  BOOL flock::Benchmark( INT NumOfBirds, INT NumOfSteps )
+  {
+    /* 100 square meters of bounds circle per bird */
+    flock F(vec3(0, 50, 0), (FLT)sqrt(NumOfBirds * 100 / PI));
+    kinematics_system Motion;
+    std::vector<primitives::instance> Instances;
+    rng Rnd(30, 0);
+
+    for (INT i = 0; i < NumOfBirds; i++)
+      Motion.AddVector(F.Center + vec3(Rnd.Rnd1(), Rnd.Rnd1() * 0.1f, Rnd.Rnd1()) * F.MaxDistance * 0.7f, 0, 15,
+                       vec3(Rnd.Rnd1(), 0, Rnd.Rnd1()) * 10);
+
+    LARGE_INTEGER t0, t1, Freq;
+    DBL Time;
+
+    QueryPerformanceFrequency(&Freq);
+    QueryPerformanceCounter(&t0);
+    for (INT s = 0; s < NumOfSteps; s++)
+    {
+      F.Steer(Motion);
+      Motion.Compute(1.0f / 60);
+      F.GetInstances(Motion, matr::Identity(), nullptr, Instances);
+    }
+    QueryPerformanceCounter(&t1);
+    Time = (DBL)(t1.QuadPart - t0.QuadPart) * 1000 / Freq.QuadPart / mth::Max(NumOfSteps, 1);
+
+    /* Brute force rules for sample birds (sums differ by order only) */
+    const kinematics_system::vector_bodies &B = Motion.Vectors;
+    const rules &R = F.Rules;
+    INT NumOfChecked = mth::Min(NumOfBirds, 100), Mismatches = 0;
+
+    F.Steer(Motion);
+    for (INT c = 0; c < NumOfChecked; c++)
+    {
+      INT i = (INT)((UINT64)c * NumOfBirds / NumOfChecked), n = 0;
+      vec3
+        P(B.X[i], B.Y[i], B.Z[i]), V(B.SpeedX[i], B.SpeedY[i], B.SpeedZ[i]),
+        D(0), Vs(0), S(0), A(0);
+
+      for (INT j = 0; j < NumOfBirds; j++)
+      {
+        FLT
+          dx = B.X[j] - P[0], dy = B.Y[j] - P[1], dz = B.Z[j] - P[2],
+          d2 = dx * dx + dy * dy + dz * dz;
+
+        if (d2 > 0 && d2 < R.Radius * R.Radius)
+        {
+          n++;
+          D += vec3(dx, dy, dz);
+          Vs += vec3(B.SpeedX[j], B.SpeedY[j], B.SpeedZ[j]);
+          if (d2 < R.SeparationRadius * R.SeparationRadius)
+            S -= vec3(dx, dy, dz) / mth::Max(d2, 1e-6f);
+        }
+      }
+      if (n > 0)
+        A += D * (R.Cohesion / n) + (Vs / (FLT)n - V) * R.Alignment + S * R.Separation;
+
+      FLT Speed = !V;
+
+      if (Speed > 1e-3f)
+        A += V * ((R.CruiseSpeed - Speed) / Speed * R.Cruise);
+
+      FLT
+        hx = F.Center[0] - P[0], hz = F.Center[2] - P[2],
+        h = sqrt(hx * hx + hz * hz);
+
+      if (h > F.MaxDistance)
+        A += vec3(hx, 0, hz) * ((h - F.MaxDistance) / h * R.Bounds);
+      A[1] += (F.Center[1] - P[1]) * R.Level - V[1] * 2 * sqrt(R.Level);
+
+      FLT Len = !A;
+
+      if (Len > R.MaxAccel)
+        A *= R.MaxAccel / Len;
+      if (!(A - vec3(B.AccelX[i], B.AccelY[i], B.AccelZ[i])) > 1e-3f * (1 + Len))
+        Mismatches++;
+    }
+
+    CHAR Buf[300];
+
+    sprintf(Buf, "Flock: %i birds, %i steps, %.3f ms per step, %.2f neighbours per bird, %i of %i checked birds mismatch\n",
+      NumOfBirds, NumOfSteps, Time, (DBL)F.NumOfNeighbours / mth::Max(NumOfBirds, 1), Mismatches, NumOfChecked);
+    OutputDebugString(Buf);
+    printf("%s", Buf);
+    return Mismatches == 0;
+  } /* End of 'flock::Benchmark' function */
+} /* end of 'digl' namespace */
+
+/* END OF 'flock.cpp' FILE */
@@ -0,0 +1,124 @@
+/***************************************************************
+ * Copyright (C) 2020
+ *    Computer Graphics Support Group of 30 Phys-Math Gymnasium
+ ***************************************************************/
+
+/* FILE NAME   : flock.h
+ * PURPOSE     : Flocking behaviour header file.
+ * PROGRAMMER  : Dmitriy Vlasov.
+ * LAST UPDATE : 19.10.2020
+ * NOTE        : Namespace 'digl'.
+ *
+ *   Flock steers vector bodies of 'kinematics_system' (sets their
+ *   accelerations, motion step is done by system itself). Boids rules:
+ *   separation, alignment, cohesion, cruise speed and bounds (horizontal
+ *   circle and flight level). Neighbours are taken from grid runs
+ *   ('neighbour_grid::WalkRuns'), speeds are gathered in grid order, so
+ *   neighbours are read from contiguous arrays and rules are summed 4
+ *   neighbours per step with SSE. Birds are processed by chunks of grid
+ *   order (close birds together) in parallel. Cell runs are read by whole
+ *   registers (lanes past run end are masked), so short runs of sparse
+ *   flocks do not fall to scalar code.
+ *
+ * No part of this file may be changed without agreement of
+ * Computer Graphics Support Group of 30 Phys-Math Gymnasium.
+ */
+
+#ifndef __FLOCK_H_
+#define __FLOCK_H_
+
+#include "../def.h"
+#include "../ANIM/RENDER/prim.h"
+#include "kinematics_system.h"
+#include "neighbour_grid.h"
+
+#include <vector>
+
+/* Animation project namespace */
+namespace digl
+{
+  /* Flocking behaviour representation type */
+  class flock
+  {
+  public:
+    /* Minimal number of birds in one thread block */
+    static const size_t MinBlock = 1 << 10;
+
+    /* Boids rules parameters */
+    struct rules
+    {
+      FLT
+        Radius = 12,            // Neighbour distance
+        SeparationRadius = 4,   // Separation distance
+        Separation = 40,        // Rule weights
+        Alignment = 1.5f,
+        Cohesion = 0.4f,
+        CruiseSpeed = 10,       // Speed birds keep
+        Cruise = 1,
+        Bounds = 1,             // Pull back per meter out of bounds
+        Level = 0.5f,           // Flight level spring
+        MaxAccel = 15;          // Acceleration limit
+    } Rules;
+
+    vec3 Center;                // Bounds circle center (flight level is its height)
+    FLT MaxDistance;            // Bounds circle radius
+    neighbour_grid Grid;        // Birds grid of last 'Steer' call
+    INT NumOfNeighbours = 0;    // Neighbours found in last 'Steer' call
+
+  private:
+    std::vector<FLT>
+      PosX, PosY, PosZ,                      // Positions in grid order (padded to register width)
+      SpeedX, SpeedY, SpeedZ;                // Speeds in grid order
+    std::vector<INT> BlockNeighbours;        // Neighbours found by thread blocks
+
+  public:
+    /* Flock constructor function.
+     * ARGUMENTS:
+     *   - bounds circle center and radius:
+     *       const vec3 &InCenter;
+     *       FLT InMaxDistance;
+     */
+    flock( const vec3 &InCenter = vec3(0), FLT InMaxDistance = 100 ) :
+      Center(InCenter), MaxDistance(InMaxDistance)
+    {
+    } /* End of 'flock' function */
+
+    /* Set accelerations of all vector bodies function (parallel).
+     * ARGUMENTS:
+     *   - birds motion:
+     *       kinematics_system &Motion;
+     * RETURNS: None.
+     */
+    VOID Steer( kinematics_system &Motion );
+
+    /* Get birds instances function (parallel).
+     * ARGUMENTS:
+     *   - birds motion:
+     *       const kinematics_system &Motion;
+     *   - bird model transformation:
+     *       const matr &Model;
+     *   - wing phases of birds (nullptr for zero):
+     *       const FLT *Phases;
+     *   - instances to fill (parameter X is wing phase):
+     *       std::vector<primitives::instance> &Instances;
+     * RETURNS: None.
+     */
+    VOID GetInstances( const kinematics_system &Motion, const matr &Model, const FLT *Phases,
+                       std::vector<primitives::instance> &Instances ) const;
+
+    /* Headless benchmark function (same density for any number of birds, 60 Hz steps).
+     * Accelerations of sample birds after last step are checked against
+     * brute force scalar rules over all birds.
+     * ARGUMENTS:
+     *   - number of birds and steps:
+     *       INT NumOfBirds, NumOfSteps;
+     * RETURNS:
+     *   (BOOL) TRUE if accelerations match.
+     */
+    static BOOL Benchmark( INT NumOfBirds, INT NumOfSteps );
+  }; /* End of 'flock' class */
+} /* end of 'digl' namespace */
+
+#endif /* __FLOCK_H_ */
+
+/* END OF 'flock.h' FILE */
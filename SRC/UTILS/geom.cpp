@@ -33,10 +33,46 @@ namespace digl
     for (auto it = Childs.begin(); it != Childs.end(); ++it)
     {
       (*it)->ParentMatr = Matr;
+      (*it)->UpdateScene();
       (*it)->ResetChilds((*it)->SelfMatr * Matr);
     }
   } /* End of 'geom::ResetChilds' function */
 
+  /* Update scene instance matrices function.
+   * ARGUMENTS: None.
+   * RETURNS: None.
+   */
+  VOID geom::UpdateScene( VOID )
+  {
+    if (Scene == nullptr)
+      return;
+
+    INT i = 0;
+
+    /* Primitives added after 'AddToScene' are not in scene */
+    for (auto el : Prims)
+      for (auto Pr : el->Prims)
+        if (i < (INT)SceneInstances.size())
+          Scene->SetMatrix(SceneInstances[i++], Pr->Transform * el->Transform * SelfMatr * ParentMatr);
+  } /* End of 'geom::UpdateScene' function */
+
+  /* Add primitives of geometry and its childs to scene function.
+   * ARGUMENTS:
+   *   - scene:
+   *       scene_bvh *InScene;
+   * RETURNS: None.
+   */
+  VOID geom::AddToScene( scene_bvh *InScene )
+  {
+    Scene = InScene;
+    SceneInstances.clear();
+    for (auto el : Prims)
+      for (auto Pr : el->Prims)
+        SceneInstances.push_back(Scene->Add(Pr->GetBvh(), Pr->Transform * el->Transform * SelfMatr * ParentMatr, this));
+    for (auto el : Childs)
+      el->AddToScene(InScene);
+  } /* End of 'geom::AddToScene' function */
+
   /* Get child function.
    * ARGUMENTS:
    *   - index:
@@ -92,6 +128,7 @@ namespace digl
   VOID geom::SetMatrix( const matr &Matr )
   {
     SelfMatr = Matr;
+    UpdateScene();
     ResetChilds(SelfMatr * ParentMatr);
   } /* End of 'geom::SetMatrix' function */
 
@@ -104,6 +141,7 @@ namespace digl
   VOID geom::ApplyMatrix( const matr &Matr )
   {
     SelfMatr = SelfMatr * Matr;
+    UpdateScene();
     ResetChilds(SelfMatr * ParentMatr);
   } /* End of 'geom::ApplyMatrix' function */
 
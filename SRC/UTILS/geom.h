@@ -34,6 +34,14 @@ namespace digl
     std::vector<geom *> Childs;
     std::vector<primitives::primitives *> Prims;
     std::vector<emitter *> Emitters;
+    scene_bvh *Scene;                 // Spatial queries scene (nullptr if not added)
+    std::vector<INT> SceneInstances;  // Scene instances of primitives
+
+    /* Update scene instance matrices function.
+     * ARGUMENTS: None.
+     * RETURNS: None.
+     */
+    VOID UpdateScene( VOID );
 
     /* Reset matrixes for childs function.
      * ARGUMENTS:
@@ -49,7 +57,7 @@ namespace digl
      * RETURNS: None.
      */
     geom( VOID ) : ParentMatr(matr::Identity()),
-      SelfMatr(matr::Identity())
+      SelfMatr(matr::Identity()), Scene(nullptr)
     {
     } /* End of 'geom' functon */
 
@@ -107,6 +115,16 @@ namespace digl
      */
     VOID ApplyMatrix( const matr &Matr );
 
+    /* Add primitives of geometry and its childs to scene function.
+     * Instances follow geometry matrices, 'scene_bvh::Update' should be
+     * called after moves.
+     * ARGUMENTS:
+     *   - scene:
+     *       scene_bvh *InScene;
+     * RETURNS: None.
+     */
+    VOID AddToScene( scene_bvh *InScene );
+
     /* Geometry response function.
      * ARGUMENTS: None.
      * RETURNS: None.
@@ -0,0 +1,249 @@
+/***************************************************************
+ * Copyright (C) 2020
+ *    Computer Graphics Support Group of 30 Phys-Math Gymnasium
+ ***************************************************************/
+
+/* FILE NAME   : hash.h
+ * PURPOSE     : Content hash header file.
+ * PROGRAMMER  : Dmitriy Vlasov.
+ * LAST UPDATE : 19.10.2020
+ * NOTE        : Namespace 'digl'.
+ *
+ * No part of this file may be changed without agreement of
+ * Computer Graphics Support Group of 30 Phys-Math Gymnasium.
+ */
+
+#ifndef __HASH_H_
+#define __HASH_H_
+
+#include "../def.h"
+
+#include <cstring>
+
+/* Animation project namespace */
+namespace digl
+{
+  /* FNV-1a 64-bit content hash representation type */
+  class hash
+  {
+  public:
+    UINT64 Value; // Current hash value
+
+    /* Hash constructor.
+     * ARGUMENTS:
+     *   - start value:
+     *       UINT64 Seed;
+     * RETURNS: None.
+     */
+    hash( UINT64 Seed = 14695981039346656037ULL ) : Value(Seed)
+    {
+    } /* End of 'hash' function */
+
+    /* Add bytes to hash function.
+     * ARGUMENTS:
+     *   - data and its size in bytes:
+     *       const VOID *Data;
+     *       size_t Size;
+     * RETURNS:
+     *   (hash &) this hash.
+     */
+    hash & operator()( const VOID *Data, size_t Size )
+    {
+      const BYTE *ptr = (const BYTE *)Data;
+
+      for (size_t i = 0; i < Size; i++)
+        Value = (Value ^ ptr[i]) * 1099511628211ULL;
+      return *this;
+    } /* End of 'operator()' function */
+
+    /* Add value to hash function.
+     * ARGUMENTS:
+     *   - value (plain data):
+     *       const Type &X;
+     * RETURNS:
+     *   (hash &) this hash.
+     */
+    template<class Type>
+      hash & operator<<( const Type &X )
+      {
+        return (*this)(&X, sizeof(Type));
+      } /* End of 'operator<<' function */
+
+    /* Get hash value function.
+     * ARGUMENTS: None.
+     * RETURNS:
+     *   (UINT64) hash value.
+     */
+    operator UINT64( VOID ) const
+    {
+      return Value;
+    } /* End of 'operator UINT64' function */
+  }; /* End of 'hash' class */
+
+  /* 128-bit content digest (MurmurHash3 x64 128-bit) representation type.
+   * Strong enough to identify content by digest and size without
+   * keeping or reading back the bytes.
+   */
+  class digest
+  {
+    UINT64 H1, H2;  // Hash state
+    BYTE Tail[16];  // Bytes not yet forming full block
+    size_t Length;  // Total number of added bytes
+
+    /* Rotate left function.
+     * ARGUMENTS:
+     *   - value and number of bits:
+     *       UINT64 X;
+     *       INT R;
+     * RETURNS:
+     *   (UINT64) rotated value.
+     */
+    static UINT64 Rotl( UINT64 X, INT R )
+    {
+      return (X << R) | (X >> (64 - R));
+    } /* End of 'Rotl' function */
+
+    /* Final mix function.
+     * ARGUMENTS:
+     *   - value:
+     *       UINT64 K;
+     * RETURNS:
+     *   (UINT64) mixed value.
+     */
+    static UINT64 Mix( UINT64 K )
+    {
+      K ^= K >> 33;
+      K *= 0xFF51AFD7ED558CCDULL;
+      K ^= K >> 33;
+      K *= 0xC4CEB9FE1A85EC53ULL;
+      return K ^ (K >> 33);
+    } /* End of 'Mix' function */
+
+    /* Process full block function.
+     * ARGUMENTS:
+     *   - block (16 bytes):
+     *       const BYTE *Block;
+     * RETURNS: None.
+     */
+    VOID Process( const BYTE *Block )
+    {
+      UINT64 K1, K2;
+
+      memcpy(&K1, Block, 8);
+      memcpy(&K2, Block + 8, 8);
+      H1 ^= Rotl(K1 * C1, 31) * C2;
+      H1 = (Rotl(H1, 27) + H2) * 5 + 0x52DCE729;
+      H2 ^= Rotl(K2 * C2, 33) * C1;
+      H2 = (Rotl(H2, 31) + H1) * 5 + 0x38495AB5;
+    } /* End of 'Process' function */
+
+    static const UINT64
+      C1 = 0x87C37B91114253D5ULL,
+      C2 = 0x4CF5AD432745937FULL;
+
+  public:
+    /* Digest value */
+    struct value
+    {
+      UINT64 Lo, Hi; // Low and high halves
+
+      /* Compare values function.
+       * ARGUMENTS:
+       *   - other value:
+       *       const value &V;
+       * RETURNS:
+       *   (BOOL) TRUE if values are equal.
+       */
+      BOOL operator==( const value &V ) const
+      {
+        return Lo == V.Lo && Hi == V.Hi;
+      } /* End of 'operator==' function */
+    }; /* End of 'value' struct */
+
+    /* Digest constructor.
+     * ARGUMENTS:
+     *   - start value:
+     *       UINT64 Seed;
+     * RETURNS: None.
+     */
+    digest( UINT64 Seed = 0 ) : H1(Seed), H2(Seed), Tail(), Length(0)
+    {
+    } /* End of 'digest' function */
+
+    /* Add bytes to digest function.
+     * ARGUMENTS:
+     *   - data and its size in bytes:
+     *       const VOID *Data;
+     *       size_t Size;
+     * RETURNS:
+     *   (digest &) this digest.
+     */
+    digest & operator()( const VOID *Data, size_t Size )
+    {
+      const BYTE *ptr = (const BYTE *)Data;
+      size_t n = Length % 16;
+
+      Length += Size;
+      if (n != 0)
+      {
+        size_t k = Size < 16 - n ? Size : 16 - n;
+
+        memcpy(Tail + n, ptr, k);
+        ptr += k, Size -= k;
+        if (n + k < 16)
+          return *this;
+        Process(Tail);
+      }
+      for (; Size >= 16; ptr += 16, Size -= 16)
+        Process(ptr);
+      memcpy(Tail, ptr, Size);
+      return *this;
+    } /* End of 'operator()' function */
+
+    /* Add value to digest function.
+     * ARGUMENTS:
+     *   - value (plain data):
+     *       const Type &X;
+     * RETURNS:
+     *   (digest &) this digest.
+     */
+    template<class Type>
+      digest & operator<<( const Type &X )
+      {
+        return (*this)(&X, sizeof(Type));
+      } /* End of 'operator<<' function */
+
+    /* Get digest value function.
+     * ARGUMENTS: None.
+     * RETURNS:
+     *   (value) digest of all added bytes.
+     */
+    value Get( VOID ) const
+    {
+      UINT64 h1 = H1, h2 = H2, K1 = 0, K2 = 0;
+      size_t n = Length % 16;
+
+      for (size_t i = n; i > 8; i--)
+        K2 = (K2 << 8) | Tail[i - 1];
+      for (size_t i = n < 8 ? n : 8; i > 0; i--)
+        K1 = (K1 << 8) | Tail[i - 1];
+      if (n > 8)
+        h2 ^= Rotl(K2 * C2, 33) * C1;
+      if (n > 0)
+        h1 ^= Rotl(K1 * C1, 31) * C2;
+      h1 ^= Length;
+      h2 ^= Length;
+      h1 += h2;
+      h2 += h1;
+      h1 = Mix(h1);
+      h2 = Mix(h2);
+      h1 += h2;
+      h2 += h1;
+      return {h1, h2};
+    } /* End of 'Get' function */
+  }; /* End of 'digest' class */
+} /* end of 'digl' namespace */
+
+#endif /* __HASH_H_ */
+
+/* END OF 'hash.h' FILE */
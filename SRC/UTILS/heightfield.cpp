@@ -0,0 +1,675 @@
+/***************************************************************
+ * Copyright (C) 2020
+ *    Computer Graphics Support Group of 30 Phys-Math Gymnasium
+ ***************************************************************/
+
+/* FILE NAME   : heightfield.cpp
+ * PURPOSE     : Height map CPU cache file.
+ * PROGRAMMER  : Dmitriy Vlasov.
+ * LAST UPDATE : 19.10.2020
+ * NOTE        : Namespace 'digl'.
+ *
+ * No part of this file may be changed without agreement of
+ * Computer Graphics Support Group of 30 Phys-Math Gymnasium.
+ */
+
+/* Includes */
+#include "../ANIM/anim.h"
+#include "parallel.h"
+#include "rng.h"
+#include "heightfield.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <emmintrin.h>
+
+/* Animation project namespace */
+namespace digl
+{
+  /* Height field constructor function.
+   * ARGUMENTS:
+   *   - height map file name (empty or missing file for flat field):
+   *       const std::string &FileName;
+   *   - world space corner of height map square, its side and height scale:
+   *       const vec3 &InOrigin;
+   *       FLT InSize, InHeight;
+   */
+  heightfield::heightfield( const std::string &FileName, const vec3 &InOrigin, FLT InSize, FLT InHeight ) :
+    Name(FileName), Origin(InOrigin), Size(InSize), Height(InHeight)
+  {
+    anim *AC = anim::GetPtr();
+    std::vector<DWORD> HeightImg, NormalImg;
+
+    if (FileName != "")
+    {
+      image Img(FileName);
+
+      if (Img.W > 0 && Img.H > 0)
+      {
+        W = Img.W;
+        H = Img.H;
+        Heights.resize((size_t)W * H);
+        for (size_t i = 0; i < Heights.size(); i++)
+          Heights[i] = Img.Pixels[i * 4 + 2] / 255.0f * Height;
+        HeightImg.assign(Img.RowsD[0], Img.RowsD[0] + Heights.size());
+      }
+    }
+
+    if (W == 0)
+    {
+      /* Flat field: textures give zero height and up normal */
+      HeightTex = AC->TextureCreate(Name, 1, 1, std::vector<DWORD>(1, 0xFF000000).data(), FALSE);
+      NormalTex = AC->TextureCreate(Name + ":normals", 1, 1, std::vector<DWORD>(1, 0xFF80FF80).data(), FALSE);
+    }
+    else
+    {
+      /* Bake normals by central differences (V is world X, U is world Z) */
+      FLT
+        StepX = 2 * Size / H,
+        StepZ = 2 * Size / W;
+
+      Normals.resize(Heights.size());
+      NormalImg.resize(Heights.size());
+      parallel::For(H,
+        [&]( size_t Begin, size_t End, INT )
+        {
+          for (INT y = (INT)Begin; y < (INT)End; y++)
+            for (INT x = 0; x < W; x++)
+            {
+              INT
+                xm = x > 0 ? x - 1 : 0, xp = x < W - 1 ? x + 1 : W - 1,
+                ym = y > 0 ? y - 1 : 0, yp = y < H - 1 ? y + 1 : H - 1;
+              vec3 N = vec3((Heights[ym * W + x] - Heights[yp * W + x]) / StepX, 1,
+                            (Heights[y * W + xm] - Heights[y * W + xp]) / StepZ).Normalizing();
+
+              Normals[y * W + x] = N;
+              NormalImg[y * W + x] =
+                (DWORD)((N[2] * 0.5f + 0.5f) * 255 + 0.5f) |
+                (DWORD)((N[1] * 0.5f + 0.5f) * 255 + 0.5f) << 8 |
+                (DWORD)((N[0] * 0.5f + 0.5f) * 255 + 0.5f) << 16 | 0xFF000000;
+            }
+        }, 16);
+      HeightTex = AC->TextureCreate(Name, W, H, HeightImg.data(), FALSE);
+      NormalTex = AC->TextureCreate(Name + ":normals", W, H, NormalImg.data(), FALSE);
+      BuildLevels();
+    }
+    /* Textures are created not shared, so their sampling may be changed */
+    for (texture *Tex : {HeightTex, NormalTex})
+    {
+      glBindTexture(GL_TEXTURE_2D, Tex->TexId);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+  } /* End of 'heightfield::heightfield' function */
+
+  /* Build min/max pyramid function.
+   * ARGUMENTS: None.
+   * RETURNS: None.
+   */
+  VOID heightfield::BuildLevels( VOID )
+  {
+    Levels.clear();
+    if (W < 2 || H < 2)
+      return;
+
+    /* Cells between texel centers: bilinear surface range is corners range */
+    Levels.push_back({W - 1, H - 1});
+    level &L0 = Levels[0];
+
+    L0.Min.resize((size_t)L0.W * L0.H);
+    L0.Max.resize((size_t)L0.W * L0.H);
+    parallel::For(L0.H,
+      [&]( size_t Begin, size_t End, INT )
+      {
+        for (INT y = (INT)Begin; y < (INT)End; y++)
+          for (INT x = 0; x < L0.W; x++)
+          {
+            FLT
+              h00 = Heights[y * W + x], h01 = Heights[y * W + x + 1],
+              h10 = Heights[(y + 1) * W + x], h11 = Heights[(y + 1) * W + x + 1];
+
+            L0.Min[y * L0.W + x] = mth::Min(mth::Min(h00, h01), mth::Min(h10, h11));
+            L0.Max[y * L0.W + x] = mth::Max(mth::Max(h00, h01), mth::Max(h10, h11));
+          }
+      }, 16);
+
+    /* Next levels by 2x2 cells of previous one */
+    while (Levels.back().W > 1 || Levels.back().H > 1)
+    {
+      const level &P = Levels.back();
+      level L {(P.W + 1) / 2, (P.H + 1) / 2};
+
+      L.Min.resize((size_t)L.W * L.H);
+      L.Max.resize((size_t)L.W * L.H);
+      for (INT y = 0; y < L.H; y++)
+        for (INT x = 0; x < L.W; x++)
+        {
+          FLT Lo = 1e30f, Hi = -1e30f;
+
+          for (INT cy = y * 2; cy < mth::Min(y * 2 + 2, P.H); cy++)
+            for (INT cx = x * 2; cx < mth::Min(x * 2 + 2, P.W); cx++)
+            {
+              Lo = mth::Min(Lo, P.Min[cy * P.W + cx]);
+              Hi = mth::Max(Hi, P.Max[cy * P.W + cx]);
+            }
+          L.Min[y * L.W + x] = Lo;
+          L.Max[y * L.W + x] = Hi;
+        }
+      Levels.push_back(std::move(L));
+    }
+  } /* End of 'heightfield::BuildLevels' function */
+
+  /* Clip ray parameter range by rectangle function.
+   * ARGUMENTS:
+   *   - ray origin and direction (X, Y used):
+   *       const FLT *Org, *Dir;
+   *   - rectangle:
+   *       FLT X0, X1, Y0, Y1;
+   *   - ray parameter range to clip:
+   *       FLT &T0, &T1;
+   * RETURNS:
+   *   (BOOL) TRUE if range is not empty.
+   */
+  static BOOL ClipRect( const FLT *Org, const FLT *Dir, FLT X0, FLT X1, FLT Y0, FLT Y1, FLT &T0, FLT &T1 )
+  {
+    FLT Lo[2] = {X0, Y0}, Hi[2] = {X1, Y1};
+
+    for (INT a = 0; a < 2; a++)
+      if (Dir[a] == 0)
+      {
+        if (Org[a] < Lo[a] || Org[a] > Hi[a])
+          return FALSE;
+      }
+      else
+      {
+        FLT
+          ta = (Lo[a] - Org[a]) / Dir[a],
+          tb = (Hi[a] - Org[a]) / Dir[a];
+
+        if (ta > tb)
+          std::swap(ta, tb);
+        T0 = mth::Max(T0, ta);
+        T1 = mth::Min(T1, tb);
+      }
+    return T0 <= T1;
+  } /* End of 'ClipRect' function */
+
+  /* Trace ray in pyramid node function.
+   * ARGUMENTS:
+   *   - pyramid level and node cell:
+   *       INT Level, X, Y;
+   *   - ray origin and direction (cell units along X, Y, height units along Z):
+   *       const FLT *Org, *Dir;
+   *   - ray parameter range in node:
+   *       FLT T0, T1;
+   *   - any hit is enough flag:
+   *       BOOL IsAny;
+   * RETURNS:
+   *   (FLT) hit ray parameter (-1 if none).
+   */
+  FLT heightfield::TraceNode( INT Level, INT X, INT Y, const FLT *Org, const FLT *Dir, FLT T0, FLT T1, BOOL IsAny ) const
+  {
+    const level &L = Levels[Level];
+    FLT
+      z0 = Org[2] + Dir[2] * T0,
+      z1 = Org[2] + Dir[2] * T1,
+      Lo = mth::Min(z0, z1);
+
+    /* Ray is above node: skip it; ray is under node minimum: surely hit */
+    if (Lo > L.Max[Y * L.W + X])
+      return -1;
+    if (IsAny && Lo < L.Min[Y * L.W + X])
+      return T0;
+
+    if (Level > 0)
+    {
+      /* Children in ray order */
+      const level &C = Levels[Level - 1];
+      INT Step = 1 << (Level - 1), NumOfChildren = 0;
+      struct
+      {
+        INT X, Y;
+        FLT T0, T1;
+      } Children[4];
+
+      for (INT cy = Y * 2; cy < mth::Min(Y * 2 + 2, C.H); cy++)
+        for (INT cx = X * 2; cx < mth::Min(X * 2 + 2, C.W); cx++)
+        {
+          FLT a = T0, b = T1;
+
+          if (ClipRect(Org, Dir, (FLT)(cx * Step), (FLT)mth::Min((cx + 1) * Step, Levels[0].W),
+                (FLT)(cy * Step), (FLT)mth::Min((cy + 1) * Step, Levels[0].H), a, b))
+          {
+            INT i = NumOfChildren++;
+
+            for (; i > 0 && Children[i - 1].T0 > a; i--)
+              Children[i] = Children[i - 1];
+            Children[i] = {cx, cy, a, b};
+          }
+        }
+      for (INT i = 0; i < NumOfChildren; i++)
+      {
+        FLT T = TraceNode(Level - 1, Children[i].X, Children[i].Y, Org, Dir, Children[i].T0, Children[i].T1, IsAny);
+
+        if (T >= 0)
+          return T;
+      }
+      return -1;
+    }
+
+    /* Cell: ray height minus bilinear height is q2 * t^2 + q1 * t + q0 */
+    DBL
+      h00 = Heights[Y * W + X], h01 = Heights[Y * W + X + 1],
+      h10 = Heights[(Y + 1) * W + X], h11 = Heights[(Y + 1) * W + X + 1],
+      B = h01 - h00, C = h10 - h00, D = h00 - h01 - h10 + h11,
+      ax = Org[0] - X, bx = Dir[0],
+      ay = Org[1] - Y, by = Dir[1],
+      q2 = -D * bx * by,
+      q1 = Dir[2] - B * bx - C * by - D * (ax * by + bx * ay),
+      q0 = Org[2] - h00 - B * ax - C * ay - D * ax * ay;
+    auto F = [&]( DBL t ){ return (q2 * t + q1) * t + q0; };
+
+    if (F(T0) <= 0)
+      return T0;
+
+    DBL Roots[2];
+    INT NumOfRoots = 0;
+
+    if (q2 == 0)
+    {
+      if (q1 != 0)
+        Roots[NumOfRoots++] = -q0 / q1;
+    }
+    else
+    {
+      DBL Disc = q1 * q1 - 4 * q2 * q0;
+
+      if (Disc >= 0)
+      {
+        DBL q = -0.5 * (q1 + (q1 < 0 ? -sqrt(Disc) : sqrt(Disc)));
+
+        Roots[NumOfRoots++] = q / q2;
+        if (q != 0)
+          Roots[NumOfRoots++] = q0 / q;
+        if (NumOfRoots == 2 && Roots[1] < Roots[0])
+          std::swap(Roots[0], Roots[1]);
+      }
+    }
+    for (INT i = 0; i < NumOfRoots; i++)
+      if (Roots[i] >= T0 && Roots[i] <= T1)
+        return (FLT)Roots[i];
+    /* Round off near cell border */
+    return F(T1) <= 0 ? T1 : -1;
+  } /* End of 'heightfield::TraceNode' function */
+
+  /* Trace ray in height map space function.
+   * ARGUMENTS:
+   *   - ray origin and direction (cell units along X, Y, height units along Z):
+   *       const FLT *Org, *Dir;
+   *   - ray parameter range:
+   *       FLT T0, T1;
+   *   - any hit is enough flag:
+   *       BOOL IsAny;
+   * RETURNS:
+   *   (FLT) hit ray parameter (-1 if none).
+   */
+  FLT heightfield::Trace( const FLT *Org, const FLT *Dir, FLT T0, FLT T1, BOOL IsAny ) const
+  {
+    if (!ClipRect(Org, Dir, 0, (FLT)Levels[0].W, 0, (FLT)Levels[0].H, T0, T1))
+      return -1;
+    return TraceNode((INT)Levels.size() - 1, 0, 0, Org, Dir, T0, T1, IsAny);
+  } /* End of 'heightfield::Trace' function */
+
+  /* Find first ray hit function.
+   * ARGUMENTS:
+   *   - world space ray origin and direction:
+   *       const vec3 &Org, &Dir;
+   *   - maximal ray parameter:
+   *       FLT MaxT;
+   *   - hit ray parameter:
+   *       FLT &T;
+   * RETURNS:
+   *   (BOOL) TRUE if ground is hit in [0, MaxT] (origin under ground gives 0).
+   */
+  BOOL heightfield::Intersect( const vec3 &Org, const vec3 &Dir, FLT MaxT, FLT &T ) const
+  {
+    if (Levels.empty())
+    {
+      /* Flat field */
+      FLT h = Org[1] - GetHeight(Org[0], Org[2]);
+
+      if (h <= 0)
+        return T = 0, TRUE;
+      if (Dir[1] >= 0 || -h / Dir[1] > MaxT)
+        return FALSE;
+      return T = -h / Dir[1], TRUE;
+    }
+
+    /* Height map space: X along U (world Z), Y along V (world X) */
+    FLT
+      MapOrg[3] =
+      {
+        (Org[2] - Origin[2]) / Size * W - 0.5f,
+        (Org[0] - Origin[0]) / Size * H - 0.5f,
+        Org[1] - Origin[1]
+      },
+      MapDir[3] = {Dir[2] / Size * W, Dir[0] / Size * H, Dir[1]};
+
+    T = Trace(MapOrg, MapDir, 0, MaxT, FALSE);
+    return T >= 0;
+  } /* End of 'heightfield::Intersect' function */
+
+  /* Check ray segment goes under ground function (line of sight).
+   * ARGUMENTS:
+   *   - world space ray origin and direction:
+   *       const vec3 &Org, &Dir;
+   *   - maximal ray parameter:
+   *       FLT MaxT;
+   * RETURNS:
+   *   (BOOL) TRUE if ground is hit in [0, MaxT].
+   */
+  BOOL heightfield::IsOccluded( const vec3 &Org, const vec3 &Dir, FLT MaxT ) const
+  {
+    if (Levels.empty())
+    {
+      FLT T;
+
+      return Intersect(Org, Dir, MaxT, T);
+    }
+
+    FLT
+      MapOrg[3] =
+      {
+        (Org[2] - Origin[2]) / Size * W - 0.5f,
+        (Org[0] - Origin[0]) / Size * H - 0.5f,
+        Org[1] - Origin[1]
+      },
+      MapDir[3] = {Dir[2] / Size * W, Dir[0] / Size * H, Dir[1]};
+
+    return Trace(MapOrg, MapDir, 0, MaxT, TRUE) >= 0;
+  } /* End of 'heightfield::IsOccluded' function */
+
+  /* Find first hits of ray set function (rays are traced in parallel).
+   * ARGUMENTS:
+   *   - world space ray origins and directions:
+   *       const vec3 *Orgs, *Dirs;
+   *   - maximal ray parameter:
+   *       FLT MaxT;
+   *   - hit ray parameters to fill (-1 for miss):
+   *       FLT *Res;
+   *   - number of rays:
+   *       size_t Count;
+   * RETURNS: None.
+   */
+  VOID heightfield::Intersect( const vec3 *Orgs, const vec3 *Dirs, FLT MaxT, FLT *Res, size_t Count ) const
+  {
+    parallel::For(Count,
+      [&]( size_t Begin, size_t End, INT )
+      {
+        for (size_t i = Begin; i < End; i++)
+          if (!Intersect(Orgs[i], Dirs[i], MaxT, Res[i]))
+            Res[i] = -1;
+      }, 256);
+  } /* End of 'heightfield::Intersect' function */
+
+  /* Headless check of 'Intersect' against fine fixed step ray march function.
+   * ARGUMENTS:
+   *   - number of rays:
+   *       INT NumOfRays;
+   * RETURNS:
+   *   (BOOL) TRUE if all results match.
+   */
+  BOOL heightfield::Test( INT NumOfRays )
+  {
+    const FLT MaxT = 200, Step = 0.005f, TolT = 0.01f, TolHeight = 0.05f;
+    heightfield F;
+    rng Rnd(30, 0);
+
+    /* Not square and not power of 2 map, so pyramid has partial cells */
+    F.W = 213, F.H = 150;
+    F.Origin = vec3(-50, -5, -40);
+    F.Size = 100, F.Height = 20;
+    F.Heights.resize((size_t)F.W * F.H);
+    for (INT y = 0; y < F.H; y++)
+      for (INT x = 0; x < F.W; x++)
+        F.Heights[y * F.W + x] = F.Height * (0.5f + 0.3f * sin(x * 0.05f) * cos(y * 0.07f) + 0.2f * Rnd.Rnd0());
+    F.BuildLevels();
+
+    /* Unit directions (march step is world length), some origins are under ground or out of map */
+    std::vector<vec3> Orgs(NumOfRays), Dirs(NumOfRays);
+    std::vector<FLT> Res(NumOfRays), Ref(NumOfRays);
+
+    for (INT i = 0; i < NumOfRays; i++)
+    {
+      vec3 D;
+
+      Orgs[i] = vec3(Rnd.Rnd1() * 60, F.Origin[1] - 2 + Rnd.Rnd0() * 32, 10 + Rnd.Rnd1() * 60);
+      do
+        D = vec3(Rnd.Rnd1(), 0.2f - Rnd.Rnd0() * 1.2f, Rnd.Rnd1());
+      while (!D < 0.1f);
+      Dirs[i] = D.Normalizing();
+    }
+
+    LARGE_INTEGER Freq, t0, t1;
+    DBL TraceTime, MarchTime;
+
+    QueryPerformanceFrequency(&Freq);
+    QueryPerformanceCounter(&t0);
+    F.Intersect(Orgs.data(), Dirs.data(), MaxT, Res.data(), NumOfRays);
+    QueryPerformanceCounter(&t1);
+    TraceTime = (DBL)(t1.QuadPart - t0.QuadPart) * 1000 / Freq.QuadPart;
+
+    /* Point is hit if it is under ground inside texel centers square (border is not traced) */
+    auto IsUnder = [&]( const vec3 &P )
+    {
+      FLT
+        x = (P[2] - F.Origin[2]) / F.Size * F.W - 0.5f,
+        y = (P[0] - F.Origin[0]) / F.Size * F.H - 0.5f;
+
+      return x >= 0 && x <= F.W - 1 && y >= 0 && y <= F.H - 1 && P[1] <= F.GetHeight(P[0], P[2]);
+    };
+
+    QueryPerformanceCounter(&t0);
+    parallel::For(NumOfRays,
+      [&]( size_t Begin, size_t End, INT )
+      {
+        for (size_t i = Begin; i < End; i++)
+        {
+          Ref[i] = -1;
+          for (INT k = 0; k * Step <= MaxT; k++)
+            if (IsUnder(Orgs[i] + Dirs[i] * (k * Step)))
+            {
+              /* Refine crossing between last point above and first one under ground */
+              FLT a = (k - 1) * Step, b = k * Step;
+
+              if (k > 0)
+                for (INT n = 0; n < 24; n++)
+                {
+                  FLT m = (a + b) * 0.5f;
+
+                  if (IsUnder(Orgs[i] + Dirs[i] * m))
+                    b = m;
+                  else
+                    a = m;
+                }
+              Ref[i] = b;
+              break;
+            }
+        }
+      }, 16);
+    QueryPerformanceCounter(&t1);
+    MarchTime = (DBL)(t1.QuadPart - t0.QuadPart) * 1000 / Freq.QuadPart;
+
+    /* Exact hit before marched one is peak grazed between march points, it is checked to be on ground only */
+    INT NumOfHits = 0, NumOfGrazes = 0, Mismatches = 0;
+    FLT MaxErrT = 0, MaxErrHeight = 0;
+
+    for (INT i = 0; i < NumOfRays; i++)
+    {
+      if (Res[i] < 0 && Ref[i] < 0)
+        continue;
+      if (Res[i] < 0 || (Ref[i] >= 0 && Res[i] > Ref[i] + TolT))
+      {
+        Mismatches++;
+        continue;
+      }
+      NumOfHits++;
+
+      /* Hit point is never above ground (it is under ground for rays starting or entering map under it) */
+      vec3 P = Orgs[i] + Dirs[i] * Res[i];
+      FLT ErrHeight = P[1] - F.GetHeight(P[0], P[2]);
+
+      if (Ref[i] < 0 || Res[i] < Ref[i] - TolT)
+        NumOfGrazes++, ErrHeight = fabs(ErrHeight);
+      else
+      {
+        FLT ErrT = !(P - (Orgs[i] + Dirs[i] * Ref[i]));
+
+        MaxErrT = mth::Max(MaxErrT, ErrT);
+        Mismatches += ErrT > TolT;
+        ErrHeight = mth::Max(ErrHeight, 0.f);
+      }
+      MaxErrHeight = mth::Max(MaxErrHeight, ErrHeight);
+      Mismatches += ErrHeight > TolHeight;
+    }
+
+    CHAR Buf[300];
+
+    sprintf(Buf, "Heightfield: %i rays, intersect %.3f ms, march %.3f ms, %i hits (%i grazing), "
+      "max hit point error %g, max height error %g, %i mismatches\n", NumOfRays, TraceTime, MarchTime,
+      NumOfHits, NumOfGrazes, MaxErrT, MaxErrHeight, Mismatches);
+    OutputDebugString(Buf);
+    printf("%s", Buf);
+    return Mismatches == 0;
+  } /* End of 'heightfield::Test' function */
+
+  /* Sample height map function (bilinear, clamp to edge).
+   * ARGUMENTS:
+   *   - height map coordinates:
+   *       FLT U, V;
+   * RETURNS:
+   *   (FLT) height above origin.
+   */
+  FLT heightfield::Sample( FLT U, FLT V ) const
+  {
+    if (W == 0)
+      return 0;
+
+    FLT
+      x = mth::Span<FLT>(0, (FLT)(W - 1), U * W - 0.5f),
+      y = mth::Span<FLT>(0, (FLT)(H - 1), V * H - 0.5f);
+    INT
+      x0 = (INT)x, y0 = (INT)y,
+      x1 = x0 < W - 1 ? x0 + 1 : x0,
+      y1 = y0 < H - 1 ? y0 + 1 : y0;
+    FLT
+      sx = x - x0,
+      sy = y - y0;
+
+    return
+      (Heights[y0 * W + x0] * (1 - sx) + Heights[y0 * W + x1] * sx) * (1 - sy) +
+      (Heights[y1 * W + x0] * (1 - sx) + Heights[y1 * W + x1] * sx) * sy;
+  } /* End of 'heightfield::Sample' function */
+
+  /* Get normal function.
+   * ARGUMENTS:
+   *   - world space point:
+   *       FLT X, Z;
+   * RETURNS:
+   *   (vec3) unit normal.
+   */
+  vec3 heightfield::GetNormal( FLT X, FLT Z ) const
+  {
+    if (W == 0)
+      return vec3(0, 1, 0);
+
+    FLT
+      x = mth::Span<FLT>(0, (FLT)(W - 1), (Z - Origin[2]) / Size * W - 0.5f),
+      y = mth::Span<FLT>(0, (FLT)(H - 1), (X - Origin[0]) / Size * H - 0.5f);
+    INT
+      x0 = (INT)x, y0 = (INT)y,
+      x1 = x0 < W - 1 ? x0 + 1 : x0,
+      y1 = y0 < H - 1 ? y0 + 1 : y0;
+    FLT
+      sx = x - x0,
+      sy = y - y0;
+
+    return
+      ((Normals[y0 * W + x0] * (1 - sx) + Normals[y0 * W + x1] * sx) * (1 - sy) +
+       (Normals[y1 * W + x0] * (1 - sx) + Normals[y1 * W + x1] * sx) * sy).Normalizing();
+  } /* End of 'heightfield::GetNormal' function */
+
+  /* Get heights of point set function (4 points per SSE step).
+   * ARGUMENTS:
+   *   - world space points:
+   *       const FLT *X, *Z;
+   *   - world space heights to fill:
+   *       FLT *Res;
+   *   - number of points:
+   *       size_t Count;
+   * RETURNS: None.
+   */
+  VOID heightfield::GetHeights( const FLT *X, const FLT *Z, FLT *Res, size_t Count ) const
+  {
+    size_t i = 0;
+
+    if (W == 0)
+    {
+      for (; i < Count; i++)
+        Res[i] = Origin[1];
+      return;
+    }
+
+    const __m128
+      ScaleU = _mm_set1_ps(W / Size), ScaleV = _mm_set1_ps(H / Size),
+      OrgU = _mm_set1_ps(Origin[2]), OrgV = _mm_set1_ps(Origin[0]),
+      MaxU = _mm_set1_ps((FLT)(W - 1)), MaxV = _mm_set1_ps((FLT)(H - 1)),
+      Half = _mm_set1_ps(0.5f), Zero = _mm_setzero_ps(), One = _mm_set1_ps(1),
+      OrgY = _mm_set1_ps(Origin[1]);
+
+    for (; i + 4 <= Count; i += 4)
+    {
+      __m128
+        u = _mm_min_ps(_mm_max_ps(_mm_sub_ps(_mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(Z + i), OrgU), ScaleU), Half), Zero), MaxU),
+        v = _mm_min_ps(_mm_max_ps(_mm_sub_ps(_mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(X + i), OrgV), ScaleV), Half), Zero), MaxV);
+      __m128i
+        x0 = _mm_cvttps_epi32(u),
+        y0 = _mm_cvttps_epi32(v);
+      __m128
+        sx = _mm_sub_ps(u, _mm_cvtepi32_ps(x0)),
+        sy = _mm_sub_ps(v, _mm_cvtepi32_ps(y0));
+      alignas(16) INT Xs[4], Ys[4];
+      alignas(16) FLT H00[4], H01[4], H10[4], H11[4];
+
+      /* SSE2 has no gather */
+      _mm_store_si128((__m128i *)Xs, x0);
+      _mm_store_si128((__m128i *)Ys, y0);
+      for (INT k = 0; k < 4; k++)
+      {
+        INT
+          r0 = Ys[k] * W,
+          r1 = Ys[k] < H - 1 ? r0 + W : r0,
+          c1 = Xs[k] < W - 1 ? Xs[k] + 1 : Xs[k];
+
+        H00[k] = Heights[r0 + Xs[k]];
+        H01[k] = Heights[r0 + c1];
+        H10[k] = Heights[r1 + Xs[k]];
+        H11[k] = Heights[r1 + c1];
+      }
+
+      __m128
+        isx = _mm_sub_ps(One, sx),
+        h0 = _mm_add_ps(_mm_mul_ps(_mm_load_ps(H00), isx), _mm_mul_ps(_mm_load_ps(H01), sx)),
+        h1 = _mm_add_ps(_mm_mul_ps(_mm_load_ps(H10), isx), _mm_mul_ps(_mm_load_ps(H11), sx)),
+        h = _mm_add_ps(_mm_mul_ps(h0, _mm_sub_ps(One, sy)), _mm_mul_ps(h1, sy));
+
+      _mm_storeu_ps(Res + i, _mm_add_ps(h, OrgY));
+    }
+    for (; i < Count; i++)
+      Res[i] = GetHeight(X[i], Z[i]);
+  } /* End of 'heightfield::GetHeights' function */
+} /* end of 'digl' namespace */
+
+/* END OF 'heightfield.cpp' FILE */
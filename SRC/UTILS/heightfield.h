@@ -0,0 +1,214 @@
+/***************************************************************
+ * Copyright (C) 2020
+ *    Computer Graphics Support Group of 30 Phys-Math Gymnasium
+ ***************************************************************/
+
+/* FILE NAME   : heightfield.h
+ * PURPOSE     : Height map CPU cache header file.
+ * PROGRAMMER  : Dmitriy Vlasov.
+ * LAST UPDATE : 19.10.2020
+ * NOTE        : Namespace 'digl'.
+ *
+ *   Height map (red channel) is kept on CPU in world units, normals
+ *   are baked once (in parallel) and uploaded as texture, so shaders
+ *   make one fetch instead of rebuilding normal from neighbour texels.
+ *   Height map U runs along world Z, V along world X (as in landscape
+ *   shaders), both textures clamp to edge like CPU queries.
+ *
+ *   Rays are traced by min/max pyramid of cells between texel centers
+ *   (maximum mipmap traversal): subtree is skipped when ray is above its
+ *   maximum, cell is hit exactly (ray height minus bilinear height is
+ *   quadratic in ray parameter). Half texel border (clamped heights) is
+ *   not hit by rays.
+ *
+ * No part of this file may be changed without agreement of
+ * Computer Graphics Support Group of 30 Phys-Math Gymnasium.
+ */
+
+#ifndef __HEIGHTFIELD_H_
+#define __HEIGHTFIELD_H_
+
+/* Includes */
+#include "../def.h"
+#include "../ANIM/RENDER/RESOURCES/texture.h"
+#include <string>
+#include <vector>
+
+/* Animation project namespace */
+namespace digl
+{
+  /* Height field representation class */
+  class heightfield
+  {
+  public:
+    std::string Name;           // Height map file name
+    INT W = 0, H = 0;           // Height map size (zero for flat field)
+    vec3 Origin;                // World space corner of height map square
+    FLT Size = 0, Height = 0;   // World space square side and height scale
+    std::vector<FLT> Heights;   // Heights above origin (row along V)
+    std::vector<vec3> Normals;  // Baked normals
+    texture
+      *HeightTex = nullptr,     // Height map texture (height in red channel)
+      *NormalTex = nullptr;     // Normal texture (normal * 0.5 + 0.5 in RGB)
+
+    /* Min/max pyramid level (level 0 cell is square between 4 texel centers) */
+    struct level
+    {
+      INT W, H;                 // Number of cells
+      std::vector<FLT> Min, Max; // Cell height range
+    }; /* End of 'level' struct */
+
+    std::vector<level> Levels;  // Pyramid levels (last one has 1 cell)
+
+  private:
+    /* Build min/max pyramid function.
+     * ARGUMENTS: None.
+     * RETURNS: None.
+     */
+    VOID BuildLevels( VOID );
+
+    /* Trace ray in height map space function.
+     * ARGUMENTS:
+     *   - ray origin and direction (cell units along X, Y, height units along Z):
+     *       const FLT *Org, *Dir;
+     *   - ray parameter range:
+     *       FLT T0, T1;
+     *   - any hit is enough flag:
+     *       BOOL IsAny;
+     * RETURNS:
+     *   (FLT) hit ray parameter (-1 if none).
+     */
+    FLT Trace( const FLT *Org, const FLT *Dir, FLT T0, FLT T1, BOOL IsAny ) const;
+
+    /* Trace ray in pyramid node function.
+     * ARGUMENTS:
+     *   - pyramid level and node cell:
+     *       INT Level, X, Y;
+     *   - ray origin and direction (cell units along X, Y, height units along Z):
+     *       const FLT *Org, *Dir;
+     *   - ray parameter range in node:
+     *       FLT T0, T1;
+     *   - any hit is enough flag:
+     *       BOOL IsAny;
+     * RETURNS:
+     *   (FLT) hit ray parameter (-1 if none).
+     */
+    FLT TraceNode( INT Level, INT X, INT Y, const FLT *Org, const FLT *Dir, FLT T0, FLT T1, BOOL IsAny ) const;
+
+    /* Height field without textures constructor function (for headless check).
+     * ARGUMENTS: None.
+     */
+    heightfield( VOID )
+    {
+    } /* End of 'heightfield' function */
+
+  public:
+
+    /* Height field constructor function.
+     * ARGUMENTS:
+     *   - height map file name (empty or missing file for flat field):
+     *       const std::string &FileName;
+     *   - world space corner of height map square, its side and height scale:
+     *       const vec3 &InOrigin;
+     *       FLT InSize, InHeight;
+     */
+    heightfield( const std::string &FileName, const vec3 &InOrigin, FLT InSize, FLT InHeight );
+
+    /* Sample height map function (bilinear, clamp to edge).
+     * ARGUMENTS:
+     *   - height map coordinates:
+     *       FLT U, V;
+     * RETURNS:
+     *   (FLT) height above origin.
+     */
+    FLT Sample( FLT U, FLT V ) const;
+
+    /* Get height function.
+     * ARGUMENTS:
+     *   - world space point:
+     *       FLT X, Z;
+     * RETURNS:
+     *   (FLT) world space height.
+     */
+    FLT GetHeight( FLT X, FLT Z ) const
+    {
+      if (W == 0)
+        return Origin[1];
+      return Origin[1] + Sample((Z - Origin[2]) / Size, (X - Origin[0]) / Size);
+    } /* End of 'GetHeight' function */
+
+    /* Get normal function.
+     * ARGUMENTS:
+     *   - world space point:
+     *       FLT X, Z;
+     * RETURNS:
+     *   (vec3) unit normal.
+     */
+    vec3 GetNormal( FLT X, FLT Z ) const;
+
+    /* Get heights of point set function (4 points per SSE step).
+     * ARGUMENTS:
+     *   - world space points:
+     *       const FLT *X, *Z;
+     *   - world space heights to fill:
+     *       FLT *Res;
+     *   - number of points:
+     *       size_t Count;
+     * RETURNS: None.
+     */
+    VOID GetHeights( const FLT *X, const FLT *Z, FLT *Res, size_t Count ) const;
+
+    /* Find first ray hit function.
+     * ARGUMENTS:
+     *   - world space ray origin and direction:
+     *       const vec3 &Org, &Dir;
+     *   - maximal ray parameter:
+     *       FLT MaxT;
+     *   - hit ray parameter:
+     *       FLT &T;
+     * RETURNS:
+     *   (BOOL) TRUE if ground is hit in [0, MaxT] (origin under ground gives 0).
+     */
+    BOOL Intersect( const vec3 &Org, const vec3 &Dir, FLT MaxT, FLT &T ) const;
+
+    /* Check ray segment goes under ground function (line of sight).
+     * ARGUMENTS:
+     *   - world space ray origin and direction:
+     *       const vec3 &Org, &Dir;
+     *   - maximal ray parameter:
+     *       FLT MaxT;
+     * RETURNS:
+     *   (BOOL) TRUE if ground is hit in [0, MaxT].
+     */
+    BOOL IsOccluded( const vec3 &Org, const vec3 &Dir, FLT MaxT ) const;
+
+    /* Find first hits of ray set function (rays are traced in parallel).
+     * ARGUMENTS:
+     *   - world space ray origins and directions:
+     *       const vec3 *Orgs, *Dirs;
+     *   - maximal ray parameter:
+     *       FLT MaxT;
+     *   - hit ray parameters to fill (-1 for miss):
+     *       FLT *Res;
+     *   - number of rays:
+     *       size_t Count;
+     * RETURNS: None.
+     */
+    VOID Intersect( const vec3 *Orgs, const vec3 *Dirs, FLT MaxT, FLT *Res, size_t Count ) const;
+
+    /* Headless check of 'Intersect' against fine fixed step ray march function.
+     * Random rays are traced over rough procedural height map, hit
+     * parameters and hit points are compared with marched ones.
+     * ARGUMENTS:
+     *   - number of rays:
+     *       INT NumOfRays;
+     * RETURNS:
+     *   (BOOL) TRUE if all results match.
+     */
+    static BOOL Test( INT NumOfRays );
+  }; /* End of 'heightfield' class */
+} /* end of 'digl' namespace */
+
+#endif /* __HEIGHTFIELD_H_ */
+
+/* END OF 'heightfield.h' FILE */
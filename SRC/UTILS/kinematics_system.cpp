@@ -0,0 +1,215 @@
+/***************************************************************
+ * Copyright (C) 2020
+ *    Computer Graphics Support Group of 30 Phys-Math Gymnasium
+ ***************************************************************/
+
+/* FILE NAME   : kinematics_system.cpp
+ * PURPOSE     : Batched kinematics file.
+ * PROGRAMMER  : Dmitriy Vlasov.
+ * LAST UPDATE : 19.10.2020
+ * NOTE        : Namespace 'digl'.
+ *
+ * No part of this file may be changed without agreement of
+ * Computer Graphics Support Group of 30 Phys-Math Gymnasium.
+ */
+
+/* Includes */
+#include "parallel.h"
+#include "rng.h"
+#include "kinematics_system.h"
+
+#include <cmath>
+#include <cstdio>
+
+/* Animation project namespace */
+namespace digl
+{
+  /* Add scalar body function.
+   * ARGUMENTS:
+   *   - start value and speed range:
+   *       FLT StartValue, SpeedMin, SpeedMax;
+   *   - start speed and acceleration:
+   *       FLT Speed, Accel;
+   * RETURNS:
+   *   (INT) body index.
+   */
+  INT kinematics_system::AddScalar( FLT StartValue, FLT SpeedMin, FLT SpeedMax, FLT Speed, FLT Accel )
+  {
+    Scalars.Value.push_back(StartValue);
+    Scalars.Speed.push_back(Speed);
+    Scalars.Accel.push_back(Accel);
+    Scalars.SpeedMin.push_back(SpeedMin);
+    Scalars.SpeedMax.push_back(SpeedMax);
+    return (INT)Scalars.Value.size() - 1;
+  } /* End of 'kinematics_system::AddScalar' function */
+
+  /* Add vector body function.
+   * ARGUMENTS:
+   *   - start value:
+   *       const vec3 &StartValue;
+   *   - speed length range:
+   *       FLT SpeedMin, SpeedMax;
+   *   - start speed and acceleration:
+   *       const vec3 &Speed, &Accel;
+   * RETURNS:
+   *   (INT) body index.
+   */
+  INT kinematics_system::AddVector( const vec3 &StartValue, FLT SpeedMin, FLT SpeedMax,
+                                    const vec3 &Speed, const vec3 &Accel )
+  {
+    Vectors.X.push_back(StartValue[0]);
+    Vectors.Y.push_back(StartValue[1]);
+    Vectors.Z.push_back(StartValue[2]);
+    Vectors.SpeedX.push_back(Speed[0]);
+    Vectors.SpeedY.push_back(Speed[1]);
+    Vectors.SpeedZ.push_back(Speed[2]);
+    Vectors.AccelX.push_back(Accel[0]);
+    Vectors.AccelY.push_back(Accel[1]);
+    Vectors.AccelZ.push_back(Accel[2]);
+    Vectors.SpeedMin.push_back(SpeedMin);
+    Vectors.SpeedMax.push_back(SpeedMax);
+    return (INT)Vectors.X.size() - 1;
+  } /* End of 'kinematics_system::AddVector' function */
+
+  /* Advance all bodies function.
+   * ARGUMENTS:
+   *   - delta time:
+   *       FLT DeltaTime;
+   * RETURNS: None.
+   */
+  VOID kinematics_system::Compute( FLT DeltaTime )
+  {
+    FLT HalfDt = DeltaTime * 0.5f;
+
+    parallel::For(Scalars.Value.size(),
+      [&]( size_t Begin, size_t End, INT )
+      {
+        FLT
+          *Value = Scalars.Value.data(), *Speed = Scalars.Speed.data(), *Accel = Scalars.Accel.data(),
+          *Min = Scalars.SpeedMin.data(), *Max = Scalars.SpeedMax.data();
+
+        for (size_t i = Begin; i < End; i++)
+        {
+          FLT v = Speed[i], a = Accel[i];
+          BOOL IsBound = v == Max[i] || v == Min[i];
+
+          Value[i] += (IsBound ? v : v + a * HalfDt) * DeltaTime;
+          Speed[i] = mth::Span(Min[i], Max[i], v + a * DeltaTime);
+        }
+      }, MinBlock);
+
+    parallel::For(Vectors.X.size(),
+      [&]( size_t Begin, size_t End, INT )
+      {
+        vector_bodies &B = Vectors;
+
+        for (size_t i = Begin; i < End; i++)
+        {
+          FLT
+            vx = B.SpeedX[i], vy = B.SpeedY[i], vz = B.SpeedZ[i],
+            ax = B.AccelX[i], ay = B.AccelY[i], az = B.AccelZ[i],
+            Len = sqrt(vx * vx + vy * vy + vz * vz),
+            h = IsClamped(Len, B.SpeedMin[i], B.SpeedMax[i]) ? 0 : HalfDt;
+
+          B.X[i] += (vx + ax * h) * DeltaTime;
+          B.Y[i] += (vy + ay * h) * DeltaTime;
+          B.Z[i] += (vz + az * h) * DeltaTime;
+          vx += ax * DeltaTime;
+          vy += ay * DeltaTime;
+          vz += az * DeltaTime;
+          Len = sqrt(vx * vx + vy * vy + vz * vz);
+
+          FLT Scale =
+            Len == 0 ? 1 :
+            Len > B.SpeedMax[i] ? B.SpeedMax[i] / Len :
+            Len < B.SpeedMin[i] ? B.SpeedMin[i] / Len : 1;
+
+          B.SpeedX[i] = vx * Scale;
+          B.SpeedY[i] = vy * Scale;
+          B.SpeedZ[i] = vz * Scale;
+        }
+      }, MinBlock);
+  } /* End of 'kinematics_system::Compute' function */
+
+  /* Headless benchmark of batch step against scalar 'Step' calls function.
+   * ARGUMENTS:
+   *   - number of bodies of each kind and number of steps:
+   *       INT NumOfBodies, NumOfSteps;
+   * RETURNS:
+   *   (BOOL) TRUE if batch and scalar results match.
+   */
+  BOOL kinematics_system::Benchmark( INT NumOfBodies, INT NumOfSteps )
+  {
+    const FLT DeltaTime = 1.0f / 60;
+    kinematics_system Batch;
+    std::vector<FLT> Value, Speed;
+    std::vector<vec3> VecValue, VecSpeed;
+    rng Rnd(30, 0);
+
+    /* Every 8th body starts at rest with zero acceleration (speed below minimum with no direction) */
+    for (INT i = 0; i < NumOfBodies; i++)
+    {
+      BOOL IsRest = i % 8 == 0;
+      FLT Min = Rnd.Rnd0() * 5, Max = Min + Rnd.Rnd0() * 20;
+
+      Batch.AddScalar(Rnd.Rnd1() * 100, -Max, Max, IsRest ? 0 : Rnd.Rnd1() * Max, IsRest ? 0 : Rnd.Rnd1() * 10);
+      Batch.AddVector(Rnd.Vec1() * 100, Min, Max, IsRest ? vec3(0) : Rnd.Vec1() * Max,
+                      IsRest ? vec3(0) : Rnd.Vec1() * 10);
+    }
+    Value = Batch.Scalars.Value, Speed = Batch.Scalars.Speed;
+    VecValue.resize(NumOfBodies), VecSpeed.resize(NumOfBodies);
+    for (INT i = 0; i < NumOfBodies; i++)
+      VecValue[i] = Batch.GetValue(i), VecSpeed[i] = Batch.GetSpeed(i);
+
+    LARGE_INTEGER Freq, t0, t1;
+    DBL BatchTime, ScalarTime;
+
+    QueryPerformanceFrequency(&Freq);
+    QueryPerformanceCounter(&t0);
+    for (INT s = 0; s < NumOfSteps; s++)
+      Batch.Compute(DeltaTime);
+    QueryPerformanceCounter(&t1);
+    BatchTime = (DBL)(t1.QuadPart - t0.QuadPart) * 1000 / Freq.QuadPart / mth::Max(NumOfSteps, 1);
+
+    const scalar_bodies &S = Batch.Scalars;
+    const vector_bodies &V = Batch.Vectors;
+
+    QueryPerformanceCounter(&t0);
+    for (INT s = 0; s < NumOfSteps; s++)
+      for (INT i = 0; i < NumOfBodies; i++)
+      {
+        Step(Value[i], Speed[i], S.Accel[i], S.SpeedMin[i], S.SpeedMax[i], DeltaTime);
+        Step(VecValue[i], VecSpeed[i], vec3(V.AccelX[i], V.AccelY[i], V.AccelZ[i]),
+             V.SpeedMin[i], V.SpeedMax[i], DeltaTime);
+      }
+    QueryPerformanceCounter(&t1);
+    ScalarTime = (DBL)(t1.QuadPart - t0.QuadPart) * 1000 / Freq.QuadPart / mth::Max(NumOfSteps, 1);
+
+    /* Results may differ by rounding only (compiler may fuse multiply-adds differently) */
+    INT Mismatches = 0;
+    auto Check = []( FLT A, FLT B )
+    {
+      return fabs(A - B) <= 1e-4f * (1 + fabs(B));
+    };
+
+    for (INT i = 0; i < NumOfBodies; i++)
+    {
+      vec3 P = Batch.GetValue(i), W = Batch.GetSpeed(i);
+      BOOL IsSame = Check(S.Value[i], Value[i]) && Check(S.Speed[i], Speed[i]);
+
+      for (INT k = 0; k < 3; k++)
+        IsSame = IsSame && Check(P[k], VecValue[i][k]) && Check(W[k], VecSpeed[i][k]);
+      Mismatches += !IsSame;
+    }
+
+    CHAR Buf[300];
+
+    sprintf(Buf, "Kinematics: %i scalar and %i vector bodies, %i steps, batch %.3f ms, scalar %.3f ms per step, "
+      "%i mismatches\n", NumOfBodies, NumOfBodies, NumOfSteps, BatchTime, ScalarTime, Mismatches);
+    OutputDebugString(Buf);
+    printf("%s", Buf);
+    return Mismatches == 0;
+  } /* End of 'kinematics_system::Benchmark' function */
+} /* end of 'digl' namespace */
+
+/* END OF 'kinematics_system.cpp' FILE */
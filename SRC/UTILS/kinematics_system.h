@@ -0,0 +1,226 @@
+/***************************************************************
+ * Copyright (C) 2020
+ *    Computer Graphics Support Group of 30 Phys-Math Gymnasium
+ ***************************************************************/
+
+/* FILE NAME   : kinematics_system.h
+ * PURPOSE     : Batched kinematics header file.
+ * PROGRAMMER  : Dmitriy Vlasov.
+ * LAST UPDATE : 19.10.2020
+ * NOTE        : Namespace 'digl'.
+ *
+ *   Scalar and vector bodies are kept in structure of arrays and are
+ *   advanced together by one explicit delta time (no animation clock
+ *   access, so system works without 'anim' instance). Step is same as
+ *   'kinematics::Compute' and 'kinematicsVec::Compute' (both use
+ *   'Step' functions of this class).
+ *
+ * No part of this file may be changed without agreement of
+ * Computer Graphics Support Group of 30 Phys-Math Gymnasium.
+ */
+
+#ifndef __KINEMATICS_SYSTEM_H_
+#define __KINEMATICS_SYSTEM_H_
+
+#include "../def.h"
+
+#include <vector>
+
+/* Animation project namespace */
+namespace digl
+{
+  /* Batched kinematics representation type */
+  class kinematics_system
+  {
+  public:
+    /* Minimal number of bodies in one thread block */
+    static const size_t MinBlock = 1 << 16;
+
+    /* Scalar bodies */
+    struct scalar_bodies
+    {
+      std::vector<FLT>
+        Value, Speed, Accel,   // Current value, speed and acceleration
+        SpeedMin, SpeedMax;    // Speed range
+    } Scalars;
+
+    /* Vector bodies */
+    struct vector_bodies
+    {
+      std::vector<FLT>
+        X, Y, Z,                       // Current value
+        SpeedX, SpeedY, SpeedZ,        // Current speed
+        AccelX, AccelY, AccelZ,        // Current acceleration
+        SpeedMin, SpeedMax;            // Speed length range
+    } Vectors;
+
+    /* Scalar step function.
+     * ARGUMENTS:
+     *   - value and speed to change:
+     *       FLT &Value, &Speed;
+     *   - acceleration and speed range:
+     *       FLT Accel, SpeedMin, SpeedMax;
+     *   - delta time:
+     *       FLT DeltaTime;
+     * RETURNS:
+     *   (FLT) value change.
+     */
+    static FLT Step( FLT &Value, FLT &Speed, FLT Accel, FLT SpeedMin, FLT SpeedMax, FLT DeltaTime )
+    {
+      FLT Delta;
+
+      if (Speed == SpeedMax || Speed == SpeedMin)
+        Delta = Speed * DeltaTime;
+      else
+        Delta = (Speed + Accel * 0.5f * DeltaTime) * DeltaTime;
+      Value += Delta;
+      Speed = mth::Span(SpeedMin, SpeedMax, Speed + Accel * DeltaTime);
+      return Delta;
+    } /* End of 'Step' function */
+
+    /* Check speed length is on speed range bound function.
+     * Speed scaled to bound has its length only close to bound.
+     * ARGUMENTS:
+     *   - speed length and range:
+     *       FLT Len, SpeedMin, SpeedMax;
+     * RETURNS:
+     *   (BOOL) TRUE if speed is clamped.
+     */
+    static BOOL IsClamped( FLT Len, FLT SpeedMin, FLT SpeedMax )
+    {
+      return Len >= SpeedMax * (1 - 1e-5f) || Len <= SpeedMin * (1 + 1e-5f);
+    } /* End of 'IsClamped' function */
+
+    /* Vector step function.
+     * ARGUMENTS:
+     *   - value and speed to change:
+     *       vec3 &Value, &Speed;
+     *   - acceleration:
+     *       const vec3 &Accel;
+     *   - speed length range:
+     *       FLT SpeedMin, SpeedMax;
+     *   - delta time:
+     *       FLT DeltaTime;
+     * RETURNS:
+     *   (vec3) value change.
+     */
+    static vec3 Step( vec3 &Value, vec3 &Speed, const vec3 &Accel, FLT SpeedMin, FLT SpeedMax, FLT DeltaTime )
+    {
+      FLT Len = !Speed;
+      vec3 Delta;
+
+      if (IsClamped(Len, SpeedMin, SpeedMax))
+        Delta = Speed * DeltaTime;
+      else
+        Delta = (Speed + Accel * 0.5f * DeltaTime) * DeltaTime;
+      Value += Delta;
+      Speed = Speed + Accel * DeltaTime;
+      Len = !Speed;
+
+      /* Zero speed has no direction to scale along (kept zero as in 'Compute') */
+      FLT Scale =
+        Len == 0 ? 1 :
+        Len > SpeedMax ? SpeedMax / Len :
+        Len < SpeedMin ? SpeedMin / Len : 1;
+
+      Speed = Speed * Scale;
+      return Delta;
+    } /* End of 'Step' function */
+
+    /* Add scalar body function.
+     * ARGUMENTS:
+     *   - start value and speed range:
+     *       FLT StartValue, SpeedMin, SpeedMax;
+     *   - start speed and acceleration:
+     *       FLT Speed, Accel;
+     * RETURNS:
+     *   (INT) body index.
+     */
+    INT AddScalar( FLT StartValue, FLT SpeedMin, FLT SpeedMax, FLT Speed = 0, FLT Accel = 0 );
+
+    /* Add vector body function.
+     * ARGUMENTS:
+     *   - start value:
+     *       const vec3 &StartValue;
+     *   - speed length range:
+     *       FLT SpeedMin, SpeedMax;
+     *   - start speed and acceleration:
+     *       const vec3 &Speed, &Accel;
+     * RETURNS:
+     *   (INT) body index.
+     */
+    INT AddVector( const vec3 &StartValue, FLT SpeedMin, FLT SpeedMax,
+                   const vec3 &Speed = vec3(0), const vec3 &Accel = vec3(0) );
+
+    /* Get vector body value function.
+     * ARGUMENTS:
+     *   - body index:
+     *       INT Body;
+     * RETURNS:
+     *   (vec3) value.
+     */
+    vec3 GetValue( INT Body ) const
+    {
+      return vec3(Vectors.X[Body], Vectors.Y[Body], Vectors.Z[Body]);
+    } /* End of 'GetValue' function */
+
+    /* Get vector body speed function.
+     * ARGUMENTS:
+     *   - body index:
+     *       INT Body;
+     * RETURNS:
+     *   (vec3) speed.
+     */
+    vec3 GetSpeed( INT Body ) const
+    {
+      return vec3(Vectors.SpeedX[Body], Vectors.SpeedY[Body], Vectors.SpeedZ[Body]);
+    } /* End of 'GetSpeed' function */
+
+    /* Set vector body value function.
+     * ARGUMENTS:
+     *   - body index:
+     *       INT Body;
+     *   - new value:
+     *       const vec3 &V;
+     * RETURNS: None.
+     */
+    VOID SetValue( INT Body, const vec3 &V )
+    {
+      Vectors.X[Body] = V[0], Vectors.Y[Body] = V[1], Vectors.Z[Body] = V[2];
+    } /* End of 'SetValue' function */
+
+    /* Set vector body acceleration function.
+     * ARGUMENTS:
+     *   - body index:
+     *       INT Body;
+     *   - new acceleration:
+     *       const vec3 &A;
+     * RETURNS: None.
+     */
+    VOID SetAccel( INT Body, const vec3 &A )
+    {
+      Vectors.AccelX[Body] = A[0], Vectors.AccelY[Body] = A[1], Vectors.AccelZ[Body] = A[2];
+    } /* End of 'SetAccel' function */
+
+    /* Advance all bodies function.
+     * ARGUMENTS:
+     *   - delta time:
+     *       FLT DeltaTime;
+     * RETURNS: None.
+     */
+    VOID Compute( FLT DeltaTime );
+
+    /* Headless benchmark of batch step against scalar 'Step' calls function.
+     * ARGUMENTS:
+     *   - number of bodies of each kind and number of steps:
+     *       INT NumOfBodies, NumOfSteps;
+     * RETURNS:
+     *   (BOOL) TRUE if batch and scalar results match.
+     */
+    static BOOL Benchmark( INT NumOfBodies, INT NumOfSteps );
+  }; /* End of 'kinematics_system' class */
+} /* end of 'digl' namespace */
+
+#endif /* __KINEMATICS_SYSTEM_H_ */
+
+/* END OF 'kinematics_system.h' FILE */
@@ -0,0 +1,499 @@
+/***************************************************************
+ * Copyright (C) 2020
+ *    Computer Graphics Support Group of 30 Phys-Math Gymnasium
+ ***************************************************************/
+
+/* FILE NAME   : neighbour_grid.cpp
+ * PURPOSE     : Uniform grid neighbour index file.
+ * PROGRAMMER  : Dmitriy Vlasov.
+ * LAST UPDATE : 19.10.2020
+ * NOTE        : Namespace 'digl'.
+ *
+ * No part of this file may be changed without agreement of
+ * Computer Graphics Support Group of 30 Phys-Math Gymnasium.
+ */
+
+/* Includes */
+#include "parallel.h"
+#include "rng.h"
+#include "neighbour_grid.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <emmintrin.h>
+
+/* Animation project namespace */
+namespace digl
+{
+  /* Build grid function (parallel).
+   * ARGUMENTS:
+   *   - point positions (structure of arrays):
+   *       const FLT *PX, *PY, *PZ;
+   *   - number of points:
+   *       size_t Count;
+   * RETURNS: None.
+   */
+  VOID neighbour_grid::Build( const FLT *PX, const FLT *PY, const FLT *PZ, size_t Count )
+  {
+    X.resize(Count);
+    Y.resize(Count);
+    Z.resize(Count);
+    Index.resize(Count);
+    Cells.resize(Count);
+    Tmp.resize(Count);
+    if (Count == 0)
+    {
+      NX = NY = NZ = 0;
+      CellStart.assign(1, 0);
+      return;
+    }
+
+    /* Bounding box by blocks */
+    INT NumOfBlocks = parallel::NumOfBlocks(Count, MinBlock);
+    std::vector<FLT> Bounds((size_t)NumOfBlocks * 6);
+
+    parallel::For(Count,
+      [&]( size_t Begin, size_t End, INT Block )
+      {
+        FLT *B = &Bounds[(size_t)Block * 6];
+
+        B[0] = B[3] = PX[Begin];
+        B[1] = B[4] = PY[Begin];
+        B[2] = B[5] = PZ[Begin];
+        for (size_t i = Begin + 1; i < End; i++)
+        {
+          B[0] = mth::Min(B[0], PX[i]), B[3] = mth::Max(B[3], PX[i]);
+          B[1] = mth::Min(B[1], PY[i]), B[4] = mth::Max(B[4], PY[i]);
+          B[2] = mth::Min(B[2], PZ[i]), B[5] = mth::Max(B[5], PZ[i]);
+        }
+      }, MinBlock);
+
+    vec3 Min(Bounds[0], Bounds[1], Bounds[2]), Max(Bounds[3], Bounds[4], Bounds[5]);
+
+    for (INT b = 1; b < NumOfBlocks; b++)
+      for (INT k = 0; k < 3; k++)
+      {
+        Min[k] = mth::Min(Min[k], Bounds[(size_t)b * 6 + k]);
+        Max[k] = mth::Max(Max[k], Bounds[(size_t)b * 6 + 3 + k]);
+      }
+
+    /* Grid size: no more than twice as many cells as points */
+    DBL MaxCells = mth::Max(2.0 * Count, 64.0);
+
+    Origin = Min;
+    for (Step = CellSize > 0 ? CellSize : 1; ; Step *= 1.25f)
+    {
+      NX = (INT)((Max[0] - Min[0]) / Step) + 1;
+      NY = (INT)((Max[1] - Min[1]) / Step) + 1;
+      NZ = (INT)((Max[2] - Min[2]) / Step) + 1;
+      if ((DBL)NX * NY * NZ <= MaxCells)
+        break;
+    }
+
+    /* Coarse cell ranges (no more than 256) */
+    UINT NumOfCells = (UINT)NX * NY * NZ, Shift = 0;
+
+    while (((NumOfCells - 1) >> Shift) >= 256)
+      Shift++;
+
+    UINT NumOfBuckets = ((NumOfCells - 1) >> Shift) + 1;
+    std::vector<UINT> Hist((size_t)NumOfBlocks * NumOfBuckets), BucketStart(NumOfBuckets + 1);
+
+    /* Point cells and block histograms of coarse ranges */
+    parallel::For(Count,
+      [&]( size_t Begin, size_t End, INT Block )
+      {
+        UINT *H = &Hist[(size_t)Block * NumOfBuckets];
+
+        memset(H, 0, sizeof(UINT) * NumOfBuckets);
+        for (size_t i = Begin; i < End; i++)
+        {
+          UINT c = ((UINT)GetCell(PZ[i], 2) * NY + GetCell(PY[i], 1)) * NX + GetCell(PX[i], 0);
+
+          Cells[i] = c;
+          H[c >> Shift]++;
+        }
+      }, MinBlock);
+
+    /* Block offsets: range major, block minor (keeps order stable) */
+    UINT Sum = 0;
+
+    for (UINT k = 0; k < NumOfBuckets; k++)
+    {
+      BucketStart[k] = Sum;
+      for (INT b = 0; b < NumOfBlocks; b++)
+      {
+        UINT &H = Hist[(size_t)b * NumOfBuckets + k], N = H;
+
+        H = Sum;
+        Sum += N;
+      }
+    }
+    BucketStart[NumOfBuckets] = Sum;
+
+    /* Block scatter */
+    parallel::For(Count,
+      [&]( size_t Begin, size_t End, INT Block )
+      {
+        UINT *H = &Hist[(size_t)Block * NumOfBuckets];
+
+        for (size_t i = Begin; i < End; i++)
+          Tmp[H[Cells[i] >> Shift]++] = (INT)i;
+      }, MinBlock);
+
+    /* Counting sort of coarse ranges by cells */
+    CellStart.resize((size_t)NumOfCells + 1);
+    parallel::For(NumOfBuckets,
+      [&]( size_t Begin, size_t End, INT )
+      {
+        std::vector<UINT> Pos((size_t)1 << Shift);
+
+        for (size_t k = Begin; k < End; k++)
+        {
+          UINT
+            c0 = (UINT)k << Shift,
+            n = mth::Min(NumOfCells - c0, 1u << Shift),
+            s = BucketStart[k];
+
+          memset(Pos.data(), 0, sizeof(UINT) * n);
+          for (UINT j = BucketStart[k]; j < BucketStart[k + 1]; j++)
+            Pos[Cells[Tmp[j]] - c0]++;
+          for (UINT c = 0; c < n; c++)
+          {
+            UINT N = Pos[c];
+
+            CellStart[c0 + c] = Pos[c] = s;
+            s += N;
+          }
+          for (UINT j = BucketStart[k]; j < BucketStart[k + 1]; j++)
+          {
+            INT i = Tmp[j];
+            UINT p = Pos[Cells[i] - c0]++;
+
+            Index[p] = i;
+            X[p] = PX[i];
+            Y[p] = PY[i];
+            Z[p] = PZ[i];
+          }
+        }
+      }, Count < MinBlock ? NumOfBuckets : 1);
+    CellStart[NumOfCells] = (UINT)Count;
+  } /* End of 'neighbour_grid::Build' function */
+
+  /* Find points within distance function.
+   * ARGUMENTS:
+   *   - point and distance:
+   *       const vec3 &P;
+   *       FLT R;
+   *   - original indices of found points to fill:
+   *       std::vector<INT> &Res;
+   * RETURNS:
+   *   (size_t) number of found points.
+   */
+  size_t neighbour_grid::Radius( const vec3 &P, FLT R, std::vector<INT> &Res ) const
+  {
+    const __m128
+      px = _mm_set1_ps(P[0]), py = _mm_set1_ps(P[1]), pz = _mm_set1_ps(P[2]),
+      r2 = _mm_set1_ps(R * R);
+
+    Res.clear();
+    WalkRuns(P, R,
+      [&]( size_t Begin, size_t End )
+      {
+        size_t i = Begin;
+
+        for (; i + 4 <= End; i += 4)
+        {
+          __m128
+            dx = _mm_sub_ps(_mm_loadu_ps(&X[i]), px),
+            dy = _mm_sub_ps(_mm_loadu_ps(&Y[i]), py),
+            dz = _mm_sub_ps(_mm_loadu_ps(&Z[i]), pz),
+            d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+          INT Mask = _mm_movemask_ps(_mm_cmple_ps(d2, r2));
+
+          for (INT k = 0; Mask != 0; k++, Mask >>= 1)
+            if (Mask & 1)
+              Res.push_back(Index[i + k]);
+        }
+        for (; i < End; i++)
+        {
+          FLT dx = X[i] - P[0], dy = Y[i] - P[1], dz = Z[i] - P[2];
+
+          if (dx * dx + dy * dy + dz * dz <= R * R)
+            Res.push_back(Index[i]);
+        }
+      });
+    return Res.size();
+  } /* End of 'neighbour_grid::Radius' function */
+
+  /* Find nearest points function.
+   * ARGUMENTS:
+   *   - point:
+   *       const vec3 &P;
+   *   - maximal number of points:
+   *       INT K;
+   *   - original indices of found points to fill (nearest first) and
+   *     their squared distances (nullptr if not needed):
+   *       INT *Res;
+   *       FLT *Dist2;
+   *   - original index of point to skip (-1 for none):
+   *       INT Skip;
+   * RETURNS:
+   *   (INT) number of found points.
+   */
+  INT neighbour_grid::Nearest( const vec3 &P, INT K, INT *Res, FLT *Dist2, INT Skip ) const
+  {
+    if (K <= 0 || Index.empty())
+      return 0;
+
+    FLT Local[64];
+    std::vector<FLT> Big;
+    FLT *D = Dist2 != nullptr ? Dist2 : K <= 64 ? Local : (Big.resize(K), Big.data());
+    INT n = 0;
+
+    /* Insert into sorted list (equal distances are ordered by index) */
+    auto Insert = [&]( FLT d, INT Id )
+    {
+      if (Id == Skip || (n == K && (d > D[K - 1] || (d == D[K - 1] && Id > Res[K - 1]))))
+        return;
+
+      INT j = n < K ? n++ : K - 1;
+
+      for (; j > 0 && (D[j - 1] > d || (D[j - 1] == d && Res[j - 1] > Id)); j--)
+        D[j] = D[j - 1], Res[j] = Res[j - 1];
+      D[j] = d;
+      Res[j] = Id;
+    };
+
+    /* Check sorted points range */
+    const __m128 px = _mm_set1_ps(P[0]), py = _mm_set1_ps(P[1]), pz = _mm_set1_ps(P[2]);
+    auto Check = [&]( size_t Begin, size_t End )
+    {
+      size_t i = Begin;
+
+      for (; i + 4 <= End; i += 4)
+      {
+        __m128
+          dx = _mm_sub_ps(_mm_loadu_ps(&X[i]), px),
+          dy = _mm_sub_ps(_mm_loadu_ps(&Y[i]), py),
+          dz = _mm_sub_ps(_mm_loadu_ps(&Z[i]), pz),
+          d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+        INT Mask = _mm_movemask_ps(_mm_cmple_ps(d2, _mm_set1_ps(n < K ? FLT_MAX : D[K - 1])));
+
+        if (Mask != 0)
+        {
+          alignas(16) FLT Ds[4];
+
+          _mm_store_ps(Ds, d2);
+          for (INT k = 0; Mask != 0; k++, Mask >>= 1)
+            if (Mask & 1)
+              Insert(Ds[k], Index[i + k]);
+        }
+      }
+      for (; i < End; i++)
+      {
+        FLT dx = X[i] - P[0], dy = Y[i] - P[1], dz = Z[i] - P[2];
+
+        Insert(dx * dx + dy * dy + dz * dz, Index[i]);
+      }
+    };
+
+    /* Rings of cells around point cell */
+    INT c[3] = {GetCell(P[0], 0), GetCell(P[1], 1), GetCell(P[2], 2)}, N[3] = {NX, NY, NZ};
+
+    for (INT r = 0; ; r++)
+    {
+      for (INT z = mth::Max(c[2] - r, 0); z <= mth::Min(c[2] + r, NZ - 1); z++)
+        for (INT y = mth::Max(c[1] - r, 0); y <= mth::Min(c[1] + r, NY - 1); y++)
+        {
+          size_t Row = ((size_t)z * NY + y) * NX;
+
+          if (abs(z - c[2]) == r || abs(y - c[1]) == r)
+          {
+            INT x0 = mth::Max(c[0] - r, 0), x1 = mth::Min(c[0] + r, NX - 1);
+
+            Check(CellStart[Row + x0], CellStart[Row + x1 + 1]);
+          }
+          else
+          {
+            if (c[0] - r >= 0)
+              Check(CellStart[Row + c[0] - r], CellStart[Row + c[0] - r + 1]);
+            if (c[0] + r < NX)
+              Check(CellStart[Row + c[0] + r], CellStart[Row + c[0] + r + 1]);
+          }
+        }
+
+      /* Distance to not checked cells */
+      FLT Bound = FLT_MAX;
+
+      for (INT k = 0; k < 3; k++)
+      {
+        if (c[k] - r > 0)
+          Bound = mth::Min(Bound, P[k] - (Origin[k] + (c[k] - r) * Step));
+        if (c[k] + r < N[k] - 1)
+          Bound = mth::Min(Bound, Origin[k] + (c[k] + r + 1) * Step - P[k]);
+      }
+      if (Bound == FLT_MAX || (n == K && D[K - 1] < Bound * Bound))
+        break;
+    }
+    return n;
+  } /* End of 'neighbour_grid::Nearest' function */
+
+  /* Find nearest points of set of points function (parallel).
+   * ARGUMENTS:
+   *   - query points (structure of arrays):
+   *       const FLT *QX, *QY, *QZ;
+   *   - number of query points:
+   *       size_t Count;
+   *   - maximal number of points per query:
+   *       INT K;
+   *   - 'K' original indices per query to fill (-1 for missing points):
+   *       INT *Res;
+   * RETURNS: None.
+   */
+  VOID neighbour_grid::Nearest( const FLT *QX, const FLT *QY, const FLT *QZ, size_t Count, INT K, INT *Res ) const
+  {
+    parallel::For(Count,
+      [&]( size_t Begin, size_t End, INT )
+      {
+        for (size_t i = Begin; i < End; i++)
+        {
+          INT *R = Res + i * K;
+
+          for (INT n = Nearest(vec3(QX[i], QY[i], QZ[i]), K, R); n < K; n++)
+            R[n] = -1;
+        }
+      }, MinBlock / 64);
+  } /* End of 'neighbour_grid::Nearest' function */
+
+  /* Headless benchmark function (points in 1 km wide and 100 m high box).
+   * ARGUMENTS:
+   *   - number of points and queries:
+   *       INT NumOfPoints, NumOfQueries;
+   * RETURNS:
+   *   (BOOL) TRUE if radius and nearest query results match brute force ones.
+   */
+  BOOL neighbour_grid::Benchmark( INT NumOfPoints, INT NumOfQueries )
+  {
+    NumOfPoints = mth::Max(NumOfPoints, 0);
+    NumOfQueries = mth::Max(NumOfQueries, 0);
+
+    LARGE_INTEGER Freq, t0, t1;
+    CHAR Buf[300];
+    auto Report = [&]( const CHAR *What, DBL Ms )
+    {
+      sprintf(Buf, "Neighbour grid: %s: %.3f ms\n", What, Ms);
+      OutputDebugString(Buf);
+      printf("%s", Buf);
+    };
+    auto Ms = [&]( VOID )
+    {
+      QueryPerformanceCounter(&t1);
+      return (DBL)(t1.QuadPart - t0.QuadPart) * 1000 / Freq.QuadPart;
+    };
+    const FLT R = 5;
+    const INT K = 8, NumOfBuilds = 10, NumOfSlow = mth::Min(NumOfQueries, 100);
+    rng Rnd(30, 0);
+    std::vector<FLT> PX(NumOfPoints), PY(NumOfPoints), PZ(NumOfPoints);
+    neighbour_grid G(R);
+
+    QueryPerformanceFrequency(&Freq);
+    for (INT i = 0; i < NumOfPoints; i++)
+    {
+      PX[i] = Rnd.Rnd1() * 500;
+      PY[i] = Rnd.Rnd0() * 100;
+      PZ[i] = Rnd.Rnd1() * 500;
+    }
+
+    /* Rebuilds (points move a bit every tick) */
+    DBL BuildTime = 0;
+
+    for (INT b = 0; b < NumOfBuilds; b++)
+    {
+      for (INT i = 0; i < NumOfPoints; i++)
+        PX[i] += 0.1f, PZ[i] -= 0.1f;
+      QueryPerformanceCounter(&t0);
+      G.Build(PX.data(), PY.data(), PZ.data(), NumOfPoints);
+      BuildTime += Ms();
+    }
+    Report("rebuild", BuildTime / NumOfBuilds);
+    sprintf(Buf, "Neighbour grid: %i points, %i x %i x %i cells of %.2f m\n", NumOfPoints, G.NX, G.NY, G.NZ, G.Step);
+    OutputDebugString(Buf);
+    printf("%s", Buf);
+
+    /* Queries around random points (random box points for empty grid) */
+    std::vector<FLT> QX(NumOfQueries), QY(NumOfQueries), QZ(NumOfQueries);
+    std::vector<INT> Found((size_t)NumOfQueries * K);
+    std::vector<size_t> BlockNeighbours(parallel::NumOfBlocks(NumOfQueries, MinBlock / 64));
+    size_t NumOfNeighbours = 0;
+
+    for (INT i = 0; i < NumOfQueries; i++)
+      if (NumOfPoints == 0)
+      {
+        QX[i] = Rnd.Rnd1() * 500;
+        QY[i] = Rnd.Rnd0() * 100;
+        QZ[i] = Rnd.Rnd1() * 500;
+      }
+      else
+      {
+        INT p = Rnd.Next() % NumOfPoints;
+
+        QX[i] = PX[p], QY[i] = PY[p], QZ[i] = PZ[p];
+      }
+    QueryPerformanceCounter(&t0);
+    parallel::For(NumOfQueries,
+      [&]( size_t Begin, size_t End, INT Block )
+      {
+        std::vector<INT> Res;
+
+        for (size_t i = Begin; i < End; i++)
+          BlockNeighbours[Block] += G.Radius(vec3(QX[i], QY[i], QZ[i]), R, Res);
+      }, MinBlock / 64);
+    Report("radius query", Ms() / mth::Max(NumOfQueries, 1));
+    for (size_t n : BlockNeighbours)
+      NumOfNeighbours += n;
+    QueryPerformanceCounter(&t0);
+    G.Nearest(QX.data(), QY.data(), QZ.data(), NumOfQueries, K, Found.data());
+    Report("8 nearest query", Ms() / mth::Max(NumOfQueries, 1));
+
+    /* Brute force check */
+    INT Mismatches = 0;
+    std::vector<INT> Res;
+    std::vector<std::pair<FLT, INT>> All(NumOfPoints);
+
+    QueryPerformanceCounter(&t0);
+    for (INT q = 0; q < NumOfSlow; q++)
+    {
+      size_t Inside = 0;
+
+      for (INT i = 0; i < NumOfPoints; i++)
+      {
+        FLT dx = PX[i] - QX[q], dy = PY[i] - QY[q], dz = PZ[i] - QZ[q], d2 = dx * dx + dy * dy + dz * dz;
+
+        All[i] = {d2, i};
+        Inside += d2 <= R * R;
+      }
+      std::partial_sort(All.begin(), All.begin() + mth::Min(K, NumOfPoints), All.end());
+      if (G.Radius(vec3(QX[q], QY[q], QZ[q]), R, Res) != Inside)
+        Mismatches++;
+      for (INT k = 0; k < K && k < NumOfPoints; k++)
+        if (Found[(size_t)q * K + k] != All[k].second)
+        {
+          Mismatches++;
+          break;
+        }
+    }
+    Report("brute force query", Ms() / mth::Max(NumOfSlow, 1));
+    sprintf(Buf, "Neighbour grid: %.2f neighbours per radius query, %i mismatches against brute force\n",
+      (DBL)NumOfNeighbours / mth::Max(NumOfQueries, 1), Mismatches);
+    OutputDebugString(Buf);
+    printf("%s", Buf);
+    return Mismatches == 0;
+  } /* End of 'neighbour_grid::Benchmark' function */
+} /* end of 'digl' namespace */
+
+/* END OF 'neighbour_grid.cpp' FILE */
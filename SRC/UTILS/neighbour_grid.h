@@ -0,0 +1,195 @@
+/***************************************************************
+ * Copyright (C) 2020
+ *    Computer Graphics Support Group of 30 Phys-Math Gymnasium
+ ***************************************************************/
+
+/* FILE NAME   : neighbour_grid.h
+ * PURPOSE     : Uniform grid neighbour index header file.
+ * PROGRAMMER  : Dmitriy Vlasov.
+ * LAST UPDATE : 19.10.2020
+ * NOTE        : Namespace 'digl'.
+ *
+ *   Grid covers bounding box of points (cell size is enlarged when grid
+ *   would have more than twice as many cells as points). Cells are
+ *   numbered X first, so every run of cells along X is one contiguous
+ *   range of sorted points. Points are copied in cell order (positions
+ *   in structure of arrays and original indices) by stable counting
+ *   sort: parallel histograms of coarse cell ranges, parallel scatter,
+ *   then counting sort of every coarse range by cells (coarse ranges in
+ *   parallel). Order of points does not depend on number of threads.
+ *
+ *   Queries walk cell runs, distances are filtered 4 points per step
+ *   with SSE. Grid is read only after 'Build', so any number of threads
+ *   may query it at once.
+ *
+ * No part of this file may be changed without agreement of
+ * Computer Graphics Support Group of 30 Phys-Math Gymnasium.
+ */
+
+#ifndef __NEIGHBOUR_GRID_H_
+#define __NEIGHBOUR_GRID_H_
+
+#include "../def.h"
+
+#include <vector>
+
+/* Animation project namespace */
+namespace digl
+{
+  /* Uniform grid neighbour index representation type */
+  class neighbour_grid
+  {
+  public:
+    /* Minimal number of points in one thread block */
+    static const size_t MinBlock = 1 << 14;
+
+    FLT CellSize;                  // Requested cell size (usually query radius)
+
+    /* Built grid */
+    vec3 Origin;                   // Grid minimum corner
+    FLT Step;                      // Actual cell size
+    INT NX, NY, NZ;                // Number of cells along axes
+    std::vector<UINT> CellStart;   // First sorted point of cells (number of cells + 1)
+    std::vector<FLT> X, Y, Z;      // Point positions in cell order
+    std::vector<INT> Index;        // Original indices of sorted points
+
+  private:
+    std::vector<UINT> Cells;       // Cells of original points
+    std::vector<INT> Tmp;          // Points sorted by coarse cell ranges
+
+  public:
+    /* Grid constructor function.
+     * ARGUMENTS:
+     *   - cell size:
+     *       FLT InCellSize;
+     */
+    neighbour_grid( FLT InCellSize = 1 ) :
+      CellSize(InCellSize), Origin(0), Step(InCellSize), NX(0), NY(0), NZ(0)
+    {
+    } /* End of 'neighbour_grid' function */
+
+    /* Get number of points function.
+     * ARGUMENTS: None.
+     * RETURNS:
+     *   (size_t) number of points.
+     */
+    size_t Size( VOID ) const
+    {
+      return Index.size();
+    } /* End of 'Size' function */
+
+    /* Get cell coordinate of point function.
+     * ARGUMENTS:
+     *   - point coordinate and axis:
+     *       FLT V;
+     *       INT Axis;
+     * RETURNS:
+     *   (INT) cell coordinate (clamped to grid).
+     */
+    INT GetCell( FLT V, INT Axis ) const
+    {
+      INT N = Axis == 0 ? NX : Axis == 1 ? NY : NZ;
+      FLT c = (V - Origin[Axis]) / Step;
+
+      return c <= 0 ? 0 : c >= N - 1 ? N - 1 : (INT)c;
+    } /* End of 'GetCell' function */
+
+    /* Build grid function (parallel).
+     * ARGUMENTS:
+     *   - point positions (structure of arrays):
+     *       const FLT *PX, *PY, *PZ;
+     *   - number of points:
+     *       size_t Count;
+     * RETURNS: None.
+     */
+    VOID Build( const FLT *PX, const FLT *PY, const FLT *PZ, size_t Count );
+
+    /* Walk sorted point ranges near point function.
+     * ARGUMENTS:
+     *   - point and distance:
+     *       const vec3 &P;
+     *       FLT R;
+     *   - function (called as 'Func(size_t Begin, size_t End)' for every
+     *     run of cells within distance box):
+     *       FuncType Func;
+     * RETURNS: None.
+     */
+    template<class FuncType>
+      VOID WalkRuns( const vec3 &P, FLT R, FuncType Func ) const
+      {
+        if (Index.empty())
+          return;
+
+        INT
+          x0 = GetCell(P[0] - R, 0), x1 = GetCell(P[0] + R, 0),
+          y0 = GetCell(P[1] - R, 1), y1 = GetCell(P[1] + R, 1),
+          z0 = GetCell(P[2] - R, 2), z1 = GetCell(P[2] + R, 2);
+
+        for (INT z = z0; z <= z1; z++)
+          for (INT y = y0; y <= y1; y++)
+          {
+            size_t Row = ((size_t)z * NY + y) * NX;
+            UINT Begin = CellStart[Row + x0], End = CellStart[Row + x1 + 1];
+
+            if (Begin < End)
+              Func((size_t)Begin, (size_t)End);
+          }
+      } /* End of 'WalkRuns' function */
+
+    /* Find points within distance function.
+     * ARGUMENTS:
+     *   - point and distance:
+     *       const vec3 &P;
+     *       FLT R;
+     *   - original indices of found points to fill:
+     *       std::vector<INT> &Res;
+     * RETURNS:
+     *   (size_t) number of found points.
+     */
+    size_t Radius( const vec3 &P, FLT R, std::vector<INT> &Res ) const;
+
+    /* Find nearest points function.
+     * ARGUMENTS:
+     *   - point:
+     *       const vec3 &P;
+     *   - maximal number of points:
+     *       INT K;
+     *   - original indices of found points to fill (nearest first) and
+     *     their squared distances (nullptr if not needed):
+     *       INT *Res;
+     *       FLT *Dist2;
+     *   - original index of point to skip (-1 for none):
+     *       INT Skip;
+     * RETURNS:
+     *   (INT) number of found points.
+     */
+    INT Nearest( const vec3 &P, INT K, INT *Res, FLT *Dist2 = nullptr, INT Skip = -1 ) const;
+
+    /* Find nearest points of set of points function (parallel).
+     * ARGUMENTS:
+     *   - query points (structure of arrays):
+     *       const FLT *QX, *QY, *QZ;
+     *   - number of query points:
+     *       size_t Count;
+     *   - maximal number of points per query:
+     *       INT K;
+     *   - 'K' original indices per query to fill (-1 for missing points):
+     *       INT *Res;
+     * RETURNS: None.
+     */
+    VOID Nearest( const FLT *QX, const FLT *QY, const FLT *QZ, size_t Count, INT K, INT *Res ) const;
+
+    /* Headless benchmark function (points in 1 km wide and 100 m high box).
+     * ARGUMENTS:
+     *   - number of points and queries:
+     *       INT NumOfPoints, NumOfQueries;
+     * RETURNS:
+     *   (BOOL) TRUE if radius and nearest query results match brute force ones.
+     */
+    static BOOL Benchmark( INT NumOfPoints, INT NumOfQueries );
+  }; /* End of 'neighbour_grid' class */
+} /* end of 'digl' namespace */
+
+#endif /* __NEIGHBOUR_GRID_H_ */
+
+/* END OF 'neighbour_grid.h' FILE */
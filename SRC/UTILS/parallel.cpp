@@ -0,0 +1,190 @@
+/***************************************************************
+ * Copyright (C) 2020
+ *    Computer Graphics Support Group of 30 Phys-Math Gymnasium
+ ***************************************************************/
+
+/* FILE NAME   : parallel.cpp
+ * PURPOSE     : Parallel loops file.
+ * PROGRAMMER  : Dmitriy Vlasov.
+ * LAST UPDATE : 19.10.2020
+ * NOTE        : Namespace 'digl'.
+ *
+ * No part of this file may be changed without agreement of
+ * Computer Graphics Support Group of 30 Phys-Math Gymnasium.
+ */
+
+/* Includes */
+#include "parallel.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+/* Animation project namespace */
+namespace digl
+{
+  /* Parallel loops namespace */
+  namespace parallel
+  {
+    /* Thread is worker or runs loop flag (nested loops are run serially) */
+    static thread_local BOOL IsInLoop = FALSE;
+
+    /* Worker pool representation type */
+    class pool
+    {
+    private:
+      std::vector<std::thread> Workers;  // Worker threads (number of hardware threads - 1)
+      std::mutex
+        Lock,                            // Loop state lock
+        CallLock;                        // Only one thread runs loop in pool
+      std::condition_variable
+        Start,                           // New loop or exit signal
+        Done;                            // Blocks done or workers left loop signal
+      UINT64 Generation = 0;             // Number of started loops
+      INT NumOfActive = 0;               // Number of workers in current loop
+      BOOL IsExit = FALSE;               // Workers exit flag
+
+      /* Current loop */
+      size_t Count = 0;                  // Number of elements in range
+      INT NumOfBlocks = 0;               // Number of blocks
+      block_func Func = nullptr;         // Block function
+      VOID *Context = nullptr;           // Block function context
+      std::atomic<INT>
+        NextBlock {0},                   // Next block to take
+        NumOfDone {0};                   // Number of processed blocks
+
+      /* Process blocks of current loop until all are taken function.
+       * ARGUMENTS: None.
+       * RETURNS: None.
+       */
+      VOID RunBlocks( VOID )
+      {
+        INT b;
+
+        while ((b = NextBlock++) < NumOfBlocks)
+        {
+          Func(Context, Count * b / NumOfBlocks, Count * (b + 1) / NumOfBlocks, b);
+          if (++NumOfDone == NumOfBlocks)
+          {
+            std::lock_guard<std::mutex> L(Lock);
+
+            Done.notify_all();
+          }
+        }
+      } /* End of 'RunBlocks' function */
+
+      /* Worker thread function.
+       * ARGUMENTS: None.
+       * RETURNS: None.
+       */
+      VOID Worker( VOID )
+      {
+        UINT64 Seen = 0;
+
+        IsInLoop = TRUE;
+        while (TRUE)
+        {
+          std::unique_lock<std::mutex> L(Lock);
+
+          Start.wait(L, [&]( VOID ) { return IsExit || Generation != Seen; });
+          if (IsExit)
+            return;
+          Seen = Generation;
+          NumOfActive++;
+          L.unlock();
+
+          RunBlocks();
+
+          L.lock();
+          if (--NumOfActive == 0)
+            Done.notify_all();
+        }
+      } /* End of 'Worker' function */
+
+    public:
+      /* Pool destructor function */
+      ~pool( VOID )
+      {
+        {
+          std::lock_guard<std::mutex> L(Lock);
+
+          IsExit = TRUE;
+        }
+        Start.notify_all();
+        for (auto &t : Workers)
+          t.join();
+      } /* End of '~pool' function */
+
+      /* Run blocks of range function.
+       * ARGUMENTS:
+       *   - number of elements in range and number of blocks:
+       *       size_t InCount;
+       *       INT InNumOfBlocks;
+       *   - block function and its context:
+       *       block_func InFunc;
+       *       VOID *InContext;
+       * RETURNS: None.
+       */
+      VOID Run( size_t InCount, INT InNumOfBlocks, block_func InFunc, VOID *InContext )
+      {
+        if (IsInLoop || !CallLock.try_lock())
+        {
+          for (INT b = 0; b < InNumOfBlocks; b++)
+            InFunc(InContext, InCount * b / InNumOfBlocks, InCount * (b + 1) / InNumOfBlocks, b);
+          return;
+        }
+
+        if (Workers.empty())
+          for (INT i = 1; i < NumOfThreads(); i++)
+            Workers.emplace_back(&pool::Worker, this);
+
+        {
+          std::unique_lock<std::mutex> L(Lock);
+
+          /* Workers late for previous loop must leave it before it is replaced */
+          Done.wait(L, [&]( VOID ) { return NumOfActive == 0; });
+          Count = InCount;
+          NumOfBlocks = InNumOfBlocks;
+          Func = InFunc;
+          Context = InContext;
+          NextBlock = 0;
+          NumOfDone = 0;
+          Generation++;
+        }
+        Start.notify_all();
+
+        IsInLoop = TRUE;
+        RunBlocks();
+        IsInLoop = FALSE;
+
+        {
+          std::unique_lock<std::mutex> L(Lock);
+
+          Done.wait(L, [&]( VOID ) { return NumOfDone == NumOfBlocks; });
+        }
+        CallLock.unlock();
+      } /* End of 'Run' function */
+    }; /* End of 'pool' class */
+
+    /* Run blocks of range in worker pool function.
+     * ARGUMENTS:
+     *   - number of elements in range:
+     *       size_t Count;
+     *   - number of blocks:
+     *       INT NumOfBlocks;
+     *   - block function and its context:
+     *       block_func Func;
+     *       VOID *Context;
+     * RETURNS: None.
+     */
+    VOID Run( size_t Count, INT NumOfBlocks, block_func Func, VOID *Context )
+    {
+      static pool Pool;
+
+      Pool.Run(Count, NumOfBlocks, Func, Context);
+    } /* End of 'Run' function */
+  } /* end of 'parallel' namespace */
+} /* end of 'digl' namespace */
+
+/* END OF 'parallel.cpp' FILE */
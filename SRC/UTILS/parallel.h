@@ -0,0 +1,110 @@
+/***************************************************************
+ * Copyright (C) 2020
+ *    Computer Graphics Support Group of 30 Phys-Math Gymnasium
+ ***************************************************************/
+
+/* FILE NAME   : parallel.h
+ * PURPOSE     : Parallel loops header file.
+ * PROGRAMMER  : Dmitriy Vlasov.
+ * LAST UPDATE : 19.10.2020
+ * NOTE        : Namespace 'digl'.
+ *
+ * No part of this file may be changed without agreement of
+ * Computer Graphics Support Group of 30 Phys-Math Gymnasium.
+ */
+
+#ifndef __PARALLEL_H_
+#define __PARALLEL_H_
+
+#include "../def.h"
+
+#include <thread>
+
+/* Animation project namespace */
+namespace digl
+{
+  /* Parallel loops namespace */
+  namespace parallel
+  {
+    /* Get number of worker threads function.
+     * ARGUMENTS: None.
+     * RETURNS:
+     *   (INT) number of hardware threads (at least 1).
+     */
+    inline INT NumOfThreads( VOID )
+    {
+      INT n = (INT)std::thread::hardware_concurrency();
+
+      return n < 1 ? 1 : n;
+    } /* End of 'NumOfThreads' function */
+
+    /* Get number of blocks range is split to function.
+     * ARGUMENTS:
+     *   - number of elements in range:
+     *       size_t Count;
+     *   - minimal number of elements in block:
+     *       size_t MinBlock;
+     * RETURNS:
+     *   (INT) number of blocks.
+     */
+    inline INT NumOfBlocks( size_t Count, size_t MinBlock = 1 )
+    {
+      size_t n = (Count + MinBlock - 1) / (MinBlock < 1 ? 1 : MinBlock);
+
+      return n < 1 ? 1 : n < (size_t)NumOfThreads() ? (INT)n : NumOfThreads();
+    } /* End of 'NumOfBlocks' function */
+
+    /* Block function type (called with context, range and block index) */
+    typedef VOID (*block_func)( VOID *Context, size_t Begin, size_t End, INT Block );
+
+    /* Run blocks of range in worker pool function.
+     * Workers are started once on first call and wait for next loop.
+     * Nested calls (from block functions) and calls made while other
+     * thread is running loop process all blocks in calling thread with
+     * the same split.
+     * ARGUMENTS:
+     *   - number of elements in range:
+     *       size_t Count;
+     *   - number of blocks:
+     *       INT NumOfBlocks;
+     *   - block function and its context:
+     *       block_func Func;
+     *       VOID *Context;
+     * RETURNS: None.
+     */
+    VOID Run( size_t Count, INT NumOfBlocks, block_func Func, VOID *Context );
+
+    /* Parallel loop over range function.
+     * Range is split to 'NumOfBlocks(Count, MinBlock)' contiguous blocks,
+     * blocks are processed by persistent worker threads and calling thread.
+     * ARGUMENTS:
+     *   - number of elements in range:
+     *       size_t Count;
+     *   - block function (called as 'Func(size_t Begin, size_t End, INT Block)'):
+     *       FuncType Func;
+     *   - minimal number of elements in block:
+     *       size_t MinBlock;
+     * RETURNS: None.
+     */
+    template<class FuncType>
+      VOID For( size_t Count, FuncType Func, size_t MinBlock = 1 )
+      {
+        INT n = NumOfBlocks(Count, MinBlock);
+
+        if (n <= 1)
+        {
+          Func((size_t)0, Count, 0);
+          return;
+        }
+        Run(Count, n,
+          []( VOID *Context, size_t Begin, size_t End, INT Block )
+          {
+            (*(FuncType *)Context)(Begin, End, Block);
+          }, &Func);
+      } /* End of 'For' function */
+  } /* end of 'parallel' namespace */
+} /* end of 'digl' namespace */
+
+#endif /* __PARALLEL_H_ */
+
+/* END OF 'parallel.h' FILE */
@@ -16,82 +16,640 @@
 
 /* Includes */
 #include "../ANIM/anim.h"
+#include "parallel.h"
 #include "particles.h"
+#include "radix.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <immintrin.h>
 
 /* Animation project namespace */
 namespace digl
 {
-  /* Draw particle function.
-    * ARGUMENTS: None.
-    * RETURNS: None.
-    */
-  VOID particle::Draw( VOID )
+  /* SSE register operations */
+  struct simd_sse
   {
-    anim *AC = anim::GetPtr();
+    typedef __m128 reg;
+    static const INT Width = 4;
 
-    /* Shader */
-    UINT ProgId = Shader->ProgId;
-    glUseProgram(ProgId);
+    static reg Set( FLT A ) { return _mm_set1_ps(A); }
+    static reg Load( const FLT *P ) { return _mm_loadu_ps(P); }
+    static VOID Store( FLT *P, reg A ) { _mm_storeu_ps(P, A); }
+    static reg Add( reg A, reg B ) { return _mm_add_ps(A, B); }
+    static reg Sub( reg A, reg B ) { return _mm_sub_ps(A, B); }
+    static reg Mul( reg A, reg B ) { return _mm_mul_ps(A, B); }
+    static reg Div( reg A, reg B ) { return _mm_div_ps(A, B); }
+    static reg Min( reg A, reg B ) { return _mm_min_ps(A, B); }
+    static reg Sqrt( reg A ) { return _mm_sqrt_ps(A); }
+    static reg Greater( reg A, reg B ) { return _mm_cmpgt_ps(A, B); }
+    static reg Less( reg A, reg B ) { return _mm_cmplt_ps(A, B); }
+    static reg And( reg A, reg B ) { return _mm_and_ps(A, B); }
+    static reg Select( reg Mask, reg A, reg B ) { return _mm_or_ps(_mm_and_ps(Mask, A), _mm_andnot_ps(Mask, B)); }
+  }; /* End of 'simd_sse' struct */
 
-    /* Texture */
-    glActiveTexture(GL_TEXTURE0 + 0);
-    glBindTexture(GL_TEXTURE_2D, Texture->TexId);
+#ifdef __AVX__
+  /* AVX register operations */
+  struct simd_avx
+  {
+    typedef __m256 reg;
+    static const INT Width = 8;
 
-    /* Uniforms */
-    INT loc;
-    if ((loc = glGetUniformLocation(ProgId, "MatrW")) != -1)
-      glUniformMatrix4fv(loc, 1, FALSE, Matr);
-    if ((loc = glGetUniformLocation(ProgId, "MatrVP")) != -1)
-      glUniformMatrix4fv(loc, 1, FALSE, AC->Cam.VP);
-    if ((loc = glGetUniformLocation(ProgId, "Trans")) != -1)
-      glUniform1f(loc, Trans.Value);
-    if ((loc = glGetUniformLocation(ProgId, "Rotation")) != -1)
-      glUniform1f(loc, Rotation.Value);
-    if ((loc = glGetUniformLocation(ProgId, "Size")) != -1)
-      glUniform1f(loc, Size.Value);
-    if ((loc = glGetUniformLocation(ProgId, "Position")) != -1)
-      glUniform3fv(loc, 1, Position.Value);
-    if ((loc = glGetUniformLocation(ProgId, "CamLoc")) != -1)
-      glUniform3fv(loc, 1, AC->Cam.Loc);
+    static reg Set( FLT A ) { return _mm256_set1_ps(A); }
+    static reg Load( const FLT *P ) { return _mm256_loadu_ps(P); }
+    static VOID Store( FLT *P, reg A ) { _mm256_storeu_ps(P, A); }
+    static reg Add( reg A, reg B ) { return _mm256_add_ps(A, B); }
+    static reg Sub( reg A, reg B ) { return _mm256_sub_ps(A, B); }
+    static reg Mul( reg A, reg B ) { return _mm256_mul_ps(A, B); }
+    static reg Div( reg A, reg B ) { return _mm256_div_ps(A, B); }
+    static reg Min( reg A, reg B ) { return _mm256_min_ps(A, B); }
+    static reg Sqrt( reg A ) { return _mm256_sqrt_ps(A); }
+    static reg Greater( reg A, reg B ) { return _mm256_cmp_ps(A, B, _CMP_GT_OQ); }
+    static reg Less( reg A, reg B ) { return _mm256_cmp_ps(A, B, _CMP_LT_OQ); }
+    static reg And( reg A, reg B ) { return _mm256_and_ps(A, B); }
+    static reg Select( reg Mask, reg A, reg B ) { return _mm256_blendv_ps(B, A, Mask); }
+  }; /* End of 'simd_avx' struct */
 
-    /* Draw */
-    glDrawArrays(GL_POINTS, 0, 1);
-    glUseProgram(0);
-  } /* End of 'particle::Draw' function */
+  /* Widest available register operations */
+  typedef simd_avx simd_wide;
+#else /* __AVX__ */
+  typedef simd_sse simd_wide;
+#endif /* __AVX__ */
+
+  /* Integrate particles by register width steps function.
+   * ARGUMENTS:
+   *   - particles pool:
+   *       particle_pool &Pool;
+   *   - delta time and speed range (no limits if maximum is 0):
+   *       FLT DeltaTime, SpeedMin, SpeedMax;
+   *   - particles range:
+   *       size_t i, Count;
+   * RETURNS:
+   *   (size_t) index of first not integrated particle.
+   */
+  template<class S>
+    static size_t IntegrateSteps( particle_pool &Pool, FLT DeltaTime, FLT SpeedMin, FLT SpeedMax, size_t i, size_t Count )
+    {
+      typedef typename S::reg reg;
+      const reg
+        Dt = S::Set(DeltaTime), HalfDt = S::Set(DeltaTime * 0.5f),
+        Min = S::Set(SpeedMin), Max = S::Set(SpeedMax), Zero = S::Set(0), One = S::Set(1);
+      FLT
+        *P[3] = {Pool.PosX.data(), Pool.PosY.data(), Pool.PosZ.data()},
+        *V[3] = {Pool.VelX.data(), Pool.VelY.data(), Pool.VelZ.data()},
+        *A[3] = {Pool.AccX.data(), Pool.AccY.data(), Pool.AccZ.data()},
+        *Age = Pool.Age.data();
+
+      for (; i + S::Width <= Count; i += S::Width)
+      {
+        reg v[3], Len2 = Zero;
+
+        for (INT k = 0; k < 3; k++)
+        {
+          reg a = S::Load(A[k] + i);
+
+          v[k] = S::Load(V[k] + i);
+          S::Store(P[k] + i, S::Add(S::Load(P[k] + i), S::Mul(S::Add(v[k], S::Mul(a, HalfDt)), Dt)));
+          v[k] = S::Add(v[k], S::Mul(a, Dt));
+          Len2 = S::Add(Len2, S::Mul(v[k], v[k]));
+        }
+        if (SpeedMax > 0)
+        {
+          reg
+            Len = S::Sqrt(Len2),
+            Scale = S::Select(S::Greater(Len, Max), S::Div(Max, Len),
+                      S::Select(S::And(S::Less(Len, Min), S::Greater(Len, Zero)), S::Div(Min, Len), One));
+
+          for (INT k = 0; k < 3; k++)
+            v[k] = S::Mul(v[k], Scale);
+        }
+        for (INT k = 0; k < 3; k++)
+          S::Store(V[k] + i, v[k]);
+        S::Store(Age + i, S::Add(S::Load(Age + i), Dt));
+      }
+      return i;
+    } /* End of 'IntegrateSteps' function */
+
+  /* Evaluate curve by register width steps function.
+   * Value is 'Start + (V0 + A * t / 2) * t + Bound * (Age - t)', t = min(Age, T),
+   * where speed reaches 'Bound' at age 'T'.
+   * ARGUMENTS:
+   *   - curve start value, start speed, acceleration, speed bound and bound age:
+   *       FLT Start, V0, Accel, Bound, T;
+   *   - particle ages and values to fill:
+   *       const FLT *Ages;
+   *       FLT *Res;
+   *   - number of particles:
+   *       size_t Count;
+   * RETURNS:
+   *   (size_t) index of first not evaluated particle.
+   */
+  template<class S>
+    static size_t EvaluateSteps( FLT Start, FLT V0, FLT Accel, FLT Bound, FLT T, const FLT *Ages, FLT *Res, size_t Count )
+    {
+      typedef typename S::reg reg;
+      const reg
+        St = S::Set(Start), V = S::Set(V0), HalfA = S::Set(Accel * 0.5f), B = S::Set(Bound), Tb = S::Set(T);
+      size_t i = 0;
+
+      for (; i + S::Width <= Count; i += S::Width)
+      {
+        reg
+          Age = S::Load(Ages + i),
+          t = S::Min(Age, Tb);
+
+        S::Store(Res + i, S::Add(S::Add(St, S::Mul(S::Add(V, S::Mul(HalfA, t)), t)), S::Mul(B, S::Sub(Age, t))));
+      }
+      return i;
+    } /* End of 'EvaluateSteps' function */
+
+  /* Evaluate curve for array of ages function.
+   * ARGUMENTS:
+   *   - particle ages:
+   *       const FLT *Ages;
+   *   - values to fill:
+   *       FLT *Res;
+   *   - number of particles:
+   *       size_t Count;
+   * RETURNS: None.
+   */
+  VOID particle_curve::Evaluate( const FLT *Ages, FLT *Res, size_t Count ) const
+  {
+    FLT
+      V0 = mth::Span(SpeedMin, SpeedMax, Speed),
+      Bound = Accel > 0 ? SpeedMax : SpeedMin,
+      T = Accel == 0 ? FLT_MAX : mth::Max<FLT>((Bound - V0) / Accel, 0);
+    size_t i = EvaluateSteps<simd_wide>(StartValue, V0, Accel, Bound, T, Ages, Res, Count);
+
+    for (; i < Count; i++)
+      Res[i] = Get(Ages[i]);
+  } /* End of 'particle_curve::Evaluate' function */
+
+  /* Integrate particles function.
+   * ARGUMENTS:
+   *   - delta time:
+   *       FLT DeltaTime;
+   *   - speed range (no limits if maximum is 0):
+   *       FLT SpeedMin, SpeedMax;
+   *   - particles range:
+   *       size_t Begin, End;
+   * RETURNS: None.
+   */
+  VOID particle_pool::Integrate( FLT DeltaTime, FLT SpeedMin, FLT SpeedMax, size_t Begin, size_t End )
+  {
+    size_t i = IntegrateSteps<simd_wide>(*this, DeltaTime, SpeedMin, SpeedMax, Begin, End);
+
+    /* Tail (narrower steps, then one by one) */
+    if (simd_wide::Width > simd_sse::Width)
+      i = IntegrateSteps<simd_sse>(*this, DeltaTime, SpeedMin, SpeedMax, i, End);
+    for (; i < End; i++)
+    {
+      FLT
+        vx = VelX[i], vy = VelY[i], vz = VelZ[i],
+        ax = AccX[i], ay = AccY[i], az = AccZ[i];
+
+      PosX[i] += (vx + ax * 0.5f * DeltaTime) * DeltaTime;
+      PosY[i] += (vy + ay * 0.5f * DeltaTime) * DeltaTime;
+      PosZ[i] += (vz + az * 0.5f * DeltaTime) * DeltaTime;
+      vx += ax * DeltaTime;
+      vy += ay * DeltaTime;
+      vz += az * DeltaTime;
+      if (SpeedMax > 0)
+      {
+        FLT
+          Len = sqrt(vx * vx + vy * vy + vz * vz),
+          Scale = Len > SpeedMax ? SpeedMax / Len : Len < SpeedMin && Len > 0 ? SpeedMin / Len : 1;
 
+        vx *= Scale;
+        vy *= Scale;
+        vz *= Scale;
+      }
+      VelX[i] = vx;
+      VelY[i] = vy;
+      VelZ[i] = vz;
+      Age[i] += DeltaTime;
+    }
+  } /* End of 'particle_pool::Integrate' function */
 
+  /* Move alive particles of range to its beginning function (order is kept).
+   * ARGUMENTS:
+   *   - particles range:
+   *       size_t Begin, End;
+   * RETURNS:
+   *   (size_t) number of alive particles.
+   */
+  size_t particle_pool::Compact( size_t Begin, size_t End )
+  {
+    size_t Dst = Begin;
+
+    for (size_t i = Begin; i < End; i++)
+      if (Age[i] < AgeDie[i])
+      {
+        if (Dst != i)
+          Walk([i, Dst]( std::vector<FLT> &A )
+            {
+              A[Dst] = A[i];
+            });
+        Dst++;
+      }
+    return Dst - Begin;
+  } /* End of 'particle_pool::Compact' function */
+
+  /* Move particles function (destination is before source).
+   * ARGUMENTS:
+   *   - source and destination index:
+   *       size_t Src, Dst;
+   *   - number of particles:
+   *       size_t Count;
+   * RETURNS: None.
+   */
+  VOID particle_pool::Move( size_t Src, size_t Dst, size_t Count )
+  {
+    if (Src != Dst && Count > 0)
+      Walk([Src, Dst, Count]( std::vector<FLT> &A )
+        {
+          memmove(&A[Dst], &A[Src], Count * sizeof(FLT));
+        });
+  } /* End of 'particle_pool::Move' function */
+
+  /* Emitter destructor function.
+   * ARGUMENTS: None.
+   * RETURNS: None.
+   */
+  emitter::~emitter( VOID )
+  {
+    if (VBuf != 0)
+      glDeleteBuffers(1, &VBuf);
+    if (VA != 0)
+      glDeleteVertexArrays(1, &VA);
+  } /* End of 'emitter::~emitter' function */
+
+  /* Response emitter function (queues emitter for 'Simulate').
+   * ARGUMENTS:
+   *   - emitter parent world matrix:
+   *       const matr &WorldMatr;
+   * RETURNS: None.
+   */
   VOID emitter::Response( const matr &WorldMatr )
   {
-    anim *AC = anim::GetPtr();
+    Queue(anim::GetPtr()->Time, WorldMatr);
+  } /* End of 'emitter::Response' function */
 
+  /* Queue emitter for 'Simulate' at given time function.
+   * ARGUMENTS:
+   *   - animation time:
+   *       DBL Time;
+   *   - emitter parent world matrix:
+   *       const matr &WorldMatr;
+   * RETURNS: None.
+   */
+  VOID emitter::Queue( DBL Time, const matr &WorldMatr )
+  {
     /* Compute delta time */
-    static DBL LastTime = AC->Time;
-    DBL DeltaTime = AC->Time - LastTime;
-    LastTime = AC->Time;
+    DBL DeltaTime = LastTime < 0 ? 0 : Time - LastTime;
+    LastTime = Time;
 
     /* Self response */
     if (!IsImmortal)
       Age += DeltaTime;
 
-    if (AC->Time - LastTimeEmit > DeltaTimeEmit)
+    IsQueued = TRUE;
+    FrameDeltaTime = (FLT)DeltaTime;
+    FrameMatr = Matr * WorldMatr;
+    EmitCount = 0;
+    LifeScale = 1;
+    if (Time - LastTimeEmit > DeltaTimeEmit)
     {
-      LastTimeEmit = AC->Time;
-      for (INT i = 0; i < NumOfParticles; ++i)
-        EmitParticle(Matr * WorldMatr);
+      LastTimeEmit = Time;
+      EmitCount = NumOfParticles;
     }
+    NumOfRequested = NumOfGranted = EmitCount;
+  } /* End of 'emitter::Queue' function */
+
+  /* Simulate queued emitters function.
+   * ARGUMENTS:
+   *   - emitters:
+   *       const std::vector<emitter *> &Emitters;
+   *   - particle budget (nullptr for no limits):
+   *       particle_budget *Budget;
+   * RETURNS: None.
+   */
+  VOID emitter::Simulate( const std::vector<emitter *> &Emitters, particle_budget *Budget )
+  {
+    anim *AC = anim::GetPtr();
+
+    Simulate(Emitters, AC->Cam.Loc, AC->Cam.Dir, AC->Cam.Near / AC->Cam.ProjSize, Budget);
+  } /* End of 'emitter::Simulate' function */
 
-    /* Response particles */
-    for (INT i = 0; i < Particles.size(); ++i)
+  /* Simulate queued emitters for camera function.
+   * ARGUMENTS:
+   *   - emitters:
+   *       const std::vector<emitter *> &Emitters;
+   *   - camera location and direction (particles are sorted back to front):
+   *       const vec3 &CamLoc, &CamDir;
+   *   - camera projection scale (near plane distance to projection size):
+   *       FLT ViewScale;
+   *   - particle budget (nullptr for no limits):
+   *       particle_budget *Budget;
+   * RETURNS: None.
+   */
+  VOID emitter::Simulate( const std::vector<emitter *> &Emitters, const vec3 &CamLoc, const vec3 &CamDir,
+                          FLT ViewScale, particle_budget *Budget )
+  {
+    /* Job is emitter chunk */
+    struct job
+    {
+      emitter *Em;
+      size_t Chunk, Begin, End;
+    };
+    std::vector<job> Jobs;
+    auto RunJobs = [&Jobs]( auto Func )
+    {
+      parallel::For(Jobs.size(),
+        [&]( size_t Begin, size_t End, INT )
+        {
+          for (size_t j = Begin; j < End; j++)
+            Func(Jobs[j]);
+        });
+      Jobs.clear();
+    };
+    auto AddJobs = [&Jobs]( emitter *Em, size_t First, size_t Count, size_t Chunk )
     {
-      ResponseParticle(Particles[i], DeltaTime);
-      if ((Particles[i])->Age >= (Particles[i])->AgeDie)
+      for (size_t c = 0; c * Chunk < Count; c++)
+        Jobs.push_back({Em, c, First + c * Chunk, First + mth::Min(Count, (c + 1) * Chunk)});
+    };
+
+    /* Emission */
+    if (Budget != nullptr)
+      Budget->Schedule(Emitters, CamLoc, CamDir, ViewScale);
+    for (emitter *Em : Emitters)
+      if (Em->IsQueued && Em->EmitCount > 0)
+      {
+        Em->TotalEmitted += Em->EmitCount;
+        Em->EmitFirst = Em->Pool.Size();
+        Em->Pool.Resize(Em->EmitFirst + Em->EmitCount);
+        AddJobs(Em, Em->EmitFirst, Em->EmitCount, EmitChunkSize);
+      }
+    RunJobs([]( const job &J )
       {
-        delete Particles[i];
-        Particles.erase(Particles.begin() + i);
-        i--;
+        emitter *Em = J.Em;
+        rng Rnd(Em->Seed, Em->NumOfStreams + J.Chunk);
+
+        for (size_t i = J.Begin; i < J.End; i++)
+        {
+          Em->EmitParticle(Em->FrameMatr, Rnd, i);
+          Em->Pool.AgeDie[i] *= Em->LifeScale;
+        }
+      });
+
+    /* Integration and culling */
+    for (emitter *Em : Emitters)
+      if (Em->IsQueued)
+      {
+        Em->NumOfStreams += (Em->EmitCount + EmitChunkSize - 1) / EmitChunkSize;
+        Em->ChunkAlive.resize((Em->Pool.Size() + ChunkSize - 1) / ChunkSize);
+        AddJobs(Em, 0, Em->Pool.Size(), ChunkSize);
       }
+    RunJobs([]( const job &J )
+      {
+        emitter *Em = J.Em;
+
+        Em->Pool.Integrate(Em->FrameDeltaTime, Em->SpeedMin, Em->SpeedMax, J.Begin, J.End);
+        Em->ChunkAlive[J.Chunk] = Em->Pool.Compact(J.Begin, J.End);
+      });
+
+    /* Compaction of chunks */
+    for (emitter *Em : Emitters)
+      if (Em->IsQueued)
+      {
+        size_t Alive = 0;
+
+        for (size_t c = 0; c < Em->ChunkAlive.size(); c++)
+        {
+          Em->Pool.Move(c * ChunkSize, Alive, Em->ChunkAlive[c]);
+          Alive += Em->ChunkAlive[c];
+        }
+        Em->Pool.Resize(Alive);
+      }
+
+    /* Batches of emitters with same material (first emitter draws batch) */
+    for (emitter *Em : Emitters)
+      if (Em->IsQueued)
+      {
+        Em->Leader = Em;
+        for (emitter *L : Emitters)
+          if (L == Em)
+            break;
+          else if (L->IsQueued && L->Leader == L && L->Shader == Em->Shader && L->Texture == Em->Texture)
+          {
+            Em->Leader = L;
+            break;
+          }
+        Em->BatchFirst = Em->Leader == Em ? 0 : Em->Leader->Unsorted.size();
+        Em->Leader->Unsorted.resize(Em->BatchFirst + Em->Pool.Size());
+        Em->Leader->SortItems.resize(Em->BatchFirst + Em->Pool.Size());
+        Em->Vertices.clear();
+        AddJobs(Em, 0, Em->Pool.Size(), ChunkSize);
+      }
+
+    /* Attribute curves, unsorted vertices and view depth keys (back to front) */
+    RunJobs([&CamLoc, &CamDir]( const job &J )
+      {
+        emitter *Em = J.Em;
+        particle_pool &Pool = Em->Pool;
+        particle_vertex *Vert = &Em->Leader->Unsorted[Em->BatchFirst];
+        UINT64 *Items = &Em->Leader->SortItems[Em->BatchFirst];
+
+        Em->Size.Evaluate(&Pool.Age[J.Begin], &Pool.Sizes[J.Begin], J.End - J.Begin);
+        Em->Trans.Evaluate(&Pool.Age[J.Begin], &Pool.Fades[J.Begin], J.End - J.Begin);
+        for (size_t i = J.Begin; i < J.End; i++)
+        {
+          particle_vertex &V = Vert[i];
+
+          V.P = vec3(Pool.PosX[i], Pool.PosY[i], Pool.PosZ[i]);
+          V.Size = Pool.Sizes[i];
+          V.Trans = Pool.Fades[i];
+          Items[i] = (UINT64)~radix::FloatKey((V.P - CamLoc) & CamDir) << 32 | (Em->BatchFirst + i);
+        }
+      });
+
+    /* Sort batches and gather vertices in sorted order */
+    for (emitter *Em : Emitters)
+      if (Em->IsQueued && Em->Leader == Em)
+      {
+        radix::Sort(Em->SortItems, Em->SortTmp);
+        Em->Vertices.resize(Em->Unsorted.size());
+        AddJobs(Em, 0, Em->Unsorted.size(), ChunkSize);
+      }
+    RunJobs([]( const job &J )
+      {
+        emitter *Em = J.Em;
+
+        for (size_t i = J.Begin; i < J.End; i++)
+          Em->Vertices[i] = Em->Unsorted[(UINT)Em->SortItems[i]];
+      });
+
+    for (emitter *Em : Emitters)
+      if (Em->IsQueued)
+      {
+        Em->Unsorted.clear();
+        Em->SortItems.clear();
+        Em->IsQueued = FALSE;
+      }
+  } /* End of 'emitter::Simulate' function */
+
+  /* Benchmark emitter (fountain of particles living 2 seconds) */
+  class emitter_bench : public emitter
+  {
+  public:
+    /* Benchmark emitter constructor function.
+     * ARGUMENTS:
+     *   - particles per emission:
+     *       INT InNumOfParticles;
+     *   - emitter location:
+     *       const vec3 &Loc;
+     */
+    emitter_bench( INT InNumOfParticles, const vec3 &Loc ) : emitter(TRUE, 0, InNumOfParticles)
+    {
+      Matr = matr::Translate(Loc);
+      Trans = particle_curve(1, -1.5, 0, 0, -0.23f);
+      Size = particle_curve(0.5, -0.5, 0, 0, -0.13f);
+      SpeedMax = 20;
+    } /* End of 'emitter_bench' function */
+
+    /* Emit particle function.
+     * ARGUMENTS:
+     *   - emitter world matrix:
+     *       const matr &WorldMatr;
+     *   - random stream of emission chunk:
+     *       rng &Rnd;
+     *   - pool index of particle:
+     *       size_t Index;
+     * RETURNS None.
+     */
+    VOID EmitParticle( const matr &WorldMatr, rng &Rnd, size_t Index ) override
+    {
+      vec3 V = Rnd.Vec1() * 5;
+
+      V[1] = fabs(V[1]) + 10;
+      Pool.Set(Index, WorldMatr.TransformPoint(vec3(0)), V, vec3(0, -9.8f, 0), 2);
+    } /* End of 'EmitParticle' function */
+  }; /* End of 'emitter_bench' class */
+
+  /* Headless benchmark function (emitters of same material, 2 s particle lifetime, 60 Hz steps).
+   * ARGUMENTS:
+   *   - number of alive particles and steps:
+   *       INT NumOfParticles, NumOfSteps;
+   * RETURNS: None.
+   */
+  VOID emitter::Benchmark( INT NumOfParticles, INT NumOfSteps )
+  {
+    const INT NumOfEmitters = 4, StepsPerLife = 120;
+    std::vector<emitter *> Emitters;
+    size_t NumOfAlive = 0;
+    DBL Time = 0;
+
+    for (INT i = 0; i < NumOfEmitters; i++)
+    {
+      Emitters.push_back(new emitter_bench(mth::Max(NumOfParticles / NumOfEmitters / StepsPerLife, 1),
+                                           vec3(i * 10.0f, 0, 0)));
+      Emitters.back()->Seed = i + 1;
+    }
+
+    /* Steps: first particles lifetime fills pools, it is not measured */
+    LARGE_INTEGER t0, t1, Freq;
+
+    QueryPerformanceFrequency(&Freq);
+    for (INT s = 0; s < StepsPerLife + NumOfSteps; s++)
+    {
+      if (s == StepsPerLife)
+        QueryPerformanceCounter(&t0);
+      Time += 1.0 / 60;
+      for (emitter *Em : Emitters)
+        Em->Queue(Time);
+      Simulate(Emitters, vec3(20, 30, 60), vec3(-20, -30, -60).Normalizing(), 1);
+    }
+    QueryPerformanceCounter(&t1);
+
+    for (emitter *Em : Emitters)
+    {
+      NumOfAlive += Em->GetNumOfAlive();
+      delete Em;
     }
-  }
+
+    DBL StepTime = (DBL)(t1.QuadPart - t0.QuadPart) * 1000 / Freq.QuadPart / mth::Max(NumOfSteps, 1);
+    CHAR Buf[200];
+
+    sprintf(Buf, "Particles: %zu alive, %i steps, %.3f ms per step\n", NumOfAlive, NumOfSteps, StepTime);
+    OutputDebugString(Buf);
+    printf("%s", Buf);
+  } /* End of 'emitter::Benchmark' function */
+
+  /* Schedule emission of queued emitters function.
+   * ARGUMENTS:
+   *   - emitters:
+   *       const std::vector<emitter *> &Emitters;
+   *   - camera location and direction:
+   *       const vec3 &CamLoc, &CamDir;
+   *   - camera projection scale (near plane distance to projection size):
+   *       FLT ViewScale;
+   * RETURNS: None.
+   */
+  VOID particle_budget::Schedule( const std::vector<emitter *> &Emitters, const vec3 &CamLoc, const vec3 &CamDir, FLT ViewScale )
+  {
+    std::vector<emitter *> Queue;
+
+    NumOfAlive = NumOfRequested = NumOfGranted = 0;
+    for (emitter *Em : Emitters)
+    {
+      NumOfAlive += Em->Pool.Size();
+      if (!Em->IsQueued || Em->EmitCount == 0)
+        continue;
+
+      /* Coverage of emitter sphere */
+      vec3 D = Em->FrameMatr.TransformPoint(vec3(0)) - CamLoc;
+      FLT Dist = !D, Scale = 0;
+
+      if (Dist <= Em->Radius)
+        Em->Coverage = 1;
+      else if ((D & CamDir) < -Em->Radius)
+        Em->Coverage = 0;
+      else
+        Em->Coverage = Em->Radius / Dist * ViewScale;
+      if (Em->Coverage > 0)
+        Scale = mth::Max(MinScale, mth::Min<FLT>(1, Em->Coverage / FullCoverage));
+
+      /* Scaled request keeps fraction for next emission */
+      FLT Want = Em->EmitCount * Scale + Em->EmitCarry;
+
+      NumOfRequested += Em->EmitCount;
+      Em->EmitCount = (size_t)Want;
+      Em->EmitCarry = Scale > 0 ? Want - Em->EmitCount : 0;
+      Em->LifeScale = MinLifeScale + (1 - MinLifeScale) * (mth::Max(Scale, MinScale) - MinScale) / (1 - MinScale);
+      Queue.push_back(Em);
+    }
+
+    /* Grant by priority */
+    std::stable_sort(Queue.begin(), Queue.end(),
+      []( const emitter *A, const emitter *B )
+      {
+        return A->Priority > B->Priority || (A->Priority == B->Priority && A->Coverage > B->Coverage);
+      });
+
+    size_t Free = mth::Min(NumOfAlive < MaxAlive ? MaxAlive - NumOfAlive : 0, MaxEmitted);
+
+    for (emitter *Em : Queue)
+    {
+      Em->EmitCount = mth::Min(Em->EmitCount, Free);
+      Em->NumOfGranted = Em->EmitCount;
+      Free -= Em->EmitCount;
+      NumOfGranted += Em->EmitCount;
+    }
+  } /* End of 'particle_budget::Schedule' function */
 
   /* Draw particles function.
    * ARGUMENTS: None.
@@ -99,8 +657,62 @@ namespace digl
    */
   VOID emitter::Draw( VOID )
   {
-    for (auto it = Particles.begin(); it != Particles.end(); ++it)
-      (*it)->Draw();
+    anim *AC = anim::GetPtr();
+    size_t NumOfP = Vertices.size();
+
+    if (NumOfP == 0 || Shader == nullptr)
+      return;
+
+    if (VA == 0)
+    {
+      glGenVertexArrays(1, &VA);
+      glGenBuffers(1, &VBuf);
+      glBindVertexArray(VA);
+      glBindBuffer(GL_ARRAY_BUFFER, VBuf);
+      glVertexAttribPointer(0, 3, GL_FLOAT, FALSE, sizeof(particle_vertex), (VOID *)offsetof(particle_vertex, P));
+      glVertexAttribPointer(1, 1, GL_FLOAT, FALSE, sizeof(particle_vertex), (VOID *)offsetof(particle_vertex, Size));
+      glVertexAttribPointer(2, 1, GL_FLOAT, FALSE, sizeof(particle_vertex), (VOID *)offsetof(particle_vertex, Trans));
+      for (INT i = 0; i < 3; i++)
+        glEnableVertexAttribArray(i);
+      glBindVertexArray(0);
+    }
+
+    /* Upload (buffer is reallocated only to grow) */
+    size_t BufSize = sizeof(particle_vertex) * NumOfP;
+
+    glBindBuffer(GL_ARRAY_BUFFER, VBuf);
+    if (BufSize > VBufSize)
+    {
+      VBufSize = BufSize;
+      glBufferData(GL_ARRAY_BUFFER, BufSize, Vertices.data(), GL_STREAM_DRAW);
+    }
+    else
+    {
+      glBufferData(GL_ARRAY_BUFFER, VBufSize, nullptr, GL_STREAM_DRAW);
+      glBufferSubData(GL_ARRAY_BUFFER, 0, BufSize, Vertices.data());
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    /* Shader */
+    UINT ProgId = Shader->ProgId;
+    INT loc;
+
+    glUseProgram(ProgId);
+    if (Texture != nullptr)
+    {
+      glActiveTexture(GL_TEXTURE0 + 0);
+      glBindTexture(GL_TEXTURE_2D, Texture->TexId);
+    }
+    if ((loc = glGetUniformLocation(ProgId, "MatrVP")) != -1)
+      glUniformMatrix4fv(loc, 1, FALSE, AC->Cam.VP);
+    if ((loc = glGetUniformLocation(ProgId, "CamLoc")) != -1)
+      glUniform3fv(loc, 1, AC->Cam.Loc);
+
+    /* Draw */
+    glBindVertexArray(VA);
+    glDrawArrays(GL_POINTS, 0, (INT)NumOfP);
+    glBindVertexArray(0);
+    glUseProgram(0);
   } /* End of 'emitter::Draw' function */
 
   /* Water drop emmiter function.
@@ -117,50 +729,32 @@ namespace digl
     NumOfParticles = InNumOfParticles;
     Shader = AC->ShaderCreate("SRC/BIN/SHADER/PARTICLES/");
     Texture = AC->TextureCreate("", "SRC/BIN/TEXTURES/waterdrop.bmp");
+    Trans = particle_curve(1, -1.5, 0, 0, -0.23f);
+    Size = particle_curve(0.5, -0.5, 0, 0, -0.13f);
+    SpeedMin = 0;
+    SpeedMax = 20;
+    Radius = 10;
   } /* End of 'emitterWaterDrop::Init' function */
 
-  /* Emit particle function. 
-   * ARGUMENTS: None.
+  /* Emit particle function.
+   * ARGUMENTS:
+   *   - emitter world matrix:
+   *       const matr &WorldMatr;
+   *   - random stream of emission chunk:
+   *       rng &Rnd;
+   *   - pool index of particle:
+   *       size_t Index;
    * RETURNS None.
    */
-  VOID emitterWaterDrop::EmitParticle( const matr &WorldMatr )
+  VOID emitterWaterDrop::EmitParticle( const matr &WorldMatr, rng &Rnd, size_t Index )
   {
-    anim *AC = anim::GetPtr();
-    particle *Prt;
-    vec3 V(0);
-    V.Rnd1();
+    vec3 V = Rnd.Vec1();
     V[2] = fabs(V[1]);
 
-    Prt = new particle(3, Shader, Texture, WorldMatr);
-    Prt->Trans.Init(FALSE, 1, -1.5, 0, 0, -0.23);
-    Prt->Size.Init(FALSE, 0.5, -0.5, 0, 0, -0.13);
-    Prt->Position.Init(FALSE, vec3(0), 0, 20, V * 10, vec3(0, 0, 50));
-
-    Particles.push_back(Prt);
+    Pool.Set(Index, WorldMatr.TransformPoint(vec3(0)), WorldMatr.TransformVector(V * 10),
+             WorldMatr.TransformVector(vec3(0, 0, 50)), 3);
   } /* End of 'emitterWaterDrop::EmitParticle' function */
 
-  /* Response particle function.
-   * ARGUMENTS:
-   *   - particle for response:
-   *       particle *Prt;
-   * RETURNS: None.
-   */
-  VOID emitterWaterDrop::ResponseParticle( particle *Prt, const DBL DeltaTime )
-  {
-    Prt->Age += DeltaTime;
-    Prt->Trans.Compute();
-    Prt->Size.Compute();
-    Prt->Position.Compute();
-
-    /*
-    Prt->Trans.Compute();
-    Prt->Rotation.Compute();
-    Prt->Position.Compute();
-    */
-  } /* End of 'emitterWaterDrop::ResponseParticle'*/
-
 } /* end of 'digl' namespace */
 
-/* END OF 'geom.cpp' FILE */
-
-
+/* END OF 'particles.cpp' FILE */
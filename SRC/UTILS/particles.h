@@ -9,6 +9,27 @@
  * LAST UPDATE : 10.09.2020
  * NOTE        : Namespace 'digl'.
  *
+ *   Emitter keeps its particles in structure of arrays pool (dead
+ *   particle is replaced by last one). Particle positions are in world
+ *   space (emitter matrix is applied at emission), size and transparency
+ *   are emitter curves of particle age. All particles of emitter are
+ *   streamed to one point vertex buffer and drawn by one call.
+ *
+ *   Pool arrays are integrated and curves are evaluated 8 particles per
+ *   step with AVX (when compiled with '/arch:AVX'), 4 with SSE otherwise.
+ *
+ *   'emitter::Response' only queues emitter for frame, all queued
+ *   emitters are simulated by 'emitter::Simulate' as parallel jobs:
+ *   emission by chunks of 'EmitChunkSize' particles (every chunk has its
+ *   own random stream, so result does not depend on number of threads),
+ *   integration and dead particles culling by chunks of 'ChunkSize'
+ *   particles, then alive particles are compacted (order is kept).
+ *
+ *   Queued emitters with same shader and texture form batch: particles
+ *   of batch are radix sorted by view depth (back to front) into vertex
+ *   array of first emitter of batch, which draws whole batch by one
+ *   call ('Draw' of other batch emitters does nothing).
+ *
  * No part of this file may be changed without agreement of
  * Computer Graphics Support Group of 30 Phys-Math Gymnasium.
  */
@@ -18,69 +39,274 @@
 
 /* Includes */
 #include "../def.h"
-#include "physics.h"
 #include "../ANIM/RENDER/RESOURCES/shader.h"
 #include "../ANIM/RENDER/RESOURCES/texture.h"
+#include "rng.h"
 #include <vector>
 
 /* Animation project namespace */
 namespace digl
 {
-  /* Particles emitter representation class */
-  class particle
+  /* Particle attribute curve (uniformly accelerated value with speed limits) */
+  class particle_curve
   {
   public:
-    DBL Age;
-    DBL AgeDie;
-    shader *Shader;
-    texture *Texture;
-    kinematics Size;
-    kinematics Trans;
-    kinematics Rotation;
-    kinematicsVec Position;
-    matr Matr;
+    FLT
+      StartValue = 0,  // Value at zero age
+      Speed = 0,       // Speed at zero age
+      Accel = 0,       // Acceleration
+      SpeedMin = 0,    // Speed range
+      SpeedMax = 0;
 
-    /* Emitter constructor function.
+    /* Particle curve constructor function.
      * ARGUMENTS: None.
-     * RETURNS: None.
      */
-    particle( VOID ) :
-      Age(0), AgeDie(0), Shader(), Texture(), Size(),
-      Trans(), Rotation(), Position(), Matr(matr::Identity())
+    particle_curve( VOID )
     {
-    } /* End of 'particle' function */
+    } /* End of 'particle_curve' function */
 
-    /* Emitter constructor function.
+    /* Particle curve constructor function.
+     * ARGUMENTS:
+     *   - value at zero age:
+     *       FLT InStartValue;
+     *   - speed range:
+     *       FLT InSpeedMin, InSpeedMax;
+     *   - speed at zero age and acceleration:
+     *       FLT InSpeed, InAccel;
+     */
+    particle_curve( FLT InStartValue, FLT InSpeedMin, FLT InSpeedMax, FLT InSpeed = 0, FLT InAccel = 0 ) :
+      StartValue(InStartValue), Speed(InSpeed), Accel(InAccel), SpeedMin(InSpeedMin), SpeedMax(InSpeedMax)
+    {
+    } /* End of 'particle_curve' function */
+
+    /* Get curve value function.
+     * ARGUMENTS:
+     *   - particle age:
+     *       FLT Age;
+     * RETURNS:
+     *   (FLT) value.
+     */
+    FLT Get( FLT Age ) const
+    {
+      FLT V0 = mth::Span(SpeedMin, SpeedMax, Speed);
+
+      if (Accel == 0)
+        return StartValue + V0 * Age;
+
+      /* Speed reaches its limit at 'T' and stays there */
+      FLT
+        Bound = Accel > 0 ? SpeedMax : SpeedMin,
+        T = (Bound - V0) / Accel;
+
+      if (Age <= T)
+        return StartValue + (V0 + Accel * Age / 2) * Age;
+      T = mth::Max<FLT>(T, 0);
+      return StartValue + (V0 + Accel * T / 2) * T + Bound * (Age - T);
+    } /* End of 'Get' function */
+
+    /* Evaluate curve for array of ages function.
+     * ARGUMENTS:
+     *   - particle ages:
+     *       const FLT *Ages;
+     *   - values to fill:
+     *       FLT *Res;
+     *   - number of particles:
+     *       size_t Count;
+     * RETURNS: None.
+     */
+    VOID Evaluate( const FLT *Ages, FLT *Res, size_t Count ) const;
+  }; /* End of 'particle_curve' class */
+
+  /* Particles pool (structure of arrays) representation class */
+  class particle_pool
+  {
+  public:
+    std::vector<FLT>
+      PosX, PosY, PosZ,  // World space positions
+      VelX, VelY, VelZ,  // Velocities
+      AccX, AccY, AccZ,  // Accelerations
+      Age, AgeDie,       // Current and death ages
+      Sizes, Fades;      // Size and transparency curve values (after 'emitter::Response')
+
+    /* Get number of particles function.
      * ARGUMENTS: None.
+     * RETURNS:
+     *   (size_t) number of particles.
+     */
+    size_t Size( VOID ) const
+    {
+      return Age.size();
+    } /* End of 'Size' function */
+
+    /* Walk all arrays function.
+     * ARGUMENTS:
+     *   - function (called as 'Func(std::vector<FLT> &A)'):
+     *       FuncType Func;
+     * RETURNS: None.
+     */
+    template<class FuncType>
+      VOID Walk( FuncType Func )
+      {
+        for (std::vector<FLT> *A : {&PosX, &PosY, &PosZ, &VelX, &VelY, &VelZ, &AccX, &AccY, &AccZ, &Age, &AgeDie, &Sizes, &Fades})
+          Func(*A);
+      } /* End of 'Walk' function */
+
+    /* Set particle function.
+     * ARGUMENTS:
+     *   - particle index:
+     *       size_t i;
+     *   - world space position, velocity and acceleration:
+     *       const vec3 &P, &V, &A;
+     *   - death age:
+     *       FLT InAgeDie;
+     * RETURNS: None.
+     */
+    VOID Set( size_t i, const vec3 &P, const vec3 &V, const vec3 &A, FLT InAgeDie )
+    {
+      PosX[i] = P[0], PosY[i] = P[1], PosZ[i] = P[2];
+      VelX[i] = V[0], VelY[i] = V[1], VelZ[i] = V[2];
+      AccX[i] = A[0], AccY[i] = A[1], AccZ[i] = A[2];
+      Age[i] = 0;
+      AgeDie[i] = InAgeDie;
+      Sizes[i] = Fades[i] = 0;
+    } /* End of 'Set' function */
+
+    /* Add particle function.
+     * ARGUMENTS:
+     *   - world space position, velocity and acceleration:
+     *       const vec3 &P, &V, &A;
+     *   - death age:
+     *       FLT InAgeDie;
+     * RETURNS: None.
+     */
+    VOID Add( const vec3 &P, const vec3 &V, const vec3 &A, FLT InAgeDie )
+    {
+      Resize(Size() + 1);
+      Set(Size() - 1, P, V, A, InAgeDie);
+    } /* End of 'Add' function */
+
+    /* Remove particle function (last particle takes its place).
+     * ARGUMENTS:
+     *   - particle index:
+     *       size_t i;
      * RETURNS: None.
      */
-    particle( const FLT InAgeDie, shader *InShader,
-      texture *InTexture, const matr InMatr = matr::Identity() ) :
-      Age(0), AgeDie(InAgeDie), Shader(InShader), Texture(InTexture), Size(),
-      Trans(), Rotation(), Position(), Matr(InMatr)
+    VOID Remove( size_t i )
     {
-    } /* End of 'particle' function */
+      Walk([i]( std::vector<FLT> &A )
+        {
+          A[i] = A.back();
+          A.pop_back();
+        });
+    } /* End of 'Remove' function */
 
-    ~particle( VOID )
+    /* Resize pool function.
+     * ARGUMENTS:
+     *   - new number of particles:
+     *       size_t NewSize;
+     * RETURNS: None.
+     */
+    VOID Resize( size_t NewSize )
     {
-    } /* End of '~particle' function */
+      Walk([NewSize]( std::vector<FLT> &A )
+        {
+          A.resize(NewSize);
+        });
+    } /* End of 'Resize' function */
 
-    /* Draw particle function.
+    /* Remove all particles function.
      * ARGUMENTS: None.
      * RETURNS: None.
      */
-    VOID Draw( VOID );
+    VOID Clear( VOID )
+    {
+      Resize(0);
+    } /* End of 'Clear' function */
 
-  }; /* End of 'emitter' function */
+    /* Move alive particles of range to its beginning function (order is kept).
+     * ARGUMENTS:
+     *   - particles range:
+     *       size_t Begin, End;
+     * RETURNS:
+     *   (size_t) number of alive particles.
+     */
+    size_t Compact( size_t Begin, size_t End );
 
+    /* Move particles function (destination is before source).
+     * ARGUMENTS:
+     *   - source and destination index:
+     *       size_t Src, Dst;
+     *   - number of particles:
+     *       size_t Count;
+     * RETURNS: None.
+     */
+    VOID Move( size_t Src, size_t Dst, size_t Count );
+
+    /* Integrate particles function.
+     * ARGUMENTS:
+     *   - delta time:
+     *       FLT DeltaTime;
+     *   - speed range (no limits if maximum is 0):
+     *       FLT SpeedMin, SpeedMax;
+     *   - particles range:
+     *       size_t Begin, End;
+     * RETURNS: None.
+     */
+    VOID Integrate( FLT DeltaTime, FLT SpeedMin, FLT SpeedMax, size_t Begin, size_t End );
+  }; /* End of 'particle_pool' class */
+
+  /* Particle point vertex (location 0 - position, 1 - size, 2 - transparency) */
+  struct particle_vertex
+  {
+    vec3 P;     // World space position
+    FLT Size;   // Billboard half size
+    FLT Trans;  // Transparency
+  }; /* End of 'particle_vertex' struct */
+
+  class particle_budget;
 
   /* Particles emitter representation class */
   class emitter
   {
+    friend class particle_budget;
+
   protected:
-    std::vector<particle *> Particles;
+    particle_pool Pool;
     shader *Shader;
     texture *Texture;
+    UINT VA = 0, VBuf = 0;                   // Point vertex array and streamed buffer
+    size_t VBufSize = 0;                     // Vertex buffer size in bytes
+    std::vector<particle_vertex> Vertices;   // Vertex data of last frame
+
+  private:
+    /* Frame state filled by 'Response' */
+    DBL LastTime = -1;                       // Time of last response (-1 before first one)
+    BOOL IsQueued = FALSE;                   // Emitter is simulated this frame
+    FLT EmitCarry = 0;                       // Fraction of particle left by scaled emission
+    FLT LifeScale = 1;                       // Lifetime scale of particles emitted this frame
+    FLT Coverage = 0;                        // Screen coverage this frame
+    FLT FrameDeltaTime = 0;                  // Frame delta time
+    matr FrameMatr;                          // Frame emission matrix
+    size_t EmitFirst = 0, EmitCount = 0;     // Pool range of particles emitted this frame
+    std::vector<size_t> ChunkAlive;          // Number of alive particles of every chunk
+    emitter *Leader = nullptr;               // First emitter of batch with same material
+    size_t BatchFirst = 0;                   // First particle in batch arrays
+    std::vector<particle_vertex> Unsorted;   // Batch vertices in pool order (leader only)
+    std::vector<UINT64> SortItems, SortTmp;  // Batch depth keys with indices (leader only)
+
+  public:
+    static const size_t
+      ChunkSize = 4096,                      // Particles per simulation job
+      EmitChunkSize = 256;                   // Particles per emission job (and random stream)
+    UINT64
+      Seed = 0,                              // Random streams seed
+      NumOfStreams = 0;                      // Number of random streams used (one per emission chunk)
+    INT Priority = 0;                        // Budget priority (higher is served first)
+    FLT Radius = 1;                          // Effect world radius for screen coverage
+    size_t
+      NumOfRequested = 0,                    // Particles requested by last emission
+      NumOfGranted = 0;                      // Particles emitted by last emission
+    UINT64 TotalEmitted = 0;                 // Number of particles emitted for all time
 
   public:
     DBL Age,
@@ -90,6 +316,12 @@ namespace digl
     INT NumOfParticles;
     BOOL IsImmortal;
     matr Matr;
+    particle_curve
+      Size,                // Billboard half size of particle age
+      Trans;               // Transparency of particle age
+    FLT
+      SpeedMin = 0,        // Particle speed range (no limits if maximum is 0)
+      SpeedMax = 0;
 
     /* Emitter constructor function.
      * ARGUMENTS: None.
@@ -111,15 +343,11 @@ namespace digl
     {
     } /* End of 'emitter' function */
 
-    /* Emitter constructor function.
+    /* Emitter destructor function.
      * ARGUMENTS: None.
      * RETURNS: None.
      */
-    ~emitter( VOID )
-    {
-      for (auto it = Particles.begin(); it != Particles.end(); ++it)
-        delete *it;
-    } /* End of '~emitter' function */
+    virtual ~emitter( VOID );
 
     /* Emmiter initialization function.
     * ARGUMENTS: None.
@@ -130,29 +358,125 @@ namespace digl
     {
     } /* End of 'Init' function */
 
-    /* Emit particle function. 
-     * ARGUMENTS: None.
+    /* Emit particle function (sets new particle of pool).
+     * Called from simulation jobs, so only given pool particle may be changed.
+     * ARGUMENTS:
+     *   - emitter world matrix:
+     *       const matr &WorldMatr;
+     *   - random stream of emission chunk:
+     *       rng &Rnd;
+     *   - pool index of particle:
+     *       size_t Index;
      * RETURNS None.
      */
-    virtual VOID EmitParticle( const matr &WorldMatr = matr::Identity() )
+    virtual VOID EmitParticle( const matr &WorldMatr, rng &Rnd, size_t Index )
     {
+      Pool.Set(Index, WorldMatr.TransformPoint(vec3(0)), vec3(0), vec3(0), 0);
     } /* End of 'EmitParticle' function */
 
-    /* Response particle function.
-     * ARGUMENTS:
-     *   - particle for response:
-     *       particle *Prt;
-     * RETURNS: None.
+    /* Get number of alive particles function.
+     * ARGUMENTS: None.
+     * RETURNS:
+     *   (size_t) number of particles.
      */
-    virtual VOID ResponseParticle( particle *Prt, const DBL DeltaTime )
+    size_t GetNumOfAlive( VOID ) const
     {
-    } /* End of 'ResponseParticle'*/
+      return Pool.Size();
+    } /* End of 'GetNumOfAlive' function */
 
+    /* Response emitter function (queues emitter for 'Simulate').
+     * ARGUMENTS:
+     *   - emitter parent world matrix:
+     *       const matr &WorldMatr;
+     * RETURNS: None.
+     */
     VOID Response( const matr &WorldMatr = matr::Identity() );
 
+    /* Queue emitter for 'Simulate' at given time function.
+     * ARGUMENTS:
+     *   - animation time:
+     *       DBL Time;
+     *   - emitter parent world matrix:
+     *       const matr &WorldMatr;
+     * RETURNS: None.
+     */
+    VOID Queue( DBL Time, const matr &WorldMatr = matr::Identity() );
+
+    /* Simulate queued emitters function.
+     * ARGUMENTS:
+     *   - emitters:
+     *       const std::vector<emitter *> &Emitters;
+     *   - particle budget (nullptr for no limits):
+     *       particle_budget *Budget;
+     * RETURNS: None.
+     */
+    static VOID Simulate( const std::vector<emitter *> &Emitters, particle_budget *Budget = nullptr );
+
+    /* Simulate queued emitters for camera function.
+     * ARGUMENTS:
+     *   - emitters:
+     *       const std::vector<emitter *> &Emitters;
+     *   - camera location and direction (particles are sorted back to front):
+     *       const vec3 &CamLoc, &CamDir;
+     *   - camera projection scale (near plane distance to projection size):
+     *       FLT ViewScale;
+     *   - particle budget (nullptr for no limits):
+     *       particle_budget *Budget;
+     * RETURNS: None.
+     */
+    static VOID Simulate( const std::vector<emitter *> &Emitters, const vec3 &CamLoc, const vec3 &CamDir,
+                          FLT ViewScale, particle_budget *Budget = nullptr );
+
+    /* Headless benchmark function (emitters of same material, 2 s particle lifetime, 60 Hz steps).
+     * ARGUMENTS:
+     *   - number of alive particles and steps:
+     *       INT NumOfParticles, NumOfSteps;
+     * RETURNS: None.
+     */
+    static VOID Benchmark( INT NumOfParticles, INT NumOfSteps );
+
+    /* Draw particles function.
+     * ARGUMENTS: None.
+     * RETURNS: None.
+     */
     VOID Draw( VOID );
   }; /* End of 'emitter' class */
 
+  /* Particle budget representation class.
+   * Emission of every queued emitter is scaled by its screen coverage
+   * (emitter radius seen from camera), emitters behind camera do not
+   * emit. Particles emitted far get shorter lifetime. Scaled requests
+   * are granted by priority (then by coverage) while global number of
+   * alive particles and number of particles emitted in frame fit caps.
+   */
+  class particle_budget
+  {
+  public:
+    size_t
+      MaxAlive = 200000,     // Global cap of alive particles
+      MaxEmitted = 20000;    // Global cap of particles emitted in one frame
+    FLT
+      FullCoverage = 0.05f,  // Coverage with full emission (fraction of screen size)
+      MinScale = 0.1f,       // Minimal emission scale of visible emitter
+      MinLifeScale = 0.5f;   // Lifetime scale of emitter with minimal emission
+    size_t
+      NumOfAlive = 0,        // Alive particles before emission in last frame
+      NumOfRequested = 0,    // Particles requested in last frame (before scaling)
+      NumOfGranted = 0;      // Particles emitted in last frame
+
+    /* Schedule emission of queued emitters function.
+     * ARGUMENTS:
+     *   - emitters:
+     *       const std::vector<emitter *> &Emitters;
+     *   - camera location and direction:
+     *       const vec3 &CamLoc, &CamDir;
+     *   - camera projection scale (near plane distance to projection size):
+     *       FLT ViewScale;
+     * RETURNS: None.
+     */
+    VOID Schedule( const std::vector<emitter *> &Emitters, const vec3 &CamLoc, const vec3 &CamDir, FLT ViewScale );
+  }; /* End of 'particle_budget' class */
+
   /* Water splash emitter representation type */
   class emitterWaterDrop : public emitter
   {
@@ -181,26 +505,21 @@ namespace digl
     VOID Init(const BOOL InIsImmortal, const DBL InDeltaTimeEmit,
       const INT InNumOfParticles, const DBL InDieAge = 0) override;
 
-    /* Emit particle function. 
-     * ARGUMENTS: None.
-     * RETURNS None.
-     */
-    VOID EmitParticle( const matr &WorldMatr = matr::Identity() ) override;
-
-    /* Response particle function.
+    /* Emit particle function.
      * ARGUMENTS:
-     *   - particle for response:
-     *       particle *Prt;
-     * RETURNS: None.
+     *   - emitter world matrix:
+     *       const matr &WorldMatr;
+     *   - random stream of emission chunk:
+     *       rng &Rnd;
+     *   - pool index of particle:
+     *       size_t Index;
+     * RETURNS None.
      */
-    VOID ResponseParticle( particle *Prt, const DBL DeltaTime ) override;
+    VOID EmitParticle( const matr &WorldMatr, rng &Rnd, size_t Index ) override;
   }; /* end of 'emitterWaterDrop' class */
 
 } /* end of 'digl' namespace */
 
-#endif /* __GEOM_H_ */
-
-/* END OF 'geom.h' FILE */
-
-
+#endif /* __PARTICLES_H_ */
 
+/* END OF 'particles.h' FILE */
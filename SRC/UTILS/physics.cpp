@@ -15,8 +15,12 @@
 
 /* Includes */
 #include "../ANIM/anim.h"
+#include "kinematics_system.h"
+#include "rng.h"
 #include "physics.h"
 
+#include <cstdio>
+
 /* Animation project namespace */
 namespace digl
 {
@@ -25,7 +29,7 @@ namespace digl
    * RETURNS: None.
    */
   kinematics::kinematics( VOID ) :
-    IsPauseIgnore(TRUE), TimeLastComputation(anim::GetPtr()->GlobalTime),
+    IsPauseIgnore(TRUE), TimeLastComputation(-1),
     SpeedMin(0), SpeedMax(0), SpeedCur(0), AccelCur(0),
     DeltaValue(0), StartValue(0), Value(0), Accels()
   {
@@ -43,7 +47,7 @@ namespace digl
     SpeedMax(Val.SpeedMax),
     SpeedCur(Val.SpeedCur),
     AccelCur(Val.AccelCur),
-    TimeLastComputation(Val.IsPauseIgnore ? anim::GetPtr()->GlobalTime : anim::GetPtr()->Time),
+    TimeLastComputation(-1),
     DeltaValue(0), StartValue(0), Value(0),
     Accels()
     {
@@ -60,7 +64,7 @@ namespace digl
     const FLT &InSpeedMin, const FLT &InSpeedMax,
     const FLT &InSpeedCur, const FLT &InAccelCur ) :
     IsPauseIgnore(InIsPauseIgnore),
-    TimeLastComputation(IsPauseIgnore ? anim::GetPtr()->GlobalTime : anim::GetPtr()->Time),
+    TimeLastComputation(-1),
     SpeedMin(InSpeedMin),
     SpeedMax(InSpeedMax),
     SpeedCur(InSpeedCur),
@@ -126,28 +130,22 @@ namespace digl
   VOID kinematics::Compute( VOID )
   {
     anim *AC = anim::GetPtr();
-    /* Compute delta time */
-    DBL DeltaTime;
-    if (IsPauseIgnore)
-    {
-      DeltaTime = AC->GlobalTime - TimeLastComputation;
-      TimeLastComputation = AC->GlobalTime;
-    }
-    else
-    {
-      DeltaTime = AC->Time - TimeLastComputation;
-      TimeLastComputation = AC->Time;
-    }
+    DBL Time = IsPauseIgnore ? AC->GlobalTime : AC->Time;
 
-    /* Compute delta value */
-    if (SpeedCur == SpeedMax || SpeedCur == SpeedMin)
-      DeltaValue = SpeedCur * DeltaTime;
-    else
-      DeltaValue = (SpeedCur + AccelCur * 0.5 * DeltaTime) * DeltaTime;
-    Value += DeltaValue;
+    /* First computation only starts time counting */
+    Compute(TimeLastComputation < 0 ? 0 : Time - TimeLastComputation);
+    TimeLastComputation = Time;
+  } /* End of 'Compute' function */
 
-    /* Compute speed */
-    SpeedCur = mth::Span<FLT>(SpeedMin, SpeedMax, SpeedCur + AccelCur * DeltaTime);
+  /* Compute speed and value by explicit delta time function.
+   * ARGUMENTS:
+   *   - delta time:
+   *       DBL DeltaTime;
+   * RETURNS: None.
+   */
+  VOID kinematics::Compute( DBL DeltaTime )
+  {
+    DeltaValue = kinematics_system::Step(Value, SpeedCur, AccelCur, SpeedMin, SpeedMax, (FLT)DeltaTime);
   } /* End of 'Compute' function */
 
   /* Kinematic constructor function.
@@ -155,7 +153,7 @@ namespace digl
    * RETURNS: None.
    */
   kinematicsVec::kinematicsVec( VOID ) :
-    IsPauseIgnore(TRUE), TimeLastComputation(anim::GetPtr()->GlobalTime),
+    IsPauseIgnore(TRUE), TimeLastComputation(-1),
     SpeedMin(0), SpeedMax(0), SpeedCur(0), AccelCur(0),
     DeltaValue(0), StartValue(0), Value(0), Accels()
   {
@@ -173,7 +171,7 @@ namespace digl
     SpeedMax(Val.SpeedMax),
     SpeedCur(Val.SpeedCur),
     AccelCur(Val.AccelCur),
-    TimeLastComputation(Val.IsPauseIgnore ? anim::GetPtr()->GlobalTime : anim::GetPtr()->Time),
+    TimeLastComputation(-1),
     DeltaValue(0), StartValue(0), Value(0),
     Accels()
   {
@@ -190,7 +188,7 @@ namespace digl
     const FLT &InSpeedMin, const FLT &InSpeedMax,
     const vec3 &InSpeedCur, const vec3 &InAccelCur) :
     IsPauseIgnore(InIsPauseIgnore),
-    TimeLastComputation(IsPauseIgnore ? anim::GetPtr()->GlobalTime : anim::GetPtr()->Time),
+    TimeLastComputation(-1),
     SpeedMin(InSpeedMin),
     SpeedMax(InSpeedMax),
     SpeedCur(InSpeedCur),
@@ -214,7 +212,7 @@ namespace digl
     AccelCur = InAccelCur;
     StartValue = InStartValue;
     Value = StartValue;
-    TimeLastComputation = IsPauseIgnore ? anim::GetPtr()->GlobalTime : anim::GetPtr()->Time;
+    TimeLastComputation = -1;
   } /* End of 'Init' function */
 
   /* Set current acceleration function.
@@ -257,33 +255,404 @@ namespace digl
   VOID kinematicsVec::Compute( VOID )
   {
     anim *AC = anim::GetPtr();
-    /* Compute delta time */
-    DBL DeltaTime;
-    if (IsPauseIgnore)
+    DBL Time = IsPauseIgnore ? AC->GlobalTime : AC->Time;
+
+    /* First computation only starts time counting */
+    Compute(TimeLastComputation < 0 ? 0 : Time - TimeLastComputation);
+    TimeLastComputation = Time;
+  } /* End of 'Compute' function */
+
+  /* Compute speed and value by explicit delta time function.
+   * ARGUMENTS:
+   *   - delta time:
+   *       DBL DeltaTime;
+   * RETURNS: None.
+   */
+  VOID kinematicsVec::Compute( DBL DeltaTime )
+  {
+    DeltaValue = kinematics_system::Step(Value, SpeedCur, AccelCur, SpeedMin, SpeedMax, (FLT)DeltaTime);
+  } /* End of 'Compute' function */
+  /* Lazy kinematics constructor function.
+   * ARGUMENTS:
+   *   - start time and value:
+   *       DBL InStartTime;
+   *       FLT InStartValue;
+   *   - min and max speed:
+   *       FLT InSpeedMin, InSpeedMax;
+   *   - start speed and acceleration:
+   *       FLT InSpeed, InAccel;
+   */
+  kinematicsLazy::kinematicsLazy( DBL InStartTime, FLT InStartValue,
+    FLT InSpeedMin, FLT InSpeedMax, FLT InSpeed, FLT InAccel ) :
+    StartTime(InStartTime), StartValue(InStartValue), StartSpeed(0), Accel(InAccel),
+    SpeedMin(InSpeedMin), SpeedMax(InSpeedMax)
+  {
+    Rebase(InStartTime, InStartValue, InSpeed);
+  } /* End of 'kinematicsLazy' function */
+
+  /* Start new segment function.
+   * ARGUMENTS:
+   *   - segment start time:
+   *       DBL Time;
+   *   - value and speed at start:
+   *       FLT Value, Speed;
+   * RETURNS: None.
+   */
+  VOID kinematicsLazy::Rebase( DBL Time, FLT Value, FLT Speed )
+  {
+    StartTime = Time;
+    StartValue = Value;
+    StartSpeed = mth::Span(SpeedMin, SpeedMax, Speed);
+  } /* End of 'kinematicsLazy::Rebase' function */
+
+  /* Evaluate value and speed function.
+   * ARGUMENTS:
+   *   - time (not before segment start):
+   *       DBL Time;
+   *   - result value and speed:
+   *       FLT &Value, &Speed;
+   * RETURNS: None.
+   */
+  VOID kinematicsLazy::Evaluate( DBL Time, FLT &Value, FLT &Speed ) const
+  {
+    DBL
+      t = mth::Max(Time - StartTime, 0.0),
+      Limit = Accel > 0 ? SpeedMax : SpeedMin,
+      /* Time of reaching speed limit */
+      tc = Accel == 0 ? t : mth::Min(t, (Limit - StartSpeed) / Accel);
+
+    Value = (FLT)(StartValue + (StartSpeed + Accel * 0.5 * tc) * tc);
+    Speed = (FLT)(StartSpeed + Accel * tc);
+    if (tc < t)
+    {
+      Speed = (FLT)Limit;
+      Value += (FLT)(Limit * (t - tc));
+    }
+  } /* End of 'kinematicsLazy::Evaluate' function */
+
+  /* Set acceleration from time function.
+   * ARGUMENTS:
+   *   - time of change:
+   *       DBL Time;
+   *   - new acceleration:
+   *       FLT InAccel;
+   * RETURNS: None.
+   */
+  VOID kinematicsLazy::SetAccel( DBL Time, FLT InAccel )
+  {
+    FLT Value, Speed;
+
+    Evaluate(Time, Value, Speed);
+    Rebase(Time, Value, Speed);
+    Accel = InAccel;
+  } /* End of 'kinematicsLazy::SetAccel' function */
+
+  /* Set value from time function.
+   * ARGUMENTS:
+   *   - time of change:
+   *       DBL Time;
+   *   - new value:
+   *       FLT Value;
+   * RETURNS: None.
+   */
+  VOID kinematicsLazy::SetValue( DBL Time, FLT Value )
+  {
+    FLT Old, Speed;
+
+    Evaluate(Time, Old, Speed);
+    Rebase(Time, Value, Speed);
+  } /* End of 'kinematicsLazy::SetValue' function */
+
+  /* Lazy vector kinematics constructor function.
+   * ARGUMENTS:
+   *   - start time and value:
+   *       DBL InStartTime;
+   *       const vec3 &InStartValue;
+   *   - min and max speed length:
+   *       FLT InSpeedMin, InSpeedMax;
+   *   - start speed and acceleration:
+   *       const vec3 &InSpeed, &InAccel;
+   */
+  kinematicsLazyVec::kinematicsLazyVec( DBL InStartTime, const vec3 &InStartValue,
+    FLT InSpeedMin, FLT InSpeedMax, const vec3 &InSpeed, const vec3 &InAccel ) :
+    StartTime(InStartTime), StartValue(InStartValue), StartSpeed(0), Accel(InAccel),
+    SpeedMin(InSpeedMin), SpeedMax(InSpeedMax)
+  {
+    Rebase(InStartTime, InStartValue, InSpeed);
+  } /* End of 'kinematicsLazyVec' function */
+
+  /* Start new segment function.
+   * ARGUMENTS:
+   *   - segment start time:
+   *       DBL Time;
+   *   - value and speed at start:
+   *       const vec3 &Value, &Speed;
+   * RETURNS: None.
+   */
+  VOID kinematicsLazyVec::Rebase( DBL Time, const vec3 &Value, const vec3 &Speed )
+  {
+    FLT Len = !Speed;
+
+    StartTime = Time;
+    StartValue = Value;
+    StartSpeed = Speed;
+    if (Len > SpeedMax)
+      StartSpeed = Speed.Normalizing() * SpeedMax;
+    else if (Len < SpeedMin)
+      StartSpeed = Speed.Normalizing() * SpeedMin;
+  } /* End of 'kinematicsLazyVec::Rebase' function */
+
+  /* Logarithm of hyperbolic cosine function.
+   * ARGUMENTS:
+   *   - argument:
+   *       DBL X;
+   * RETURNS:
+   *   (DBL) ln(cosh(X)) without overflow.
+   */
+  static DBL LnCosh( DBL X )
+  {
+    X = fabs(X);
+    return X + log1p(exp(-2 * X)) - log(2.0);
+  } /* End of 'LnCosh' function */
+
+  /* Gudermannian function.
+   * ARGUMENTS:
+   *   - argument:
+   *       DBL X;
+   * RETURNS:
+   *   (DBL) integral of 1 / cosh from 0 to X.
+   */
+  static DBL Gd( DBL X )
+  {
+    return 2 * atan(tanh(X / 2));
+  } /* End of 'Gd' function */
+
+  /* Move on speed range sphere function.
+   * Speed angle to acceleration 'Th' changes as Th' = -|A| / R * sin(Th),
+   * so u = ln(tan(Th / 2)) is linear in time; speed is
+   * R * (-tanh(u) * A0 + E / cosh(u)), where A0 - acceleration direction,
+   * E - unit speed part orthogonal to it.
+   * ARGUMENTS:
+   *   - value and speed to change:
+   *       vec3 &Value, &Speed;
+   *   - acceleration:
+   *       const vec3 &Accel;
+   *   - sphere radius:
+   *       DBL R;
+   *   - time:
+   *       DBL t;
+   * RETURNS: None.
+   */
+  static VOID SphereMove( vec3 &Value, vec3 &Speed, const vec3 &Accel, DBL R, DBL t )
+  {
+    DBL AccelLen = !Accel, Along = (Speed & Accel) / AccelLen;
+    vec3
+      A0 = Accel / (FLT)AccelLen,
+      Ortho = Speed - A0 * (FLT)Along;
+    DBL OrthoLen = !Ortho;
+
+    /* Speed is along acceleration line - it is not turned */
+    if (OrthoLen <= R * 1e-6)
     {
-      DeltaTime = AC->GlobalTime - TimeLastComputation;
-      TimeLastComputation = AC->GlobalTime;
+      Value += Speed * (FLT)t;
+      return;
     }
-    else
+
+    vec3 E = Ortho / (FLT)OrthoLen;
+    DBL
+      k = AccelLen / R,
+      u0 = log(tan(atan2(OrthoLen, Along) / 2)),
+      u = u0 - k * t;
+
+    Value += A0 * (FLT)(R / k * (LnCosh(u) - LnCosh(u0))) + E * (FLT)(R / k * (Gd(u0) - Gd(u)));
+    Speed = (A0 * (FLT)-tanh(u) + E * (FLT)(1 / cosh(u))) * (FLT)R;
+  } /* End of 'SphereMove' function */
+
+  /* Evaluate value and speed function.
+   * ARGUMENTS:
+   *   - time (not before segment start):
+   *       DBL Time;
+   *   - result value and speed:
+   *       vec3 &Value, &Speed;
+   * RETURNS: None.
+   */
+  VOID kinematicsLazyVec::Evaluate( DBL Time, vec3 &Value, vec3 &Speed ) const
+  {
+    DBL
+      t = mth::Max(Time - StartTime, 0.0),
+      A2 = Accel & Accel;
+    BOOL IsLeavingMin = FALSE;
+
+    Value = StartValue;
+    Speed = StartSpeed;
+    if (SpeedMax <= 0)
     {
-      DeltaTime = AC->Time - TimeLastComputation;
-      TimeLastComputation = AC->Time;
+      Speed = vec3(0);
+      return;
+    }
+    if (A2 == 0)
+    {
+      Value += Speed * (FLT)t;
+      return;
     }
 
-    /* Compute delta value */
-    if (!SpeedCur == SpeedMax || !SpeedCur == SpeedMin)
-      DeltaValue = SpeedCur * DeltaTime;
-    else
-      DeltaValue = (SpeedCur + AccelCur * 0.5 * DeltaTime) * DeltaTime;
-    Value += DeltaValue;
-
-    /* Compute speed */
-    SpeedCur = SpeedCur + AccelCur * DeltaTime;
-    if (!SpeedCur > SpeedMax)
-      SpeedCur = SpeedCur.Normalizing() * SpeedMax;
-    else if (!SpeedCur < SpeedMin)
-      SpeedCur = SpeedCur.Normalizing() * SpeedMin;
-  } /* End of 'Compute' function */
+    /* Parts: free flight, on min sphere (up to speed orthogonal to
+     * acceleration), free flight, on max sphere */
+    for (INT Part = 0; Part < 4; Part++)
+    {
+      DBL
+        Len2 = Speed & Speed,
+        Len = sqrt(Len2),
+        b = Speed & Accel;
+
+      if (b > 0 && Len >= SpeedMax * (1 - 1e-6))
+      {
+        SphereMove(Value, Speed, Accel, SpeedMax, t);
+        return;
+      }
+      if (!IsLeavingMin && SpeedMin > 0 && b < 0 && Len <= SpeedMin * (1 + 1e-6))
+      {
+        /* Leave sphere when speed becomes orthogonal to acceleration (u = 0) */
+        DBL
+          AccelLen = sqrt(A2),
+          Ortho = sqrt(mth::Max(Len2 - b * b / A2, 0.0)),
+          te = log(tan(atan2(Ortho, b / AccelLen) / 2)) / (AccelLen / SpeedMin);
+
+        SphereMove(Value, Speed, Accel, SpeedMin, mth::Min(t, te));
+        if (t <= te)
+          return;
+        t -= te;
+        IsLeavingMin = TRUE;
+        continue;
+      }
+
+      /* Free flight up to speed range sphere */
+      DBL te = (-b + sqrt(mth::Max(b * b - A2 * (Len2 - (DBL)SpeedMax * SpeedMax), 0.0))) / A2;
+      BOOL IsMax = TRUE;
+
+      if (!IsLeavingMin && SpeedMin > 0 && b < 0)
+      {
+        DBL D = b * b - A2 * (Len2 - (DBL)SpeedMin * SpeedMin);
+
+        if (D > 0)
+        {
+          DBL tm = (-b - sqrt(D)) / A2;
+
+          if (tm >= 0 && tm < te)
+            te = tm, IsMax = FALSE;
+        }
+      }
+      if (t <= te)
+      {
+        Value += (Speed + Accel * (FLT)(t / 2)) * (FLT)t;
+        Speed += Accel * (FLT)t;
+        return;
+      }
+      Value += (Speed + Accel * (FLT)(te / 2)) * (FLT)te;
+      Speed += Accel * (FLT)te;
+      Speed = Speed.Normalizing() * (IsMax ? SpeedMax : SpeedMin);
+      t -= te;
+      IsLeavingMin = FALSE;
+    }
+  } /* End of 'kinematicsLazyVec::Evaluate' function */
+
+  /* Set acceleration from time function.
+   * ARGUMENTS:
+   *   - time of change:
+   *       DBL Time;
+   *   - new acceleration:
+   *       const vec3 &InAccel;
+   * RETURNS: None.
+   */
+  VOID kinematicsLazyVec::SetAccel( DBL Time, const vec3 &InAccel )
+  {
+    vec3 Value, Speed;
+
+    Evaluate(Time, Value, Speed);
+    Rebase(Time, Value, Speed);
+    Accel = InAccel;
+  } /* End of 'kinematicsLazyVec::SetAccel' function */
+
+  /* Set value from time function.
+   * ARGUMENTS:
+   *   - time of change:
+   *       DBL Time;
+   *   - new value:
+   *       const vec3 &Value;
+   * RETURNS: None.
+   */
+  VOID kinematicsLazyVec::SetValue( DBL Time, const vec3 &Value )
+  {
+    vec3 Old, Speed;
+
+    Evaluate(Time, Old, Speed);
+    Rebase(Time, Value, Speed);
+  } /* End of 'kinematicsLazyVec::SetValue' function */
+
+  /* Headless check of lazy kinematics against explicit steps function.
+   * ARGUMENTS:
+   *   - number of explicit steps:
+   *       INT NumOfSteps;
+   * RETURNS:
+   *   (BOOL) TRUE if results agree within step error.
+   */
+  BOOL KinematicsLazyTest( INT NumOfSteps )
+  {
+    const INT NumOfCases = 1000;
+    const FLT DeltaTime = 1.0f / 60;
+    const DBL Duration = NumOfSteps * (DBL)DeltaTime, Switch = (NumOfSteps / 2) * (DBL)DeltaTime;
+    rng Rnd(30, 0);
+    /* Largest errors relative to maximal path and maximal speed */
+    DBL ValueError = 0, SpeedError = 0, VecValueError = 0, VecSpeedError = 0;
+
+    for (INT c = 0; c < NumOfCases; c++)
+    {
+      FLT
+        Min = c % 3 == 0 ? 0 : Rnd.Rnd0() * 5, Max = Min + 1 + Rnd.Rnd0() * 20,
+        Path = (FLT)(Max * Duration) + 1e-3f;
+      vec3 Value = Rnd.Vec1() * 100, Speed = Rnd.Vec1() * Max, Accel = Rnd.Vec1() * 10, Accel2 = Rnd.Vec1() * 10;
+
+      /* Scalar motion (speed range is symmetric) */
+      kinematicsLazy Lazy(0, Value[0], -Max, Max, Speed[0], Accel[0]);
+      FLT X = Value[0], V = mth::Span(-Max, Max, Speed[0]), LazyX, LazyV;
+
+      Lazy.SetAccel(Switch, Accel2[0]);
+      for (INT s = 0; s < NumOfSteps; s++)
+        kinematics_system::Step(X, V, s < NumOfSteps / 2 ? Accel[0] : Accel2[0], -Max, Max, DeltaTime);
+      Lazy.Evaluate(Duration, LazyX, LazyV);
+      ValueError = mth::Max(ValueError, (DBL)fabs(LazyX - X) / Path);
+      SpeedError = mth::Max(SpeedError, (DBL)fabs(LazyV - V) / Max);
+
+      /* Vector motion (start speed is clamped to range as lazy motion does) */
+      kinematicsLazyVec LazyVec(0, Value, Min, Max, Speed, Accel);
+      vec3 LazyValue, LazySpeed;
+      FLT Len = !Speed;
+
+      LazyVec.SetAccel(Switch, Accel2);
+      if (Len > Max)
+        Speed = Speed.Normalizing() * Max;
+      else if (Len < Min)
+        Speed = Speed.Normalizing() * Min;
+      for (INT s = 0; s < NumOfSteps; s++)
+        kinematics_system::Step(Value, Speed, s < NumOfSteps / 2 ? Accel : Accel2, Min, Max, DeltaTime);
+      LazyVec.Evaluate(Duration, LazyValue, LazySpeed);
+      VecValueError = mth::Max(VecValueError, (DBL)!(LazyValue - Value) / Path);
+      VecSpeedError = mth::Max(VecSpeedError, (DBL)!(LazySpeed - Speed) / Max);
+    }
+
+    /* Explicit steps project speed to range sphere, so they lag behind exact turning by about one step */
+    BOOL IsOk =
+      ValueError < 0.01 && SpeedError < 0.01 &&
+      VecValueError < 0.01 + 2.0 / mth::Max(NumOfSteps, 1) && VecSpeedError < 0.05;
+    CHAR Buf[300];
+
+    sprintf(Buf, "Lazy kinematics: %i cases, %i steps, largest errors: scalar %.5f value, %.5f speed, "
+      "vector %.5f value, %.5f speed: %s\n", NumOfCases, NumOfSteps, ValueError, SpeedError,
+      VecValueError, VecSpeedError, IsOk ? "ok" : "MISMATCH");
+    OutputDebugString(Buf);
+    printf("%s", Buf);
+    return IsOk;
+  } /* End of 'KinematicsLazyTest' function */
 } /* end of 'digl' namespace */
 
 /* END OF 'physics.cpp' FILE */
@@ -29,7 +29,7 @@ namespace digl
   private:
     BOOL IsPauseIgnore;
     DBL
-      TimeLastComputation;
+      TimeLastComputation;  // Clock of last computation (-1 before first one)
 
   public:
     FLT
@@ -101,6 +101,14 @@ namespace digl
      * RETURNS: None.
      */
     VOID Compute( VOID );
+
+    /* Compute speed and value by explicit delta time function.
+     * ARGUMENTS:
+     *   - delta time:
+     *       DBL DeltaTime;
+     * RETURNS: None.
+     */
+    VOID Compute( DBL DeltaTime );
   }; /* End of 'kinematics' class */
 
   /*Vector kinematics representation type */
@@ -109,7 +117,7 @@ namespace digl
   private:
     BOOL IsPauseIgnore;
     DBL
-      TimeLastComputation;
+      TimeLastComputation;  // Clock of last computation (-1 before first one)
 
   public:
     FLT
@@ -183,7 +191,233 @@ namespace digl
      * RETURNS: None.
      */
     VOID Compute( VOID );
+
+    /* Compute speed and value by explicit delta time function.
+     * ARGUMENTS:
+     *   - delta time:
+     *       DBL DeltaTime;
+     * RETURNS: None.
+     */
+    VOID Compute( DBL DeltaTime );
   }; /* End of 'kinematicsVec' class */
+
+  /* Lazy kinematics representation type.
+   * Motion is stored as segment of constant acceleration (start time,
+   * value, speed, acceleration, speed range) and is evaluated exactly
+   * at any requested time, so nothing is computed while nobody asks. */
+  class kinematicsLazy
+  {
+  private:
+    DBL StartTime;   // Segment start time
+    FLT
+      StartValue,    // Value at segment start
+      StartSpeed,    // Speed at segment start
+      Accel;         // Segment acceleration
+
+    /* Start new segment function.
+     * ARGUMENTS:
+     *   - segment start time:
+     *       DBL Time;
+     *   - value and speed at start:
+     *       FLT Value, Speed;
+     * RETURNS: None.
+     */
+    VOID Rebase( DBL Time, FLT Value, FLT Speed );
+
+  public:
+    FLT
+      SpeedMin,
+      SpeedMax;
+
+    /* Lazy kinematics constructor function.
+     * ARGUMENTS:
+     *   - start time and value:
+     *       DBL InStartTime;
+     *       FLT InStartValue;
+     *   - min and max speed:
+     *       FLT InSpeedMin, InSpeedMax;
+     *   - start speed and acceleration:
+     *       FLT InSpeed, InAccel;
+     */
+    kinematicsLazy( DBL InStartTime = 0, FLT InStartValue = 0,
+      FLT InSpeedMin = 0, FLT InSpeedMax = 0, FLT InSpeed = 0, FLT InAccel = 0 );
+
+    /* Evaluate value and speed function.
+     * ARGUMENTS:
+     *   - time (not before segment start):
+     *       DBL Time;
+     *   - result value and speed:
+     *       FLT &Value, &Speed;
+     * RETURNS: None.
+     */
+    VOID Evaluate( DBL Time, FLT &Value, FLT &Speed ) const;
+
+    /* Get value function.
+     * ARGUMENTS:
+     *   - time:
+     *       DBL Time;
+     * RETURNS:
+     *   (FLT) value.
+     */
+    FLT GetValue( DBL Time ) const
+    {
+      FLT Value, Speed;
+
+      Evaluate(Time, Value, Speed);
+      return Value;
+    } /* End of 'GetValue' function */
+
+    /* Get speed function.
+     * ARGUMENTS:
+     *   - time:
+     *       DBL Time;
+     * RETURNS:
+     *   (FLT) speed.
+     */
+    FLT GetSpeed( DBL Time ) const
+    {
+      FLT Value, Speed;
+
+      Evaluate(Time, Value, Speed);
+      return Speed;
+    } /* End of 'GetSpeed' function */
+
+    /* Set acceleration from time function.
+     * ARGUMENTS:
+     *   - time of change:
+     *       DBL Time;
+     *   - new acceleration:
+     *       FLT InAccel;
+     * RETURNS: None.
+     */
+    VOID SetAccel( DBL Time, FLT InAccel );
+
+    /* Set value from time function.
+     * ARGUMENTS:
+     *   - time of change:
+     *       DBL Time;
+     *   - new value:
+     *       FLT Value;
+     * RETURNS: None.
+     */
+    VOID SetValue( DBL Time, FLT Value );
+  }; /* End of 'kinematicsLazy' class */
+
+  /* Lazy vector kinematics representation type.
+   * Speed length is kept in range: free flight segment part is a
+   * parabola, on speed range sphere speed turns to acceleration
+   * direction (angle half tangent decreases exponentially), which is
+   * integrated in closed form too. */
+  class kinematicsLazyVec
+  {
+  private:
+    DBL StartTime;   // Segment start time
+    vec3
+      StartValue,    // Value at segment start
+      StartSpeed,    // Speed at segment start
+      Accel;         // Segment acceleration
+
+    /* Start new segment function.
+     * ARGUMENTS:
+     *   - segment start time:
+     *       DBL Time;
+     *   - value and speed at start:
+     *       const vec3 &Value, &Speed;
+     * RETURNS: None.
+     */
+    VOID Rebase( DBL Time, const vec3 &Value, const vec3 &Speed );
+
+  public:
+    FLT
+      SpeedMin,
+      SpeedMax;
+
+    /* Lazy vector kinematics constructor function.
+     * ARGUMENTS:
+     *   - start time and value:
+     *       DBL InStartTime;
+     *       const vec3 &InStartValue;
+     *   - min and max speed length:
+     *       FLT InSpeedMin, InSpeedMax;
+     *   - start speed and acceleration:
+     *       const vec3 &InSpeed, &InAccel;
+     */
+    kinematicsLazyVec( DBL InStartTime = 0, const vec3 &InStartValue = vec3(0),
+      FLT InSpeedMin = 0, FLT InSpeedMax = 0,
+      const vec3 &InSpeed = vec3(0), const vec3 &InAccel = vec3(0) );
+
+    /* Evaluate value and speed function.
+     * ARGUMENTS:
+     *   - time (not before segment start):
+     *       DBL Time;
+     *   - result value and speed:
+     *       vec3 &Value, &Speed;
+     * RETURNS: None.
+     */
+    VOID Evaluate( DBL Time, vec3 &Value, vec3 &Speed ) const;
+
+    /* Get value function.
+     * ARGUMENTS:
+     *   - time:
+     *       DBL Time;
+     * RETURNS:
+     *   (vec3) value.
+     */
+    vec3 GetValue( DBL Time ) const
+    {
+      vec3 Value, Speed;
+
+      Evaluate(Time, Value, Speed);
+      return Value;
+    } /* End of 'GetValue' function */
+
+    /* Get speed function.
+     * ARGUMENTS:
+     *   - time:
+     *       DBL Time;
+     * RETURNS:
+     *   (vec3) speed.
+     */
+    vec3 GetSpeed( DBL Time ) const
+    {
+      vec3 Value, Speed;
+
+      Evaluate(Time, Value, Speed);
+      return Speed;
+    } /* End of 'GetSpeed' function */
+
+    /* Set acceleration from time function.
+     * ARGUMENTS:
+     *   - time of change:
+     *       DBL Time;
+     *   - new acceleration:
+     *       const vec3 &InAccel;
+     * RETURNS: None.
+     */
+    VOID SetAccel( DBL Time, const vec3 &InAccel );
+
+    /* Set value from time function.
+     * ARGUMENTS:
+     *   - time of change:
+     *       DBL Time;
+     *   - new value:
+     *       const vec3 &Value;
+     * RETURNS: None.
+     */
+    VOID SetValue( DBL Time, const vec3 &Value );
+  }; /* End of 'kinematicsLazyVec' class */
+
+  /* Headless check of lazy kinematics against explicit steps function.
+   * Random scalar and vector motions (acceleration is changed in the
+   * middle) are evaluated lazily and by 'kinematics_system::Step' calls
+   * of 1/60 second.
+   * ARGUMENTS:
+   *   - number of explicit steps:
+   *       INT NumOfSteps;
+   * RETURNS:
+   *   (BOOL) TRUE if results agree within step error.
+   */
+  BOOL KinematicsLazyTest( INT NumOfSteps );
 } /* end of 'digl' namespace */
 
 #endif /* __PHYSICS_H_ */
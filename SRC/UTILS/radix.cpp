@@ -0,0 +1,177 @@
+/***************************************************************
+ * Copyright (C) 2020
+ *    Computer Graphics Support Group of 30 Phys-Math Gymnasium
+ ***************************************************************/
+
+/* FILE NAME   : radix.cpp
+ * PURPOSE     : Radix sort file.
+ * PROGRAMMER  : Dmitriy Vlasov.
+ * LAST UPDATE : 19.10.2020
+ * NOTE        : Namespace 'digl'.
+ *
+ * No part of this file may be changed without agreement of
+ * Computer Graphics Support Group of 30 Phys-Math Gymnasium.
+ */
+
+/* Includes */
+#include "parallel.h"
+#include "rng.h"
+#include "radix.h"
+
+#include <algorithm>
+#include <cstdio>
+
+/* Animation project namespace */
+namespace digl
+{
+  /* Sort items by keys function.
+   * ARGUMENTS:
+   *   - items (key in high 32 bits, index in low 32 bits):
+   *       std::vector<UINT64> &Items;
+   *   - temporary buffer:
+   *       std::vector<UINT64> &Tmp;
+   * RETURNS: None.
+   */
+  VOID radix::Sort( std::vector<UINT64> &Items, std::vector<UINT64> &Tmp )
+  {
+    const INT Bits = 11, NumOfDigits = 1 << Bits, NumOfPasses = (32 + Bits - 1) / Bits;
+    size_t Count = Items.size();
+
+    if (Count < 2)
+      return;
+    Tmp.resize(Count);
+
+    /* One block keeps histograms of all passes (filled by single read),
+     * several blocks recount their ranges before every pass */
+    INT NumOfBlocks = Count < ParallelMin ? 1 : parallel::NumOfBlocks(Count, ParallelMin / 4);
+    std::vector<size_t> Hist((size_t)(NumOfBlocks == 1 ? NumOfPasses : NumOfBlocks) * NumOfDigits);
+    UINT64 *Src = Items.data(), *Dst = Tmp.data();
+
+    if (NumOfBlocks == 1)
+      for (size_t i = 0; i < Count; i++)
+      {
+        UINT64 Key = Src[i] >> 32;
+
+        for (INT p = 0; p < NumOfPasses; p++)
+          Hist[(size_t)p * NumOfDigits + ((Key >> (p * Bits)) & (NumOfDigits - 1))]++;
+      }
+
+    for (INT Pass = 0; Pass < NumOfPasses; Pass++)
+    {
+      INT Shift = 32 + Pass * Bits;
+      size_t *PassHist = NumOfBlocks == 1 ? &Hist[(size_t)Pass * NumOfDigits] : Hist.data();
+
+      /* Block histograms */
+      if (NumOfBlocks > 1)
+        parallel::For(Count, [&]( size_t Begin, size_t End, INT Block )
+          {
+            size_t *H = &PassHist[(size_t)Block * NumOfDigits];
+
+            memset(H, 0, sizeof(size_t) * NumOfDigits);
+            for (size_t i = Begin; i < End; i++)
+              H[(Src[i] >> Shift) & (NumOfDigits - 1)]++;
+          }, ParallelMin / 4);
+
+      /* Skip pass with one digit for all keys */
+      UINT64 Digit = (Src[0] >> Shift) & (NumOfDigits - 1);
+      size_t Same = 0;
+
+      for (INT b = 0; b < NumOfBlocks; b++)
+        Same += PassHist[(size_t)b * NumOfDigits + Digit];
+      if (Same == Count)
+        continue;
+
+      /* Block offsets: digit major, block minor (keeps order stable) */
+      size_t Sum = 0;
+
+      for (INT d = 0; d < NumOfDigits; d++)
+        for (INT b = 0; b < NumOfBlocks; b++)
+        {
+          size_t &H = PassHist[(size_t)b * NumOfDigits + d], N = H;
+
+          H = Sum;
+          Sum += N;
+        }
+
+      /* Block scatter */
+      auto Scatter = [&]( size_t Begin, size_t End, INT Block )
+      {
+        size_t *H = &PassHist[(size_t)Block * NumOfDigits];
+
+        for (size_t i = Begin; i < End; i++)
+          Dst[H[(Src[i] >> Shift) & (NumOfDigits - 1)]++] = Src[i];
+      };
+
+      if (NumOfBlocks == 1)
+        Scatter(0, Count, 0);
+      else
+        parallel::For(Count, Scatter, ParallelMin / 4);
+      std::swap(Src, Dst);
+    }
+    if (Src != Items.data())
+      Items.swap(Tmp);
+  } /* End of 'radix::Sort' function */
+
+  /* Headless check of sort against 'std::stable_sort' function.
+   * ARGUMENTS:
+   *   - number of items of largest check:
+   *       INT NumOfItems;
+   * RETURNS:
+   *   (BOOL) TRUE if all results match.
+   */
+  BOOL radix::Test( INT NumOfItems )
+  {
+    LARGE_INTEGER Freq, t0, t1;
+    CHAR Buf[300];
+    auto Ms = [&]( VOID )
+    {
+      QueryPerformanceCounter(&t1);
+      return (DBL)(t1.QuadPart - t0.QuadPart) * 1000 / Freq.QuadPart;
+    };
+    rng Rnd(30, 0);
+    std::vector<UINT64> Items, Tmp, Ref;
+    BOOL IsOk = TRUE;
+
+    QueryPerformanceFrequency(&Freq);
+    /* Key kinds: 0 - few distinct keys, 1 - float keys of both signs, 2 - all keys equal */
+    for (INT Size : {0, 1, 1000, (INT)ParallelMin + 1, NumOfItems})
+      for (INT Kind = 0; Kind < 3; Kind++)
+      {
+        Items.resize(Size);
+        for (INT i = 0; i < Size; i++)
+        {
+          UINT Key = Kind == 0 ? Rnd.Next() % (Size / 16 + 1) : Kind == 1 ? FloatKey(Rnd.Rnd1() * 1000) : 30;
+
+          /* Index in low bits checks order of items with equal keys */
+          Items[i] = (UINT64)Key << 32 | (UINT)i;
+        }
+        Ref = Items;
+
+        QueryPerformanceCounter(&t0);
+        std::stable_sort(Ref.begin(), Ref.end(),
+          []( UINT64 A, UINT64 B )
+          {
+            return A >> 32 < B >> 32;
+          });
+        DBL RefTime = Ms();
+
+        QueryPerformanceCounter(&t0);
+        Sort(Items, Tmp);
+        DBL Time = Ms();
+
+        BOOL IsSame = Items == Ref;
+
+        IsOk = IsOk && IsSame;
+        if (!IsSame || Size == NumOfItems)
+        {
+          sprintf(Buf, "Radix sort: %i items, %s keys: %s, %.3f ms (std::stable_sort %.3f ms)\n", Size,
+            Kind == 0 ? "duplicate" : Kind == 1 ? "float" : "equal", IsSame ? "ok" : "MISMATCH", Time, RefTime);
+          OutputDebugString(Buf);
+          printf("%s", Buf);
+        }
+      }
+    return IsOk;
+  } /* End of 'radix::Test' function */
+} /* end of 'digl' namespace */
+
+/* END OF 'radix.cpp' FILE */
@@ -0,0 +1,78 @@
+/***************************************************************
+ * Copyright (C) 2020
+ *    Computer Graphics Support Group of 30 Phys-Math Gymnasium
+ ***************************************************************/
+
+/* FILE NAME   : radix.h
+ * PURPOSE     : Radix sort header file.
+ * PROGRAMMER  : Dmitriy Vlasov.
+ * LAST UPDATE : 19.10.2020
+ * NOTE        : Namespace 'digl'.
+ *
+ *   Stable LSD radix sort of 32-bit keys with 32-bit indices (packed
+ *   together to 64-bit items), 11 bits per pass, passes with same digit
+ *   for all keys are skipped. Large arrays are sorted by thread blocks
+ *   (block histograms, prefix sums, stable block scatter).
+ *
+ * No part of this file may be changed without agreement of
+ * Computer Graphics Support Group of 30 Phys-Math Gymnasium.
+ */
+
+#ifndef __RADIX_H_
+#define __RADIX_H_
+
+#include "../def.h"
+
+#include <cstring>
+#include <vector>
+
+/* Animation project namespace */
+namespace digl
+{
+  /* Radix sort namespace */
+  namespace radix
+  {
+    /* Minimal number of items to sort in parallel */
+    const size_t ParallelMin = 1 << 16;
+
+    /* Convert float to key with same order function.
+     * ARGUMENTS:
+     *   - value:
+     *       FLT X;
+     * RETURNS:
+     *   (UINT) key.
+     */
+    inline UINT FloatKey( FLT X )
+    {
+      UINT U;
+
+      memcpy(&U, &X, sizeof(U));
+      return U ^ (U >> 31 ? 0xFFFFFFFF : 0x80000000);
+    } /* End of 'FloatKey' function */
+
+    /* Sort items by keys function.
+     * ARGUMENTS:
+     *   - items (key in high 32 bits, index in low 32 bits):
+     *       std::vector<UINT64> &Items;
+     *   - temporary buffer:
+     *       std::vector<UINT64> &Tmp;
+     * RETURNS: None.
+     */
+    VOID Sort( std::vector<UINT64> &Items, std::vector<UINT64> &Tmp );
+
+    /* Headless check of sort against 'std::stable_sort' function.
+     * Random keys with many duplicates (stability), negative float keys
+     * and equal keys are sorted, timings are reported for largest size.
+     * ARGUMENTS:
+     *   - number of items of largest check:
+     *       INT NumOfItems;
+     * RETURNS:
+     *   (BOOL) TRUE if all results match.
+     */
+    BOOL Test( INT NumOfItems );
+  } /* end of 'radix' namespace */
+} /* end of 'digl' namespace */
+
+#endif /* __RADIX_H_ */
+
+/* END OF 'radix.h' FILE */
@@ -0,0 +1,223 @@
+/***************************************************************
+ * Copyright (C) 2020
+ *    Computer Graphics Support Group of 30 Phys-Math Gymnasium
+ ***************************************************************/
+
+/* FILE NAME   : replay.cpp
+ * PURPOSE     : Input recording and replay file.
+ * PROGRAMMER  : Dmitriy Vlasov.
+ * LAST UPDATE : 19.10.2020
+ * NOTE        : Namespace 'digl'.
+ *
+ * No part of this file may be changed without agreement of
+ * Computer Graphics Support Group of 30 Phys-Math Gymnasium.
+ */
+
+/* Includes */
+#include "replay.h"
+
+/* Animation project namespace */
+namespace digl
+{
+  /* Log file signature and version */
+  static const CHAR Signature[4] = {'D', 'G', 'R', 'P'};
+  static const UINT Version = 1;
+
+  /* Zigzag coding of signed value */
+  static UINT Zig( INT X )
+  {
+    return (UINT)X << 1 ^ (UINT)(X >> 31);
+  } /* End of 'Zig' function */
+
+  /* Zigzag decoding of signed value */
+  static INT Unzig( UINT X )
+  {
+    return (INT)(X >> 1) ^ -(INT)(X & 1);
+  } /* End of 'Unzig' function */
+
+  /* Write unsigned varint function.
+   * ARGUMENTS:
+   *   - value:
+   *       UINT X;
+   * RETURNS: None.
+   */
+  VOID replay::Write( UINT X )
+  {
+    while (X >= 0x80)
+    {
+      fputc((INT)(X & 0x7F | 0x80), F);
+      X >>= 7;
+    }
+    fputc((INT)X, F);
+  } /* End of 'replay::Write' function */
+
+  /* Read unsigned varint function.
+   * ARGUMENTS: None.
+   * RETURNS:
+   *   (UINT) value (0 after log end).
+   */
+  UINT replay::Read( VOID )
+  {
+    UINT X = 0;
+
+    for (INT Shift = 0; Pos < Log.size() && Shift < 32; Shift += 7)
+    {
+      BYTE B = Log[Pos++];
+
+      X |= (UINT)(B & 0x7F) << Shift;
+      if (!(B & 0x80))
+        return X;
+    }
+    IsEnd = TRUE;
+    return 0;
+  } /* End of 'replay::Read' function */
+
+  /* Start recording function.
+   * ARGUMENTS:
+   *   - log file name:
+   *       const std::string &FileName;
+   *   - random seed and fixed delta time:
+   *       UINT64 NewSeed;
+   *       DBL NewDeltaTime;
+   * RETURNS:
+   *   (BOOL) TRUE if log file is created.
+   */
+  BOOL replay::Record( const std::string &FileName, UINT64 NewSeed, DBL NewDeltaTime )
+  {
+    if ((F = fopen(FileName.c_str(), "wb")) == nullptr)
+      return FALSE;
+    Seed = NewSeed;
+    DeltaTime = NewDeltaTime;
+    fwrite(Signature, 1, 4, F);
+    fwrite(&Version, 4, 1, F);
+    fwrite(&Seed, 8, 1, F);
+    fwrite(&DeltaTime, 8, 1, F);
+    IsRecord = TRUE;
+    IsEnd = IsClosed = FALSE;
+    return TRUE;
+  } /* End of 'replay::Record' function */
+
+  /* Start replay function.
+   * ARGUMENTS:
+   *   - log file name:
+   *       const std::string &FileName;
+   * RETURNS:
+   *   (BOOL) TRUE if log is loaded.
+   */
+  BOOL replay::Play( const std::string &FileName )
+  {
+    FILE *In;
+    CHAR Sign[4];
+    UINT Ver;
+
+    if ((In = fopen(FileName.c_str(), "rb")) == nullptr)
+      return FALSE;
+    if (fread(Sign, 1, 4, In) != 4 || memcmp(Sign, Signature, 4) != 0 ||
+        fread(&Ver, 4, 1, In) != 1 || Ver != Version ||
+        fread(&Seed, 8, 1, In) != 1 || fread(&DeltaTime, 8, 1, In) != 1)
+    {
+      fclose(In);
+      return FALSE;
+    }
+
+    BYTE Buf[4096];
+    size_t Len;
+
+    Log.clear();
+    while ((Len = fread(Buf, 1, sizeof(Buf), In)) > 0)
+      Log.insert(Log.end(), Buf, Buf + Len);
+    fclose(In);
+    Pos = 0;
+    IsPlay = TRUE;
+    IsEnd = IsClosed = FALSE;
+    return TRUE;
+  } /* End of 'replay::Play' function */
+
+  /* Record or replay tick input function.
+   * ARGUMENTS:
+   *   - keys state (0 or 1, replaced in replay):
+   *       BYTE *NewKeys;
+   *   - mouse and wheel deltas (replaced in replay):
+   *       INT &Dx, &Dy, &Dz;
+   * RETURNS: None.
+   */
+  VOID replay::Input( BYTE *NewKeys, INT &Dx, INT &Dy, INT &Dz )
+  {
+    if (IsRecord)
+    {
+      BYTE Changed[256];
+      INT NumOfChanged = 0;
+
+      for (INT i = 0; i < 256; i++)
+        if (NewKeys[i] != Keys[i])
+          Changed[NumOfChanged++] = (BYTE)i, Keys[i] = NewKeys[i];
+      Write(NumOfChanged);
+      fwrite(Changed, 1, NumOfChanged, F);
+      Write(Zig(Dx));
+      Write(Zig(Dy));
+      Write(Zig(Dz));
+    }
+    else if (IsPlay)
+    {
+      if (Tick == 0)
+      {
+        LARGE_INTEGER t;
+
+        QueryPerformanceCounter(&t);
+        StartTime = t.QuadPart;
+      }
+
+      /* Log end keeps last keys and zero mouse */
+      UINT NumOfChanged = Read();
+
+      for (UINT i = 0; i < NumOfChanged && Pos < Log.size(); i++)
+        Keys[Log[Pos++]] ^= 1;
+      Dx = Unzig(Read());
+      Dy = Unzig(Read());
+      Dz = Unzig(Read());
+      memcpy(NewKeys, Keys, 256);
+    }
+  } /* End of 'replay::Input' function */
+
+  /* Finish tick function (writes or checks state hash).
+   * ARGUMENTS: None.
+   * RETURNS: None.
+   */
+  VOID replay::EndTick( VOID )
+  {
+    UINT H = (UINT)State.Value;
+
+    if (IsRecord)
+      fwrite(&H, 4, 1, F);
+    else if (IsPlay && !IsEnd)
+    {
+      UINT Old = 0;
+
+      if (Pos + 4 <= Log.size())
+        memcpy(&Old, &Log[Pos], 4);
+      else
+        IsEnd = TRUE;
+      Pos += 4;
+      if (!IsEnd && Old != H && NumOfMismatches++ == 0)
+        FirstMismatch = Tick;
+
+      if (Pos >= Log.size())
+      {
+        LARGE_INTEGER t, Freq;
+        CHAR Buf[200];
+
+        IsEnd = TRUE;
+        QueryPerformanceCounter(&t);
+        QueryPerformanceFrequency(&Freq);
+        sprintf(Buf, "Replay: %i ticks, %i mismatches (first at %i), %.3f ms per tick\n",
+          Tick + 1, NumOfMismatches, FirstMismatch,
+          (DBL)(t.QuadPart - StartTime) * 1000 / Freq.QuadPart / (Tick + 1));
+        OutputDebugString(Buf);
+      }
+    }
+    State = hash();
+    Tick++;
+  } /* End of 'replay::EndTick' function */
+} /* end of 'digl' namespace */
+
+/* END OF 'replay.cpp' FILE */
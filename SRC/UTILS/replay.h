@@ -0,0 +1,154 @@
+/***************************************************************
+ * Copyright (C) 2020
+ *    Computer Graphics Support Group of 30 Phys-Math Gymnasium
+ ***************************************************************/
+
+/* FILE NAME   : replay.h
+ * PURPOSE     : Input recording and replay header file.
+ * PROGRAMMER  : Dmitriy Vlasov.
+ * LAST UPDATE : 19.10.2020
+ * NOTE        : Namespace 'digl'.
+ *
+ *   Deterministic mode runs with fixed delta time and seeded random
+ *   streams. Log keeps seed, delta time and per tick input: changed key
+ *   numbers, mouse and wheel deltas (zigzag varints) and low 32 bits of
+ *   state hash fed by units. Replay feeds input back and compares hashes.
+ *
+ * No part of this file may be changed without agreement of
+ * Computer Graphics Support Group of 30 Phys-Math Gymnasium.
+ */
+
+#ifndef __REPLAY_H_
+#define __REPLAY_H_
+
+#include "../def.h"
+#include "hash.h"
+#include "rng.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/* Animation project namespace */
+namespace digl
+{
+  /* Input log representation type */
+  class replay
+  {
+  private:
+    FILE *F;                    // Recorded log file
+    std::vector<BYTE> Log;      // Replayed log
+    size_t Pos;                 // Replayed log read position
+    BYTE Keys[256];             // Keys of previous tick
+    UINT64 StartTime;           // Replay start performance counter
+
+    /* Write unsigned varint function.
+     * ARGUMENTS:
+     *   - value:
+     *       UINT X;
+     * RETURNS: None.
+     */
+    VOID Write( UINT X );
+
+    /* Read unsigned varint function.
+     * ARGUMENTS: None.
+     * RETURNS:
+     *   (UINT) value (0 after log end).
+     */
+    UINT Read( VOID );
+
+  public:
+    BOOL
+      IsRecord,                 // Input is recorded
+      IsPlay,                   // Input is replayed
+      IsEnd,                    // Replayed log is over
+      IsClosed;                 // Replayed log end is handled (window close is posted)
+    UINT64 Seed;                // Random streams seed
+    DBL DeltaTime;              // Fixed delta time
+    INT Tick;                   // Current tick number
+    INT NumOfMismatches,        // Number of ticks with other state hash
+      FirstMismatch;            // First mismatched tick (-1 for none)
+    hash State;                 // Current tick state hash (fed by units)
+
+    /* Replay constructor.
+     * ARGUMENTS: None.
+     */
+    replay( VOID ) : F(nullptr), Pos(0), StartTime(0), IsRecord(FALSE), IsPlay(FALSE), IsEnd(FALSE), IsClosed(FALSE),
+      Seed(0), DeltaTime(1.0 / 60), Tick(0), NumOfMismatches(0), FirstMismatch(-1)
+    {
+      memset(Keys, 0, sizeof(Keys));
+    } /* End of 'replay' function */
+
+    /* Replay destructor.
+     * ARGUMENTS: None.
+     */
+    ~replay( VOID )
+    {
+      if (F != nullptr)
+        fclose(F);
+    } /* End of '~replay' function */
+
+    /* Check deterministic mode function.
+     * ARGUMENTS: None.
+     * RETURNS:
+     *   (BOOL) TRUE if input is recorded or replayed.
+     */
+    BOOL IsActive( VOID ) const
+    {
+      return IsRecord || IsPlay;
+    } /* End of 'IsActive' function */
+
+    /* Get random stream function.
+     * ARGUMENTS:
+     *   - stream number:
+     *       UINT64 Stream;
+     * RETURNS:
+     *   (rng) random stream seeded by log seed.
+     */
+    rng Random( UINT64 Stream ) const
+    {
+      return rng(Seed, Stream);
+    } /* End of 'Random' function */
+
+    /* Start recording function.
+     * ARGUMENTS:
+     *   - log file name:
+     *       const std::string &FileName;
+     *   - random seed and fixed delta time:
+     *       UINT64 NewSeed;
+     *       DBL NewDeltaTime;
+     * RETURNS:
+     *   (BOOL) TRUE if log file is created.
+     */
+    BOOL Record( const std::string &FileName, UINT64 NewSeed, DBL NewDeltaTime );
+
+    /* Start replay function.
+     * ARGUMENTS:
+     *   - log file name:
+     *       const std::string &FileName;
+     * RETURNS:
+     *   (BOOL) TRUE if log is loaded.
+     */
+    BOOL Play( const std::string &FileName );
+
+    /* Record or replay tick input function.
+     * ARGUMENTS:
+     *   - keys state (0 or 1, replaced in replay):
+     *       BYTE *NewKeys;
+     *   - mouse and wheel deltas (replaced in replay):
+     *       INT &Dx, &Dy, &Dz;
+     * RETURNS: None.
+     */
+    VOID Input( BYTE *NewKeys, INT &Dx, INT &Dy, INT &Dz );
+
+    /* Finish tick function (writes or checks state hash).
+     * ARGUMENTS: None.
+     * RETURNS: None.
+     */
+    VOID EndTick( VOID );
+  }; /* End of 'replay' class */
+} /* end of 'digl' namespace */
+
+#endif /* __REPLAY_H_ */
+
+/* END OF 'replay.h' FILE */
@@ -0,0 +1,101 @@
+/***************************************************************
+ * Copyright (C) 2020
+ *    Computer Graphics Support Group of 30 Phys-Math Gymnasium
+ ***************************************************************/
+
+/* FILE NAME   : rng.h
+ * PURPOSE     : Random number streams header file.
+ * PROGRAMMER  : Dmitriy Vlasov.
+ * LAST UPDATE : 19.10.2020
+ * NOTE        : Namespace 'digl'.
+ *
+ *   PCG32 generator: same seed and stream number always give same
+ *   sequence, different streams of one seed are independent, so work
+ *   split to jobs gets same numbers for any number of threads.
+ *
+ * No part of this file may be changed without agreement of
+ * Computer Graphics Support Group of 30 Phys-Math Gymnasium.
+ */
+
+#ifndef __RNG_H_
+#define __RNG_H_
+
+#include "../def.h"
+
+/* Animation project namespace */
+namespace digl
+{
+  /* Random number stream representation type */
+  class rng
+  {
+  private:
+    UINT64 State, Inc; // Generator state and stream increment (odd)
+
+  public:
+    /* Random number stream constructor.
+     * ARGUMENTS:
+     *   - seed and stream number:
+     *       UINT64 Seed, Stream;
+     */
+    rng( UINT64 Seed = 0, UINT64 Stream = 0 ) : State(0), Inc(Stream << 1 | 1)
+    {
+      Next();
+      State += Seed;
+      Next();
+    } /* End of 'rng' function */
+
+    /* Get next 32-bit number function.
+     * ARGUMENTS: None.
+     * RETURNS:
+     *   (UINT) random number.
+     */
+    UINT Next( VOID )
+    {
+      UINT64 Old = State;
+      UINT
+        X = (UINT)(((Old >> 18) ^ Old) >> 27),
+        R = (UINT)(Old >> 59);
+
+      State = Old * 6364136223846793005ULL + Inc;
+      return X >> R | X << ((32 - R) & 31);
+    } /* End of 'Next' function */
+
+    /* Get random number in [0, 1) function.
+     * ARGUMENTS: None.
+     * RETURNS:
+     *   (FLT) random number.
+     */
+    FLT Rnd0( VOID )
+    {
+      return (Next() >> 8) * (1.0f / 16777216);
+    } /* End of 'Rnd0' function */
+
+    /* Get random number in [-1, 1) function.
+     * ARGUMENTS: None.
+     * RETURNS:
+     *   (FLT) random number.
+     */
+    FLT Rnd1( VOID )
+    {
+      return Rnd0() * 2 - 1;
+    } /* End of 'Rnd1' function */
+
+    /* Get random vector with components in [-1, 1) function.
+     * ARGUMENTS: None.
+     * RETURNS:
+     *   (vec3) random vector.
+     */
+    vec3 Vec1( VOID )
+    {
+      FLT
+        X = Rnd1(),
+        Y = Rnd1();
+
+      return vec3(X, Y, Rnd1());
+    } /* End of 'Vec1' function */
+  }; /* End of 'rng' class */
+} /* end of 'digl' namespace */
+
+#endif /* __RNG_H_ */
+
+/* END OF 'rng.h' FILE */
@@ -0,0 +1,1076 @@
+/***************************************************************
+ * Copyright (C) 2020
+ *    Computer Graphics Support Group of 30 Phys-Math Gymnasium
+ ***************************************************************/
+
+/* FILE NAME   : road_graph.cpp
+ * PURPOSE     : Road network graph and routing file.
+ * PROGRAMMER  : Dmitriy Vlasov.
+ * LAST UPDATE : 19.10.2020
+ * NOTE        : Namespace 'digl'.
+ *
+ * No part of this file may be changed without agreement of
+ * Computer Graphics Support Group of 30 Phys-Math Gymnasium.
+ */
+
+/* Includes */
+#include "parallel.h"
+#include "rng.h"
+#include "road_graph.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+
+/* Animation project namespace */
+namespace digl
+{
+  /* Graph file signature and version */
+  static const CHAR Signature[4] = {'D', 'G', 'R', 'G'};
+  static const UINT Version = 1;
+
+  /* Heap order: smallest key on top */
+  typedef std::greater<std::pair<FLT, INT>> heap_order;
+
+  /* Graph constructor.
+   * ARGUMENTS: None.
+   */
+  road_graph::road_graph( VOID ) : hFile(nullptr), hMapping(nullptr), View(nullptr)
+  {
+    Pack({}, {}, {}, {}, {}, {});
+  } /* End of 'road_graph' function */
+
+  /* Graph destructor.
+   * ARGUMENTS: None.
+   */
+  road_graph::~road_graph( VOID )
+  {
+    Close();
+  } /* End of '~road_graph' function */
+
+  /* Set array pointers to buffer function.
+   * ARGUMENTS:
+   *   - buffer (starts with header):
+   *       const BYTE *Data;
+   * RETURNS: None.
+   */
+  VOID road_graph::SetPointers( const BYTE *Data )
+  {
+    memcpy(&Header, Data, sizeof(header));
+
+    const BYTE *P = Data + sizeof(header);
+    size_t
+      N = Header.NumOfNodes, E = Header.NumOfEdges,
+      U = Header.NumOfUp, D = Header.NumOfDown;
+    auto Take = [&]( size_t Size ) -> const BYTE *
+    {
+      const BYTE *R = P;
+
+      P += (Size + 7) & ~(size_t)7;
+      return R;
+    };
+
+    X = (const FLT *)Take(N * 4);
+    Z = (const FLT *)Take(N * 4);
+    Offsets = (const UINT *)Take((N + 1) * 4);
+    Targets = (const INT *)Take(E * 4);
+    Costs = (const FLT *)Take(E * 4);
+    RevOffsets = (const UINT *)Take((N + 1) * 4);
+    Sources = (const INT *)Take(E * 4);
+    RevCosts = (const FLT *)Take(E * 4);
+    Rank = nullptr;
+    UpOffsets = DownOffsets = nullptr;
+    UpTargets = DownSources = UpMids = DownMids = nullptr;
+    UpCosts = DownCosts = nullptr;
+    if (Header.IsHierarchy)
+    {
+      Rank = (const INT *)Take(N * 4);
+      UpOffsets = (const UINT *)Take((N + 1) * 4);
+      UpTargets = (const INT *)Take(U * 4);
+      UpCosts = (const FLT *)Take(U * 4);
+      UpMids = (const INT *)Take(U * 4);
+      DownOffsets = (const UINT *)Take((N + 1) * 4);
+      DownSources = (const INT *)Take(D * 4);
+      DownCosts = (const FLT *)Take(D * 4);
+      DownMids = (const INT *)Take(D * 4);
+    }
+  } /* End of 'road_graph::SetPointers' function */
+
+  /* Get buffer size by header function.
+   * ARGUMENTS:
+   *   - header:
+   *       const header &H;
+   * RETURNS:
+   *   (UINT64) buffer size in bytes (sections are 8 byte aligned).
+   */
+  UINT64 road_graph::GetSize( const header &H )
+  {
+    auto Al = []( UINT64 Size ){ return (Size + 7) & ~(UINT64)7; };
+    UINT64
+      N = H.NumOfNodes, E = H.NumOfEdges,
+      U = H.NumOfUp, D = H.NumOfDown,
+      Size = sizeof(header) + Al(N * 4) * 2 + Al((N + 1) * 4) * 2 + Al(E * 4) * 4;
+
+    if (H.IsHierarchy)
+      Size += Al(N * 4) + Al((N + 1) * 4) * 2 + Al(U * 4) * 3 + Al(D * 4) * 3;
+    return Size;
+  } /* End of 'road_graph::GetSize' function */
+
+  /* Check buffer before use function.
+   * ARGUMENTS:
+   *   - buffer (starts with header) and its size:
+   *       const BYTE *Data;
+   *       size_t Size;
+   * RETURNS:
+   *   (BOOL) TRUE if buffer holds header and all its arrays and all node numbers are in range.
+   */
+  BOOL road_graph::IsValid( const BYTE *Data, size_t Size )
+  {
+    header H;
+
+    if (Data == nullptr || Size < sizeof(header))
+      return FALSE;
+    memcpy(&H, Data, sizeof(header));
+    if ((UINT64)Size < GetSize(H))
+      return FALSE;
+
+    /* Sections in 'SetPointers' order */
+    const BYTE *P = Data + sizeof(header);
+    size_t
+      N = H.NumOfNodes, E = H.NumOfEdges,
+      U = H.NumOfUp, D = H.NumOfDown;
+    auto Take = [&]( size_t Count ) -> const BYTE *
+    {
+      const BYTE *R = P;
+
+      P += (Count * 4 + 7) & ~(size_t)7;
+      return R;
+    };
+    auto IsOffsets = [&]( size_t Count )
+    {
+      const UINT *Off = (const UINT *)Take(N + 1);
+
+      if (Off[0] != 0 || Off[N] != Count)
+        return FALSE;
+      for (size_t i = 0; i < N; i++)
+        if (Off[i] > Off[i + 1])
+          return FALSE;
+      return TRUE;
+    };
+    auto IsNodes = [&]( size_t Count, INT Min )
+    {
+      const INT *Node = (const INT *)Take(Count);
+
+      for (size_t i = 0; i < Count; i++)
+        if (Node[i] < Min || Node[i] >= (INT)N)
+          return FALSE;
+      return TRUE;
+    };
+
+    Take(N);                      // X
+    Take(N);                      // Z
+    if (!IsOffsets(E) || !IsNodes(E, 0))
+      return FALSE;
+    Take(E);                      // Costs
+    if (!IsOffsets(E) || !IsNodes(E, 0))
+      return FALSE;
+    Take(E);                      // RevCosts
+    if (!H.IsHierarchy)
+      return TRUE;
+    Take(N);                      // Rank
+    if (!IsOffsets(U) || !IsNodes(U, 0))
+      return FALSE;
+    Take(U);                      // UpCosts
+    if (!IsNodes(U, -1) || !IsOffsets(D) || !IsNodes(D, 0))
+      return FALSE;
+    Take(D);                      // DownCosts
+    return IsNodes(D, -1);
+  } /* End of 'road_graph::IsValid' function */
+
+  /* Pack arrays into buffer function.
+   * ARGUMENTS:
+   *   - node positions:
+   *       const std::vector<FLT> &NewX, &NewZ;
+   *   - directed edges (sorted by start node):
+   *       const std::vector<edge> &Edges;
+   *   - hierarchy node order (empty for no hierarchy):
+   *       const std::vector<INT> &NewRank;
+   *   - edges to higher nodes and from higher nodes of each node:
+   *       const std::vector<std::vector<arc>> &Up, &Down;
+   * RETURNS: None.
+   */
+  VOID road_graph::Pack( const std::vector<FLT> &NewX, const std::vector<FLT> &NewZ, const std::vector<edge> &Edges,
+                         const std::vector<INT> &NewRank,
+                         const std::vector<std::vector<arc>> &Up, const std::vector<std::vector<arc>> &Down )
+  {
+    header H {};
+    size_t N = NewX.size(), E = Edges.size(), U = 0, D = 0;
+
+    for (auto &A : Up)
+      U += A.size();
+    for (auto &A : Down)
+      D += A.size();
+    memcpy(H.Signature, Signature, 4);
+    H.Version = Version;
+    H.NumOfNodes = (UINT)N;
+    H.NumOfEdges = (UINT)E;
+    H.NumOfUp = (UINT)U;
+    H.NumOfDown = (UINT)D;
+    H.IsHierarchy = !NewRank.empty();
+
+    /* A* heuristic scale: no edge is cheaper per length */
+    H.MinCostPerLength = 0;
+    for (size_t e = 0; e < E; e++)
+    {
+      FLT
+        dx = NewX[Edges[e].To] - NewX[Edges[e].From],
+        dz = NewZ[Edges[e].To] - NewZ[Edges[e].From],
+        Len = sqrt(dx * dx + dz * dz);
+
+      if (Len > 0 && (H.MinCostPerLength == 0 || Edges[e].Cost / Len < H.MinCostPerLength))
+        H.MinCostPerLength = Edges[e].Cost / Len;
+    }
+    H.MinCostPerLength *= 0.999f;
+
+    /* Sections are 8 byte aligned */
+    auto Al = []( size_t Size ){ return (Size + 7) & ~(size_t)7; };
+    size_t Size = (size_t)GetSize(H);
+
+    Close();
+    Blob.assign(Size, 0);
+
+    BYTE *P = Blob.data();
+    auto Put = [&]( const VOID *Src, size_t Bytes )
+    {
+      if (Bytes > 0)
+        memcpy(P, Src, Bytes);
+      P += Al(Bytes);
+    };
+
+    Put(&H, sizeof(header));
+    Put(NewX.data(), N * 4);
+    Put(NewZ.data(), N * 4);
+
+    /* Out edges, then in edges by counting sort */
+    std::vector<UINT> Off(N + 1, 0), RevOff(N + 1, 0);
+    std::vector<INT> Tgt(E), Src(E);
+    std::vector<FLT> Cst(E), RevCst(E);
+
+    for (size_t e = 0; e < E; e++)
+    {
+      Off[Edges[e].From + 1]++;
+      RevOff[Edges[e].To + 1]++;
+      Tgt[e] = Edges[e].To;
+      Cst[e] = Edges[e].Cost;
+    }
+    for (size_t i = 0; i < N; i++)
+      Off[i + 1] += Off[i], RevOff[i + 1] += RevOff[i];
+    {
+      std::vector<UINT> Pos(RevOff.begin(), RevOff.end() - 1);
+
+      for (size_t e = 0; e < E; e++)
+      {
+        UINT k = Pos[Edges[e].To]++;
+
+        Src[k] = Edges[e].From;
+        RevCst[k] = Edges[e].Cost;
+      }
+    }
+    Put(Off.data(), (N + 1) * 4);
+    Put(Tgt.data(), E * 4);
+    Put(Cst.data(), E * 4);
+    Put(RevOff.data(), (N + 1) * 4);
+    Put(Src.data(), E * 4);
+    Put(RevCst.data(), E * 4);
+
+    if (H.IsHierarchy)
+    {
+      Put(NewRank.data(), N * 4);
+      for (auto *A : {&Up, &Down})
+      {
+        std::vector<UINT> AOff(N + 1, 0);
+        std::vector<INT> ANode, AMid;
+        std::vector<FLT> ACost;
+
+        for (size_t i = 0; i < N; i++)
+        {
+          AOff[i + 1] = AOff[i] + (UINT)(*A)[i].size();
+          for (auto &a : (*A)[i])
+          {
+            ANode.push_back(a.Node);
+            ACost.push_back(a.Cost);
+            AMid.push_back(a.Mid);
+          }
+        }
+        Put(AOff.data(), (N + 1) * 4);
+        Put(ANode.data(), ANode.size() * 4);
+        Put(ACost.data(), ACost.size() * 4);
+        Put(AMid.data(), AMid.size() * 4);
+      }
+    }
+    SetPointers(Blob.data());
+  } /* End of 'road_graph::Pack' function */
+
+  /* Build graph function (hierarchy is dropped).
+   * ARGUMENTS:
+   *   - node positions:
+   *       const std::vector<FLT> &NewX, &NewZ;
+   *   - directed edges (copy is sorted):
+   *       std::vector<edge> Edges;
+   * RETURNS: None.
+   */
+  VOID road_graph::Build( const std::vector<FLT> &NewX, const std::vector<FLT> &NewZ, std::vector<edge> Edges )
+  {
+    /* Sort, drop loops and keep cheapest of parallel edges */
+    std::sort(Edges.begin(), Edges.end(),
+      []( const edge &A, const edge &B )
+      {
+        return A.From != B.From ? A.From < B.From : A.To != B.To ? A.To < B.To : A.Cost < B.Cost;
+      });
+    Edges.erase(std::unique(Edges.begin(), Edges.end(),
+      []( const edge &A, const edge &B ){ return A.From == B.From && A.To == B.To; }), Edges.end());
+    Edges.erase(std::remove_if(Edges.begin(), Edges.end(),
+      []( const edge &A ){ return A.From == A.To; }), Edges.end());
+    Pack(NewX, NewZ, Edges, {}, {}, {});
+  } /* End of 'road_graph::Build' function */
+
+  /* Build contraction hierarchy function.
+   * ARGUMENTS:
+   *   - maximal number of settled nodes in witness search:
+   *       INT MaxSettled;
+   * RETURNS: None.
+   */
+  VOID road_graph::BuildHierarchy( INT MaxSettled )
+  {
+    INT N = (INT)Header.NumOfNodes;
+    std::vector<FLT> NewX(X, X + N), NewZ(Z, Z + N);
+    std::vector<edge> Edges;
+    std::vector<std::vector<arc>> Out(N), In(N), Up(N), Down(N);
+
+    for (INT v = 0; v < N; v++)
+      for (UINT e = Offsets[v]; e < Offsets[v + 1]; e++)
+      {
+        Edges.push_back({v, Targets[e], Costs[e]});
+        Out[v].push_back({Targets[e], Costs[e], -1});
+        In[Targets[e]].push_back({v, Costs[e], -1});
+      }
+
+    /* Witness search: bounded Dijkstra over not contracted nodes */
+    std::vector<FLT> WDist(N);
+    std::vector<UINT> WStamp(N, 0);
+    std::vector<std::pair<FLT, INT>> WHeap;
+    UINT WGen = 0;
+
+    auto Witness = [&]( INT Source, INT Skip, FLT Limit, INT Settle )
+    {
+      WGen++;
+      WHeap.clear();
+      WDist[Source] = 0;
+      WStamp[Source] = WGen;
+      WHeap.push_back({0.f, Source});
+      for (INT Settled = 0; !WHeap.empty() && Settled < Settle; )
+      {
+        std::pop_heap(WHeap.begin(), WHeap.end(), heap_order());
+        auto [d, u] = WHeap.back();
+
+        WHeap.pop_back();
+        if (d > WDist[u])
+          continue;
+        if (d > Limit)
+          break;
+        Settled++;
+        for (auto &a : Out[u])
+          if (a.Node != Skip)
+          {
+            FLT nd = d + a.Cost;
+
+            if (WStamp[a.Node] != WGen || nd < WDist[a.Node])
+            {
+              WStamp[a.Node] = WGen;
+              WDist[a.Node] = nd;
+              WHeap.push_back({nd, a.Node});
+              std::push_heap(WHeap.begin(), WHeap.end(), heap_order());
+            }
+          }
+      }
+    };
+
+    /* Shortcuts needed by node contraction */
+    std::vector<std::pair<INT, arc>> Shortcuts;
+
+    auto Contract = [&]( INT v, INT Settle )
+    {
+      Shortcuts.clear();
+      for (auto &in : In[v])
+      {
+        FLT Limit = -1;
+
+        for (auto &out : Out[v])
+          if (out.Node != in.Node)
+            Limit = mth::Max(Limit, in.Cost + out.Cost);
+        if (Limit < 0)
+          continue;
+        Witness(in.Node, v, Limit, Settle);
+        for (auto &out : Out[v])
+          if (out.Node != in.Node &&
+              !(WStamp[out.Node] == WGen && WDist[out.Node] <= in.Cost + out.Cost))
+            Shortcuts.push_back({in.Node, {out.Node, in.Cost + out.Cost, v}});
+      }
+    };
+
+    /* Priority: edge difference, contracted neighbours and hierarchy depth */
+    std::vector<INT> Deleted(N, 0), Level(N, 0), NewRank(N, -1);
+    INT SimSettle = mth::Max(20, MaxSettled / 10);
+
+    auto Priority = [&]( INT v ) -> FLT
+    {
+      Contract(v, SimSettle);
+      return 2.f * ((INT)Shortcuts.size() - (INT)(In[v].size() + Out[v].size())) + Deleted[v] + Level[v];
+    };
+
+    std::vector<std::pair<FLT, INT>> Queue;
+
+    for (INT v = 0; v < N; v++)
+      Queue.push_back({Priority(v), v});
+    std::make_heap(Queue.begin(), Queue.end(), heap_order());
+
+    /* Add or improve edge in adjacency list */
+    auto AddArc = []( std::vector<arc> &List, const arc &A )
+    {
+      for (auto &a : List)
+        if (a.Node == A.Node)
+        {
+          if (A.Cost < a.Cost)
+            a = A;
+          return;
+        }
+      List.push_back(A);
+    };
+    auto RemoveArc = []( std::vector<arc> &List, INT Node )
+    {
+      for (size_t i = 0; i < List.size(); i++)
+        if (List[i].Node == Node)
+        {
+          List[i] = List.back();
+          List.pop_back();
+          return;
+        }
+    };
+
+    for (INT r = 0; !Queue.empty(); )
+    {
+      std::pop_heap(Queue.begin(), Queue.end(), heap_order());
+      INT v = Queue.back().second;
+
+      Queue.pop_back();
+      if (NewRank[v] >= 0)
+        continue;
+
+      /* Lazy update: contract only if still smallest */
+      FLT p = Priority(v);
+
+      if (!Queue.empty() && p > Queue.front().first)
+      {
+        Queue.push_back({p, v});
+        std::push_heap(Queue.begin(), Queue.end(), heap_order());
+        continue;
+      }
+
+      Contract(v, MaxSettled);
+      NewRank[v] = r++;
+      Up[v] = Out[v];
+      Down[v] = In[v];
+      for (auto &s : Shortcuts)
+      {
+        AddArc(Out[s.first], s.second);
+        AddArc(In[s.second.Node], {s.first, s.second.Cost, v});
+      }
+      for (auto &a : Out[v])
+      {
+        RemoveArc(In[a.Node], v);
+        Deleted[a.Node]++;
+        Level[a.Node] = mth::Max(Level[a.Node], Level[v] + 1);
+      }
+      for (auto &a : In[v])
+      {
+        RemoveArc(Out[a.Node], v);
+        Deleted[a.Node]++;
+        Level[a.Node] = mth::Max(Level[a.Node], Level[v] + 1);
+      }
+      std::vector<arc>().swap(Out[v]);
+      std::vector<arc>().swap(In[v]);
+    }
+    Pack(NewX, NewZ, Edges, NewRank, Up, Down);
+  } /* End of 'road_graph::BuildHierarchy' function */
+
+  /* Save graph to binary file function.
+   * ARGUMENTS:
+   *   - file name:
+   *       const std::string &FileName;
+   * RETURNS:
+   *   (BOOL) TRUE if success.
+   */
+  BOOL road_graph::Save( const std::string &FileName ) const
+  {
+    FILE *F;
+    const BYTE
+      *Data = View != nullptr ? View : Blob.data(),
+      *End = IsHierarchy() ? (const BYTE *)(DownMids + Header.NumOfDown) : (const BYTE *)(RevCosts + Header.NumOfEdges);
+    size_t Size = (End - Data + 7) & ~(size_t)7;
+
+    if ((F = fopen(FileName.c_str(), "wb")) == nullptr)
+      return FALSE;
+
+    BOOL IsOk = fwrite(Data, 1, Size, F) == Size;
+
+    fclose(F);
+    return IsOk;
+  } /* End of 'road_graph::Save' function */
+
+  /* Load graph by file mapping function.
+   * ARGUMENTS:
+   *   - file name:
+   *       const std::string &FileName;
+   * RETURNS:
+   *   (BOOL) TRUE if success.
+   */
+  BOOL road_graph::Load( const std::string &FileName )
+  {
+    HANDLE hF, hM;
+    const BYTE *Data;
+    LARGE_INTEGER Size;
+
+    hF = CreateFile(FileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (hF == INVALID_HANDLE_VALUE)
+      return FALSE;
+    if (!GetFileSizeEx(hF, &Size) || Size.QuadPart < (LONGLONG)sizeof(header) ||
+        (hM = CreateFileMapping(hF, nullptr, PAGE_READONLY, 0, 0, nullptr)) == nullptr)
+    {
+      CloseHandle(hF);
+      return FALSE;
+    }
+    /* Header counts must fit file and edges must lead to existing nodes before arrays are used */
+    if ((Data = (const BYTE *)MapViewOfFile(hM, FILE_MAP_READ, 0, 0, 0)) == nullptr ||
+        memcmp(Data, Signature, 4) != 0 || ((const header *)Data)->Version != Version ||
+        !IsValid(Data, (size_t)Size.QuadPart))
+    {
+      if (Data != nullptr)
+        UnmapViewOfFile(Data);
+      CloseHandle(hM);
+      CloseHandle(hF);
+      return FALSE;
+    }
+    Close();
+    hFile = hF;
+    hMapping = hM;
+    View = Data;
+    SetPointers(View);
+    return TRUE;
+  } /* End of 'road_graph::Load' function */
+
+  /* Free graph function.
+   * ARGUMENTS: None.
+   * RETURNS: None.
+   */
+  VOID road_graph::Close( VOID )
+  {
+    if (View != nullptr)
+    {
+      UnmapViewOfFile(View);
+      CloseHandle(hMapping);
+      CloseHandle(hFile);
+      View = nullptr;
+      hMapping = hFile = nullptr;
+    }
+    std::vector<BYTE>().swap(Blob);
+  } /* End of 'road_graph::Close' function */
+
+  /* Find nearest node function.
+   * ARGUMENTS:
+   *   - world space point:
+   *       FLT PosX, PosZ;
+   * RETURNS:
+   *   (INT) node number (-1 for empty graph).
+   */
+  INT road_graph::Nearest( FLT PosX, FLT PosZ ) const
+  {
+    INT Best = -1;
+    FLT BestDist = 0;
+
+    for (INT v = 0; v < (INT)Header.NumOfNodes; v++)
+    {
+      FLT d = (X[v] - PosX) * (X[v] - PosX) + (Z[v] - PosZ) * (Z[v] - PosZ);
+
+      if (Best < 0 || d < BestDist)
+        Best = v, BestDist = d;
+    }
+    return Best;
+  } /* End of 'road_graph::Nearest' function */
+
+  /* Prepare query scratch function.
+   * ARGUMENTS:
+   *   - query scratch:
+   *       query &Q;
+   * RETURNS: None.
+   */
+  VOID road_graph::Start( query &Q ) const
+  {
+    size_t N = Header.NumOfNodes;
+
+    for (INT d = 0; d < 2; d++)
+    {
+      if (Q.Dist[d].size() != N)
+      {
+        Q.Dist[d].assign(N, 0);
+        Q.Parent[d].assign(N, -1);
+        Q.Mid[d].assign(N, -1);
+        Q.Stamp[d].assign(N, 0);
+        Q.Generation = 0;
+      }
+      Q.Heap[d].clear();
+    }
+    if (++Q.Generation == 0)
+    {
+      /* Generation counter wrap */
+      for (INT d = 0; d < 2; d++)
+        std::fill(Q.Stamp[d].begin(), Q.Stamp[d].end(), 0);
+      Q.Generation = 1;
+    }
+    Q.NumOfSettled = 0;
+  } /* End of 'road_graph::Start' function */
+
+  /* Relax node distance function.
+   * ARGUMENTS:
+   *   - query scratch:
+   *       query &Q;
+   *   - search direction and node:
+   *       INT Dir, Node;
+   *   - new distance and heap key:
+   *       FLT Dist, Key;
+   *   - parent node and shortcut middle node:
+   *       INT Parent, Mid;
+   * RETURNS:
+   *   (BOOL) TRUE if distance is decreased.
+   */
+  BOOL road_graph::Relax( query &Q, INT Dir, INT Node, FLT Dist, FLT Key, INT Parent, INT Mid )
+  {
+    if (Q.Stamp[Dir][Node] == Q.Generation && Q.Dist[Dir][Node] <= Dist)
+      return FALSE;
+    Q.Stamp[Dir][Node] = Q.Generation;
+    Q.Dist[Dir][Node] = Dist;
+    Q.Parent[Dir][Node] = Parent;
+    Q.Mid[Dir][Node] = Mid;
+    Q.Heap[Dir].push_back({Key, Node});
+    std::push_heap(Q.Heap[Dir].begin(), Q.Heap[Dir].end(), heap_order());
+    return TRUE;
+  } /* End of 'road_graph::Relax' function */
+
+  /* Unpack hierarchy edge to road nodes function.
+   * ARGUMENTS:
+   *   - edge ends and middle node:
+   *       INT From, To, Mid;
+   *   - path to add nodes after 'From' to:
+   *       std::vector<INT> &Path;
+   * RETURNS: None.
+   */
+  VOID road_graph::Unpack( INT From, INT To, INT Mid, std::vector<INT> &Path ) const
+  {
+    if (Mid < 0)
+    {
+      Path.push_back(To);
+      return;
+    }
+
+    /* Middle node is lower than both ends: 'From -> Mid' is its down edge, 'Mid -> To' is its up edge */
+    INT m1 = -1, m2 = -1;
+
+    for (UINT e = DownOffsets[Mid]; e < DownOffsets[Mid + 1]; e++)
+      if (DownSources[e] == From)
+      {
+        m1 = DownMids[e];
+        break;
+      }
+    for (UINT e = UpOffsets[Mid]; e < UpOffsets[Mid + 1]; e++)
+      if (UpTargets[e] == To)
+      {
+        m2 = UpMids[e];
+        break;
+      }
+    Unpack(From, Mid, m1, Path);
+    Unpack(Mid, To, m2, Path);
+  } /* End of 'road_graph::Unpack' function */
+
+  /* Route by A* function.
+   * ARGUMENTS:
+   *   - start and end nodes:
+   *       INT From, To;
+   *   - query scratch:
+   *       query &Q;
+   *   - path nodes to fill (nullptr if not needed):
+   *       std::vector<INT> *Path;
+   * RETURNS:
+   *   (FLT) route cost (-1 if unreachable).
+   */
+  FLT road_graph::AStar( INT From, INT To, query &Q, std::vector<INT> *Path ) const
+  {
+    FLT Scale = Header.MinCostPerLength, tx = X[To], tz = Z[To];
+    auto H = [&]( INT v )
+    {
+      return Scale * sqrt((X[v] - tx) * (X[v] - tx) + (Z[v] - tz) * (Z[v] - tz));
+    };
+
+    Start(Q);
+    Relax(Q, 0, From, 0, H(From), -1, -1);
+    while (!Q.Heap[0].empty())
+    {
+      std::pop_heap(Q.Heap[0].begin(), Q.Heap[0].end(), heap_order());
+      auto [k, u] = Q.Heap[0].back();
+      FLT d = Q.Dist[0][u];
+
+      Q.Heap[0].pop_back();
+      if (k > d + H(u))
+        continue;
+      Q.NumOfSettled++;
+      if (u == To)
+      {
+        if (Path != nullptr)
+        {
+          Path->clear();
+          for (INT v = To; v >= 0; v = Q.Parent[0][v])
+            Path->push_back(v);
+          std::reverse(Path->begin(), Path->end());
+        }
+        return d;
+      }
+      for (UINT e = Offsets[u]; e < Offsets[u + 1]; e++)
+      {
+        INT v = Targets[e];
+        FLT nd = d + Costs[e];
+
+        if (nd < GetDist(Q, 0, v))
+          Relax(Q, 0, v, nd, nd + H(v), u, -1);
+      }
+    }
+    return -1;
+  } /* End of 'road_graph::AStar' function */
+
+  /* Route by bidirectional Dijkstra function.
+   * ARGUMENTS:
+   *   - start and end nodes:
+   *       INT From, To;
+   *   - query scratch:
+   *       query &Q;
+   *   - path nodes to fill (nullptr if not needed):
+   *       std::vector<INT> *Path;
+   * RETURNS:
+   *   (FLT) route cost (-1 if unreachable).
+   */
+  FLT road_graph::Bidirectional( INT From, INT To, query &Q, std::vector<INT> *Path ) const
+  {
+    FLT Best = 1e30f;
+    INT Meet = -1;
+
+    Start(Q);
+    Relax(Q, 0, From, 0, 0, -1, -1);
+    Relax(Q, 1, To, 0, 0, -1, -1);
+    if (From == To)
+      Best = 0, Meet = From;
+    while (!Q.Heap[0].empty() && !Q.Heap[1].empty() &&
+           Q.Heap[0].front().first + Q.Heap[1].front().first < Best)
+    {
+      /* Smaller frontier goes on */
+      INT Dir = Q.Heap[0].size() <= Q.Heap[1].size() ? 0 : 1;
+      std::vector<std::pair<FLT, INT>> &Heap = Q.Heap[Dir];
+
+      std::pop_heap(Heap.begin(), Heap.end(), heap_order());
+      auto [d, u] = Heap.back();
+
+      Heap.pop_back();
+      if (d > Q.Dist[Dir][u])
+        continue;
+      Q.NumOfSettled++;
+
+      const UINT *Off = Dir == 0 ? Offsets : RevOffsets;
+      const INT *Next = Dir == 0 ? Targets : Sources;
+      const FLT *Cost = Dir == 0 ? Costs : RevCosts;
+
+      for (UINT e = Off[u]; e < Off[u + 1]; e++)
+      {
+        INT v = Next[e];
+        FLT nd = d + Cost[e];
+
+        if (Relax(Q, Dir, v, nd, nd, u, -1))
+        {
+          FLT Total = nd + GetDist(Q, 1 - Dir, v);
+
+          if (Total < Best)
+            Best = Total, Meet = v;
+        }
+      }
+    }
+    if (Meet < 0)
+      return -1;
+    if (Path != nullptr)
+    {
+      Path->clear();
+      for (INT v = Meet; v >= 0; v = Q.Parent[0][v])
+        Path->push_back(v);
+      std::reverse(Path->begin(), Path->end());
+      for (INT v = Q.Parent[1][Meet]; v >= 0; v = Q.Parent[1][v])
+        Path->push_back(v);
+    }
+    return Best;
+  } /* End of 'road_graph::Bidirectional' function */
+
+  /* Route by contraction hierarchy function.
+   * ARGUMENTS:
+   *   - start and end nodes:
+   *       INT From, To;
+   *   - query scratch:
+   *       query &Q;
+   *   - path nodes to fill (nullptr if not needed):
+   *       std::vector<INT> *Path;
+   * RETURNS:
+   *   (FLT) route cost (-1 if unreachable).
+   */
+  FLT road_graph::Hierarchy( INT From, INT To, query &Q, std::vector<INT> *Path ) const
+  {
+    if (!IsHierarchy())
+      return Bidirectional(From, To, Q, Path);
+
+    FLT Best = 1e30f;
+    INT Meet = -1;
+
+    Start(Q);
+    Relax(Q, 0, From, 0, 0, -1, -1);
+    Relax(Q, 1, To, 0, 0, -1, -1);
+    if (From == To)
+      Best = 0, Meet = From;
+
+    /* Both upward searches go on while their minimum is below best route */
+    for (INT Dir = 0; ; Dir = 1 - Dir)
+    {
+      BOOL
+        IsF = !Q.Heap[0].empty() && Q.Heap[0].front().first < Best,
+        IsB = !Q.Heap[1].empty() && Q.Heap[1].front().first < Best;
+
+      if (!IsF && !IsB)
+        break;
+      if (Dir == 0 ? !IsF : !IsB)
+        Dir = 1 - Dir;
+
+      std::vector<std::pair<FLT, INT>> &Heap = Q.Heap[Dir];
+
+      std::pop_heap(Heap.begin(), Heap.end(), heap_order());
+      auto [d, u] = Heap.back();
+
+      Heap.pop_back();
+      if (d > Q.Dist[Dir][u])
+        continue;
+      Q.NumOfSettled++;
+
+      FLT Total = d + GetDist(Q, 1 - Dir, u);
+
+      if (Total < Best)
+        Best = Total, Meet = u;
+
+      /* Stall on demand: node is reached cheaper from higher node */
+      const UINT *SOff = Dir == 0 ? DownOffsets : UpOffsets;
+      const INT *SNext = Dir == 0 ? DownSources : UpTargets;
+      const FLT *SCost = Dir == 0 ? DownCosts : UpCosts;
+      BOOL IsStalled = FALSE;
+
+      for (UINT e = SOff[u]; e < SOff[u + 1] && !IsStalled; e++)
+        IsStalled = GetDist(Q, Dir, SNext[e]) + SCost[e] < d;
+      if (IsStalled)
+        continue;
+
+      const UINT *Off = Dir == 0 ? UpOffsets : DownOffsets;
+      const INT *Next = Dir == 0 ? UpTargets : DownSources;
+      const FLT *Cost = Dir == 0 ? UpCosts : DownCosts;
+      const INT *Mids = Dir == 0 ? UpMids : DownMids;
+
+      for (UINT e = Off[u]; e < Off[u + 1]; e++)
+        Relax(Q, Dir, Next[e], d + Cost[e], d + Cost[e], u, Mids[e]);
+    }
+    if (Meet < 0)
+      return -1;
+    if (Path != nullptr)
+    {
+      std::vector<INT> Chain;
+
+      Path->clear();
+      for (INT v = Meet; v >= 0; v = Q.Parent[0][v])
+        Chain.push_back(v);
+      Path->push_back(From);
+      for (size_t i = Chain.size() - 1; i > 0; i--)
+        Unpack(Chain[i], Chain[i - 1], Q.Mid[0][Chain[i - 1]], *Path);
+      for (INT v = Meet; Q.Parent[1][v] >= 0; v = Q.Parent[1][v])
+        Unpack(v, Q.Parent[1][v], Q.Mid[1][v], *Path);
+    }
+    return Best;
+  } /* End of 'road_graph::Hierarchy' function */
+
+  /* Route set of agents function (hierarchy if built, A* otherwise; parallel).
+   * ARGUMENTS:
+   *   - start and end nodes:
+   *       const INT *From, *To;
+   *   - number of queries:
+   *       size_t Count;
+   *   - route costs to fill (-1 for unreachable):
+   *       FLT *Res;
+   *   - paths to fill (nullptr if not needed):
+   *       std::vector<INT> *Paths;
+   * RETURNS: None.
+   */
+  VOID road_graph::Route( const INT *From, const INT *To, size_t Count, FLT *Res, std::vector<INT> *Paths ) const
+  {
+    parallel::For(Count,
+      [&]( size_t Begin, size_t End, INT )
+      {
+        query Q;
+
+        for (size_t i = Begin; i < End; i++)
+          Res[i] = IsHierarchy() ?
+            Hierarchy(From[i], To[i], Q, Paths != nullptr ? &Paths[i] : nullptr) :
+            AStar(From[i], To[i], Q, Paths != nullptr ? &Paths[i] : nullptr);
+      }, MinBlock);
+  } /* End of 'road_graph::Route' function */
+
+  /* Build grid city function (arterial every 8th street is twice faster).
+   * ARGUMENTS:
+   *   - number of nodes along side and street step:
+   *       INT Side;
+   *       FLT Step;
+   *   - random seed (cost jitter):
+   *       UINT64 Seed;
+   * RETURNS: None.
+   */
+  VOID road_graph::BuildGrid( INT Side, FLT Step, UINT64 Seed )
+  {
+    rng Rnd(Seed, 0);
+    std::vector<FLT> NewX((size_t)Side * Side), NewZ((size_t)Side * Side);
+    std::vector<edge> Edges;
+
+    Edges.reserve((size_t)Side * (Side - 1) * 4);
+    for (INT i = 0; i < Side; i++)
+      for (INT j = 0; j < Side; j++)
+      {
+        INT v = i * Side + j;
+
+        NewX[v] = j * Step;
+        NewZ[v] = i * Step;
+        /* Travel time: 10 m/s streets, 20 m/s arterials, 20% jitter */
+        if (j + 1 < Side)
+        {
+          FLT t = Step / (i % 8 == 0 ? 20 : 10);
+
+          Edges.push_back({v, v + 1, t * (1 + 0.2f * Rnd.Rnd0())});
+          Edges.push_back({v + 1, v, t * (1 + 0.2f * Rnd.Rnd0())});
+        }
+        if (i + 1 < Side)
+        {
+          FLT t = Step / (j % 8 == 0 ? 20 : 10);
+
+          Edges.push_back({v, v + Side, t * (1 + 0.2f * Rnd.Rnd0())});
+          Edges.push_back({v + Side, v, t * (1 + 0.2f * Rnd.Rnd0())});
+        }
+      }
+    Build(NewX, NewZ, std::move(Edges));
+  } /* End of 'road_graph::BuildGrid' function */
+
+  /* Headless benchmark function (grid city of about 1M edges).
+   * ARGUMENTS:
+   *   - number of nodes along side and number of queries:
+   *       INT Side, NumOfQueries;
+   *   - file name to save and map graph (empty to skip):
+   *       const std::string &FileName;
+   * RETURNS:
+   *   (BOOL) TRUE if hierarchy and A* distances match bidirectional Dijkstra ones.
+   */
+  BOOL road_graph::Benchmark( INT Side, INT NumOfQueries, const std::string &FileName )
+  {
+    LARGE_INTEGER Freq, t0, t1;
+    CHAR Buf[300];
+    auto Report = [&]( const CHAR *What, DBL Ms )
+    {
+      sprintf(Buf, "Road graph: %s: %.3f ms\n", What, Ms);
+      OutputDebugString(Buf);
+      printf("%s", Buf);
+    };
+    auto Ms = [&]( VOID )
+    {
+      QueryPerformanceCounter(&t1);
+      return (DBL)(t1.QuadPart - t0.QuadPart) * 1000 / Freq.QuadPart;
+    };
+    road_graph G, Mapped;
+    const road_graph *R = &G;
+
+    QueryPerformanceFrequency(&Freq);
+    QueryPerformanceCounter(&t0);
+    G.BuildGrid(Side, 100, 30);
+    Report("grid build", Ms());
+    sprintf(Buf, "Road graph: %u nodes, %u edges\n", G.Header.NumOfNodes, G.Header.NumOfEdges);
+    OutputDebugString(Buf);
+    printf("%s", Buf);
+
+    QueryPerformanceCounter(&t0);
+    G.BuildHierarchy();
+    Report("hierarchy build", Ms());
+    sprintf(Buf, "Road graph: %u up and %u down hierarchy edges\n", G.Header.NumOfUp, G.Header.NumOfDown);
+    OutputDebugString(Buf);
+    printf("%s", Buf);
+
+    if (FileName != "" && G.Save(FileName))
+    {
+      QueryPerformanceCounter(&t0);
+      if (Mapped.Load(FileName))
+      {
+        Report("file mapping", Ms());
+        R = &Mapped;
+      }
+    }
+
+    /* Random node pairs */
+    rng Rnd(30, 1);
+    std::vector<INT> From(NumOfQueries), To(NumOfQueries);
+    std::vector<FLT> Res(NumOfQueries);
+    INT N = R->GetNumOfNodes(), NumOfSlow = mth::Min(NumOfQueries, 100), Mismatches = 0;
+    query Q;
+
+    for (INT i = 0; i < NumOfQueries; i++)
+      From[i] = Rnd.Next() % N, To[i] = Rnd.Next() % N;
+
+    std::vector<FLT> Ref(NumOfSlow);
+
+    QueryPerformanceCounter(&t0);
+    for (INT i = 0; i < NumOfSlow; i++)
+      Ref[i] = R->Bidirectional(From[i], To[i], Q);
+    Report("bidirectional Dijkstra query", Ms() / NumOfSlow);
+    QueryPerformanceCounter(&t0);
+    for (INT i = 0; i < NumOfSlow; i++)
+      if (fabs(R->AStar(From[i], To[i], Q) - Ref[i]) > 1e-3f * Ref[i] + 1e-3f)
+        Mismatches++;
+    Report("A* query", Ms() / NumOfSlow);
+    QueryPerformanceCounter(&t0);
+    for (INT i = 0; i < NumOfQueries; i++)
+      Res[i] = R->Hierarchy(From[i], To[i], Q);
+    Report("hierarchy query", Ms() / NumOfQueries);
+    for (INT i = 0; i < NumOfSlow; i++)
+      if (fabs(Res[i] - Ref[i]) > 1e-3f * Ref[i] + 1e-3f)
+        Mismatches++;
+
+    std::vector<std::vector<INT>> Paths(NumOfQueries);
+
+    QueryPerformanceCounter(&t0);
+    R->Route(From.data(), To.data(), NumOfQueries, Res.data(), Paths.data());
+    Report("batched routes with paths (all queries)", Ms());
+    sprintf(Buf, "Road graph: %i mismatches against bidirectional Dijkstra\n", Mismatches);
+    OutputDebugString(Buf);
+    printf("%s", Buf);
+    return Mismatches == 0;
+  } /* End of 'road_graph::Benchmark' function */
+} /* end of 'digl' namespace */
+
+/* END OF 'road_graph.cpp' FILE */
@@ -0,0 +1,349 @@
+/***************************************************************
+ * Copyright (C) 2020
+ *    Computer Graphics Support Group of 30 Phys-Math Gymnasium
+ ***************************************************************/
+
+/* FILE NAME   : road_graph.h
+ * PURPOSE     : Road network graph and routing header file.
+ * PROGRAMMER  : Dmitriy Vlasov.
+ * LAST UPDATE : 19.10.2020
+ * NOTE        : Namespace 'digl'.
+ *
+ *   Graph is kept in compressed sparse row form (out edges and reverse
+ *   in edges of each node) inside one buffer laid out as binary file,
+ *   so loaded graph is used straight from file mapping. Routing: A*
+ *   (straight line heuristic scaled by minimal cost per length),
+ *   bidirectional Dijkstra and contraction hierarchy queries (upward
+ *   searches from both ends, shortcuts are unpacked by middle nodes).
+ *   Query scratch is kept in 'query' (one per thread), batched routing
+ *   splits queries between threads.
+ *
+ * No part of this file may be changed without agreement of
+ * Computer Graphics Support Group of 30 Phys-Math Gymnasium.
+ */
+
+#ifndef __ROAD_GRAPH_H_
+#define __ROAD_GRAPH_H_
+
+#include "../def.h"
+
+#include <string>
+#include <vector>
+
+/* Animation project namespace */
+namespace digl
+{
+  /* Road network graph representation type */
+  class road_graph
+  {
+  public:
+    /* Minimal number of queries in one thread block */
+    static const size_t MinBlock = 64;
+
+    /* Directed edge */
+    struct edge
+    {
+      INT From, To;
+      FLT Cost;
+    }; /* End of 'edge' struct */
+
+    /* Query scratch (one per thread) */
+    struct query
+    {
+      std::vector<FLT> Dist[2];       // Forward and backward search distances
+      std::vector<INT>
+        Parent[2],                    // Search tree parent nodes
+        Mid[2];                       // Shortcut middle node of parent edge (-1 for road edge)
+      std::vector<UINT> Stamp[2];     // Query generation of node distance
+      std::vector<std::pair<FLT, INT>> Heap[2];
+      UINT Generation = 0;            // Current query generation
+      INT NumOfSettled = 0;           // Settled nodes of last query
+    }; /* End of 'query' struct */
+
+    /* Graph sizes (file header) */
+    struct header
+    {
+      CHAR Signature[4];
+      UINT Version;
+      UINT NumOfNodes, NumOfEdges;     // Graph
+      UINT NumOfUp, NumOfDown;         // Hierarchy (zero when not built)
+      FLT MinCostPerLength;            // A* heuristic scale
+      UINT IsHierarchy;                // Hierarchy arrays are stored
+    } Header;
+
+    /* Graph arrays (point to 'Blob' or file mapping) */
+    const FLT *X, *Z;                              // Node positions
+    const UINT *Offsets, *RevOffsets;              // Out and in edge ranges of nodes
+    const INT *Targets, *Sources;                  // Out edge targets, in edge sources
+    const FLT *Costs, *RevCosts;                   // Out and in edge costs
+    const INT *Rank;                               // Hierarchy node order
+    const UINT *UpOffsets, *DownOffsets;           // Hierarchy edge ranges of nodes
+    const INT *UpTargets, *DownSources;            // Edges to higher nodes, edges from higher nodes
+    const FLT *UpCosts, *DownCosts;
+    const INT *UpMids, *DownMids;                  // Shortcut middle nodes (-1 for road edge)
+
+  private:
+    /* Hierarchy edge (other end node, cost and shortcut middle node) */
+    struct arc
+    {
+      INT Node;
+      FLT Cost;
+      INT Mid;
+    }; /* End of 'arc' struct */
+
+    std::vector<BYTE> Blob;         // Built graph buffer
+    VOID *hFile, *hMapping;         // Loaded graph file and its mapping
+    const BYTE *View;               // Loaded graph mapping view
+
+    /* Set array pointers to buffer function.
+     * ARGUMENTS:
+     *   - buffer (starts with header):
+     *       const BYTE *Data;
+     * RETURNS: None.
+     */
+    VOID SetPointers( const BYTE *Data );
+
+    /* Get buffer size by header function.
+     * ARGUMENTS:
+     *   - header:
+     *       const header &H;
+     * RETURNS:
+     *   (UINT64) buffer size in bytes (sections are 8 byte aligned).
+     */
+    static UINT64 GetSize( const header &H );
+
+    /* Check buffer before use function.
+     * ARGUMENTS:
+     *   - buffer (starts with header) and its size:
+     *       const BYTE *Data;
+     *       size_t Size;
+     * RETURNS:
+     *   (BOOL) TRUE if buffer holds header and all its arrays and all node numbers are in range.
+     */
+    static BOOL IsValid( const BYTE *Data, size_t Size );
+
+    /* Pack arrays into buffer function.
+     * ARGUMENTS:
+     *   - node positions:
+     *       const std::vector<FLT> &NewX, &NewZ;
+     *   - directed edges (sorted by start node):
+     *       const std::vector<edge> &Edges;
+     *   - hierarchy node order (empty for no hierarchy):
+     *       const std::vector<INT> &NewRank;
+     *   - edges to higher nodes and from higher nodes of each node:
+     *       const std::vector<std::vector<arc>> &Up, &Down;
+     * RETURNS: None.
+     */
+    VOID Pack( const std::vector<FLT> &NewX, const std::vector<FLT> &NewZ, const std::vector<edge> &Edges,
+               const std::vector<INT> &NewRank,
+               const std::vector<std::vector<arc>> &Up, const std::vector<std::vector<arc>> &Down );
+
+    /* Prepare query scratch function.
+     * ARGUMENTS:
+     *   - query scratch:
+     *       query &Q;
+     * RETURNS: None.
+     */
+    VOID Start( query &Q ) const;
+
+    /* Get node search distance function.
+     * ARGUMENTS:
+     *   - query scratch:
+     *       const query &Q;
+     *   - search direction (0 - forward, 1 - backward) and node:
+     *       INT Dir, Node;
+     * RETURNS:
+     *   (FLT) distance (huge if node is not reached).
+     */
+    static FLT GetDist( const query &Q, INT Dir, INT Node )
+    {
+      return Q.Stamp[Dir][Node] == Q.Generation ? Q.Dist[Dir][Node] : 1e30f;
+    } /* End of 'GetDist' function */
+
+    /* Relax node distance function.
+     * ARGUMENTS:
+     *   - query scratch:
+     *       query &Q;
+     *   - search direction and node:
+     *       INT Dir, Node;
+     *   - new distance and heap key:
+     *       FLT Dist, Key;
+     *   - parent node and shortcut middle node:
+     *       INT Parent, Mid;
+     * RETURNS:
+     *   (BOOL) TRUE if distance is decreased.
+     */
+    static BOOL Relax( query &Q, INT Dir, INT Node, FLT Dist, FLT Key, INT Parent, INT Mid );
+
+    /* Unpack hierarchy edge to road nodes function.
+     * ARGUMENTS:
+     *   - edge ends and middle node:
+     *       INT From, To, Mid;
+     *   - path to add nodes after 'From' to:
+     *       std::vector<INT> &Path;
+     * RETURNS: None.
+     */
+    VOID Unpack( INT From, INT To, INT Mid, std::vector<INT> &Path ) const;
+
+  public:
+    /* Graph constructor.
+     * ARGUMENTS: None.
+     */
+    road_graph( VOID );
+
+    /* Graph destructor.
+     * ARGUMENTS: None.
+     */
+    ~road_graph( VOID );
+
+    /* Build graph function (hierarchy is dropped).
+     * ARGUMENTS:
+     *   - node positions:
+     *       const std::vector<FLT> &NewX, &NewZ;
+     *   - directed edges (copy is sorted):
+     *       std::vector<edge> Edges;
+     * RETURNS: None.
+     */
+    VOID Build( const std::vector<FLT> &NewX, const std::vector<FLT> &NewZ, std::vector<edge> Edges );
+
+    /* Build contraction hierarchy function.
+     * ARGUMENTS:
+     *   - maximal number of settled nodes in witness search:
+     *       INT MaxSettled;
+     * RETURNS: None.
+     */
+    VOID BuildHierarchy( INT MaxSettled = 500 );
+
+    /* Check hierarchy is built function.
+     * ARGUMENTS: None.
+     * RETURNS:
+     *   (BOOL) TRUE if hierarchy queries are available.
+     */
+    BOOL IsHierarchy( VOID ) const
+    {
+      return Rank != nullptr;
+    } /* End of 'IsHierarchy' function */
+
+    /* Get number of nodes function.
+     * ARGUMENTS: None.
+     * RETURNS:
+     *   (INT) number of nodes.
+     */
+    INT GetNumOfNodes( VOID ) const
+    {
+      return (INT)Header.NumOfNodes;
+    } /* End of 'GetNumOfNodes' function */
+
+    /* Save graph to binary file function.
+     * ARGUMENTS:
+     *   - file name:
+     *       const std::string &FileName;
+     * RETURNS:
+     *   (BOOL) TRUE if success.
+     */
+    BOOL Save( const std::string &FileName ) const;
+
+    /* Load graph by file mapping function.
+     * ARGUMENTS:
+     *   - file name:
+     *       const std::string &FileName;
+     * RETURNS:
+     *   (BOOL) TRUE if success.
+     */
+    BOOL Load( const std::string &FileName );
+
+    /* Free graph function.
+     * ARGUMENTS: None.
+     * RETURNS: None.
+     */
+    VOID Close( VOID );
+
+    /* Find nearest node function.
+     * ARGUMENTS:
+     *   - world space point:
+     *       FLT PosX, PosZ;
+     * RETURNS:
+     *   (INT) node number (-1 for empty graph).
+     */
+    INT Nearest( FLT PosX, FLT PosZ ) const;
+
+    /* Route by A* function.
+     * ARGUMENTS:
+     *   - start and end nodes:
+     *       INT From, To;
+     *   - query scratch:
+     *       query &Q;
+     *   - path nodes to fill (nullptr if not needed):
+     *       std::vector<INT> *Path;
+     * RETURNS:
+     *   (FLT) route cost (-1 if unreachable).
+     */
+    FLT AStar( INT From, INT To, query &Q, std::vector<INT> *Path = nullptr ) const;
+
+    /* Route by bidirectional Dijkstra function.
+     * ARGUMENTS:
+     *   - start and end nodes:
+     *       INT From, To;
+     *   - query scratch:
+     *       query &Q;
+     *   - path nodes to fill (nullptr if not needed):
+     *       std::vector<INT> *Path;
+     * RETURNS:
+     *   (FLT) route cost (-1 if unreachable).
+     */
+    FLT Bidirectional( INT From, INT To, query &Q, std::vector<INT> *Path = nullptr ) const;
+
+    /* Route by contraction hierarchy function.
+     * ARGUMENTS:
+     *   - start and end nodes:
+     *       INT From, To;
+     *   - query scratch:
+     *       query &Q;
+     *   - path nodes to fill (nullptr if not needed):
+     *       std::vector<INT> *Path;
+     * RETURNS:
+     *   (FLT) route cost (-1 if unreachable).
+     */
+    FLT Hierarchy( INT From, INT To, query &Q, std::vector<INT> *Path = nullptr ) const;
+
+    /* Route set of agents function (hierarchy if built, A* otherwise; parallel).
+     * ARGUMENTS:
+     *   - start and end nodes:
+     *       const INT *From, *To;
+     *   - number of queries:
+     *       size_t Count;
+     *   - route costs to fill (-1 for unreachable):
+     *       FLT *Res;
+     *   - paths to fill (nullptr if not needed):
+     *       std::vector<INT> *Paths;
+     * RETURNS: None.
+     */
+    VOID Route( const INT *From, const INT *To, size_t Count, FLT *Res, std::vector<INT> *Paths = nullptr ) const;
+
+    /* Build grid city function (arterial every 8th street is twice faster).
+     * ARGUMENTS:
+     *   - number of nodes along side and street step:
+     *       INT Side;
+     *       FLT Step;
+     *   - random seed (cost jitter):
+     *       UINT64 Seed;
+     * RETURNS: None.
+     */
+    VOID BuildGrid( INT Side, FLT Step, UINT64 Seed = 0 );
+
+    /* Headless benchmark function (grid city of about 1M edges).
+     * ARGUMENTS:
+     *   - number of nodes along side and number of queries:
+     *       INT Side, NumOfQueries;
+     *   - file name to save and map graph (empty to skip):
+     *       const std::string &FileName;
+     * RETURNS:
+     *   (BOOL) TRUE if hierarchy and A* distances match bidirectional Dijkstra ones.
+     */
+    static BOOL Benchmark( INT Side, INT NumOfQueries, const std::string &FileName );
+  }; /* End of 'road_graph' class */
+} /* end of 'digl' namespace */
+
+#endif /* __ROAD_GRAPH_H_ */
+
+/* END OF 'road_graph.h' FILE */
@@ -111,10 +111,10 @@ namespace digl
 
     glDepthMask(FALSE);
     glBindVertexArray(Box->VA);
-    if (Box->NumOfElements != 0)
+    if (Box->IndexType != 0)
     {
       glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, Box->IBuf);
-      glDrawElements(GL_TRIANGLE_STRIP, Box->NumOfElements, GL_UNSIGNED_INT, NULL);
+      glDrawElements(GL_TRIANGLE_STRIP, Box->NumOfElements, Box->IndexType, NULL);
       glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
     }
     else
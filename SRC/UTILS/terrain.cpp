@@ -0,0 +1,306 @@
+/***************************************************************
+ * Copyright (C) 2020
+ *    Computer Graphics Support Group of 30 Phys-Math Gymnasium
+ ***************************************************************/
+
+/* FILE NAME   : terrain.cpp
+ * PURPOSE     : Chunked level of detail terrain file.
+ * PROGRAMMER  : Dmitriy Vlasov.
+ * LAST UPDATE : 19.10.2020
+ * NOTE        : Namespace 'digl'.
+ *
+ * No part of this file may be changed without agreement of
+ * Computer Graphics Support Group of 30 Phys-Math Gymnasium.
+ */
+
+/* Includes */
+#include "../ANIM/anim.h"
+#include "parallel.h"
+#include "terrain.h"
+
+#include <algorithm>
+#include <cmath>
+
+/* Animation project namespace */
+namespace digl
+{
+  /* Terrain initialization function.
+   * ARGUMENTS:
+   *   - material (shader with terrain uniforms and height field textures):
+   *       material *Mtl;
+   *   - height field:
+   *       const heightfield *InField;
+   *   - maximal quadtree depth (-1 to stop at height map resolution):
+   *       INT MaxDepth;
+   * RETURNS: None.
+   */
+  VOID terrain::Init( material *Mtl, const heightfield *InField, INT MaxDepth )
+  {
+    anim *AC = anim::GetPtr();
+
+    Field = InField;
+    if (MaxDepth < 0)
+      for (MaxDepth = 0; (ChunkCells << MaxDepth) < mth::Max(Field->W, Field->H); MaxDepth++)
+        ;
+
+    /* Shared chunk grid with skirt */
+    topology::base<vertex::std> Topo(prim_type::TRIMESH);
+    INT N = ChunkCells, W = N + 1;
+    std::vector<INT> Border;
+
+    for (INT i = 0; i <= N; i++)
+      for (INT j = 0; j <= N; j++)
+        Topo.Vertex << vertex::std(vec3((FLT)j / N, 0, (FLT)i / N), vec2((FLT)j / N, (FLT)i / N), vec3(0, 1, 0), vec4(1));
+    for (INT i = 0; i < N; i++)
+      for (INT j = 0; j < N; j++)
+      {
+        INT v = i * W + j;
+
+        Topo.Index << v << v + W << v + 1;
+        Topo.Index << v + 1 << v + W << v + W + 1;
+      }
+    for (INT k = 0; k < N; k++)
+      Border.push_back(k);
+    for (INT k = 0; k < N; k++)
+      Border.push_back(k * W + N);
+    for (INT k = N; k > 0; k--)
+      Border.push_back(N * W + k);
+    for (INT k = N; k > 0; k--)
+      Border.push_back(k * W);
+    for (INT b : Border)
+    {
+      vertex::std V = Topo.Vertex[b];
+
+      V.P[1] = 1;
+      Topo.Vertex << V;
+    }
+    for (size_t k = 0, s = (size_t)W * W; k < Border.size(); k++)
+    {
+      INT
+        a = Border[k], b = Border[(k + 1) % Border.size()],
+        sa = (INT)(s + k), sb = (INT)(s + (k + 1) % Border.size());
+
+      Topo.Index << a << b << sb;
+      Topo.Index << a << sb << sa;
+    }
+    meshopt::Optimize(Topo, "terrain chunk");
+    Chunk = AC->PrimCreate(Topo);
+    Chunk->SetMaterial(Mtl);
+
+    /* Quadtree */
+    Nodes.clear();
+    Build(0, 0, 1, MaxDepth);
+    parallel::For(Nodes.size(),
+      [this]( size_t Begin, size_t End, INT )
+      {
+        for (size_t i = Begin; i < End; i++)
+          Evaluate(Nodes[i]);
+      });
+    /* Children are built after parent, so reverse pass makes error monotonic */
+    for (size_t i = Nodes.size(); i-- > 0; )
+      for (INT c : Nodes[i].Children)
+        if (c >= 0)
+          Nodes[i].Error = mth::Max(Nodes[i].Error, Nodes[c].Error);
+
+    CHAR Buf[200];
+
+    sprintf(Buf, "Terrain: %dx%d height map, %d nodes, depth %d, root error %f\n",
+            Field->W, Field->H, (INT)Nodes.size(), MaxDepth, Nodes[0].Error);
+    OutputDebugString(Buf);
+  } /* End of 'terrain::Init' function */
+
+  /* Build quadtree node function.
+   * ARGUMENTS:
+   *   - node height map coordinates:
+   *       FLT U, V, NodeSize;
+   *   - remaining depth:
+   *       INT Depth;
+   * RETURNS:
+   *   (INT) node index.
+   */
+  INT terrain::Build( FLT U, FLT V, FLT NodeSize, INT Depth )
+  {
+    INT Index = (INT)Nodes.size();
+    node N {};
+
+    N.U = U;
+    N.V = V;
+    N.Size = NodeSize;
+    N.Children[0] = N.Children[1] = N.Children[2] = N.Children[3] = -1;
+    Nodes.push_back(N);
+    if (Depth > 0)
+      for (INT c = 0; c < 4; c++)
+      {
+        INT Child = Build(U + (c & 1) * NodeSize / 2, V + (c >> 1) * NodeSize / 2, NodeSize / 2, Depth - 1);
+
+        Nodes[Index].Children[c] = Child;
+      }
+    return Index;
+  } /* End of 'terrain::Build' function */
+
+  /* Evaluate node bounds and error function.
+   * Error is maximal deviation of height map texels inside node from
+   * node grid (bilinear interpolation of grid vertex heights).
+   * ARGUMENTS:
+   *   - node to evaluate:
+   *       node &N;
+   * RETURNS: None.
+   */
+  VOID terrain::Evaluate( node &N ) const
+  {
+    INT W = ChunkCells + 1;
+    std::vector<FLT> Grid((size_t)W * W);
+    FLT Lo = Field->Height, Hi = 0, Dev = 0, Step = N.Size / ChunkCells;
+
+    for (INT i = 0; i < W; i++)
+      for (INT j = 0; j < W; j++)
+      {
+        FLT h = Field->Sample(N.U + i * Step, N.V + j * Step);
+
+        Grid[j * W + i] = h;
+        Lo = mth::Min(Lo, h);
+        Hi = mth::Max(Hi, h);
+      }
+    if (Field->W > 0)
+    {
+      INT
+        W1 = Field->W, H1 = Field->H,
+        x0 = (INT)ceil(N.U * W1 - 0.5f),
+        x1 = (INT)floor((N.U + N.Size) * W1 - 0.5f),
+        y0 = (INT)ceil(N.V * H1 - 0.5f),
+        y1 = (INT)floor((N.V + N.Size) * H1 - 0.5f);
+
+      for (INT y = mth::Max(y0, 0); y <= y1 && y < H1; y++)
+        for (INT x = mth::Max(x0, 0); x <= x1 && x < W1; x++)
+        {
+          FLT
+            h = Field->Heights[y * W1 + x],
+            gx = ((x + 0.5f) / W1 - N.U) / Step,
+            gy = ((y + 0.5f) / H1 - N.V) / Step;
+          INT
+            i = mth::Min((INT)gx, ChunkCells - 1),
+            j = mth::Min((INT)gy, ChunkCells - 1);
+          FLT
+            sx = gx - i,
+            sy = gy - j,
+            g = (Grid[j * W + i] * (1 - sx) + Grid[j * W + i + 1] * sx) * (1 - sy) +
+                (Grid[(j + 1) * W + i] * (1 - sx) + Grid[(j + 1) * W + i + 1] * sx) * sy;
+
+          Dev = mth::Max(Dev, fabs(h - g));
+          Lo = mth::Min(Lo, h);
+          Hi = mth::Max(Hi, h);
+        }
+    }
+    /* Height map U runs along world Z, V along world X */
+    N.Min = Field->Origin + vec3(N.V * Field->Size, Lo, N.U * Field->Size);
+    N.Max = Field->Origin + vec3((N.V + N.Size) * Field->Size, Hi, (N.U + N.Size) * Field->Size);
+    N.Error = Dev + DetailError * Step * Field->Size;
+  } /* End of 'terrain::Evaluate' function */
+
+  /* Select and draw visible nodes function.
+   * ARGUMENTS:
+   *   - node index:
+   *       INT Index;
+   *   - view frustum planes (A, B, C, D of 'Ax + By + Cz + D >= 0' inner half space):
+   *       const FLT (*Planes)[4];
+   *   - pixels per world unit at unit distance:
+   *       FLT PixelScale;
+   *   - chunk uniform locations:
+   *       INT LocOrigin, LocSize, LocSkirt;
+   * RETURNS: None.
+   */
+  VOID terrain::DrawNode( INT Index, const FLT (*Planes)[4], FLT PixelScale, INT LocOrigin, INT LocSize, INT LocSkirt )
+  {
+    anim *AC = anim::GetPtr();
+    const node &N = Nodes[Index];
+
+    /* Frustum culling by box vertex farthest along plane normal */
+    for (INT p = 0; p < 6; p++)
+    {
+      FLT D = Planes[p][3];
+
+      for (INT k = 0; k < 3; k++)
+        D += Planes[p][k] * (Planes[p][k] >= 0 ? N.Max[k] : N.Min[k]);
+      if (D < 0)
+        return;
+    }
+
+    /* Distance to box */
+    vec3 Near = vec3::Max(N.Min, vec3::Min(N.Max, AC->Cam.Loc));
+    FLT Dist = !(Near - AC->Cam.Loc);
+
+    if (N.Children[0] >= 0 && (Dist <= AC->Cam.Near || N.Error * PixelScale / Dist > PixelError))
+    {
+      /* Refine front to back */
+      INT Order[4] = {N.Children[0], N.Children[1], N.Children[2], N.Children[3]};
+      FLT Dists[4];
+
+      for (INT c = 0; c < 4; c++)
+        Dists[c] = !((Nodes[Order[c]].Min + Nodes[Order[c]].Max) / 2 - AC->Cam.Loc);
+      for (INT c = 1; c < 4; c++)
+        for (INT k = c; k > 0 && Dists[k] < Dists[k - 1]; k--)
+        {
+          std::swap(Dists[k], Dists[k - 1]);
+          std::swap(Order[k], Order[k - 1]);
+        }
+      for (INT c = 0; c < 4; c++)
+        DrawNode(Order[c], Planes, PixelScale, LocOrigin, LocSize, LocSkirt);
+      return;
+    }
+
+    if (LocOrigin != -1)
+      glUniform2f(LocOrigin, N.U, N.V);
+    if (LocSize != -1)
+      glUniform1f(LocSize, N.Size);
+    if (LocSkirt != -1)
+      glUniform1f(LocSkirt, N.Error + Field->Size * N.Size / ChunkCells * 0.01f);
+    AC->Draw(*Chunk, matr::Identity());
+    NumOfDrawn++;
+  } /* End of 'terrain::DrawNode' function */
+
+  /* Draw terrain function.
+   * ARGUMENTS: None.
+   * RETURNS: None.
+   */
+  VOID terrain::Draw( VOID )
+  {
+    anim *AC = anim::GetPtr();
+
+    NumOfDrawn = 0;
+    if (Chunk == nullptr || Field == nullptr || Chunk->Material == nullptr || Chunk->Material->Shader == nullptr || Nodes.empty())
+      return;
+
+    INT ProgId = Chunk->Material->Shader->ProgId, loc;
+
+    glUseProgram(ProgId);
+    if ((loc = glGetUniformLocation(ProgId, "LandOrigin")) != -1)
+      glUniform3fv(loc, 1, Field->Origin);
+    if ((loc = glGetUniformLocation(ProgId, "LandSize")) != -1)
+      glUniform1f(loc, Field->Size);
+    if ((loc = glGetUniformLocation(ProgId, "LandHeight")) != -1)
+      glUniform1f(loc, Field->Height);
+
+    /* Frustum planes of row vector 'VP' matrix: clip W +- clip X, Y, Z */
+    FLT *M = AC->Cam.VP, Planes[6][4];
+
+    for (INT p = 0; p < 6; p++)
+    {
+      INT Axis = p / 2;
+      FLT Sign = p % 2 == 0 ? 1 : -1, Len;
+
+      for (INT k = 0; k < 4; k++)
+        Planes[p][k] = M[k * 4 + 3] + Sign * M[k * 4 + Axis];
+      Len = sqrt(Planes[p][0] * Planes[p][0] + Planes[p][1] * Planes[p][1] + Planes[p][2] * Planes[p][2]);
+      if (Len > 0)
+        for (INT k = 0; k < 4; k++)
+          Planes[p][k] /= Len;
+    }
+
+    DrawNode(0, Planes, mth::Min(AC->FrameW, AC->FrameH) * AC->Cam.Near / AC->Cam.ProjSize,
+             glGetUniformLocation(ProgId, "ChunkOrigin"),
+             glGetUniformLocation(ProgId, "ChunkSize"),
+             glGetUniformLocation(ProgId, "SkirtDepth"));
+  } /* End of 'terrain::Draw' function */
+} /* end of 'digl' namespace */
+
+/* END OF 'terrain.cpp' FILE */
@@ -0,0 +1,129 @@
+/***************************************************************
+ * Copyright (C) 2020
+ *    Computer Graphics Support Group of 30 Phys-Math Gymnasium
+ ***************************************************************/
+
+/* FILE NAME   : terrain.h
+ * PURPOSE     : Chunked level of detail terrain header file.
+ * PROGRAMMER  : Dmitriy Vlasov.
+ * LAST UPDATE : 19.10.2020
+ * NOTE        : Namespace 'digl'.
+ *
+ *   Height map square is split to quadtree of chunks. Every chunk is
+ *   drawn with one shared grid primitive (heights are fetched from
+ *   height map in vertex shader), so node level only changes grid
+ *   spacing. Node keeps bounding box and geometric error (maximal
+ *   height map deviation from its grid). Visible nodes are refined
+ *   while projected error exceeds allowed number of pixels. Cracks
+ *   between neighbour chunks of different levels are hidden by skirts
+ *   (grid border copy pushed down by node error).
+ *
+ *   Shader uniforms: 'LandOrigin' (vec3), 'LandSize', 'LandHeight',
+ *   'ChunkOrigin' (vec2, height map coordinates), 'ChunkSize',
+ *   'SkirtDepth'. Grid vertex position keeps chunk local coordinates
+ *   in X and Z and skirt flag in Y. Height map U runs along world Z,
+ *   V along world X.
+ *
+ * No part of this file may be changed without agreement of
+ * Computer Graphics Support Group of 30 Phys-Math Gymnasium.
+ */
+
+#ifndef __TERRAIN_H_
+#define __TERRAIN_H_
+
+/* Includes */
+#include "../def.h"
+#include "../ANIM/RENDER/prim.h"
+#include "heightfield.h"
+#include <string>
+#include <vector>
+
+/* Animation project namespace */
+namespace digl
+{
+  /* Chunked terrain representation class */
+  class terrain
+  {
+  private:
+    /* Quadtree node */
+    struct node
+    {
+      vec3 Min, Max;   // World space bounding box
+      FLT Error;       // Maximal height deviation of node grid
+      FLT U, V, Size;  // Height map coordinates of corner and size
+      INT Children[4]; // Child node indices (-1 for leaf)
+    }; /* End of 'node' struct */
+
+    std::vector<node> Nodes;           // Nodes (root is first)
+    const heightfield *Field = nullptr; // Height field
+    primitives::prim *Chunk = nullptr; // Shared chunk grid
+
+    /* Build quadtree node function.
+     * ARGUMENTS:
+     *   - node height map coordinates:
+     *       FLT U, V, NodeSize;
+     *   - remaining depth:
+     *       INT Depth;
+     * RETURNS:
+     *   (INT) node index.
+     */
+    INT Build( FLT U, FLT V, FLT NodeSize, INT Depth );
+
+    /* Evaluate node bounds and error function.
+     * ARGUMENTS:
+     *   - node to evaluate:
+     *       node &N;
+     * RETURNS: None.
+     */
+    VOID Evaluate( node &N ) const;
+
+    /* Select and draw visible nodes function.
+     * ARGUMENTS:
+     *   - node index:
+     *       INT Index;
+     *   - view frustum planes (A, B, C, D of 'Ax + By + Cz + D >= 0' inner half space):
+     *       const FLT (*Planes)[4];
+     *   - pixels per world unit at unit distance:
+     *       FLT PixelScale;
+     *   - chunk uniform locations:
+     *       INT LocOrigin, LocSize, LocSkirt;
+     * RETURNS: None.
+     */
+    VOID DrawNode( INT Index, const FLT (*Planes)[4], FLT PixelScale, INT LocOrigin, INT LocSize, INT LocSkirt );
+
+  public:
+    INT ChunkCells = 32;     // Number of grid cells along chunk side
+    FLT PixelError = 2;      // Allowed projected error in pixels
+    FLT DetailError = 0;     // Error per unit of cell size added for shader displaced surfaces
+    INT NumOfDrawn = 0;      // Number of chunks drawn last frame
+
+    /* Terrain constructor function.
+     * ARGUMENTS: None.
+     */
+    terrain( VOID )
+    {
+    } /* End of 'terrain' function */
+
+    /* Terrain initialization function.
+     * ARGUMENTS:
+     *   - material (shader with terrain uniforms and height field textures):
+     *       material *Mtl;
+     *   - height field:
+     *       const heightfield *InField;
+     *   - maximal quadtree depth (-1 to stop at height map resolution):
+     *       INT MaxDepth;
+     * RETURNS: None.
+     */
+    VOID Init( material *Mtl, const heightfield *InField, INT MaxDepth = -1 );
+
+    /* Draw terrain function.
+     * ARGUMENTS: None.
+     * RETURNS: None.
+     */
+    VOID Draw( VOID );
+  }; /* End of 'terrain' class */
+} /* end of 'digl' namespace */
+
+#endif /* __TERRAIN_H_ */
+
+/* END OF 'terrain.h' FILE */
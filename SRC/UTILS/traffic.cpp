@@ -0,0 +1,582 @@
+/***************************************************************
+ * Copyright (C) 2020
+ *    Computer Graphics Support Group of 30 Phys-Math Gymnasium
+ ***************************************************************/
+
+/* FILE NAME   : traffic.cpp
+ * PURPOSE     : Vehicle traffic simulation file.
+ * PROGRAMMER  : Dmitriy Vlasov.
+ * LAST UPDATE : 19.10.2020
+ * NOTE        : Namespace 'digl'.
+ *
+ * No part of this file may be changed without agreement of
+ * Computer Graphics Support Group of 30 Phys-Math Gymnasium.
+ */
+
+/* Includes */
+#include "parallel.h"
+#include "rng.h"
+#include "traffic.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+/* Animation project namespace */
+namespace digl
+{
+  /* Remove lane vehicles by predicate function.
+   * ARGUMENTS:
+   *   - lane:
+   *       lane &L;
+   *   - vehicle index predicate (TRUE to remove):
+   *       PredType Pred;
+   * RETURNS: None.
+   */
+  template<class PredType>
+    VOID traffic::Erase( lane &L, PredType Pred )
+    {
+      size_t n = 0;
+
+      for (size_t i = 0; i < L.Pos.size(); i++)
+        if (!Pred(i))
+        {
+          L.Pos[n] = L.Pos[i];
+          L.Speed[n] = L.Speed[i];
+          L.DesiredSpeed[n] = L.DesiredSpeed[i];
+          L.Accel[n] = L.Accel[i];
+          L.Change[n] = L.Change[i];
+          n++;
+        }
+      L.Pos.resize(n);
+      L.Speed.resize(n);
+      L.DesiredSpeed.resize(n);
+      L.Accel.resize(n);
+      L.Change.resize(n);
+    } /* End of 'traffic::Erase' function */
+
+  /* Insert sorted vehicles to lane function.
+   * ARGUMENTS:
+   *   - lane:
+   *       lane &L;
+   *   - vehicles to insert (sorted by position):
+   *       const lane &In;
+   * RETURNS: None.
+   */
+  VOID traffic::Merge( lane &L, const lane &In )
+  {
+    if (In.Pos.empty())
+      return;
+
+    lane R;
+    size_t
+      n = L.Pos.size() + In.Pos.size(),
+      i = 0, j = 0;
+
+    R.Pos.reserve(n);
+    R.Speed.reserve(n);
+    R.DesiredSpeed.reserve(n);
+    R.Accel.reserve(n);
+    R.Change.reserve(n);
+    while (i < L.Pos.size() || j < In.Pos.size())
+    {
+      const lane &S = j == In.Pos.size() || (i < L.Pos.size() && L.Pos[i] <= In.Pos[j]) ? L : In;
+      size_t &k = &S == &L ? i : j;
+
+      R.Pos.push_back(S.Pos[k]);
+      R.Speed.push_back(S.Speed[k]);
+      R.DesiredSpeed.push_back(S.DesiredSpeed[k]);
+      R.Accel.push_back(S.Accel[k]);
+      R.Change.push_back(0);
+      k++;
+    }
+    R.Stops = std::move(L.Stops);
+    L = std::move(R);
+  } /* End of 'traffic::Merge' function */
+
+  /* Apply nearest stop line ahead to leader gap function.
+   * Stop line is stationary leader of zero length for vehicles behind it.
+   * ARGUMENTS:
+   *   - lane:
+   *       const lane &L;
+   *   - vehicle front bumper position and speed:
+   *       FLT Pos, Speed;
+   *   - gap to leader and approach speed (replaced if stop line is closer):
+   *       FLT &Gap, &DeltaSpeed;
+   * RETURNS: None.
+   */
+  VOID traffic::StopLine( const lane &L, FLT Pos, FLT Speed, FLT &Gap, FLT &DeltaSpeed )
+  {
+    if (L.Stops.empty())
+      return;
+
+    auto Stop = std::lower_bound(L.Stops.begin(), L.Stops.end(), Pos);
+
+    if (Stop != L.Stops.end() && *Stop - Pos < Gap)
+      Gap = *Stop - Pos, DeltaSpeed = Speed;
+  } /* End of 'traffic::StopLine' function */
+
+  /* Add straight road function.
+   * ARGUMENTS:
+   *   - start and end of first lane:
+   *       const vec3 &Start, &End;
+   *   - number of lanes and lane width:
+   *       INT NumOfLanes;
+   *       FLT LaneWidth;
+   * RETURNS:
+   *   (INT) road index.
+   */
+  INT traffic::AddRoad( const vec3 &Start, const vec3 &End, INT NumOfLanes, FLT LaneWidth )
+  {
+    Roads.push_back({(INT)Lanes.size(), NumOfLanes, !(End - Start), FALSE, Start, (End - Start).Normalizing(), 0, LaneWidth});
+    Lanes.resize(Lanes.size() + NumOfLanes);
+    return (INT)Roads.size() - 1;
+  } /* End of 'traffic::AddRoad' function */
+
+  /* Add ring road function.
+   * ARGUMENTS:
+   *   - ring center and first lane radius:
+   *       const vec3 &Center;
+   *       FLT Radius;
+   *   - number of lanes and lane width:
+   *       INT NumOfLanes;
+   *       FLT LaneWidth;
+   * RETURNS:
+   *   (INT) road index.
+   */
+  INT traffic::AddRing( const vec3 &Center, FLT Radius, INT NumOfLanes, FLT LaneWidth )
+  {
+    Roads.push_back({(INT)Lanes.size(), NumOfLanes, 2 * (FLT)PI * Radius, TRUE, Center, vec3(0), Radius, LaneWidth});
+    Lanes.resize(Lanes.size() + NumOfLanes);
+    return (INT)Roads.size() - 1;
+  } /* End of 'traffic::AddRing' function */
+
+  /* Add vehicle function.
+   * ARGUMENTS:
+   *   - road and its lane number:
+   *       INT Road, Lane;
+   *   - position along lane, speed and desired speed:
+   *       FLT Pos, Speed, DesiredSpeed;
+   * RETURNS: None.
+   */
+  VOID traffic::AddVehicle( INT Road, INT Lane, FLT Pos, FLT Speed, FLT DesiredSpeed )
+  {
+    lane In;
+
+    In.Pos.push_back(Pos);
+    In.Speed.push_back(Speed);
+    In.DesiredSpeed.push_back(DesiredSpeed);
+    In.Accel.push_back(0);
+    In.Change.push_back(0);
+    Merge(Lanes[Roads[Road].FirstLane + Lane], In);
+  } /* End of 'traffic::AddVehicle' function */
+
+  /* Fill road with vehicles function.
+   * ARGUMENTS:
+   *   - road:
+   *       INT Road;
+   *   - vehicles per lane:
+   *       INT Count;
+   *   - desired speed range:
+   *       FLT MinSpeed, MaxSpeed;
+   *   - random seed:
+   *       UINT64 Seed;
+   * RETURNS: None.
+   */
+  VOID traffic::Fill( INT Road, INT Count, FLT MinSpeed, FLT MaxSpeed, UINT64 Seed )
+  {
+    const road &R = Roads[Road];
+    rng Rnd(Seed, Road);
+
+    for (INT l = 0; l < R.NumOfLanes; l++)
+    {
+      lane &L = Lanes[R.FirstLane + l];
+      FLT Step = GetLaneLength(R, l) / mth::Max(Count, 1);
+
+      /* Evenly spaced with jitter - stays sorted */
+      for (INT i = 0; i < Count; i++)
+      {
+        FLT v0 = MinSpeed + (MaxSpeed - MinSpeed) * Rnd.Rnd0();
+
+        L.Pos.push_back(Step * (i + 0.5f + 0.25f * Rnd.Rnd1()));
+        L.Speed.push_back(v0 * 0.5f);
+        L.DesiredSpeed.push_back(v0);
+        L.Accel.push_back(0);
+        L.Change.push_back(0);
+      }
+    }
+  } /* End of 'traffic::Fill' function */
+
+  /* Get number of vehicles function.
+   * ARGUMENTS: None.
+   * RETURNS:
+   *   (size_t) number of vehicles.
+   */
+  size_t traffic::GetNumOfVehicles( VOID ) const
+  {
+    size_t n = 0;
+
+    for (auto &L : Lanes)
+      n += L.Pos.size();
+    return n;
+  } /* End of 'traffic::GetNumOfVehicles' function */
+
+  /* Simulation step function.
+   * ARGUMENTS:
+   *   - delta time:
+   *       FLT DeltaTime;
+   * RETURNS: None.
+   */
+  VOID traffic::Step( FLT DeltaTime )
+  {
+    /* Lane of road */
+    std::vector<INT> LaneRoad(Lanes.size());
+
+    for (INT r = 0; r < (INT)Roads.size(); r++)
+      for (INT l = 0; l < Roads[r].NumOfLanes; l++)
+        LaneRoad[Roads[r].FirstLane + l] = r;
+
+    /* IDM accelerations (leader is next vehicle in lane) */
+    parallel::For(Lanes.size(),
+      [&]( size_t Begin, size_t End, INT )
+      {
+        for (size_t k = Begin; k < End; k++)
+        {
+          lane &L = Lanes[k];
+          const road &R = Roads[LaneRoad[k]];
+          size_t n = L.Pos.size();
+          FLT Length = GetLaneLength(R, (INT)k - R.FirstLane);
+
+          for (size_t i = 0; i < n; i++)
+          {
+            FLT Gap = NoLeader, DeltaSpeed = 0;
+
+            if (i + 1 < n)
+              Gap = L.Pos[i + 1] - L.Pos[i] - Driver.Length, DeltaSpeed = L.Speed[i] - L.Speed[i + 1];
+            else if (R.IsRing)
+              Gap = L.Pos[0] + Length - L.Pos[i] - Driver.Length, DeltaSpeed = L.Speed[i] - L.Speed[0];
+            StopLine(L, L.Pos[i], L.Speed[i], Gap, DeltaSpeed);
+            L.Accel[i] = Idm(L.Speed[i], L.DesiredSpeed[i], Gap, DeltaSpeed);
+          }
+        }
+      }, MinBlock);
+
+    /* MOBIL lane change decisions, one side per step */
+    INT Side = StepCount & 1 ? 1 : -1;
+
+    parallel::For(Lanes.size(),
+      [&]( size_t Begin, size_t End, INT )
+      {
+        for (size_t k = Begin; k < End; k++)
+        {
+          lane &L = Lanes[k];
+          const road &R = Roads[LaneRoad[k]];
+          INT Target = (INT)k - R.FirstLane + Side;
+          size_t n = L.Pos.size();
+
+          std::fill(L.Change.begin(), L.Change.end(), 0);
+          if (Target < 0 || Target >= R.NumOfLanes)
+            continue;
+
+          const lane &T = Lanes[R.FirstLane + Target];
+          size_t m = T.Pos.size();
+          FLT
+            Length = GetLaneLength(R, (INT)k - R.FirstLane),
+            TargetLength = GetLaneLength(R, Target),
+            Scale = TargetLength / Length;
+
+          for (size_t i = 0; i < n; i++)
+          {
+            /* Position in target lane at same ring angle */
+            FLT
+              x = L.Pos[i] * Scale, v = L.Speed[i],
+              GainNew = 0, GainOld = 0, MyAccel;
+
+            /* Target lane neighbours */
+            size_t j = std::lower_bound(T.Pos.begin(), T.Pos.end(), x) - T.Pos.begin();
+
+            if (m > 0 && (j < m || R.IsRing))
+            {
+              size_t Lead = j < m ? j : 0;
+              FLT
+                Gap = T.Pos[Lead] + (j < m ? 0 : TargetLength) - x - Driver.Length,
+                DeltaSpeed = v - T.Speed[Lead];
+
+              if (Gap < Driver.MinGap)
+                continue;
+              StopLine(T, x, v, Gap, DeltaSpeed);
+              MyAccel = Idm(v, L.DesiredSpeed[i], Gap, DeltaSpeed);
+            }
+            else
+            {
+              FLT Gap = NoLeader, DeltaSpeed = 0;
+
+              StopLine(T, x, v, Gap, DeltaSpeed);
+              MyAccel = Idm(v, L.DesiredSpeed[i], Gap, DeltaSpeed);
+            }
+            if (m > 0 && (j > 0 || R.IsRing))
+            {
+              size_t Follow = j > 0 ? j - 1 : m - 1;
+              FLT
+                vf = T.Speed[Follow],
+                Gap = x - T.Pos[Follow] + (j > 0 ? 0 : TargetLength) - Driver.Length,
+                NewAccel;
+
+              if (Gap < Driver.MinGap)
+                continue;
+              NewAccel = Idm(vf, T.DesiredSpeed[Follow], Gap, vf - v);
+              if (NewAccel < -Driver.SafeDecel)
+                continue;
+              GainNew = NewAccel - T.Accel[Follow];
+            }
+
+            /* Old follower gets my leader */
+            if (n > 1 && (i > 0 || R.IsRing))
+            {
+              size_t
+                Follow = i > 0 ? i - 1 : n - 1,
+                Lead = i + 1 < n ? i + 1 : 0;
+              FLT Gap = NoLeader, DeltaSpeed = 0, vf = L.Speed[Follow];
+
+              if (Lead == Follow)
+                Gap = Length - Driver.Length;
+              else if (i + 1 < n || R.IsRing)
+                Gap = L.Pos[Lead] - L.Pos[Follow] + (Lead > Follow ? 0 : Length) - Driver.Length,
+                DeltaSpeed = vf - L.Speed[Lead];
+              StopLine(L, L.Pos[Follow], vf, Gap, DeltaSpeed);
+              GainOld = Idm(vf, L.DesiredSpeed[Follow], Gap, DeltaSpeed) - L.Accel[Follow];
+            }
+
+            if (MyAccel - L.Accel[i] + Driver.Politeness * (GainNew + GainOld) > Driver.Threshold)
+              L.Change[i] = (CHAR)Side;
+          }
+        }
+      }, MinBlock);
+
+    /* Moves between lanes (all to same side, so lanes of road are independent pairs) */
+    parallel::For(Roads.size(),
+      [&]( size_t Begin, size_t End, INT )
+      {
+        for (size_t r = Begin; r < End; r++)
+        {
+          const road &R = Roads[r];
+          std::vector<lane> Moved(R.NumOfLanes);
+
+          for (INT l = 0; l < R.NumOfLanes; l++)
+          {
+            lane &L = Lanes[R.FirstLane + l], &M = Moved[l];
+            FLT Scale = 0;
+
+            if (l + Side >= 0 && l + Side < R.NumOfLanes)
+              Scale = GetLaneLength(R, l + Side) / GetLaneLength(R, l);
+            for (size_t i = 0; i < L.Pos.size(); i++)
+              if (L.Change[i] != 0)
+              {
+                M.Pos.push_back(L.Pos[i] * Scale);
+                M.Speed.push_back(L.Speed[i]);
+                M.DesiredSpeed.push_back(L.DesiredSpeed[i]);
+                M.Accel.push_back(L.Accel[i]);
+                M.Change.push_back(0);
+              }
+            if (!M.Pos.empty())
+              Erase(L, [&]( size_t i ){ return L.Change[i] != 0; });
+          }
+          for (INT l = 0; l < R.NumOfLanes; l++)
+            if (!Moved[l].Pos.empty())
+              Merge(Lanes[R.FirstLane + l + Side], Moved[l]);
+        }
+      }, MinBlock);
+
+    /* Ballistic integration (stopped vehicles do not roll back) */
+    parallel::For(Lanes.size(),
+      [&]( size_t Begin, size_t End, INT )
+      {
+        for (size_t k = Begin; k < End; k++)
+        {
+          lane &L = Lanes[k];
+          const road &R = Roads[LaneRoad[k]];
+          size_t n = L.Pos.size();
+          FLT Length = GetLaneLength(R, (INT)k - R.FirstLane);
+
+          for (size_t i = 0; i < n; i++)
+          {
+            FLT v = L.Speed[i], a = L.Accel[i], v1 = v + a * DeltaTime;
+
+            if (v1 < 0)
+            {
+              L.Pos[i] -= v * v / (2 * a);
+              L.Speed[i] = 0;
+            }
+            else
+            {
+              L.Pos[i] += (v + v1) * 0.5f * DeltaTime;
+              L.Speed[i] = v1;
+            }
+          }
+
+          /* Vehicles passed lane end */
+          size_t Tail = n;
+
+          while (Tail > 0 && L.Pos[Tail - 1] >= Length)
+            Tail--;
+          if (!R.IsRing)
+          {
+            Erase(L, [&]( size_t i ){ return i >= Tail; });
+            n = Tail;
+          }
+          else if (Tail < n)
+          {
+            for (size_t i = Tail; i < n; i++)
+              L.Pos[i] -= Length;
+            std::rotate(L.Pos.begin(), L.Pos.begin() + Tail, L.Pos.end());
+            std::rotate(L.Speed.begin(), L.Speed.begin() + Tail, L.Speed.end());
+            std::rotate(L.DesiredSpeed.begin(), L.DesiredSpeed.begin() + Tail, L.DesiredSpeed.end());
+            std::rotate(L.Accel.begin(), L.Accel.begin() + Tail, L.Accel.end());
+          }
+
+          /* Order fix for rare overtakes (large steps) */
+          for (size_t i = 1; i < n; i++)
+            for (size_t j = i; j > 0 && L.Pos[j - 1] > L.Pos[j]; j--)
+            {
+              std::swap(L.Pos[j - 1], L.Pos[j]);
+              std::swap(L.Speed[j - 1], L.Speed[j]);
+              std::swap(L.DesiredSpeed[j - 1], L.DesiredSpeed[j]);
+              std::swap(L.Accel[j - 1], L.Accel[j]);
+            }
+        }
+      }, MinBlock);
+    StepCount++;
+  } /* End of 'traffic::Step' function */
+
+  /* Get vehicle instances function (parallel by lanes).
+   * ARGUMENTS:
+   *   - vehicle model transformation:
+   *       const matr &Model;
+   *   - instances to fill (parameters are speed, desired speed, acceleration and lane number):
+   *       std::vector<primitives::instance> &Instances;
+   * RETURNS: None.
+   */
+  VOID traffic::GetInstances( const matr &Model, std::vector<primitives::instance> &Instances ) const
+  {
+    std::vector<size_t> Start(Lanes.size() + 1, 0);
+    std::vector<INT> LaneRoad(Lanes.size());
+
+    for (INT r = 0; r < (INT)Roads.size(); r++)
+      for (INT l = 0; l < Roads[r].NumOfLanes; l++)
+        LaneRoad[Roads[r].FirstLane + l] = r;
+    for (size_t k = 0; k < Lanes.size(); k++)
+      Start[k + 1] = Start[k] + Lanes[k].Pos.size();
+    Instances.resize(Start.back());
+
+    parallel::For(Lanes.size(),
+      [&]( size_t Begin, size_t End, INT )
+      {
+        vec3 Up(0, 1, 0);
+
+        for (size_t k = Begin; k < End; k++)
+        {
+          const lane &L = Lanes[k];
+          const road &R = Roads[LaneRoad[k]];
+          INT l = (INT)k - R.FirstLane;
+          primitives::instance *Out = &Instances[Start[k]];
+          vec3 Side = R.Dir % Up;
+          FLT Radius = R.Radius + l * R.LaneWidth;
+
+          for (size_t i = 0; i < L.Pos.size(); i++)
+          {
+            FLT s = L.Pos[i] - Driver.Length * 0.5f;
+            vec3 P, F;
+
+            if (R.IsRing)
+            {
+              FLT a = s / Radius;
+
+              P = R.Org + vec3(cos(a) * Radius, 0, sin(a) * Radius);
+              F = vec3(-sin(a), 0, cos(a));
+            }
+            else
+            {
+              P = R.Org + R.Dir * s + Side * (l * R.LaneWidth);
+              F = R.Dir;
+            }
+            Out[i].World = Model * matr::Basis(F % Up, Up, F) * matr::Translate(P);
+            Out[i].Params = vec4(L.Speed[i], L.DesiredSpeed[i], L.Accel[i], (FLT)l);
+          }
+        }
+      }, MinBlock);
+  } /* End of 'traffic::GetInstances' function */
+
+  /* Headless benchmark function (ring roads, 3 lanes, 60 Hz steps, stop line road).
+   * ARGUMENTS:
+   *   - number of vehicles and steps:
+   *       INT NumOfVehicles, NumOfSteps;
+   * RETURNS:
+   *   (BOOL) TRUE if lanes are consistent and no vehicle ran stop line after all steps.
+   */
+  BOOL traffic::Benchmark( INT NumOfVehicles, INT NumOfSteps )
+  {
+    const INT NumOfLanes = 3, PerLane = 125;
+    traffic T;
+    std::vector<primitives::instance> Instances;
+    INT
+      PerRing = NumOfLanes * PerLane,
+      NumOfRings = (NumOfVehicles + PerRing - 1) / PerRing;
+
+    /* 500 m radius rings: 25 m per vehicle in lane */
+    for (INT r = 0; r < NumOfRings; r++)
+    {
+      INT Road = T.AddRing(vec3(r % 16 * 1100.f, 0, r / 16 * 1100.f), 500, NumOfLanes);
+
+      T.Fill(Road, PerLane, 20, 35, 30);
+    }
+
+    /* Straight road queue of fast vehicles close behind stop line at its middle */
+    const FLT StopPos = 500;
+    INT StopRoad = T.AddRoad(vec3(0, 0, -1100), vec3(1000, 0, -1100), 2);
+
+    for (INT l = 0; l < 2; l++)
+    {
+      T.Lanes[T.Roads[StopRoad].FirstLane + l].Stops.push_back(StopPos);
+      for (INT i = 0; i < 20; i++)
+        T.AddVehicle(StopRoad, l, StopPos - 5 - i * 15.f, 30, 35);
+    }
+
+    size_t NumOfStart = T.GetNumOfVehicles();
+    LARGE_INTEGER t0, t1, Freq;
+    DBL Time;
+
+    QueryPerformanceFrequency(&Freq);
+    QueryPerformanceCounter(&t0);
+    for (INT s = 0; s < NumOfSteps; s++)
+    {
+      T.Step(1.0f / 60);
+      T.GetInstances(matr::Identity(), Instances);
+    }
+    QueryPerformanceCounter(&t1);
+    Time = (DBL)(t1.QuadPart - t0.QuadPart) * 1000 / Freq.QuadPart / mth::Max(NumOfSteps, 1);
+
+    /* All vehicles stay sorted inside own lane length, stop line queue stays behind it */
+    INT Errors = T.GetNumOfVehicles() != NumOfStart;
+
+    for (const road &R : T.Roads)
+      for (INT l = 0; l < R.NumOfLanes; l++)
+      {
+        const lane &L = T.Lanes[R.FirstLane + l];
+        FLT Length = GetLaneLength(R, l);
+
+        for (size_t i = 0; i < L.Pos.size(); i++)
+          Errors += L.Pos[i] < 0 || L.Pos[i] >= Length || L.Speed[i] < 0 || (i > 0 && L.Pos[i - 1] > L.Pos[i]) ||
+            (!L.Stops.empty() && L.Pos[i] > L.Stops[0]);
+      }
+
+    CHAR Buf[200];
+
+    sprintf(Buf, "Traffic: %i vehicles, %i steps, %.3f ms per step, %i errors\n",
+      (INT)NumOfStart, NumOfSteps, Time, Errors);
+    OutputDebugString(Buf);
+    printf("%s", Buf);
+    return Errors == 0;
+  } /* End of 'traffic::Benchmark' function */
+} /* end of 'digl' namespace */
+
+/* END OF 'traffic.cpp' FILE */
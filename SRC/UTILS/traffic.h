@@ -0,0 +1,223 @@
+/***************************************************************
+ * Copyright (C) 2020
+ *    Computer Graphics Support Group of 30 Phys-Math Gymnasium
+ ***************************************************************/
+
+/* FILE NAME   : traffic.h
+ * PURPOSE     : Vehicle traffic simulation header file.
+ * PROGRAMMER  : Dmitriy Vlasov.
+ * LAST UPDATE : 19.10.2020
+ * NOTE        : Namespace 'digl'.
+ *
+ *   Vehicles are kept per lane in arrays sorted by lane position, so
+ *   leader of vehicle is next one in its lane. Step: accelerations by
+ *   Intelligent Driver Model (parallel by lanes), lane change decisions
+ *   by MOBIL (parallel by lanes, to the left on even steps and to the
+ *   right on odd ones, so two vehicles never merge into one gap from
+ *   both sides), moves between lanes (parallel by roads) and ballistic
+ *   integration (parallel by lanes). Ring lanes have own radius and
+ *   length, vehicle changing ring lane keeps its angle.
+ *
+ * No part of this file may be changed without agreement of
+ * Computer Graphics Support Group of 30 Phys-Math Gymnasium.
+ */
+
+#ifndef __TRAFFIC_H_
+#define __TRAFFIC_H_
+
+#include "../def.h"
+#include "../ANIM/RENDER/prim.h"
+
+#include <vector>
+
+/* Animation project namespace */
+namespace digl
+{
+  /* Vehicle traffic representation type */
+  class traffic
+  {
+  public:
+    /* Minimal number of lanes in one thread block */
+    static const size_t MinBlock = 16;
+
+    /* Gap to leader of vehicle with free road ahead */
+    static constexpr FLT NoLeader = 1e9f;
+
+    /* Driver model parameters */
+    struct driver
+    {
+      FLT
+        MaxAccel = 1.5f,       // IDM maximal acceleration
+        ComfortDecel = 2,      // IDM comfortable deceleration
+        TimeGap = 1.2f,        // IDM safe time headway
+        MinGap = 2,            // IDM minimal bumper to bumper gap
+        Length = 4.5f,         // Vehicle length
+        Politeness = 0.3f,     // MOBIL politeness factor
+        Threshold = 0.2f,      // MOBIL lane change acceleration gain threshold
+        SafeDecel = 4;         // MOBIL maximal deceleration forced on new follower
+    } Driver;
+
+    /* Lane vehicles (sorted by position) */
+    struct lane
+    {
+      std::vector<FLT>
+        Pos,                   // Front bumper position along lane
+        Speed,                 // Speed
+        DesiredSpeed,          // IDM desired speed
+        Accel;                 // Acceleration of current step
+      std::vector<CHAR> Change; // Lane change decision of current step (-1, 0, 1)
+      std::vector<FLT> Stops;   // Stop lines (sorted, vehicle behind one sees it as stationary leader)
+    }; /* End of 'lane' struct */
+
+    /* Road: parallel lanes of same length */
+    struct road
+    {
+      INT FirstLane, NumOfLanes; // Road lanes in 'Lanes'
+      FLT Length;                // Lane length (first lane one for ring)
+      BOOL IsRing;               // Closed road (vehicles leaving end enter start)
+      vec3 Org, Dir;             // Straight road start and unit direction (ring center for ring)
+      FLT Radius;                // Ring radius of first lane
+      FLT LaneWidth;             // Lane width
+    }; /* End of 'road' struct */
+
+    std::vector<road> Roads;
+    std::vector<lane> Lanes;
+    INT StepCount = 0;
+
+  private:
+    /* Remove lane vehicles by predicate function */
+    template<class PredType>
+      static VOID Erase( lane &L, PredType Pred );
+
+    /* Insert sorted vehicles to lane function */
+    static VOID Merge( lane &L, const lane &In );
+
+    /* Apply nearest stop line ahead to leader gap function */
+    static VOID StopLine( const lane &L, FLT Pos, FLT Speed, FLT &Gap, FLT &DeltaSpeed );
+
+  public:
+    /* IDM acceleration function.
+     * ARGUMENTS:
+     *   - speed and desired speed:
+     *       FLT Speed, DesiredSpeed;
+     *   - gap to leader (bumper to bumper, 'NoLeader' for none) and approach speed:
+     *       FLT Gap, DeltaSpeed;
+     * RETURNS:
+     *   (FLT) acceleration.
+     */
+    FLT Idm( FLT Speed, FLT DesiredSpeed, FLT Gap, FLT DeltaSpeed ) const
+    {
+      FLT
+        r = Speed / DesiredSpeed,
+        r2 = r * r,
+        Free = 1 - r2 * r2,
+        Want = Driver.MinGap + mth::Max(0.f, Speed * Driver.TimeGap +
+          Speed * DeltaSpeed / (2 * sqrt(Driver.MaxAccel * Driver.ComfortDecel))),
+        s = Want / mth::Max(Gap, 0.1f);
+
+      return Driver.MaxAccel * (Free - s * s);
+    } /* End of 'Idm' function */
+
+    /* Get lane length function.
+     * ARGUMENTS:
+     *   - road and its lane number:
+     *       const road &R;
+     *       INT Lane;
+     * RETURNS:
+     *   (FLT) lane length.
+     */
+    static FLT GetLaneLength( const road &R, INT Lane )
+    {
+      return R.IsRing ? 2 * (FLT)PI * (R.Radius + Lane * R.LaneWidth) : R.Length;
+    } /* End of 'GetLaneLength' function */
+
+    /* Add straight road function.
+     * ARGUMENTS:
+     *   - start and end of first lane:
+     *       const vec3 &Start, &End;
+     *   - number of lanes and lane width:
+     *       INT NumOfLanes;
+     *       FLT LaneWidth;
+     * RETURNS:
+     *   (INT) road index.
+     */
+    INT AddRoad( const vec3 &Start, const vec3 &End, INT NumOfLanes, FLT LaneWidth = 3.5f );
+
+    /* Add ring road function.
+     * ARGUMENTS:
+     *   - ring center and first lane radius:
+     *       const vec3 &Center;
+     *       FLT Radius;
+     *   - number of lanes and lane width:
+     *       INT NumOfLanes;
+     *       FLT LaneWidth;
+     * RETURNS:
+     *   (INT) road index.
+     */
+    INT AddRing( const vec3 &Center, FLT Radius, INT NumOfLanes, FLT LaneWidth = 3.5f );
+
+    /* Add vehicle function.
+     * ARGUMENTS:
+     *   - road and its lane number:
+     *       INT Road, Lane;
+     *   - position along lane, speed and desired speed:
+     *       FLT Pos, Speed, DesiredSpeed;
+     * RETURNS: None.
+     */
+    VOID AddVehicle( INT Road, INT Lane, FLT Pos, FLT Speed, FLT DesiredSpeed );
+
+    /* Fill road with vehicles function.
+     * ARGUMENTS:
+     *   - road:
+     *       INT Road;
+     *   - vehicles per lane:
+     *       INT Count;
+     *   - desired speed range:
+     *       FLT MinSpeed, MaxSpeed;
+     *   - random seed:
+     *       UINT64 Seed;
+     * RETURNS: None.
+     */
+    VOID Fill( INT Road, INT Count, FLT MinSpeed, FLT MaxSpeed, UINT64 Seed = 0 );
+
+    /* Get number of vehicles function.
+     * ARGUMENTS: None.
+     * RETURNS:
+     *   (size_t) number of vehicles.
+     */
+    size_t GetNumOfVehicles( VOID ) const;
+
+    /* Simulation step function.
+     * ARGUMENTS:
+     *   - delta time:
+     *       FLT DeltaTime;
+     * RETURNS: None.
+     */
+    VOID Step( FLT DeltaTime );
+
+    /* Get vehicle instances function (parallel by lanes).
+     * ARGUMENTS:
+     *   - vehicle model transformation:
+     *       const matr &Model;
+     *   - instances to fill (parameters are speed, desired speed, acceleration and lane number):
+     *       std::vector<primitives::instance> &Instances;
+     * RETURNS: None.
+     */
+    VOID GetInstances( const matr &Model, std::vector<primitives::instance> &Instances ) const;
+
+    /* Headless benchmark function (ring roads, 3 lanes, 60 Hz steps).
+     * Lanes are checked to stay sorted and inside lane length with
+     * all vehicles kept and no negative speeds.
+     * ARGUMENTS:
+     *   - number of vehicles and steps:
+     *       INT NumOfVehicles, NumOfSteps;
+     * RETURNS:
+     *   (BOOL) TRUE if lanes are consistent after all steps.
+     */
+    static BOOL Benchmark( INT NumOfVehicles, INT NumOfSteps );
+  }; /* End of 'traffic' class */
+} /* end of 'digl' namespace */
+
+#endif /* __TRAFFIC_H_ */
+
+/* END OF 'traffic.h' FILE */
@@ -16,6 +16,15 @@
 /* Includes */
 #include "def.h"
 #include "anim\anim.h"
+#include "anim\render\resources\g3d2.h"
+#include "utils\traffic.h"
+#include "utils\road_graph.h"
+#include "utils\neighbour_grid.h"
+#include "utils\flock.h"
+#include "utils\radix.h"
+#include "utils\physics.h"
+#include "utils\broadphase.h"
+#include "utils\heightfield.h"
 
 /* Animation project namespace */
 using namespace digl;
@@ -36,16 +45,102 @@ using namespace digl;
 INT WINAPI WinMain( HINSTANCE hInstance, HINSTANCE hPrevInstance,
                     CHAR *CmdLine, INT ShowCmd )
 {
+  /* Model conversion mode: -convert <in.g3dm|in.obj> <out.g3d2> */
+  if (__argc == 4 && strcmp(__argv[1], "-convert") == 0)
+    return g3d2::Convert(__argv[2], __argv[3]) ? 0 : 1;
+
+  /* Headless traffic benchmark: -bench-traffic [vehicles] [steps] */
+  if (__argc >= 2 && strcmp(__argv[1], "-bench-traffic") == 0)
+    return traffic::Benchmark(__argc > 2 ? atoi(__argv[2]) : 100000, __argc > 3 ? atoi(__argv[3]) : 600) ? 0 : 1;
+
+  /* Headless routing benchmark: -bench-roads [side] [queries] [file] */
+  if (__argc >= 2 && strcmp(__argv[1], "-bench-roads") == 0)
+    return road_graph::Benchmark(__argc > 2 ? atoi(__argv[2]) : 500, __argc > 3 ? atoi(__argv[3]) : 10000,
+                                 __argc > 4 ? __argv[4] : "") ? 0 : 1;
+
+  /* Headless neighbour grid benchmark: -bench-grid [points] [queries] */
+  if (__argc >= 2 && strcmp(__argv[1], "-bench-grid") == 0)
+    return neighbour_grid::Benchmark(__argc > 2 ? atoi(__argv[2]) : 1000000, __argc > 3 ? atoi(__argv[3]) : 100000) ? 0 : 1;
+
+  /* Headless flocking benchmark: -bench-flock [birds] [steps] */
+  if (__argc >= 2 && strcmp(__argv[1], "-bench-flock") == 0)
+    return flock::Benchmark(__argc > 2 ? atoi(__argv[2]) : 100000, __argc > 3 ? atoi(__argv[3]) : 600) ? 0 : 1;
+
+  /* Headless particles benchmark: -bench-particles [particles] [steps] (10k, 100k and 1M particles by default) */
+  if (__argc >= 2 && strcmp(__argv[1], "-bench-particles") == 0)
+  {
+    INT NumOfSteps = __argc > 3 ? atoi(__argv[3]) : 600;
+
+    if (__argc > 2)
+      emitter::Benchmark(atoi(__argv[2]), NumOfSteps);
+    else
+      for (INT NumOfParticles : {10000, 100000, 1000000})
+        emitter::Benchmark(NumOfParticles, NumOfSteps);
+    return 0;
+  }
+
+  /* Headless radix sort check: -test-radix [items] */
+  if (__argc >= 2 && strcmp(__argv[1], "-test-radix") == 0)
+    return radix::Test(__argc > 2 ? atoi(__argv[2]) : 1000000) ? 0 : 1;
+
+  /* Headless kinematics benchmark: -bench-kinematics [bodies] [steps] */
+  if (__argc >= 2 && strcmp(__argv[1], "-bench-kinematics") == 0)
+    return kinematics_system::Benchmark(__argc > 2 ? atoi(__argv[2]) : 1000000, __argc > 3 ? atoi(__argv[3]) : 60) ? 0 : 1;
+
+  /* Headless lazy kinematics check: -test-lazy [steps] */
+  if (__argc >= 2 && strcmp(__argv[1], "-test-lazy") == 0)
+    return KinematicsLazyTest(__argc > 2 ? atoi(__argv[2]) : 600) ? 0 : 1;
+
+  /* Headless broad phase benchmark: -bench-broadphase [bodies] [steps] (1k, 10k and 100k bodies by default) */
+  if (__argc >= 2 && strcmp(__argv[1], "-bench-broadphase") == 0)
+  {
+    INT NumOfSteps = __argc > 3 ? atoi(__argv[3]) : 60;
+    BOOL IsOk = TRUE;
+
+    if (__argc > 2)
+      IsOk = broadphase::Benchmark(atoi(__argv[2]), NumOfSteps);
+    else
+      for (INT NumOfBodies : {1000, 10000, 100000})
+        IsOk = broadphase::Benchmark(NumOfBodies, NumOfSteps) && IsOk;
+    return IsOk ? 0 : 1;
+  }
+
+  /* Headless height field ray check: -test-heightfield [rays] */
+  if (__argc >= 2 && strcmp(__argv[1], "-test-heightfield") == 0)
+    return heightfield::Test(__argc > 2 ? atoi(__argv[2]) : 2000) ? 0 : 1;
+
+  /* Deterministic mode: -record <log> [seed] or -replay <log> */
+  anim &Ani = anim::Get();
+
+  if (__argc >= 3 && strcmp(__argv[1], "-record") == 0)
+  {
+    if (!Ani.Replay.Record(__argv[2], __argc > 3 ? _strtoui64(__argv[3], nullptr, 10) : 0, 1.0 / 60))
+      return 1;
+  }
+  else if (__argc >= 3 && strcmp(__argv[1], "-replay") == 0)
+  {
+    if (!Ani.Replay.Play(__argv[2]))
+      return 1;
+  }
+  if (Ani.Replay.IsActive())
+  {
+    Ani.FixedDeltaTime = Ani.Replay.DeltaTime;
+    srand((UINT)Ani.Replay.Seed);
+    Ani.EmittersSeed = Ani.Replay.Seed;
+  }
+
   digl::units::scene Scene;
 
   Scene << "Control";
   Scene << "Info";
   Scene << "Game";
   Scene << "Ground";
+  Scene << "Traffic";
   //Scene << "Uaz";
   
   //Scene << "Skybox";
-  anim::Get().SetScene(&Scene).Run();
+  Ani.SetScene(&Scene).Run();
+  return Ani.Replay.NumOfMismatches > 0 ? 2 : 0;
 } /* End of 'WinMain' function */
 
 /* END OF 'main.cpp' */